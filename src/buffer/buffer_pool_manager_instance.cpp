@@ -44,6 +44,14 @@ BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, uint32_t
 }
 
 BufferPoolManagerInstance::~BufferPoolManagerInstance() {
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    prefetch_stop_ = true;
+  }
+  prefetch_cv_.notify_one();
+  if (prefetch_thread_.joinable()) {
+    prefetch_thread_.join();
+  }
   delete[] pages_;
   delete replacer_;
 }
@@ -53,17 +61,19 @@ bool BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) {
   if (page_id == INVALID_PAGE_ID) {
     return false;
   }
-  std::lock_guard<std::mutex> lock(latch_);
+  std::unique_lock<std::mutex> lock(latch_);
+  // the frame of a page being prefetched holds no content to flush until its read is done
+  prefetch_read_cv_.wait(lock, [&] { return prefetch_reading_ != page_id; });
   auto iter = page_table_.find(page_id);
   if (iter == page_table_.end()) {
     return false;
   }
   frame_id_t flush_fid = iter->second;
   Page *page = pages_ + flush_fid;
-  // TODO(后续使用)
-  //   if (enable_logging && page->GetLSN() > log_manager_->GetPersistentLSN()) {
-  // log_manager_->Flush(true);
-  //   }
+  // WAL: the log records describing this page must reach the disk before the page does
+  if (enable_logging && log_manager_ != nullptr && page->GetLSN() > log_manager_->GetPersistentLSN()) {
+    log_manager_->Flush();
+  }
   disk_manager_->WritePage(page_id, page->data_);
   pages_[flush_fid].is_dirty_ = false;
   return true;
@@ -72,9 +82,14 @@ bool BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) {
 void BufferPoolManagerInstance::FlushAllPgsImp() {
   // You can do it!
   // 这在最后checkpoint会用到 设置为clean
+  std::lock_guard<std::mutex> lock(latch_);
   for (auto page_frame : page_table_) {
     page_id_t page_id = page_frame.first;
     frame_id_t frame_id = page_frame.second;
+    // a page being prefetched is still being read from the disk
+    if (page_id == prefetch_reading_) {
+      continue;
+    }
     disk_manager_->WritePage(page_id, pages_[frame_id].data_);
     pages_[frame_id].is_dirty_ = false;
   }
@@ -97,10 +112,9 @@ bool BufferPoolManagerInstance::FindReplacer(frame_id_t *frame_id) {
   // 2.2   flush log and page
   Page *page = &pages_[*frame_id];
   if (page->IsDirty()) {
-    // if (enable_logging && page->GetLSN() > log_manager_->GetPersistentLSN()) {
-    // TODO(后续使用)
-    //   log_manager_->Flush(true);
-    // }
+    if (enable_logging && log_manager_ != nullptr && page->GetLSN() > log_manager_->GetPersistentLSN()) {
+      log_manager_->Flush();
+    }
     char *data = pages_[*frame_id].data_;
     disk_manager_->WritePage(page->page_id_, data);
   }
@@ -161,7 +175,9 @@ Page *BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) {
   // 2.     If R is dirty, write it back to the disk.
   // 3.     Delete R from the page table and insert P.
   // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
-  std::lock_guard<std::mutex> lock(latch_);
+  std::unique_lock<std::mutex> lock(latch_);
+  // a page being prefetched is in the page table before its content is read in
+  prefetch_read_cv_.wait(lock, [&] { return prefetch_reading_ != page_id; });
   // 1.     Search the page table for the requested page (P).
   // 1.1    If P exists, pin it and return it immediately.
   auto iter = page_table_.find(page_id);
@@ -183,6 +199,8 @@ Page *BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) {
   // 3.     Delete R from the page table and insert P.
   page_table_[page_id] = replace_frame_id;  // 建立我们需要的页的映射关系到替换的frame_id
   // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
+  // Pages past the end of the file read back as zeroes rather than the victim's old content.
+  page->ResetMemory();
   disk_manager_->ReadPage(page_id, page->data_);
   page->is_dirty_ = false;
   page->page_id_ = page_id;
@@ -199,8 +217,9 @@ bool BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) {
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
   latch_.lock();
-  // 1. find this page
+  // 1. find this page, one that isn't in the buffer pool is free to go
   if (page_table_.find(page_id) == page_table_.end()) {
+    DeallocatePage(page_id);
     latch_.unlock();
     return true;
   }
@@ -251,13 +270,81 @@ bool BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) {
   return true;
 }
 
+void BufferPoolManagerInstance::PrefetchPgImp(page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(latch_);
+    if (page_table_.count(page_id) > 0 || prefetch_queue_.size() >= MAX_PREFETCH_QUEUE ||
+        prefetch_queued_.count(page_id) > 0) {
+      return;
+    }
+    prefetch_queue_.push_back(page_id);
+    prefetch_queued_.insert(page_id);
+    if (!prefetch_thread_.joinable()) {
+      prefetch_thread_ = std::thread(&BufferPoolManagerInstance::PrefetchLoop, this);
+    }
+  }
+  prefetch_cv_.notify_one();
+}
+
+void BufferPoolManagerInstance::PrefetchLoop() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (true) {
+    prefetch_cv_.wait(lock, [this] { return prefetch_stop_ || !prefetch_queue_.empty(); });
+    if (prefetch_stop_) {
+      return;
+    }
+    page_id_t page_id = prefetch_queue_.front();
+    prefetch_queue_.pop_front();
+    prefetch_queued_.erase(page_id);
+    // reserve a frame for the page and keep it pinned while it is read in, so it is neither evicted nor handed out
+    // half read; a page that cannot be read in because every frame is pinned is just not prefetched
+    frame_id_t frame_id;
+    if (page_table_.count(page_id) > 0 || !FindReplacer(&frame_id)) {
+      continue;
+    }
+    Page *page = &pages_[frame_id];
+    page_table_[page_id] = frame_id;
+    page->page_id_ = page_id;
+    page->pin_count_ = 1;
+    prefetch_reading_ = page_id;
+
+    lock.unlock();
+    page->ResetMemory();
+    disk_manager_->ReadPage(page_id, page->data_);
+    lock.lock();
+
+    // publish the page as an unpinned frame and wake up whoever asked for it in the meantime
+    page->is_dirty_ = false;
+    page->pin_count_ = 0;
+    replacer_->Unpin(frame_id);
+    prefetch_reading_ = INVALID_PAGE_ID;
+    prefetch_read_cv_.notify_all();
+  }
+}
+
 page_id_t BufferPoolManagerInstance::AllocatePage() {
+  if (!free_page_ids_.empty()) {
+    page_id_t page_id = *free_page_ids_.begin();
+    free_page_ids_.erase(free_page_ids_.begin());
+    return page_id;
+  }
   const page_id_t next_page_id = next_page_id_;
   next_page_id_ += num_instances_;
   ValidatePageId(next_page_id);
   return next_page_id;
 }
 
+void BufferPoolManagerInstance::DeallocatePage(page_id_t page_id) {
+  // a set, so that deleting a page twice doesn't hand it out twice; ids never allocated are ignored
+  if (page_id >= 0 && page_id < next_page_id_) {
+    ValidatePageId(page_id);
+    free_page_ids_.insert(page_id);
+  }
+}
+
 void BufferPoolManagerInstance::ValidatePageId(const page_id_t page_id) const {
   assert(page_id % num_instances_ == instance_index_);  // allocated pages mod back to this BPI
 }
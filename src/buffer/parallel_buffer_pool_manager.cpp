@@ -100,4 +100,10 @@ void ParallelBufferPoolManager::FlushAllPgsImp() {
   }
 }
 
+void ParallelBufferPoolManager::PrefetchPgImp(page_id_t page_id) {
+  if (page_id != INVALID_PAGE_ID) {
+    GetBufferPoolManager(page_id)->PrefetchPage(page_id);
+  }
+}
+
 }  // namespace bustub
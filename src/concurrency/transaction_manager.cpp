@@ -33,6 +33,11 @@ Transaction *TransactionManager::Begin(Transaction *txn, IsolationLevel isolatio
   txn_map_mutex.lock();
   txn_map[txn->GetTransactionId()] = txn;
   txn_map_mutex.unlock();
+
+  if (enable_logging && log_manager_ != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::BEGIN);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+  }
   return txn;
 }
 
@@ -52,6 +57,22 @@ void TransactionManager::Commit(Transaction *txn) {
   }
   write_set->clear();
 
+  if (enable_logging && log_manager_ != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::COMMIT);
+    lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+    txn->SetPrevLSN(lsn);
+    // A synchronous commit is durable before its locks are released. An asynchronous one only bounds how long the
+    // COMMIT record may sit in the log buffer; a crash in that window rolls the transaction back during recovery.
+    bool synchronous = txn->GetSynchronousCommit() == SynchronousCommit::DEFAULT
+                           ? synchronous_commit_.load()
+                           : txn->GetSynchronousCommit() == SynchronousCommit::ON;
+    if (synchronous) {
+      log_manager_->WaitForFlush(lsn);
+    } else {
+      log_manager_->ScheduleFlush();
+    }
+  }
+
   // Release all the locks.
   ReleaseLocks(txn);
   // Release the global transaction latch.
@@ -102,6 +123,11 @@ void TransactionManager::Abort(Transaction *txn) {
   table_write_set->clear();
   index_write_set->clear();
 
+  if (enable_logging && log_manager_ != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ABORT);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+  }
+
   // Release all the locks.
   ReleaseLocks(txn);
   // Release the global transaction latch.
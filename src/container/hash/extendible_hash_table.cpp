@@ -11,8 +11,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <string>
+#include <thread>  // NOLINT
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -25,17 +29,50 @@ namespace bustub {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn)
-    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
+                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                                     LogManager *log_manager)
+    : buffer_pool_manager_(buffer_pool_manager),
+      comparator_(comparator),
+      hash_fn_(std::move(hash_fn)),
+      log_manager_(log_manager) {
   //  implement me!
-  auto dir_page = CreateDirectoryPage(&directory_page_id_);  // 创建目录页
+  auto header_page = CreateDirectoryPage(&header_page_id_);  // 创建头页
+  page_id_t directory_page_id;
+  auto dir_page = CreateDirectoryPage(&directory_page_id);  // 创建目录页
+  header_page->SetBucketPageId(0, directory_page_id);
 
   page_id_t bucket_page_id;
-  buffer_pool_manager_->NewPage(&bucket_page_id, nullptr);  // 申请第一个桶的页
+  CreateBucketPage(&bucket_page_id);  // 申请第一个桶的页
   dir_page->SetBucketPageId(0, bucket_page_id);
+  LogDirectoryImage(dir_page);
+  LogDirectoryImage(header_page);
 
-  buffer_pool_manager_->UnpinPage(bucket_page_id, false, nullptr);     // 放回桶页
-  buffer_pool_manager_->UnpinPage(directory_page_id_, true, nullptr);  // 放回目录页
+  buffer_pool_manager_->UnpinPage(bucket_page_id, true, nullptr);     // 放回桶页
+  buffer_pool_manager_->UnpinPage(directory_page_id, true, nullptr);  // 放回目录页
+  buffer_pool_manager_->UnpinPage(header_page_id_, true, nullptr);    // 放回头页
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
+                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                                     page_id_t header_page_id, LogManager *log_manager)
+    : header_page_id_(header_page_id),
+      buffer_pool_manager_(buffer_pool_manager),
+      comparator_(comparator),
+      hash_fn_(std::move(hash_fn)),
+      log_manager_(log_manager) {}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+HASH_TABLE_TYPE::~ExtendibleHashTable() {
+  {
+    std::scoped_lock lock(merge_latch_);
+    merge_running_ = false;
+    merge_stop_ = true;
+  }
+  merge_cv_.notify_all();
+  if (merge_thread_.joinable()) {
+    merge_thread_.join();
+  }
 }
 
 /*****************************************************************************
@@ -53,9 +90,28 @@ uint32_t HASH_TABLE_TYPE::Hash(KeyType key) {
   return static_cast<uint32_t>(hash_fn_.GetHash(key));
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint32_t HASH_TABLE_TYPE::ReverseBits(uint32_t hash) {
+  uint32_t reversed = 0;
+  for (int i = 0; i < 32; i++) {
+    reversed = (reversed << 1) | ((hash >> i) & 1);
+  }
+  return reversed;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint64_t HASH_TABLE_TYPE::ReadVersion(Page *page) {
+  uint64_t version = page->GetVersion();
+  while ((version & 1) != 0) {
+    std::this_thread::yield();
+    version = page->GetVersion();
+  }
+  return version;
+}
+
 template <typename KeyType, typename ValueType, typename KeyComparator>
 inline uint32_t HASH_TABLE_TYPE::KeyToDirectoryIndex(KeyType key, HashTableDirectoryPage *dir_page) {
-  uint32_t index = Hash(key) & dir_page->GetGlobalDepthMask();
+  uint32_t index = (Hash(key) >> dir_page->GetHashShift()) & dir_page->GetGlobalDepthMask();
   return index;
 }
 
@@ -66,9 +122,10 @@ inline page_id_t HASH_TABLE_TYPE::KeyToPageId(KeyType key, HashTableDirectoryPag
   return page_id;
 }
 template <typename KeyType, typename ValueType, typename KeyComparator>
-HashTableDirectoryPage *HASH_TABLE_TYPE::CreateDirectoryPage(page_id_t *bucket_page_id) {
+HashTableDirectoryPage *HASH_TABLE_TYPE::CreateDirectoryPage(page_id_t *directory_page_id) {
   auto dir_page = reinterpret_cast<HashTableDirectoryPage *>(
-      buffer_pool_manager_->NewPage(&directory_page_id_, nullptr)->GetData());  // 创建目录页
+      buffer_pool_manager_->NewPage(directory_page_id, nullptr)->GetData());
+  dir_page->SetPageId(*directory_page_id);
   return dir_page;
 }
 
@@ -76,16 +133,44 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_BUCKET_TYPE *HASH_TABLE_TYPE::CreateBucketPage(page_id_t *bucket_page_id) {
   auto *new_bucket_page =
       reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(buffer_pool_manager_->NewPage(bucket_page_id, nullptr)->GetData());
+  new_bucket_page->SetPageId(*bucket_page_id);
   return new_bucket_page;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-HashTableDirectoryPage *HASH_TABLE_TYPE::FetchDirectoryPage() {
+HashTableDirectoryPage *HASH_TABLE_TYPE::FetchDirectoryPage(page_id_t directory_page_id) {
   auto directory_page = reinterpret_cast<HashTableDirectoryPage *>(
-      buffer_pool_manager_->FetchPage(directory_page_id_, nullptr)->GetData());
+      buffer_pool_manager_->FetchPage(directory_page_id, nullptr)->GetData());
   return directory_page;
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+HashTableDirectoryPage *HASH_TABLE_TYPE::FetchDirectoryPageFor(uint32_t hash, bool exclusive) {
+  HashTableDirectoryPage *header_page = FetchDirectoryPage(header_page_id_);
+  reinterpret_cast<Page *>(header_page)->RLatch();
+  page_id_t directory_page_id = header_page->GetBucketPageId(hash & header_page->GetGlobalDepthMask());
+  HashTableDirectoryPage *dir_page = FetchDirectoryPage(directory_page_id);
+  if (exclusive) {
+    reinterpret_cast<Page *>(dir_page)->WLatch();
+  } else {
+    reinterpret_cast<Page *>(dir_page)->RLatch();
+  }
+  reinterpret_cast<Page *>(header_page)->RUnlatch();
+  buffer_pool_manager_->UnpinPage(header_page_id_, false);
+  return dir_page;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::ReleaseDirectoryPage(HashTableDirectoryPage *dir_page, bool exclusive, bool is_dirty) {
+  page_id_t directory_page_id = dir_page->GetPageId();
+  if (exclusive) {
+    reinterpret_cast<Page *>(dir_page)->WUnlatch();
+  } else {
+    reinterpret_cast<Page *>(dir_page)->RUnlatch();
+  }
+  buffer_pool_manager_->UnpinPage(directory_page_id, is_dirty);
+}
+
 template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_BUCKET_TYPE *HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_id) {
   auto bucket_page =
@@ -93,24 +178,155 @@ HASH_TABLE_BUCKET_TYPE *HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_i
   return bucket_page;
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+HASH_TABLE_BUCKET_TYPE *HASH_TABLE_TYPE::FetchBucketPageFor(const KeyType &key, HashTableDirectoryPage *dir_page,
+                                                            bool exclusive, page_id_t *bucket_page_id) {
+  while (true) {
+    *bucket_page_id = KeyToPageId(key, dir_page);
+    HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(*bucket_page_id);
+    auto *page = reinterpret_cast<Page *>(bucket_page);
+    if (exclusive) {
+      page->WLatch();
+    } else {
+      page->RLatch();
+    }
+    // the entries of a bucket only change under its write latch, so now that we hold it the entry is settled
+    if (KeyToPageId(key, dir_page) == *bucket_page_id) {
+      return bucket_page;
+    }
+    if (exclusive) {
+      page->WUnlatch();
+    } else {
+      page->RUnlatch();
+    }
+    buffer_pool_manager_->UnpinPage(*bucket_page_id, false);
+  }
+}
+
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) {
-  table_latch_.RLock();
-  auto dir_page = FetchDirectoryPage();
-  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
-  auto *bucket_page = FetchBucketPage(bucket_page_id);
+  uint32_t hash = Hash(key);
+  size_t num_values = result->size();
+  while (!GetValueOptimistic(hash, key, result)) {
+  }
+  return result->size() > num_values;
+}
 
-  reinterpret_cast<Page *>(bucket_page)->RLatch();
-  bool ret = bucket_page->GetValue(key, comparator_, result);  // 读取桶页内容前加页的读锁
-  reinterpret_cast<Page *>(bucket_page)->RUnlatch();
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::GetValueOptimistic(uint32_t hash, const KeyType &key, std::vector<ValueType> *result) {
+  // the directory page is still in the header page when its version is taken
+  Page *header = buffer_pool_manager_->FetchPage(header_page_id_);
+  uint64_t header_version = ReadVersion(header);
+  auto *header_page = reinterpret_cast<HashTableDirectoryPage *>(header->GetData());
+  page_id_t directory_page_id = header_page->GetBucketPageId(hash & header_page->GetGlobalDepthMask());
+  Page *directory = buffer_pool_manager_->FetchPage(directory_page_id);
+  uint64_t directory_version = ReadVersion(directory);
+  bool valid = header->ValidateVersion(header_version);
+  buffer_pool_manager_->UnpinPage(header_page_id_, false);
+  if (!valid) {
+    buffer_pool_manager_->UnpinPage(directory_page_id, false);
+    return false;
+  }
 
-  buffer_pool_manager_->UnpinPage(bucket_page_id, false, nullptr);
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr);
-  table_latch_.RUnlock();
-  return ret;
+  // splits and merges repoint the entry with the bucket write-latched, so it is read again once the bucket's version
+  // is taken; a later split or merge shows in that version
+  auto *dir_page = reinterpret_cast<HashTableDirectoryPage *>(directory->GetData());
+  uint32_t bucket_idx = (hash >> dir_page->GetHashShift()) & dir_page->GetGlobalDepthMask();
+  page_id_t bucket_page_id = dir_page->GetBucketPageId(bucket_idx);
+  Page *bucket = buffer_pool_manager_->FetchPage(bucket_page_id);
+  uint64_t bucket_version = ReadVersion(bucket);
+  valid = dir_page->GetBucketPageId(bucket_idx) == bucket_page_id && directory->ValidateVersion(directory_version);
+  buffer_pool_manager_->UnpinPage(directory_page_id, false);
+  valid = valid && GetBucketValueOptimistic(bucket, bucket_version, key, result);
+  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+  return valid;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::GetBucketValueOptimistic(Page *bucket, uint64_t bucket_version, const KeyType &key,
+                                               std::vector<ValueType> *result) {
+  // the entries are copied and only compared once the version shows that no writer tore them
+  std::vector<MappingType> candidates;
+  auto *bucket_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(bucket->GetData());
+  bucket_page->GetCandidates(key, &candidates);
+  page_id_t overflow_page_id = bucket_page->GetOverflowPageId();
+  while (overflow_page_id != INVALID_PAGE_ID) {
+    // overflow pages are unlinked and deleted under the bucket latch, a link is good while the bucket is unchanged
+    if (!bucket->ValidateVersion(bucket_version)) {
+      return false;
+    }
+    HASH_TABLE_BUCKET_TYPE *overflow_page = FetchBucketPage(overflow_page_id);
+    overflow_page->GetCandidates(key, &candidates);
+    page_id_t next_page_id = overflow_page->GetOverflowPageId();
+    buffer_pool_manager_->UnpinPage(overflow_page_id, false);
+    overflow_page_id = next_page_id;
+  }
+  if (!bucket->ValidateVersion(bucket_version)) {
+    return false;
+  }
+  for (const auto &[candidate_key, value] : candidates) {
+    if (comparator_(candidate_key, key) == 0) {
+      result->push_back(value);
+    }
+  }
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::GetValues(Transaction *transaction, const std::vector<KeyType> &keys,
+                                std::vector<std::vector<ValueType>> *results) {
+  results->assign(keys.size(), {});
+  // hash every key first. Sorted by the low hash bits, the keys of a directory page and of a bucket are adjacent.
+  std::vector<std::pair<uint32_t, size_t>> order;
+  order.reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    order.emplace_back(ReverseBits(Hash(keys[i])), i);
+  }
+  std::sort(order.begin(), order.end());
+
+  std::vector<size_t> retries;
+  for (size_t next = 0; next < order.size();) {
+    uint32_t hash = ReverseBits(order[next].first);
+    HashTableDirectoryPage *dir_page = FetchDirectoryPageFor(hash, false);
+    // the directory page holds every key that agrees with this one in the bits the header resolves
+    uint32_t shift = dir_page->GetHashShift();
+    uint32_t header_mask = (1U << shift) - 1;
+    size_t end = next;
+    while (end < order.size() && ((ReverseBits(order[end].first) ^ hash) & header_mask) == 0) {
+      end++;
+    }
+
+    std::array<page_id_t, PREFETCH_GROUP_SIZE> bucket_page_ids;
+    std::array<Page *, PREFETCH_GROUP_SIZE> pages;
+    for (size_t group = next; group < end; group += PREFETCH_GROUP_SIZE) {
+      size_t group_size = std::min(PREFETCH_GROUP_SIZE, end - group);
+      for (size_t i = 0; i < group_size; i++) {
+        uint32_t key_hash = ReverseBits(order[group + i].first);
+        bucket_page_ids[i] = dir_page->GetBucketPageId((key_hash >> shift) & dir_page->GetGlobalDepthMask());
+        pages[i] = buffer_pool_manager_->FetchPage(bucket_page_ids[i]);
+        reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(pages[i]->GetData())->Prefetch();
+      }
+      for (size_t i = 0; i < group_size; i++) {
+        size_t key_idx = order[group + i].second;
+        uint64_t version = ReadVersion(pages[i]);
+        // the bucket may have been split or merged before its version was taken, or be changed while it is read,
+        // such keys take the usual way afterwards
+        if (KeyToPageId(keys[key_idx], dir_page) != bucket_page_ids[i] ||
+            !GetBucketValueOptimistic(pages[i], version, keys[key_idx], &(*results)[key_idx])) {
+          retries.push_back(key_idx);
+        }
+        buffer_pool_manager_->UnpinPage(bucket_page_ids[i], false);
+      }
+    }
+    ReleaseDirectoryPage(dir_page, false, false);
+    next = end;
+  }
+  for (size_t key_idx : retries) {
+    GetValue(transaction, keys[key_idx], &(*results)[key_idx]);
+  }
 }
 
 /*****************************************************************************
@@ -118,23 +334,24 @@ bool HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  table_latch_.RLock();
-  auto dir_page = FetchDirectoryPage();
-  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
-  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
-
-  reinterpret_cast<Page *>(bucket_page)->WLatch();
-  bool fulled = bucket_page->IsFull();
+  auto dir_page = FetchDirectoryPageFor(Hash(key), false);
+  page_id_t bucket_page_id;
+  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPageFor(key, dir_page, true, &bucket_page_id);
+  ReleaseDirectoryPage(dir_page, false, false);
+  // the pair may be in the overflow chain of the bucket already, SplitInsert looks there
+  bool fulled = bucket_page->IsFull() || bucket_page->HasOverflow();
   bool res = false;
   if (!fulled) {
     // if isfulled, no need to try, because it will always return false.
-    res = bucket_page->Insert(key, value, comparator_);
+    uint32_t slot_idx;
+    res = bucket_page->Insert(key, value, comparator_, &slot_idx);
+    if (res) {
+      LogBucketEntry(transaction, LogRecordType::HASH_BUCKET_INSERT, bucket_page_id, bucket_page, slot_idx);
+    }
   }
   reinterpret_cast<Page *>(bucket_page)->WUnlatch();
 
-  assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false));
-  assert(buffer_pool_manager_->UnpinPage(bucket_page_id, true));
-  table_latch_.RUnlock();
+  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
   if (fulled) {
     return SplitInsert(transaction, key, value);
   }
@@ -146,312 +363,802 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value) {
   // Bucket page is Full, need to split image and insert.
   // First.   If local_deprth < global_depth, just simplely allocate a new page and rehash the old bucket page.
-  // Second.  If local depth = global_depth, need to Incr global_depth and then allocate a new page and rehash the old
-  // bucket page.
-  //   here Print();
-  table_latch_.WLock();
-  auto dir_page = FetchDirectoryPage();
-  uint32_t bucket_idx = KeyToDirectoryIndex(key, dir_page);
-
-  // 1. Fetch bucket_page and Allocate another new bucket page
-  page_id_t bucket_page_id = dir_page->GetBucketPageId(bucket_idx);
-  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
-  reinterpret_cast<Page *>(bucket_page)->WLatch();
-  if (!bucket_page->IsFull()) {  // 再次检查桶是否满了
-    bool ret_tmp = bucket_page->Insert(key, value, comparator_);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, true, nullptr);
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr);
-    reinterpret_cast<Page *>(bucket_page)->WUnlatch();
-    table_latch_.WUnlock();
-    return ret_tmp;
-  }
-
-  // 2. Judge if need to incr global depth.
-  if (dir_page->GetLocalDepth(bucket_idx) == dir_page->GetGlobalDepth()) {
-    dir_page->IncrGlobalDepth();
-  }
-
-  // 3. Create a new page
-  page_id_t new_bucket_page_id;
-  Page *new_page = buffer_pool_manager_->NewPage(&new_bucket_page_id);
-  assert(new_page != nullptr);
-  new_page->WLatch();
-  auto new_bucket_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(new_page->GetData());
-
-  // 4.  Incr local_depth and Get split image bucket
-  dir_page->IncrLocalDepth(bucket_idx);  // first incr local_depth and then calculate the another bucket_idx
-  uint32_t new_bucket_idx = dir_page->GetSplitImageIndex(bucket_idx);
-  uint32_t now_local_depth = dir_page->GetLocalDepth(bucket_idx);
-  //  4.1 First method, set all bucket whose page_id pointer to bucket_page_id
-  uint32_t now_local_mask = static_cast<uint32_t>((1 << now_local_depth) - 1);
-  for (uint32_t i = 0; i < dir_page->Size(); i++) {
-    page_id_t page_id = dir_page->GetBucketPageId(i);
-    if (page_id == bucket_page_id) {
-      // two parts all need to incrLocalDepth.
-      dir_page->SetLocalDepth(i, now_local_depth);
-      // another part need to pointer another page
-      if ((i & now_local_mask) != (bucket_idx & now_local_mask)) {
-        dir_page->SetBucketPageId(i, new_bucket_page_id);
+  // Second.  If local depth = global_depth, need to Incr global_depth (or split the directory page if it is full)
+  // and start over.
+  // The bucket may still be full after a split if all of its keys went one way, then split again.
+  // Third.   If the keys of one hash take up the bucket no split can help, they go to overflow pages instead.
+  // A split only holds the directory page read-latched, along with the bucket and its split image.
+  uint32_t hash = Hash(key);
+  while (true) {
+    auto dir_page = FetchDirectoryPageFor(hash, false);
+    uint32_t bucket_idx = KeyToDirectoryIndex(key, dir_page);
+
+    // 1. Fetch bucket_page and Allocate another new bucket page
+    page_id_t bucket_page_id;
+    HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPageFor(key, dir_page, true, &bucket_page_id);
+    // 1.1 A bucket with an overflow chain keeps the keys of the chain's hash there, while other keys take the room
+    // of the bucket page itself, which the keys of the chain's hash give up.
+    uint32_t key_hash = hash & SPLITTABLE_HASH_MASK;
+    uint32_t chain_hash = 0;
+    bool chained = GetChainHash(bucket_page, &chain_hash);
+    if (chained && key_hash == chain_hash) {
+      bool ret_tmp = ChainInsert(transaction, bucket_page, key, value);
+      reinterpret_cast<Page *>(bucket_page)->WUnlatch();
+      buffer_pool_manager_->UnpinPage(bucket_page_id, true, nullptr);
+      ReleaseDirectoryPage(dir_page, false, false);
+      return ret_tmp;
+    }
+    if (chained && bucket_page->IsFull()) {
+      MoveToChain(bucket_page, chain_hash);
+    }
+    if (!bucket_page->IsFull()) {  // 再次检查桶是否满了
+      uint32_t slot_idx;
+      bool ret_tmp = bucket_page->Insert(key, value, comparator_, &slot_idx);
+      if (ret_tmp) {
+        LogBucketEntry(transaction, LogRecordType::HASH_BUCKET_INSERT, bucket_page_id, bucket_page, slot_idx);
       }
+      reinterpret_cast<Page *>(bucket_page)->WUnlatch();
+      buffer_pool_manager_->UnpinPage(bucket_page_id, true, nullptr);
+      ReleaseDirectoryPage(dir_page, false, false);
+      return ret_tmp;
     }
-  }
-  // 4.2  Second method: calculate the diff and set the bucket which dist bucket_idx k*diff.
-  //   uint32_t diff = 0x1 << now_local_depth;  // the distance of two buckets which share a page
-  //   // 3.1  Set loca_depth and page_id of buckets which share a page with bucket_idx
-  //   // two directions
-  //   uint32_t start_idx1 = bucket_idx % diff;
-  //   for (uint32_t i = start_idx1; i < dir_page->Size(); i += diff) {
-  //     dir_page->SetLocalDepth(i, now_local_depth);
-  //     dir_page->SetBucketPageId(i, bucket_page_id);
-  //   }
-  //   // 3.2  Set loca_depth and page_id of buckets which share a page with bucket_idx
-  //   // two directions
-  //   uint32_t start_idx2 = new_bucket_idx % diff;
-  //   for (uint32_t i = start_idx2; i < dir_page->Size(); i += diff) {
-  //     dir_page->SetLocalDepth(i, now_local_depth);
-  //     dir_page->SetBucketPageId(i, new_bucket_page_id);
-  //   }
-
-  // 5. Rehash and insert
-  //   LOG_DEBUG("bucket_idx: %d -- new_bucket_idx: %d", bucket_idx, new_bucket_idx);
-  //   dir_page->PrintDirectory();
-  KeyType bucket_key;
-  ValueType bucket_value;
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    if (!bucket_page->IsReadable(i)) {
+
+    // 1.2 No split moves apart the keys of one hash, if they fill half of the bucket they start an overflow chain
+    uint32_t num_same_hash = 0;
+    for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE && !chained; i++) {
+      if (bucket_page->IsReadable(i) && (Hash(bucket_page->KeyAt(i)) & SPLITTABLE_HASH_MASK) == key_hash) {
+        num_same_hash++;
+      }
+    }
+    if (2 * num_same_hash >= BUCKET_ARRAY_SIZE) {
+      bool ret_tmp = ChainInsert(transaction, bucket_page, key, value);
+      reinterpret_cast<Page *>(bucket_page)->WUnlatch();
+      buffer_pool_manager_->UnpinPage(bucket_page_id, true, nullptr);
+      ReleaseDirectoryPage(dir_page, false, false);
+      return ret_tmp;
+    }
+
+    // 2. Judge if need to incr global depth, which takes the directory page write latch.
+    uint32_t local_depth = dir_page->GetLocalDepth(bucket_idx);
+    if (local_depth == dir_page->GetGlobalDepth()) {
+      reinterpret_cast<Page *>(bucket_page)->WUnlatch();
+      buffer_pool_manager_->UnpinPage(bucket_page_id, false, nullptr);
+      ReleaseDirectoryPage(dir_page, false, false);
+      if (!GrowDirectory(hash)) {
+        return false;
+      }
       continue;
     }
-    bucket_key = bucket_page->KeyAt(i);
-    bucket_value = bucket_page->ValueAt(i);
-    uint32_t should_in_idx = KeyToDirectoryIndex(bucket_key, dir_page);
-    assert(should_in_idx == bucket_idx || should_in_idx == new_bucket_idx);
-    if (should_in_idx == new_bucket_idx) {
-      // delete from old_bucket
-      bucket_page->RemoveAt(i);
-      // put new bucket page
-      new_bucket_page->Insert(bucket_key, bucket_value, comparator_);
-    }
-  }
-  // should insert here?
-  page_id_t should_be_in = KeyToPageId(key, dir_page);
-  assert(should_be_in == bucket_page_id || should_be_in == new_bucket_page_id);
-  bool res;
-  if (should_be_in == bucket_page_id) {
-    res = bucket_page->Insert(key, value, comparator_);
-  } else {
-    res = new_bucket_page->Insert(key, value, comparator_);
+
+    // 3. Create a new page
+    page_id_t new_bucket_page_id;
+    Page *new_page = buffer_pool_manager_->NewPage(&new_bucket_page_id);
+    assert(new_page != nullptr);
+    new_page->WLatch();
+    auto new_bucket_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(new_page->GetData());
+    new_bucket_page->SetPageId(new_bucket_page_id);
+
+    // 4.  Incr local_depth and point the entries of the split image to the new page. The entries of the bucket are
+    // every 2^local_depth-th one, the split image has the next hash bit set. Other splits change other entries.
+    // A chained bucket stays on the side of the chain's hash and the split image is the other side, so the chain
+    // stays whole.
+    uint32_t high_bit = 1U << local_depth;
+    bool keep_high = chained && ((chain_hash >> dir_page->GetHashShift()) & high_bit) != 0;
+    for (uint32_t i = bucket_idx & (high_bit - 1); i < dir_page->Size(); i += high_bit) {
+      dir_page->SetLocalDepth(i, local_depth + 1);
+      if (((i & high_bit) != 0) != keep_high) {
+        dir_page->SetBucketPageId(i, new_bucket_page_id);
+      }
+    }
+
+    // 5. Rehash and insert
+    KeyType bucket_key;
+    ValueType bucket_value;
+    // the moved entries land in slots 0..n-1 of the empty split image, which is all the split record has to say
+    std::vector<uint32_t> moved_slots;
+    std::string moved_entries;
+    for (size_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
+      if (!bucket_page->IsReadable(i)) {
+        continue;
+      }
+      bucket_key = bucket_page->KeyAt(i);
+      bucket_value = bucket_page->ValueAt(i);
+      if (((KeyToDirectoryIndex(bucket_key, dir_page) & high_bit) != 0) != keep_high) {
+        if (IsLogging()) {
+          moved_slots.push_back(i);
+          moved_entries.append(bucket_page->EntryAt(i));
+        }
+        // delete from old_bucket
+        bucket_page->RemoveAt(i);
+        // put new bucket page
+        new_bucket_page->Insert(bucket_key, bucket_value, comparator_);
+      }
+    }
+    if (IsLogging()) {
+      LogDirectoryImage(dir_page);
+      LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::HASH_BUCKET_SPLIT, bucket_page_id,
+                           new_bucket_page_id, bucket_page->GetSlot(0), std::move(moved_slots),
+                           std::move(moved_entries));
+      lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+      bucket_page->SetLSN(lsn);
+      new_bucket_page->SetLSN(lsn);
+    }
+    // should insert here?
+    page_id_t should_be_in = KeyToPageId(key, dir_page);
+    assert(should_be_in == bucket_page_id || should_be_in == new_bucket_page_id);
+    auto insert_page = should_be_in == bucket_page_id ? bucket_page : new_bucket_page;
+    bool fulled = insert_page->IsFull() || insert_page->HasOverflow();
+    bool res = false;
+    if (!fulled) {
+      uint32_t slot_idx;
+      res = insert_page->Insert(key, value, comparator_, &slot_idx);
+      if (res) {
+        LogBucketEntry(transaction, LogRecordType::HASH_BUCKET_INSERT, should_be_in, insert_page, slot_idx);
+      }
+    }
+
+    reinterpret_cast<Page *>(bucket_page)->WUnlatch();
+    reinterpret_cast<Page *>(new_bucket_page)->WUnlatch();
+
+    // 6.  Unpin pages
+    buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+    buffer_pool_manager_->UnpinPage(new_bucket_page_id, true);
+    ReleaseDirectoryPage(dir_page, false, true);
+    if (!fulled) {
+      return res;
+    }
   }
+}
 
-  reinterpret_cast<Page *>(bucket_page)->WUnlatch();
-  reinterpret_cast<Page *>(new_bucket_page)->WUnlatch();
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::GrowDirectory(uint32_t hash) {
+  auto dir_page = FetchDirectoryPageFor(hash, true);
+  uint32_t bucket_idx = (hash >> dir_page->GetHashShift()) & dir_page->GetGlobalDepthMask();
+  // someone else may have grown it already
+  if (dir_page->GetLocalDepth(bucket_idx) < dir_page->GetGlobalDepth()) {
+    ReleaseDirectoryPage(dir_page, true, false);
+    return true;
+  }
+  if (dir_page->IsFull()) {
+    ReleaseDirectoryPage(dir_page, true, false);
+    return SplitDirectory(hash);
+  }
+  dir_page->IncrGlobalDepth();
+  LogDirectoryImage(dir_page);
+  ReleaseDirectoryPage(dir_page, true, true);
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::SplitDirectory(uint32_t hash) {
+  // the header latch keeps out everyone who has not reached a directory page yet, the directory latch the others
+  HashTableDirectoryPage *header_page = FetchDirectoryPage(header_page_id_);
+  reinterpret_cast<Page *>(header_page)->WLatch();
+  uint32_t header_idx = hash & header_page->GetGlobalDepthMask();
+  page_id_t directory_page_id = header_page->GetBucketPageId(header_idx);
+  HashTableDirectoryPage *dir_page = FetchDirectoryPage(directory_page_id);
+  reinterpret_cast<Page *>(dir_page)->WLatch();
 
-  // 6.  Unpin pages
-  assert(buffer_pool_manager_->UnpinPage(directory_page_id_, true));
-  assert(buffer_pool_manager_->UnpinPage(bucket_page_id, true));
-  assert(buffer_pool_manager_->UnpinPage(new_bucket_page_id, true));
+  // someone else may have split it already
+  bool split = dir_page->IsFull();
+  bool res = true;
+  if (split && header_page->GetLocalDepth(header_idx) == header_page->GetGlobalDepth()) {
+    if (header_page->IsFull()) {
+      split = false;
+      res = false;
+    } else {
+      header_page->IncrGlobalDepth();
+    }
+  }
+  if (split) {
+    page_id_t image_page_id;
+    HashTableDirectoryPage *image_page = CreateDirectoryPage(&image_page_id);
+    uint32_t shift = header_page->GetLocalDepth(header_idx);
+    assert(shift == dir_page->GetHashShift());
+    dir_page->SplitTo(image_page);
+    for (uint32_t i = 0; i < header_page->Size(); i++) {
+      if (header_page->GetBucketPageId(i) == directory_page_id) {
+        header_page->SetLocalDepth(i, shift + 1);
+        if (((i >> shift) & 1) != 0) {
+          header_page->SetBucketPageId(i, image_page_id);
+        }
+      }
+    }
+    LogDirectoryImage(image_page);
+    LogDirectoryImage(dir_page);
+    LogDirectoryImage(header_page);
+    buffer_pool_manager_->UnpinPage(image_page_id, true);
+  }
 
-  table_latch_.WUnlock();
-  // if it still does not has space, it will recurse. Insert -> SplitInsert -> Insert ...
-  //   return Insert(transaction, key, value);
+  reinterpret_cast<Page *>(dir_page)->WUnlatch();
+  reinterpret_cast<Page *>(header_page)->WUnlatch();
+  buffer_pool_manager_->UnpinPage(directory_page_id, split);
+  buffer_pool_manager_->UnpinPage(header_page_id_, split);
   return res;
 }
 
 /*****************************************************************************
- * REMOVE
+ * BULK LOAD
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  uint32_t bucket_idx = KeyToDirectoryIndex(key, dir_page);
-  uint32_t bucket_page_id = dir_page->GetBucketPageId(bucket_idx);
+void HASH_TABLE_TYPE::Reserve(size_t num_entries) {
+  // leave room in the buckets for an uneven spread of the hashes
+  const double fill = 0.7;
+  HashTableDirectoryPage *header_page = FetchDirectoryPage(header_page_id_);
+  reinterpret_cast<Page *>(header_page)->WLatch();
+  page_id_t directory_page_id = header_page->GetBucketPageId(0);
+  auto dir_page = FetchDirectoryPage(directory_page_id);
+  page_id_t bucket_page_id = dir_page->GetBucketPageId(0);
   HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
+  bool empty = header_page->GetGlobalDepth() == 0 && dir_page->GetGlobalDepth() == 0 && bucket_page->IsEmpty();
+  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+
+  uint32_t depth = 0;
+  while (empty && depth < 2 * DIRECTORY_MAX_DEPTH &&
+         static_cast<double>(1U << depth) * BUCKET_ARRAY_SIZE * fill < static_cast<double>(num_entries)) {
+    depth++;
+  }
+  if (depth == 0) {
+    buffer_pool_manager_->UnpinPage(directory_page_id, false);
+    reinterpret_cast<Page *>(header_page)->WUnlatch();
+    buffer_pool_manager_->UnpinPage(header_page_id_, false);
+    return;
+  }
+
+  // fill up the first directory page before spreading over more of them
+  uint32_t header_depth = depth > DIRECTORY_MAX_DEPTH ? depth - DIRECTORY_MAX_DEPTH : 0;
+  uint32_t dir_depth = depth - header_depth;
+  for (uint32_t i = 0; i < header_depth; i++) {
+    header_page->IncrGlobalDepth();
+  }
+  for (uint32_t h = 0; h < header_page->Size(); h++) {
+    if (h > 0) {
+      dir_page = CreateDirectoryPage(&directory_page_id);
+    }
+    dir_page->SetHashShift(header_depth);
+    for (uint32_t i = 0; i < dir_depth; i++) {
+      dir_page->IncrGlobalDepth();
+    }
+    for (uint32_t i = 0; i < dir_page->Size(); i++) {
+      if (h > 0 || i > 0) {
+        CreateBucketPage(&bucket_page_id);
+        buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+        dir_page->SetBucketPageId(i, bucket_page_id);
+      }
+      dir_page->SetLocalDepth(i, dir_depth);
+    }
+    LogDirectoryImage(dir_page);
+    buffer_pool_manager_->UnpinPage(directory_page_id, true);
+    header_page->SetBucketPageId(h, directory_page_id);
+    header_page->SetLocalDepth(h, header_depth);
+  }
+  LogDirectoryImage(header_page);
+  reinterpret_cast<Page *>(header_page)->WUnlatch();
+  buffer_pool_manager_->UnpinPage(header_page_id_, true);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::BulkInsert(Transaction *transaction, const std::vector<MappingType> &entries) {
+  Reserve(entries.size());
+  // group by the low hash bits first, which are the ones that pick the bucket
+  std::vector<std::pair<uint32_t, size_t>> order;
+  order.reserve(entries.size());
+  for (size_t i = 0; i < entries.size(); i++) {
+    order.emplace_back(ReverseBits(Hash(entries[i].first)), i);
+  }
+  std::sort(order.begin(), order.end());
+  for (const auto &[hash, i] : order) {
+    Insert(transaction, entries[i].first, entries[i].second);
+  }
+}
 
-  reinterpret_cast<Page *>(bucket_page)->WLatch();
-  bool res = bucket_page->Remove(key, value, comparator_);
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) {
+  HashTableDirectoryPage *dir_page = FetchDirectoryPageFor(Hash(key), false);
+  page_id_t bucket_page_id;
+  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPageFor(key, dir_page, true, &bucket_page_id);
+  ReleaseDirectoryPage(dir_page, false, false);
+  uint32_t slot_idx;
+  bool res = bucket_page->Remove(key, value, comparator_, &slot_idx);
+  if (res) {
+    LogBucketEntry(transaction, LogRecordType::HASH_BUCKET_REMOVE, bucket_page_id, bucket_page, slot_idx);
+  } else if (bucket_page->HasOverflow()) {
+    res = ChainRemove(transaction, bucket_page, key, value);
+  }
   // If bucket_page' size == 0, need to check if can merge(which requeire spit_image_page's size == 0 too).
-  uint32_t bucket_size = bucket_page->NumReadable();
+  // A bucket with an overflow chain is not empty.
+  uint32_t bucket_size = bucket_page->HasOverflow() ? 1 : bucket_page->NumReadable();
   reinterpret_cast<Page *>(bucket_page)->WUnlatch();
 
-  assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false));
-  assert(buffer_pool_manager_->UnpinPage(bucket_page_id, true));
-  table_latch_.RUnlock();
-  if (bucket_size == 0) {  // through remove return false, if it is empty, we can merge it.
-    Merge(transaction, key, value);
-    // while (ExtraMerge(transaction, key, value)) {
-    // }
+  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+  if (bucket_size == 0 && !QueueMerge(Hash(key))) {  // through remove return false, if it is empty, we can merge it.
+    Merge(Hash(key));
   }
   return res;
 }
 
+/*****************************************************************************
+ * OVERFLOW CHAINS
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::GetChainValue(HASH_TABLE_BUCKET_TYPE *bucket_page, const KeyType &key,
+                                    std::vector<ValueType> *result) {
+  bool found = bucket_page->GetValue(key, comparator_, result);
+  page_id_t overflow_page_id = bucket_page->GetOverflowPageId();
+  while (overflow_page_id != INVALID_PAGE_ID) {
+    HASH_TABLE_BUCKET_TYPE *overflow_page = FetchBucketPage(overflow_page_id);
+    found = overflow_page->GetValue(key, comparator_, result) || found;
+    page_id_t next_page_id = overflow_page->GetOverflowPageId();
+    buffer_pool_manager_->UnpinPage(overflow_page_id, false);
+    overflow_page_id = next_page_id;
+  }
+  return found;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::GetChainHash(HASH_TABLE_BUCKET_TYPE *bucket_page, uint32_t *chain_hash) {
+  if (!bucket_page->HasOverflow()) {
+    return false;
+  }
+  // overflow pages are never empty and only have keys of the chain's hash
+  page_id_t overflow_page_id = bucket_page->GetOverflowPageId();
+  HASH_TABLE_BUCKET_TYPE *overflow_page = FetchBucketPage(overflow_page_id);
+  for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
+    if (overflow_page->IsReadable(i)) {
+      *chain_hash = Hash(overflow_page->KeyAt(i)) & SPLITTABLE_HASH_MASK;
+      break;
+    }
+  }
+  buffer_pool_manager_->UnpinPage(overflow_page_id, false);
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::ChainInsert(Transaction *transaction, HASH_TABLE_BUCKET_TYPE *bucket_page, const KeyType &key,
+                                  const ValueType &value) {
+  // a page only turns away the pairs it has itself, the whole chain has to be looked at first
+  std::vector<ValueType> values;
+  GetChainValue(bucket_page, key, &values);
+  if (std::find(values.begin(), values.end(), value) != values.end()) {
+    return false;
+  }
+  uint32_t slot_idx;
+  if (bucket_page->Insert(key, value, comparator_, &slot_idx)) {
+    LogBucketEntry(transaction, LogRecordType::HASH_BUCKET_INSERT, bucket_page->GetPageId(), bucket_page, slot_idx);
+    return true;
+  }
+  InsertIntoOverflow(transaction, bucket_page, key, value);
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::InsertIntoOverflow(Transaction *transaction, HASH_TABLE_BUCKET_TYPE *bucket_page,
+                                         const KeyType &key, const ValueType &value) {
+  page_id_t overflow_page_id = bucket_page->GetOverflowPageId();
+  while (overflow_page_id != INVALID_PAGE_ID) {
+    HASH_TABLE_BUCKET_TYPE *overflow_page = FetchBucketPage(overflow_page_id);
+    uint32_t slot_idx;
+    bool inserted = overflow_page->Insert(key, value, comparator_, &slot_idx);
+    if (inserted) {
+      LogBucketEntry(transaction, LogRecordType::HASH_BUCKET_INSERT, overflow_page_id, overflow_page, slot_idx);
+    }
+    page_id_t next_page_id = overflow_page->GetOverflowPageId();
+    buffer_pool_manager_->UnpinPage(overflow_page_id, inserted);
+    if (inserted) {
+      return;
+    }
+    overflow_page_id = next_page_id;
+  }
+
+  // link a new overflow page in after the bucket, which is the only page whose link changes
+  HASH_TABLE_BUCKET_TYPE *overflow_page = CreateBucketPage(&overflow_page_id);
+  overflow_page->SetOverflowPageId(bucket_page->GetOverflowPageId());
+  bucket_page->SetOverflowPageId(overflow_page_id);
+  LogBucketImage(overflow_page);
+  LogBucketImage(bucket_page);
+  uint32_t slot_idx;
+  overflow_page->Insert(key, value, comparator_, &slot_idx);
+  LogBucketEntry(transaction, LogRecordType::HASH_BUCKET_INSERT, overflow_page_id, overflow_page, slot_idx);
+  buffer_pool_manager_->UnpinPage(overflow_page_id, true);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::MoveToChain(HASH_TABLE_BUCKET_TYPE *bucket_page, uint32_t chain_hash) {
+  // the moves are not part of any transaction, like those of a split
+  for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
+    if (!bucket_page->IsReadable(i) || (Hash(bucket_page->KeyAt(i)) & SPLITTABLE_HASH_MASK) != chain_hash) {
+      continue;
+    }
+    KeyType bucket_key = bucket_page->KeyAt(i);
+    ValueType bucket_value = bucket_page->ValueAt(i);
+    bucket_page->RemoveAt(i);
+    LogBucketEntry(nullptr, LogRecordType::HASH_BUCKET_REMOVE, bucket_page->GetPageId(), bucket_page, i);
+    InsertIntoOverflow(nullptr, bucket_page, bucket_key, bucket_value);
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_TYPE::ChainRemove(Transaction *transaction, HASH_TABLE_BUCKET_TYPE *bucket_page, const KeyType &key,
+                                  const ValueType &value) {
+  HASH_TABLE_BUCKET_TYPE *prev_page = bucket_page;
+  page_id_t page_id = bucket_page->GetOverflowPageId();
+  while (page_id != INVALID_PAGE_ID) {
+    HASH_TABLE_BUCKET_TYPE *page = FetchBucketPage(page_id);
+    uint32_t slot_idx;
+    bool removed = page->Remove(key, value, comparator_, &slot_idx);
+    bool unlink = removed && page->IsEmpty();
+    if (removed) {
+      LogBucketEntry(transaction, LogRecordType::HASH_BUCKET_REMOVE, page_id, page, slot_idx);
+    }
+    if (unlink) {
+      prev_page->SetOverflowPageId(page->GetOverflowPageId());
+      LogBucketImage(prev_page);
+    }
+    if (prev_page != bucket_page) {
+      buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), unlink);
+    }
+    if (removed) {
+      buffer_pool_manager_->UnpinPage(page_id, true);
+      if (unlink) {
+        FreePage(page_id);
+      }
+      return true;
+    }
+    prev_page = page;
+    page_id = page->GetOverflowPageId();
+  }
+  if (prev_page != bucket_page) {
+    buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), false);
+  }
+  return false;
+}
+
 /*****************************************************************************
  * MERGE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const ValueType &value) {
+bool HASH_TABLE_TYPE::Merge(uint32_t hash) {
   /*
    * Three conditions should not merge:
    * There are three conditions under which we skip the merge:
    * 1. The bucket is no longer empty.
    * 2. The bucket has local depth 0.
    * 3. The bucket's local depth doesn't match its split image's local depth.
+   *
+   * Buckets only merge within their directory page, directory pages do not merge. Like a split, a merge holds the
+   * directory page read-latched and write-latches the pair of buckets; only shrinking the directory write-latches it.
    */
-  table_latch_.WLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  uint32_t bucket_idx = KeyToDirectoryIndex(key, dir_page);
+  // first retry the pages an earlier merge could not delete
+  FreePage(INVALID_PAGE_ID);
+  HashTableDirectoryPage *dir_page = FetchDirectoryPageFor(hash, false);
+  uint32_t bucket_idx = (hash >> dir_page->GetHashShift()) & dir_page->GetGlobalDepthMask();
   uint32_t bucket_ld = dir_page->GetLocalDepth(bucket_idx);
 
   // 1.    Cal bucket_idx and local_depth, judge and then Load bucket_page
   // 1.1   condition 2: local_depth > 0.
   if (bucket_ld == 0) {
-    assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false));
-    table_latch_.WUnlock();
-    return;
+    ReleaseDirectoryPage(dir_page, false, false);
+    return false;
   }
-  // 1.2   condition 3: split_local_depth == bucket_local_depth
+  // 1.2   Latch the pair, the lower page id first, then check that neither was split or merged in the meantime
   uint32_t split_idx = dir_page->GetSplitImageIndex(bucket_idx);
-  uint32_t split_ld = dir_page->GetLocalDepth(split_idx);
-  if (split_ld != bucket_ld) {
-    assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false));
-    table_latch_.WUnlock();
-    return;
-  }
-  // 1.3   condition 1: Empty() == true
   page_id_t bucket_page_id = dir_page->GetBucketPageId(bucket_idx);
-  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
-  if (!bucket_page->IsEmpty()) {
-    assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false));
-    assert(buffer_pool_manager_->UnpinPage(bucket_page_id, false));
-    table_latch_.WUnlock();
-    return;
+  page_id_t split_page_id = dir_page->GetBucketPageId(split_idx);
+  if (bucket_page_id == split_page_id) {
+    ReleaseDirectoryPage(dir_page, false, false);
+    return false;
   }
+  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
+  HASH_TABLE_BUCKET_TYPE *split_page = FetchBucketPage(split_page_id);
+  auto *first = reinterpret_cast<Page *>(bucket_page_id < split_page_id ? bucket_page : split_page);
+  auto *second = reinterpret_cast<Page *>(bucket_page_id < split_page_id ? split_page : bucket_page);
+  first->WLatch();
+  second->WLatch();
+  // 1.3   condition 3: split_local_depth == bucket_local_depth, and condition 1: Empty() == true
+  bool merge = dir_page->GetBucketPageId(bucket_idx) == bucket_page_id &&
+               dir_page->GetBucketPageId(split_idx) == split_page_id &&
+               dir_page->GetLocalDepth(bucket_idx) == bucket_ld && dir_page->GetLocalDepth(split_idx) == bucket_ld &&
+               bucket_page->IsEmpty() && !bucket_page->HasOverflow();
 
-  // 2.    Set local_depth and page pointers which point bucket_page or split_page originally.
-  page_id_t split_page_id = dir_page->GetBucketPageId(split_idx);
-  for (uint32_t i = 0; i < dir_page->Size(); i++) {
-    page_id_t pid = dir_page->GetBucketPageId(i);
-    if (pid == bucket_page_id || pid == split_page_id) {
+  // 2.    Set local_depth and page pointers of the entries of both buckets, every 2^(local_depth-1)-th one.
+  if (merge) {
+    uint32_t step = 1U << (bucket_ld - 1);
+    for (uint32_t i = bucket_idx & (step - 1); i < dir_page->Size(); i += step) {
       dir_page->SetBucketPageId(i, split_page_id);
-      dir_page->SetLocalDepth(i, split_ld - 1);  // or dir_page->DecrLocalDepth(i)
+      dir_page->SetLocalDepth(i, bucket_ld - 1);  // or dir_page->DecrLocalDepth(i)
     }
+    LogDirectoryImage(dir_page);
+  }
+  bool merge_again = merge && split_page->IsEmpty() && !split_page->HasOverflow();
+  second->WUnlatch();
+  first->WUnlatch();
+  buffer_pool_manager_->UnpinPage(split_page_id, false);
+  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+  ReleaseDirectoryPage(dir_page, false, merge);
+  if (!merge) {
+    return false;
   }
 
   // 3. Delete bucket_page, before that, you should unpin page
-  assert(buffer_pool_manager_->UnpinPage(bucket_page_id, false));
-  buffer_pool_manager_->DeletePage(bucket_page_id);  // 这里不应该assert的，可能别的线程想要读取呢 就删不掉了
+  FreePage(bucket_page_id);  // 这里不应该assert的，可能别的线程想要读取呢 就删不掉了
 
   // 4.  After merge, check if can shrink.
+  dir_page = FetchDirectoryPageFor(hash, true);
+  bool shrunk = false;
   while (dir_page->CanShrink()) {
     dir_page->DecrGlobalDepth();
+    shrunk = true;
+  }
+  if (shrunk) {
+    LogDirectoryImage(dir_page);
   }
   // 5.  Unpin page
-  assert(buffer_pool_manager_->UnpinPage(directory_page_id_, true));
-  table_latch_.WUnlock();
+  ReleaseDirectoryPage(dir_page, true, shrunk);
+  return merge_again;
 }
 
-// 合并可能存在的另一半空桶  例如 00 10 指向空桶 01 指向非空 11变成空桶  再将11 和 01合并后再合并00 10对应的空桶
-// 额外的合并操作
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_TYPE::ExtraMerge(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  table_latch_.WLock();
-  auto dir_page = FetchDirectoryPage();
-  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
-  uint32_t index = KeyToDirectoryIndex(key, dir_page);
-  uint32_t local_depth = dir_page->GetLocalDepth(index);
-  uint32_t dir_size = dir_page->Size();
-  bool extra_merge_occur = false;
-  if (local_depth > 0) {
-    auto extra_bucket_idx = dir_page->GetSplitImageIndex(index);  // 计算合并完后对应桶
-    auto extra_local_depth = dir_page->GetLocalDepth(extra_bucket_idx);
-    auto extra_bucket_page_id = dir_page->GetBucketPageId(extra_bucket_idx);
-    auto *extra_bucket = FetchBucketPage(extra_bucket_page_id);
-    if (extra_local_depth == local_depth && extra_bucket->IsEmpty()) {
-      extra_merge_occur = true;
-      page_id_t tmp_bucket_page_id;
-      for (uint32_t i = 0; i < dir_size; i++) {
-        tmp_bucket_page_id = dir_page->GetBucketPageId(i);
-        if (tmp_bucket_page_id == extra_bucket_page_id) {  // 如果是空桶，更改指向并将深度减一
-          dir_page->SetBucketPageId(i, bucket_page_id);
-          dir_page->DecrLocalDepth(i);
-        } else if (tmp_bucket_page_id == bucket_page_id) {  // 原先桶只需将深度减一
-          dir_page->DecrLocalDepth(i);
-        }
-      }
-      buffer_pool_manager_->UnpinPage(extra_bucket_page_id, false, nullptr);  // 先unpin再删除
-      buffer_pool_manager_->DeletePage(extra_bucket_page_id, nullptr);
-      bool ret = dir_page->CanShrink();
-      if (ret) {  // 降低全局深度
-        dir_page->DecrGlobalDepth();
+bool HASH_TABLE_TYPE::QueueMerge(uint32_t hash) {
+  std::scoped_lock lock(merge_latch_);
+  if (!merge_running_) {
+    return false;
+  }
+  // the thread has fallen too far behind, the caller merges by itself
+  if (merge_queue_.size() >= MAX_MERGE_QUEUE) {
+    return false;
+  }
+  merge_queue_.push_back(hash);
+  merge_cv_.notify_all();
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::StartBackgroundMerge(size_t merges_per_round, std::chrono::milliseconds round_interval) {
+  std::scoped_lock lock(merge_latch_);
+  merges_per_round_ = merges_per_round;
+  merge_interval_ = round_interval;
+  if (!merge_running_) {
+    merge_running_ = true;
+    merge_thread_ = std::thread(&HASH_TABLE_TYPE::MergeLoop, this);
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::StopBackgroundMerge() {
+  {
+    std::scoped_lock lock(merge_latch_);
+    if (!merge_running_) {
+      return;
+    }
+    merge_running_ = false;
+    merge_stop_ = true;
+  }
+  merge_cv_.notify_all();
+  merge_thread_.join();
+
+  std::deque<uint32_t> hashes;
+  {
+    std::scoped_lock lock(merge_latch_);
+    merge_stop_ = false;
+    hashes.swap(merge_queue_);
+  }
+  for (uint32_t hash : hashes) {
+    while (Merge(hash)) {
+    }
+  }
+  FreePage(INVALID_PAGE_ID);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::WaitForMerges() {
+  std::unique_lock lock(merge_latch_);
+  merge_cv_.wait(lock, [this] { return !merge_running_ || (merge_queue_.empty() && !merging_); });
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::MergeLoop() {
+  std::unique_lock lock(merge_latch_);
+  while (true) {
+    merge_cv_.wait(lock, [this] { return merge_stop_ || !merge_queue_.empty(); });
+    if (merge_stop_) {
+      return;
+    }
+    size_t num_merges = std::min(merges_per_round_, merge_queue_.size());
+    std::vector<uint32_t> hashes(merge_queue_.begin(), merge_queue_.begin() + num_merges);
+    merge_queue_.erase(merge_queue_.begin(), merge_queue_.begin() + num_merges);
+    merging_ = true;
+    lock.unlock();
+
+    // a merge may leave an empty pair behind, which goes to the back of the queue
+    std::vector<uint32_t> merge_again;
+    for (uint32_t hash : hashes) {
+      if (Merge(hash)) {
+        merge_again.push_back(hash);
       }
     }
-    if (!extra_merge_occur) {  // 额外的合并未发生
-      buffer_pool_manager_->UnpinPage(extra_bucket_page_id, false, nullptr);
+
+    lock.lock();
+    merge_queue_.insert(merge_queue_.end(), merge_again.begin(), merge_again.end());
+    merging_ = false;
+    merge_cv_.notify_all();
+    // rate limit, so that a purge does not keep the pages of the table latched
+    merge_cv_.wait_for(lock, merge_interval_, [this] { return merge_stop_; });
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::FreePage(page_id_t page_id) {
+  std::vector<page_id_t> page_ids;
+  {
+    std::scoped_lock lock(merge_latch_);
+    page_ids.swap(unfreed_pages_);
+  }
+  if (page_id != INVALID_PAGE_ID) {
+    page_ids.push_back(page_id);
+  }
+  // an optimistic lookup may still have a page pinned, it is kept for the next call
+  std::vector<page_id_t> pinned;
+  for (page_id_t id : page_ids) {
+    if (!buffer_pool_manager_->DeletePage(id)) {
+      pinned.push_back(id);
     }
   }
-  buffer_pool_manager_->UnpinPage(bucket_page_id, false, nullptr);
-  buffer_pool_manager_->UnpinPage(directory_page_id_, true, nullptr);
-  table_latch_.WUnlock();
-  return extra_merge_occur;
+  if (!pinned.empty()) {
+    std::scoped_lock lock(merge_latch_);
+    unfreed_pages_.insert(unfreed_pages_.end(), pinned.begin(), pinned.end());
+  }
 }
+
 /*****************************************************************************
- * GETGLOBALDEPTH - DO NOT TOUCH
+ * LOGGING
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::LogBucketEntry(Transaction *transaction, LogRecordType type, page_id_t bucket_page_id,
+                                     HASH_TABLE_BUCKET_TYPE *bucket_page, uint32_t bucket_idx) {
+  if (!IsLogging()) {
+    return;
+  }
+  txn_id_t txn_id = transaction == nullptr ? INVALID_TXN_ID : transaction->GetTransactionId();
+  lsn_t prev_lsn = transaction == nullptr ? INVALID_LSN : transaction->GetPrevLSN();
+  // the entry is the fingerprint, the key and the value; a removed one is no longer readable through KeyAt()
+  std::string entry = bucket_page->EntryAt(bucket_idx);
+  KeyType key;
+  memcpy(&key, entry.data() + 1, sizeof(KeyType));
+  LogRecord log_record(txn_id, prev_lsn, type, bucket_page_id, header_page_id_, Hash(key),
+                       bucket_page->GetSlot(bucket_idx), entry.data());
+  lsn_t lsn = log_manager_->AppendLogRecord(&log_record);
+  bucket_page->SetLSN(lsn);
+  if (transaction != nullptr) {
+    transaction->SetPrevLSN(lsn);
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::LogDirectoryImage(HashTableDirectoryPage *dir_page) {
+  if (!IsLogging()) {
+    return;
+  }
+  // splits and merges change a directory page side by side, but the last image logged has to have all their changes
+  std::scoped_lock lock(directory_log_latch_);
+  LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::INDEX_PAGE_IMAGE, dir_page->GetPageId(),
+                       reinterpret_cast<const char *>(dir_page));
+  dir_page->SetLSN(log_manager_->AppendLogRecord(&log_record));
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::LogBucketImage(HASH_TABLE_BUCKET_TYPE *bucket_page) {
+  if (!IsLogging()) {
+    return;
+  }
+  LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::INDEX_PAGE_IMAGE, bucket_page->GetPageId(),
+                       reinterpret_cast<const char *>(bucket_page));
+  bucket_page->SetLSN(log_manager_->AppendLogRecord(&log_record));
+}
+
+/*****************************************************************************
+ * GETGLOBALDEPTH
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 uint32_t HASH_TABLE_TYPE::GetGlobalDepth() {
-  table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  uint32_t global_depth = dir_page->GetGlobalDepth();
-  assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr));
-  table_latch_.RUnlock();
+  HashTableDirectoryPage *header_page = FetchDirectoryPage(header_page_id_);
+  reinterpret_cast<Page *>(header_page)->RLatch();
+  uint32_t global_depth = 0;
+  for (uint32_t i = 0; i < header_page->Size(); i++) {
+    // the first header entry of each directory page
+    if ((i >> header_page->GetLocalDepth(i)) != 0) {
+      continue;
+    }
+    page_id_t directory_page_id = header_page->GetBucketPageId(i);
+    HashTableDirectoryPage *dir_page = FetchDirectoryPage(directory_page_id);
+    reinterpret_cast<Page *>(dir_page)->RLatch();
+    global_depth = std::max(global_depth, dir_page->GetHashShift() + dir_page->GetGlobalDepth());
+    reinterpret_cast<Page *>(dir_page)->RUnlatch();
+    buffer_pool_manager_->UnpinPage(directory_page_id, false, nullptr);
+  }
+  reinterpret_cast<Page *>(header_page)->RUnlatch();
+  buffer_pool_manager_->UnpinPage(header_page_id_, false, nullptr);
   return global_depth;
 }
 
 /*****************************************************************************
- * VERIFY INTEGRITY - DO NOT TOUCH
+ * VERIFY INTEGRITY
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_TYPE::VerifyIntegrity() {
-  table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  dir_page->VerifyIntegrity();
-  assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr));
-  table_latch_.RUnlock();
+  HashTableDirectoryPage *header_page = FetchDirectoryPage(header_page_id_);
+  reinterpret_cast<Page *>(header_page)->RLatch();
+  header_page->VerifyIntegrity();
+  // besides the invariants of each page, a directory page owns as many bits as the header says and its buckets
+  std::unordered_set<page_id_t> bucket_page_ids;
+  for (uint32_t i = 0; i < header_page->Size(); i++) {
+    if ((i >> header_page->GetLocalDepth(i)) != 0) {
+      continue;
+    }
+    page_id_t directory_page_id = header_page->GetBucketPageId(i);
+    HashTableDirectoryPage *dir_page = FetchDirectoryPage(directory_page_id);
+    reinterpret_cast<Page *>(dir_page)->RLatch();
+    assert(dir_page->GetHashShift() == header_page->GetLocalDepth(i));
+    dir_page->VerifyIntegrity();
+    for (uint32_t idx = 0; idx < dir_page->Size(); idx++) {
+      if ((idx >> dir_page->GetLocalDepth(idx)) == 0) {
+        bool inserted = bucket_page_ids.insert(dir_page->GetBucketPageId(idx)).second;
+        assert(inserted);
+        (void)inserted;
+      }
+    }
+    reinterpret_cast<Page *>(dir_page)->RUnlatch();
+    buffer_pool_manager_->UnpinPage(directory_page_id, false, nullptr);
+  }
+  reinterpret_cast<Page *>(header_page)->RUnlatch();
+  buffer_pool_manager_->UnpinPage(header_page_id_, false, nullptr);
 }
 
 // 测试方法
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_TYPE::PrintDir() {
-  table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  uint32_t dir_size = dir_page->Size();
+  HashTableDirectoryPage *header_page = FetchDirectoryPage(header_page_id_);
+  reinterpret_cast<Page *>(header_page)->RLatch();
+  header_page->PrintDirectory();
+  for (uint32_t i = 0; i < header_page->Size(); i++) {
+    if ((i >> header_page->GetLocalDepth(i)) != 0) {
+      continue;
+    }
+    page_id_t directory_page_id = header_page->GetBucketPageId(i);
+    HashTableDirectoryPage *dir_page = FetchDirectoryPage(directory_page_id);
+    reinterpret_cast<Page *>(dir_page)->RLatch();
+    uint32_t dir_size = dir_page->Size();
 
-  dir_page->PrintDirectory();
-  printf("dir size is: %d\n", dir_size);
-  for (uint32_t idx = 0; idx < dir_size; idx++) {
-    auto bucket_page_id = dir_page->GetBucketPageId(idx);
-    HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
-    bucket_page->PrintBucket();
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false, nullptr);
+    dir_page->PrintDirectory();
+    printf("dir size is: %d\n", dir_size);
+    for (uint32_t idx = 0; idx < dir_size; idx++) {
+      auto bucket_page_id = dir_page->GetBucketPageId(idx);
+      HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
+      bucket_page->PrintBucket();
+      buffer_pool_manager_->UnpinPage(bucket_page_id, false, nullptr);
+    }
+    reinterpret_cast<Page *>(dir_page)->RUnlatch();
+    buffer_pool_manager_->UnpinPage(directory_page_id, false, nullptr);
   }
-
-  assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr));
-  table_latch_.RUnlock();
+  reinterpret_cast<Page *>(header_page)->RUnlatch();
+  buffer_pool_manager_->UnpinPage(header_page_id_, false, nullptr);
 }
 
+// bucket_idx is taken as the low bits of a hash, the ones the header and the directory page resolve
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_TYPE::RemoveAllItem(Transaction *transaction, uint32_t bucket_idx) {
-  table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  auto bucket_page_id = dir_page->GetBucketPageId(bucket_idx);
+  HashTableDirectoryPage *dir_page = FetchDirectoryPageFor(bucket_idx, false);
+  auto bucket_page_id =
+      dir_page->GetBucketPageId((bucket_idx >> dir_page->GetHashShift()) & dir_page->GetGlobalDepthMask());
   HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
   auto items = bucket_page->GetAllItem();
   buffer_pool_manager_->UnpinPage(bucket_page_id, false, nullptr);
-  table_latch_.RUnlock();
+  ReleaseDirectoryPage(dir_page, false, false);
   for (auto &item : items) {
     Remove(nullptr, item.first, item.second);
   }
-
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr);
 }
 /*****************************************************************************
  * TEMPLATE DEFINITIONS - DO NOT TOUCH
@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <utility>
@@ -23,46 +24,255 @@
 namespace bustub {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-HASH_TABLE_TYPE::LinearProbeHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                                      const KeyComparator &comparator, size_t num_buckets,
-                                      HashFunction<KeyType> hash_fn)
-    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {}
+LINEAR_PROBE_HASH_TABLE_TYPE::LinearProbeHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
+                                                   const KeyComparator &comparator, size_t num_buckets,
+                                                   HashFunction<KeyType> hash_fn)
+    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
+  size_t num_blocks = num_buckets == 0 ? 1 : (num_buckets - 1) / BLOCK_ARRAY_SIZE + 1;
+  header_page_id_ = CreateTable(std::min(num_blocks, HashTableHeaderPage::MaxBlocks()));
+}
+
+/*****************************************************************************
+ * HELPERS
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+page_id_t LINEAR_PROBE_HASH_TABLE_TYPE::CreateTable(size_t num_blocks) {
+  page_id_t header_page_id;
+  auto header_page = reinterpret_cast<HashTableHeaderPage *>(buffer_pool_manager_->NewPage(&header_page_id)->GetData());
+  header_page->SetPageId(header_page_id);
+  for (size_t i = 0; i < num_blocks; i++) {
+    page_id_t block_page_id;
+    buffer_pool_manager_->NewPage(&block_page_id);
+    header_page->AddBlockPageId(block_page_id);
+    buffer_pool_manager_->UnpinPage(block_page_id, true);
+  }
+  header_page->SetSize(num_blocks * BLOCK_ARRAY_SIZE);
+  buffer_pool_manager_->UnpinPage(header_page_id, true);
+  return header_page_id;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void LINEAR_PROBE_HASH_TABLE_TYPE::DeleteTable(page_id_t header_page_id) {
+  auto header_page =
+      reinterpret_cast<HashTableHeaderPage *>(buffer_pool_manager_->FetchPage(header_page_id)->GetData());
+  for (size_t i = 0; i < header_page->NumBlocks(); i++) {
+    buffer_pool_manager_->DeletePage(header_page->GetBlockPageId(i));
+  }
+  buffer_pool_manager_->UnpinPage(header_page_id, false);
+  buffer_pool_manager_->DeletePage(header_page_id);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+size_t LINEAR_PROBE_HASH_TABLE_TYPE::NumSlots(page_id_t header_page_id) {
+  auto header_page =
+      reinterpret_cast<HashTableHeaderPage *>(buffer_pool_manager_->FetchPage(header_page_id)->GetData());
+  size_t size = header_page->GetSize();
+  buffer_pool_manager_->UnpinPage(header_page_id, false);
+  return size;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+template <typename Visitor>
+void LINEAR_PROBE_HASH_TABLE_TYPE::Probe(page_id_t header_page_id, const KeyType &key, Visitor visit) {
+  auto header_page =
+      reinterpret_cast<HashTableHeaderPage *>(buffer_pool_manager_->FetchPage(header_page_id)->GetData());
+  size_t size = header_page->GetSize();
+  size_t slot = hash_fn_.GetHash(key) % size;
+  page_id_t block_page_id = INVALID_PAGE_ID;
+  HASH_TABLE_BLOCK_TYPE *block_page = nullptr;
+  bool dirty = false;
+  for (size_t i = 0; i < size; i++, slot = (slot + 1) % size) {
+    // keep the block pinned while the probe stays in it
+    page_id_t slot_block_page_id = header_page->GetBlockPageId(slot / BLOCK_ARRAY_SIZE);
+    if (slot_block_page_id != block_page_id) {
+      if (block_page != nullptr) {
+        buffer_pool_manager_->UnpinPage(block_page_id, dirty);
+      }
+      block_page_id = slot_block_page_id;
+      block_page = reinterpret_cast<HASH_TABLE_BLOCK_TYPE *>(buffer_pool_manager_->FetchPage(block_page_id)->GetData());
+      dirty = false;
+    }
+    auto offset = static_cast<slot_offset_t>(slot % BLOCK_ARRAY_SIZE);
+    bool occupied = block_page->IsOccupied(offset);
+    if (visit(block_page, offset, &dirty) || !occupied) {
+      break;
+    }
+  }
+  buffer_pool_manager_->UnpinPage(block_page_id, dirty);
+  buffer_pool_manager_->UnpinPage(header_page_id, false);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool LINEAR_PROBE_HASH_TABLE_TYPE::GetValueFrom(page_id_t header_page_id, const KeyType &key,
+                                                std::vector<ValueType> *result) {
+  bool found = false;
+  Probe(header_page_id, key, [&](HASH_TABLE_BLOCK_TYPE *block_page, slot_offset_t slot, bool * /*dirty*/) {
+    if (block_page->IsReadable(slot) && comparator_(block_page->KeyAt(slot), key) == 0) {
+      result->push_back(block_page->ValueAt(slot));
+      found = true;
+    }
+    return false;
+  });
+  return found;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool LINEAR_PROBE_HASH_TABLE_TYPE::InsertInto(page_id_t header_page_id, const KeyType &key, const ValueType &value,
+                                              bool check_duplicate) {
+  bool inserted = false;
+  Probe(header_page_id, key, [&](HASH_TABLE_BLOCK_TYPE *block_page, slot_offset_t slot, bool *dirty) {
+    if (!block_page->IsOccupied(slot)) {
+      inserted = block_page->Insert(slot, key, value);
+      *dirty = true;
+      return true;
+    }
+    // duplicate values for the same key are not allowed
+    return check_duplicate && block_page->IsReadable(slot) && comparator_(block_page->KeyAt(slot), key) == 0 &&
+           block_page->ValueAt(slot) == value;
+  });
+  if (inserted) {
+    num_occupied_++;
+  }
+  return inserted;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool LINEAR_PROBE_HASH_TABLE_TYPE::FindIn(page_id_t header_page_id, const KeyType &key, const ValueType &value,
+                                          bool remove) {
+  bool found = false;
+  Probe(header_page_id, key, [&](HASH_TABLE_BLOCK_TYPE *block_page, slot_offset_t slot, bool *dirty) {
+    if (block_page->IsReadable(slot) && comparator_(block_page->KeyAt(slot), key) == 0 &&
+        block_page->ValueAt(slot) == value) {
+      if (remove) {
+        block_page->Remove(slot);
+        *dirty = true;
+      }
+      found = true;
+    }
+    return found;
+  });
+  return found;
+}
 
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) {
-  return false;
+bool LINEAR_PROBE_HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key,
+                                            std::vector<ValueType> *result) {
+  table_latch_.RLock();
+  bool found = GetValueFrom(header_page_id_, key, result);
+  if (old_header_page_id_ != INVALID_PAGE_ID) {
+    found = GetValueFrom(old_header_page_id_, key, result) || found;
+  }
+  table_latch_.RUnlock();
+  return found;
 }
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  return false;
+bool LINEAR_PROBE_HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) {
+  table_latch_.WLock();
+  MigrateBlocks(MIGRATE_BLOCKS_PER_WRITE);
+  // a pair that was not moved over yet is still a duplicate
+  bool inserted = (old_header_page_id_ == INVALID_PAGE_ID || !FindIn(old_header_page_id_, key, value, false)) &&
+                  InsertInto(header_page_id_, key, value, true);
+  size_t size = NumSlots(header_page_id_);
+  if (old_header_page_id_ == INVALID_PAGE_ID && 4 * num_occupied_ >= 3 * size) {
+    BeginResize(size);
+  }
+  table_latch_.WUnlock();
+  return inserted;
 }
 
 /*****************************************************************************
  * REMOVE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  return false;
+bool LINEAR_PROBE_HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) {
+  table_latch_.WLock();
+  MigrateBlocks(MIGRATE_BLOCKS_PER_WRITE);
+  bool removed = FindIn(header_page_id_, key, value, true) ||
+                 (old_header_page_id_ != INVALID_PAGE_ID && FindIn(old_header_page_id_, key, value, true));
+  table_latch_.WUnlock();
+  return removed;
 }
 
 /*****************************************************************************
  * RESIZE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-void HASH_TABLE_TYPE::Resize(size_t initial_size) {}
+void LINEAR_PROBE_HASH_TABLE_TYPE::Resize(size_t initial_size) {
+  table_latch_.WLock();
+  BeginResize(initial_size);
+  table_latch_.WUnlock();
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void LINEAR_PROBE_HASH_TABLE_TYPE::BeginResize(size_t initial_size) {
+  // finish the previous resize first, only two tables are ever kept
+  MigrateBlocks(HashTableHeaderPage::MaxBlocks());
+  size_t num_blocks =
+      std::min((2 * initial_size + BLOCK_ARRAY_SIZE - 1) / BLOCK_ARRAY_SIZE, HashTableHeaderPage::MaxBlocks());
+  if (num_blocks * BLOCK_ARRAY_SIZE <= NumSlots(header_page_id_)) {
+    // a header page can not list any more blocks, the table fills up in place
+    return;
+  }
+  old_header_page_id_ = header_page_id_;
+  header_page_id_ = CreateTable(num_blocks);
+  migrate_block_ = 0;
+  num_occupied_ = 0;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void LINEAR_PROBE_HASH_TABLE_TYPE::MigrateBlocks(size_t num_blocks) {
+  if (old_header_page_id_ == INVALID_PAGE_ID) {
+    return;
+  }
+  auto old_header_page =
+      reinterpret_cast<HashTableHeaderPage *>(buffer_pool_manager_->FetchPage(old_header_page_id_)->GetData());
+  size_t old_num_blocks = old_header_page->NumBlocks();
+  for (size_t i = 0; i < num_blocks && migrate_block_ < old_num_blocks; i++, migrate_block_++) {
+    page_id_t block_page_id = old_header_page->GetBlockPageId(migrate_block_);
+    auto block_page =
+        reinterpret_cast<HASH_TABLE_BLOCK_TYPE *>(buffer_pool_manager_->FetchPage(block_page_id)->GetData());
+    for (slot_offset_t slot = 0; slot < BLOCK_ARRAY_SIZE; slot++) {
+      if (!block_page->IsReadable(slot)) {
+        continue;
+      }
+      // the pairs in the two tables are distinct, so the new one needs no duplicate check. The moved slot becomes a
+      // tombstone so that probes of the old table stay correct, tombstones themselves are left behind.
+      InsertInto(header_page_id_, block_page->KeyAt(slot), block_page->ValueAt(slot), false);
+      block_page->Remove(slot);
+    }
+    buffer_pool_manager_->UnpinPage(block_page_id, true);
+  }
+  buffer_pool_manager_->UnpinPage(old_header_page_id_, false);
+  if (migrate_block_ == old_num_blocks) {
+    DeleteTable(old_header_page_id_);
+    old_header_page_id_ = INVALID_PAGE_ID;
+    migrate_block_ = 0;
+  }
+}
 
 /*****************************************************************************
  * GETSIZE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-size_t HASH_TABLE_TYPE::GetSize() {
-  return 0;
+size_t LINEAR_PROBE_HASH_TABLE_TYPE::GetSize() {
+  table_latch_.RLock();
+  size_t size = NumSlots(header_page_id_);
+  table_latch_.RUnlock();
+  return size;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool LINEAR_PROBE_HASH_TABLE_TYPE::IsResizing() {
+  table_latch_.RLock();
+  bool resizing = old_header_page_id_ != INVALID_PAGE_ID;
+  table_latch_.RUnlock();
+  return resizing;
 }
 
 template class LinearProbeHashTable<int, int, IntComparator>;
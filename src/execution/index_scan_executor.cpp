@@ -11,12 +11,139 @@
 //===----------------------------------------------------------------------===//
 #include "execution/executors/index_scan_executor.h"
 
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "execution/expressions/column_value_expression.h"
+#include "type/value_factory.h"
+
 namespace bustub {
+
+namespace {
+
+/** Iterates over the RIDs of a point lookup, for an index without range scans. */
+class PointLookupIterator : public IndexScanIterator {
+ public:
+  explicit PointLookupIterator(std::vector<RID> rids) : rids_(std::move(rids)) {}
+
+  bool Next(Tuple * /* key */, RID *rid) override {
+    if (next_ == rids_.size()) {
+      return false;
+    }
+    *rid = rids_[next_++];
+    return true;
+  }
+
+ private:
+  std::vector<RID> rids_;
+  size_t next_{0};
+};
+
+/** Keys built over the same key schema hold the same values iff they have the same bytes. */
+bool SameKey(const Tuple &key, const Tuple &other_key) {
+  return key.GetLength() == other_key.GetLength() && memcmp(key.GetData(), other_key.GetData(), key.GetLength()) == 0;
+}
+
+}  // namespace
+
 IndexScanExecutor::IndexScanExecutor(ExecutorContext *exec_ctx, const IndexScanPlanNode *plan)
-    : AbstractExecutor(exec_ctx) {}
+    : AbstractExecutor(exec_ctx), plan_(plan) {
+  Catalog *catalog = exec_ctx_->GetCatalog();
+  index_info_ = catalog->GetIndex(plan_->GetIndexOid());
+  table_info_ = catalog->GetTable(index_info_->table_name_);
+}
+
+void IndexScanExecutor::Init() {
+  Index *index = index_info_->index_.get();
+  if (index->SupportsRangeScan()) {
+    iter_ = index->ScanRange(plan_->GetLowKey(), plan_->GetHighKey(), plan_->IsReverse(), exec_ctx_->GetTransaction());
+  } else {
+    // a hash index only looks up the low key, which the plan must set to the high key too
+    if (plan_->GetLowKey() == nullptr || plan_->GetHighKey() == nullptr ||
+        !SameKey(*plan_->GetLowKey(), *plan_->GetHighKey())) {
+      throw NotImplementedException("a hash index only serves point lookups");
+    }
+    std::vector<RID> rids;
+    index->ScanKey(*plan_->GetLowKey(), &rids, exec_ctx_->GetTransaction());
+    iter_ = std::make_unique<PointLookupIterator>(std::move(rids));
+  }
+  const Schema *output_schema = plan_->OutputSchema();
+  index_only_ = index->ReturnsKeys();
+  for (uint32_t i = 0; i < output_schema->GetColumnCount() && index_only_; i++) {
+    index_only_ = CoveredByKey(output_schema->GetColumn(i).GetExpr());
+  }
+}
+
+bool IndexScanExecutor::Next(Tuple *tuple, RID *rid) {
+  auto transaction = exec_ctx_->GetTransaction();
+  auto lockmanager = exec_ctx_->GetLockManager();
+  Tuple key;
+  RID tmp_rid;
+  while (iter_->Next(&key, &tmp_rid)) {
+    // RC and RR need to lock. if has been locked, no effect.
+    if (transaction->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED &&
+        !transaction->IsExclusiveLocked(tmp_rid) && !transaction->IsSharedLocked(tmp_rid)) {
+      lockmanager->LockShared(transaction, tmp_rid);
+    }
+
+    Tuple table_tuple;
+    bool found = true;
+    if (index_only_) {
+      table_tuple = KeyToTableTuple(key);
+    } else {
+      found = table_info_->table_->GetTuple(tmp_rid, &table_tuple, transaction);
+    }
+    const Schema *output_schema = plan_->OutputSchema();
+    std::vector<Value> vals;
+    if (found) {
+      vals.reserve(output_schema->GetColumnCount());
+      for (size_t i = 0; i < output_schema->GetColumnCount(); i++) {
+        vals.push_back(output_schema->GetColumn(i).GetExpr()->Evaluate(&table_tuple, &(table_info_->schema_)));
+      }
+    }
+    // == If is RC, and is read lock, we can release lock.
+    if (transaction->GetIsolationLevel() == IsolationLevel::READ_COMMITTED && transaction->IsSharedLocked(tmp_rid)) {
+      lockmanager->Unlock(transaction, tmp_rid);
+    }
+    if (!found) {
+      continue;
+    }
+    Tuple tmp_tuple(vals, output_schema);
+    const AbstractExpression *predicate = plan_->GetPredicate();
+    if (predicate == nullptr || predicate->Evaluate(&tmp_tuple, output_schema).GetAs<bool>()) {
+      *rid = tmp_rid;
+      *tuple = tmp_tuple;
+      return true;
+    }
+  }
+  return false;
+}
 
-void IndexScanExecutor::Init() {}
+bool IndexScanExecutor::CoveredByKey(const AbstractExpression *expr) const {
+  if (const auto *column = dynamic_cast<const ColumnValueExpression *>(expr); column != nullptr) {
+    const auto &key_attrs = index_info_->index_->GetKeyAttrs();
+    return std::find(key_attrs.begin(), key_attrs.end(), column->GetColIdx()) != key_attrs.end();
+  }
+  return std::all_of(expr->GetChildren().begin(), expr->GetChildren().end(),
+                     [this](const AbstractExpression *child) { return CoveredByKey(child); });
+}
 
-bool IndexScanExecutor::Next(Tuple *tuple, RID *rid) { return false; }
+Tuple IndexScanExecutor::KeyToTableTuple(const Tuple &key) const {
+  const Schema &schema = table_info_->schema_;
+  const auto &key_attrs = index_info_->index_->GetKeyAttrs();
+  std::vector<Value> values;
+  values.reserve(schema.GetColumnCount());
+  for (uint32_t i = 0; i < schema.GetColumnCount(); i++) {
+    // the output never reads these, a null varchar cannot be serialized into a tuple though
+    TypeId type = schema.GetColumn(i).GetType();
+    values.push_back(type == TypeId::VARCHAR ? ValueFactory::GetVarcharValue("")
+                                             : ValueFactory::GetNullValueByType(type));
+  }
+  for (uint32_t i = 0; i < key_attrs.size(); i++) {
+    values[key_attrs[i]] = key.GetValue(index_info_->index_->GetKeySchema(), i);
+  }
+  return Tuple(values, &schema);
+}
 
 }  // namespace bustub
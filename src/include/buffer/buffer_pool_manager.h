@@ -84,6 +84,13 @@ class BufferPoolManager {
     GradingCallback(callback, CallbackType::AFTER, INVALID_PAGE_ID);
   }
 
+  /**
+   * Hint that a page will be fetched soon, so that it can be read into the buffer pool in the background. The page
+   * is not pinned and may be evicted again before it is fetched.
+   * @param page_id id of the page to read ahead
+   */
+  void PrefetchPage(page_id_t page_id) { PrefetchPgImp(page_id); }
+
   /** @return size of the buffer pool */
   virtual size_t GetPoolSize() = 0;
 
@@ -141,5 +148,11 @@ class BufferPoolManager {
    * Flushes all the pages in the buffer pool to disk.
    */
   virtual void FlushAllPgsImp() = 0;
+
+  /**
+   * Read a page into the buffer pool ahead of its fetch. By default the hint is ignored.
+   * @param page_id id of page to be read ahead
+   */
+  virtual void PrefetchPgImp(page_id_t /* page_id */) {}
 };
 }  // namespace bustub
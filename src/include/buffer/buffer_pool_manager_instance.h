@@ -12,9 +12,14 @@
 
 #pragma once
 
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <list>
 #include <mutex>  // NOLINT
+#include <set>
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <unordered_set>
 
 #include "buffer/buffer_pool_manager.h"
 #include "buffer/lru_replacer.h"
@@ -102,18 +107,28 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   void FlushAllPgsImp() override;
 
   /**
-   * Allocate a page on disk.∂
+   * Queue a page that is not in the buffer pool for the prefetch thread, which is started on first use.
+   * @param page_id id of page to be read ahead
+   */
+  void PrefetchPgImp(page_id_t page_id) override;
+
+  /**
+   * Body of the prefetch thread: read queued pages into unpinned frames until the instance is destroyed. A page is
+   * read without the latch into a frame that is reserved, pinned, in the page table while the read is in flight.
+   */
+  void PrefetchLoop();
+
+  /**
+   * Allocate a page on disk, reusing the lowest deallocated page id if there is one. Called with latch_ held.
    * @return the id of the allocated page
    */
   page_id_t AllocatePage();
 
   /**
-   * Deallocate a page on disk.
+   * Deallocate a page on disk, so that its id can be allocated again. Called with latch_ held.
    * @param page_id id of the page to deallocate
    */
-  void DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-    // This is a no-nop right now without a more complex data structure to track deallocated pages
-  }
+  void DeallocatePage(page_id_t page_id);
 
   /**
    * Validate that the page_id being used is accessible to this BPI. This can be used in all of the functions to
@@ -143,7 +158,26 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   Replacer *replacer_;
   /** List of free pages. */
   std::list<frame_id_t> free_list_;
+  /** Deallocated page ids, protected by latch_. Kept in memory only: the pages they name leak on a restart. */
+  std::set<page_id_t> free_page_ids_;
   /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
   std::mutex latch_;
+
+  /** Most pages waiting to be prefetched, further hints are dropped. */
+  static constexpr size_t MAX_PREFETCH_QUEUE = 16;
+  /** Pages waiting to be prefetched, protected by latch_. */
+  std::deque<page_id_t> prefetch_queue_;
+  /** The pages in prefetch_queue_, protected by latch_. */
+  std::unordered_set<page_id_t> prefetch_queued_;
+  /** The page the prefetch thread is reading in, INVALID_PAGE_ID if none, protected by latch_. */
+  page_id_t prefetch_reading_{INVALID_PAGE_ID};
+  /** Signals the threads waiting for prefetch_reading_ that its read is done. */
+  std::condition_variable prefetch_read_cv_;
+  /** Signals the prefetch thread that pages were queued or the instance is going away. */
+  std::condition_variable prefetch_cv_;
+  /** Set, under latch_, to stop the prefetch thread. */
+  bool prefetch_stop_{false};
+  /** Reads queued pages in the background, started by the first prefetch hint. */
+  std::thread prefetch_thread_;
 };
 }  // namespace bustub
@@ -96,6 +96,12 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    */
   void FlushAllPgsImp() override;
 
+  /**
+   * Pass a prefetch hint on to the responsible BufferPoolManagerInstance.
+   * @param page_id id of page to be read ahead
+   */
+  void PrefetchPgImp(page_id_t page_id) override;
+
  private:
   std::mutex m_latch_;
   // pool_size for every bmp
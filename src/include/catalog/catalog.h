@@ -21,8 +21,12 @@
 #include "buffer/buffer_pool_manager.h"
 #include "catalog/schema.h"
 #include "container/hash/hash_function.h"
+#include "storage/index/adaptive_radix_tree_index.h"
+#include "storage/index/b_plus_tree_index.h"
 #include "storage/index/extendible_hash_table_index.h"
 #include "storage/index/index.h"
+#include "storage/index/linear_probe_hash_table_index.h"
+#include "storage/index/varlen_b_plus_tree_index.h"
 #include "storage/table/table_heap.h"
 
 namespace bustub {
@@ -69,15 +73,17 @@ struct IndexInfo {
    * @param index_oid The unique OID for the index
    * @param table_name The name of the table on which the index is created
    * @param key_size The size of the index key, in bytes
+   * @param index_type The structure of the index
    */
   IndexInfo(Schema key_schema, std::string name, std::unique_ptr<Index> &&index, index_oid_t index_oid,
-            std::string table_name, size_t key_size)
+            std::string table_name, size_t key_size, IndexType index_type)
       : key_schema_{std::move(key_schema)},
         name_{std::move(name)},
         index_{std::move(index)},
         index_oid_{index_oid},
         table_name_{std::move(table_name)},
-        key_size_{key_size} {}
+        key_size_{key_size},
+        index_type_{index_type} {}
   /** The schema for the index key */
   Schema key_schema_;
   /** The name of the index */
@@ -90,6 +96,16 @@ struct IndexInfo {
   std::string table_name_;
   /** The size of the index key, in bytes */
   const size_t key_size_;
+  /** The structure of the index */
+  const IndexType index_type_;
+};
+
+/** How a query reads an index, see Catalog::GetIndexForAccess(). */
+enum class IndexAccess {
+  /** Look up the tuples with one key */
+  POINT,
+  /** Scan the tuples in a key range, or in key order */
+  RANGE
 };
 
 /**
@@ -185,13 +201,18 @@ class Catalog {
    * @param key_schema The schema of the key
    * @param key_attrs Key attributes
    * @param keysize Size of the key
-   * @param hash_function The hash function for the index
+   * @param hash_function The hash function for the index, unused by the B+ trees
+   * @param index_type The structure of the index; KeyType, KeyComparator and keysize are unused by a
+   * VARLEN_B_PLUS_TREE and an ADAPTIVE_RADIX_TREE, which store whole normalized keys. An ADAPTIVE_RADIX_TREE is held
+   * in memory only and is built from the table heap here. The EXTENDIBLE_HASH and B_PLUS_TREE indexes log their page
+   * changes, a VARLEN_B_PLUS_TREE doesn't and has to be rebuilt from the table heap after a crash.
    * @return A (non-owning) pointer to the metadata of the new table
    */
   template <class KeyType, class ValueType, class KeyComparator>
   IndexInfo *CreateIndex(Transaction *txn, const std::string &index_name, const std::string &table_name,
                          const Schema &schema, const Schema &key_schema, const std::vector<uint32_t> &key_attrs,
-                         std::size_t keysize, HashFunction<KeyType> hash_function) {
+                         std::size_t keysize, HashFunction<KeyType> hash_function,
+                         IndexType index_type = IndexType::EXTENDIBLE_HASH) {
     // Reject the creation request for nonexistent table
     if (table_names_.find(table_name) == table_names_.end()) {
       return NULL_INDEX_INFO;
@@ -211,25 +232,50 @@ class Catalog {
     auto meta = std::make_unique<IndexMetadata>(index_name, table_name, &schema, key_attrs);
 
     // Construct the index, take ownership of metadata
-    // TODO(Kyle): We should update the API for CreateIndex
-    // to allow specification of the index type itself, not
-    // just the key, value, and comparator types
-    auto index = std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_,
-                                                                                               hash_function);
+    std::unique_ptr<Index> index;
+    switch (index_type) {
+      case IndexType::EXTENDIBLE_HASH:
+        index = std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(
+            std::move(meta), bpm_, hash_function, log_manager_);
+        break;
+      case IndexType::B_PLUS_TREE:
+        index = std::make_unique<BPlusTreeIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_,
+                                                                                    GetHeaderPageId(), log_manager_);
+        break;
+      case IndexType::LINEAR_PROBE_HASH:
+        index = std::make_unique<LinearProbeHashTableIndex<KeyType, ValueType, KeyComparator>>(
+            std::move(meta), bpm_, LINEAR_PROBE_HASH_BUCKETS, hash_function);
+        break;
+      case IndexType::VARLEN_B_PLUS_TREE:
+        index = std::make_unique<VarlenBPlusTreeIndex>(std::move(meta), bpm_, GetHeaderPageId());
+        break;
+      case IndexType::ADAPTIVE_RADIX_TREE:
+        index = std::make_unique<AdaptiveRadixTreeIndex>(std::move(meta));
+        break;
+    }
 
     // Populate the index with all tuples in table heap
     auto *table_meta = GetTable(table_name);
     auto *heap = table_meta->table_.get();
-    for (auto tuple = heap->Begin(txn); tuple != heap->End(); ++tuple) {
-      index->InsertEntry(tuple->KeyFromTuple(schema, key_schema, key_attrs), tuple->GetRid(), txn);
-    }
+    auto tuple = heap->Begin(txn);
+    index->BulkInsertEntries(
+        [&](Tuple *key, RID *rid) {
+          if (tuple == heap->End()) {
+            return false;
+          }
+          *key = tuple->KeyFromTuple(schema, key_schema, key_attrs);
+          *rid = tuple->GetRid();
+          ++tuple;
+          return true;
+        },
+        txn);
 
     // Get the next OID for the new index
     const auto index_oid = next_index_oid_.fetch_add(1);
 
     // Construct index information; IndexInfo takes ownership of the Index itself
-    auto index_info =
-        std::make_unique<IndexInfo>(key_schema, index_name, std::move(index), index_oid, table_name, keysize);
+    auto index_info = std::make_unique<IndexInfo>(key_schema, index_name, std::move(index), index_oid, table_name,
+                                                  keysize, index_type);
     auto *tmp = index_info.get();
 
     // Update internal tracking
@@ -322,7 +368,51 @@ class Catalog {
     return indexes;
   }
 
+  /**
+   * Pick the index of a table that best serves an access to the given key columns: the one whose key is made of
+   * exactly these columns, a hash index for point lookups if there is one, and an ordered index for range scans.
+   * @param table_name The name of the table to access
+   * @param key_attrs The table columns the access is keyed on, in key order
+   * @param access How the index is going to be read
+   * @return A (non-owning) pointer to the metadata for the index, NULL_INDEX_INFO if no index serves the access
+   */
+  IndexInfo *GetIndexForAccess(const std::string &table_name, const std::vector<uint32_t> &key_attrs,
+                               IndexAccess access) {
+    IndexInfo *best = NULL_INDEX_INFO;
+    for (auto *index_info : GetTableIndexes(table_name)) {
+      if (index_info->index_->GetKeyAttrs() != key_attrs) {
+        continue;
+      }
+      if (access == IndexAccess::RANGE) {
+        if (index_info->index_->SupportsRangeScan()) {
+          return index_info;
+        }
+        continue;
+      }
+      // any index answers a point lookup, a hash table in a single probe
+      if (best == NULL_INDEX_INFO || !index_info->index_->SupportsRangeScan()) {
+        best = index_info;
+      }
+    }
+    return best;
+  }
+
  private:
+  /** The initial number of buckets of a linear probing hash index. */
+  static constexpr size_t LINEAR_PROBE_HASH_BUCKETS = 1024;
+
+  /** @return The page the B+ tree indexes record their root pages in, created on first use */
+  page_id_t GetHeaderPageId() {
+    if (header_page_id_ == INVALID_PAGE_ID) {
+      Page *page = bpm_->NewPage(&header_page_id_);
+      if (page == nullptr) {
+        throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate the index header page");
+      }
+      bpm_->UnpinPage(header_page_id_, true);
+    }
+    return header_page_id_;
+  }
+
   [[maybe_unused]] BufferPoolManager *bpm_;
   [[maybe_unused]] LockManager *lock_manager_;
   [[maybe_unused]] LogManager *log_manager_;
@@ -352,6 +442,9 @@ class Catalog {
 
   /** The next index identifier to be used. */
   std::atomic<index_oid_t> next_index_oid_{0};
+
+  /** The header page of the B+ tree indexes, INVALID_PAGE_ID until the first one is created. */
+  page_id_t header_page_id_{INVALID_PAGE_ID};
 };
 
 }  // namespace bustub
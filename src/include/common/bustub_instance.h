@@ -23,14 +23,14 @@ namespace bustub {
 
 class BustubInstance {
  public:
-  explicit BustubInstance(const std::string &db_file_name) {
+  explicit BustubInstance(const std::string &db_file_name, int num_log_streams = 1) {
     enable_logging = false;
 
     // storage related
     disk_manager_ = new DiskManager(db_file_name);
 
     // log related
-    log_manager_ = new LogManager(disk_manager_);
+    log_manager_ = new LogManager(disk_manager_, num_log_streams);
 
     buffer_pool_manager_ = new BufferPoolManagerInstance(BUFFER_POOL_SIZE, disk_manager_, log_manager_);
 
@@ -0,0 +1,178 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// external_sorter.h
+//
+// Identification: src/include/common/util/external_sorter.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/exception.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * ExternalSorter sorts a stream of fixed-size items that need not fit in memory. Items are buffered until a run is
+ * full, then the run is sorted and spilled to a temporary file. Sort() merges the spilled runs into a single file,
+ * so Size() is exact before the items are read back in order with Next().
+ *
+ * The sort is stable: items that compare equal come back in the order they were added. With unique set, only the
+ * first added of them is kept.
+ */
+template <typename ItemType, typename Less>
+class ExternalSorter {
+  static_assert(std::is_trivially_copy_constructible_v<ItemType> && std::is_trivially_destructible_v<ItemType>,
+                "items are spilled to disk byte by byte");
+
+ public:
+  /** Default number of items sorted in memory at once. */
+  static constexpr size_t DEFAULT_RUN_SIZE = 1 << 18;
+
+  /**
+   * @param less strict weak ordering of the items
+   * @param unique drop duplicate items
+   * @param run_size number of items sorted in memory before a run is spilled
+   */
+  explicit ExternalSorter(Less less, bool unique = false, size_t run_size = DEFAULT_RUN_SIZE)
+      : less_(std::move(less)), unique_(unique), run_size_(std::max<size_t>(run_size, 1)) {}
+
+  ~ExternalSorter() {
+    for (FILE *run : runs_) {
+      fclose(run);
+    }
+  }
+
+  DISALLOW_COPY_AND_MOVE(ExternalSorter);
+
+  /** Add an item. May not be called after Sort(). */
+  void Add(const ItemType &item) {
+    buffer_.push_back(item);
+    if (buffer_.size() >= run_size_) {
+      SpillRun();
+    }
+  }
+
+  /** Sort the items added so far. */
+  void Sort() {
+    if (runs_.empty()) {
+      SortBuffer();
+      size_ = buffer_.size();
+      return;
+    }
+    SpillRun();
+    MergeRuns();
+  }
+
+  /** @return the number of sorted items, valid after Sort() */
+  size_t Size() const { return size_; }
+
+  /**
+   * Read back the next item in sorted order.
+   * @param[out] item the next item
+   * @return false once all items were returned
+   */
+  bool Next(ItemType *item) {
+    if (runs_.empty()) {
+      if (next_ == buffer_.size()) {
+        return false;
+      }
+      *item = buffer_[next_++];
+      return true;
+    }
+    return fread(item, sizeof(ItemType), 1, runs_[0]) == 1;
+  }
+
+ private:
+  void SortBuffer() {
+    std::stable_sort(buffer_.begin(), buffer_.end(), less_);
+    if (unique_) {
+      buffer_.erase(std::unique(buffer_.begin(), buffer_.end(), [this](const ItemType &a, const ItemType &b) {
+                      return !less_(a, b) && !less_(b, a);
+                    }),
+                    buffer_.end());
+    }
+  }
+
+  /** Sort the buffered items and write them to a new temporary file. */
+  void SpillRun() {
+    SortBuffer();
+    FILE *run = std::tmpfile();
+    if (run == nullptr) {
+      throw Exception("cannot create temporary file for sort run");
+    }
+    runs_.push_back(run);
+    if (!buffer_.empty() && fwrite(buffer_.data(), sizeof(ItemType), buffer_.size(), run) != buffer_.size()) {
+      throw Exception("cannot write sort run");
+    }
+    buffer_.clear();
+  }
+
+  /** Merge all runs into a single one, which then replaces them. */
+  void MergeRuns() {
+    FILE *merged = std::tmpfile();
+    if (merged == nullptr) {
+      throw Exception("cannot create temporary file for sort run");
+    }
+
+    // min-heap of (head item, run number), equal items come from the earlier run first to keep the sort stable
+    using Head = std::pair<ItemType, size_t>;
+    auto greater = [this](const Head &a, const Head &b) {
+      return less_(b.first, a.first) || (!less_(a.first, b.first) && a.second > b.second);
+    };
+    std::priority_queue<Head, std::vector<Head>, decltype(greater)> heads(greater);
+    for (size_t i = 0; i < runs_.size(); i++) {
+      rewind(runs_[i]);
+      ItemType item;
+      if (fread(&item, sizeof(ItemType), 1, runs_[i]) == 1) {
+        heads.emplace(item, i);
+      }
+    }
+
+    size_ = 0;
+    ItemType last{};
+    while (!heads.empty()) {
+      auto [item, run] = heads.top();
+      heads.pop();
+      if (!unique_ || size_ == 0 || less_(last, item)) {
+        if (fwrite(&item, sizeof(ItemType), 1, merged) != 1) {
+          throw Exception("cannot write sort run");
+        }
+        last = item;
+        size_++;
+      }
+      if (fread(&item, sizeof(ItemType), 1, runs_[run]) == 1) {
+        heads.emplace(item, run);
+      }
+    }
+
+    for (FILE *run : runs_) {
+      fclose(run);
+    }
+    rewind(merged);
+    runs_ = {merged};
+  }
+
+  Less less_;
+  bool unique_;
+  size_t run_size_;
+  std::vector<ItemType> buffer_;
+  size_t next_{0};
+  size_t size_{0};
+  std::vector<FILE *> runs_;
+};
+
+}  // namespace bustub
@@ -13,7 +13,9 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
 
@@ -27,6 +29,21 @@ using hash_t = std::size_t;
 class HashUtil {
  private:
   static const hash_t PRIME_FACTOR = 10000019;
+  static constexpr uint64_t WY_SECRET0 = 0xa0761d6478bd642fULL;
+  static constexpr uint64_t WY_SECRET1 = 0xe7037ed1a0b428dbULL;
+  static constexpr uint64_t WY_SECRET2 = 0x8ebc6af09c88c6e3ULL;
+
+  /** @return the 128-bit product of a and b with its halves folded together */
+  static inline uint64_t Mum(uint64_t a, uint64_t b) {
+    __uint128_t product = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+  }
+
+  static inline uint64_t ReadWord(const char *bytes) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    return word;
+  }
 
  public:
   static inline hash_t HashBytes(const char *bytes, size_t length) {
@@ -38,11 +55,34 @@ class HashUtil {
     return hash;
   }
 
+  /** @return a mix of x in which every bit of x affects every bit, the 64-bit finalizer of murmur3 */
+  static inline uint64_t HashInteger(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+  }
+
+  /**
+   * @return a 64-bit hash of length bytes. 16 bytes are folded in per step with a 128-bit multiply of the two words
+   * against the state, as wyhash does, which takes far fewer instructions per byte than murmur3 or HashBytes.
+   */
+  static inline uint64_t HashBytesFast(const char *bytes, size_t length) {
+    uint64_t seed = WY_SECRET0 ^ length;
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+      seed = Mum(ReadWord(bytes + i) ^ WY_SECRET1, ReadWord(bytes + i + 8) ^ seed);
+    }
+    uint64_t words[2] = {0, 0};
+    memcpy(words, bytes + i, length - i);
+    return Mum(WY_SECRET1 ^ length, Mum(words[0] ^ WY_SECRET2, words[1] ^ seed));
+  }
+
   static inline hash_t CombineHashes(hash_t l, hash_t r) {
-    hash_t both[2] = {};
-    both[0] = l;
-    both[1] = r;
-    return HashBytes(reinterpret_cast<char *>(both), sizeof(hash_t) * 2);
+    // rotate l so that the order of the hashes matters
+    return HashInteger(((l << 31) | (l >> 33)) ^ r);
   }
 
   static inline hash_t SumHashes(hash_t l, hash_t r) { return (l % PRIME_FACTOR + r % PRIME_FACTOR) % PRIME_FACTOR; }
@@ -60,42 +100,48 @@ class HashUtil {
   /** @return the hash of the value */
   static inline hash_t HashValue(const Value *val) {
     switch (val->GetTypeId()) {
-      case TypeId::TINYINT: {
-        auto raw = static_cast<int64_t>(val->GetAs<int8_t>());
-        return Hash<int64_t>(&raw);
-      }
-      case TypeId::SMALLINT: {
-        auto raw = static_cast<int64_t>(val->GetAs<int16_t>());
-        return Hash<int64_t>(&raw);
-      }
-      case TypeId::INTEGER: {
-        auto raw = static_cast<int64_t>(val->GetAs<int32_t>());
-        return Hash<int64_t>(&raw);
-      }
-      case TypeId::BIGINT: {
-        auto raw = static_cast<int64_t>(val->GetAs<int64_t>());
-        return Hash<int64_t>(&raw);
-      }
-      case TypeId::BOOLEAN: {
-        auto raw = val->GetAs<bool>();
-        return Hash<bool>(&raw);
-      }
+      case TypeId::TINYINT:
+        return HashInteger(static_cast<int64_t>(val->GetAs<int8_t>()));
+      case TypeId::SMALLINT:
+        return HashInteger(static_cast<int64_t>(val->GetAs<int16_t>()));
+      case TypeId::INTEGER:
+        return HashInteger(static_cast<int64_t>(val->GetAs<int32_t>()));
+      case TypeId::BIGINT:
+        return HashInteger(static_cast<int64_t>(val->GetAs<int64_t>()));
+      case TypeId::BOOLEAN:
+        return HashInteger(static_cast<uint64_t>(val->GetAs<bool>()));
       case TypeId::DECIMAL: {
         auto raw = val->GetAs<double>();
-        return Hash<double>(&raw);
+        uint64_t bits;
+        memcpy(&bits, &raw, sizeof(bits));
+        return HashInteger(bits);
       }
       case TypeId::VARCHAR: {
         auto raw = val->GetData();
         auto len = val->GetLength();
-        return HashBytes(raw, len);
-      }
-      case TypeId::TIMESTAMP: {
-        auto raw = val->GetAs<uint64_t>();
-        return Hash<uint64_t>(&raw);
+        return HashBytesFast(raw, len);
       }
+      case TypeId::TIMESTAMP:
+        return HashInteger(val->GetAs<uint64_t>());
       default: { BUSTUB_ASSERT(false, "Unsupported type."); }
     }
   }
 };
 
+/**
+ * Hash policies for HashFunction, each hashes the raw bytes of a key of a fixed size. IntegerHashPolicy is for keys
+ * of at most 8 bytes, which it reads as one integer, BytesHashPolicy for longer keys.
+ */
+struct IntegerHashPolicy {
+  static inline uint64_t Hash(const char *bytes, size_t length) {
+    uint64_t word = 0;
+    memcpy(&word, bytes, length);
+    return HashUtil::HashInteger(word);
+  }
+};
+
+struct BytesHashPolicy {
+  static inline uint64_t Hash(const char *bytes, size_t length) { return HashUtil::HashBytesFast(bytes, length); }
+};
+
 }  // namespace bustub
@@ -53,6 +53,13 @@ enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED };
  */
 enum class WType { INSERT = 0, DELETE, UPDATE };
 
+/**
+ * Whether committing waits for the COMMIT log record to reach disk.
+ * DEFAULT follows the TransactionManager setting; OFF returns as soon as the record is in the log buffer and
+ * may lose the commit on a crash (but never leaves the database inconsistent).
+ */
+enum class SynchronousCommit { DEFAULT, ON, OFF };
+
 class TableHeap;
 class Catalog;
 using table_oid_t = uint32_t;
@@ -246,6 +253,15 @@ class Transaction {
    */
   inline void SetPrevLSN(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
+  /** @return the synchronous commit setting of this transaction */
+  inline SynchronousCommit GetSynchronousCommit() const { return synchronous_commit_; }
+
+  /**
+   * Override the TransactionManager's synchronous commit setting for this transaction.
+   * @param synchronous_commit new setting
+   */
+  inline void SetSynchronousCommit(SynchronousCommit synchronous_commit) { synchronous_commit_ = synchronous_commit; }
+
  private:
   /** The current transaction state. */
   TransactionState state_;
@@ -262,6 +278,8 @@ class Transaction {
   std::shared_ptr<std::deque<IndexWriteRecord>> index_write_set_;
   /** The LSN of the last record written by the transaction. */
   lsn_t prev_lsn_;
+  /** Whether Commit waits for the COMMIT record to be flushed. */
+  SynchronousCommit synchronous_commit_{SynchronousCommit::DEFAULT};
 
   /** Concurrent index: the pages that were latched during index operation. */
   std::shared_ptr<std::deque<Page *>> page_set_;
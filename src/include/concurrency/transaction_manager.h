@@ -77,6 +77,15 @@ class TransactionManager {
     return res;
   }
 
+  /**
+   * Sets the default synchronous commit mode, used by transactions that do not override it.
+   * @param synchronous_commit true to make Commit wait until the COMMIT record is on disk
+   */
+  void SetSynchronousCommit(bool synchronous_commit) { synchronous_commit_ = synchronous_commit; }
+
+  /** @return the default synchronous commit mode */
+  bool IsSynchronousCommit() const { return synchronous_commit_; }
+
   /** Prevents all transactions from performing operations, used for checkpointing. */
   void BlockAllTransactions();
 
@@ -103,7 +112,9 @@ class TransactionManager {
 
   std::atomic<txn_id_t> next_txn_id_{0};
   LockManager *lock_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
+  /** Default commit mode; asynchronous commits are flushed within LogManager's commit delay. */
+  std::atomic<bool> synchronous_commit_{true};
 
   /** The global transaction latch is used for checkpointing. */
   ReaderWriterLatch global_txn_latch_;
@@ -12,13 +12,19 @@
 
 #pragma once
 
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <mutex>  // NOLINT
 #include <queue>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction.h"
 #include "container/hash/hash_function.h"
+#include "recovery/log_manager.h"
 #include "storage/page/hash_table_bucket_page.h"
 #include "storage/page/hash_table_directory_page.h"
 
@@ -30,6 +36,31 @@ namespace bustub {
  * Implementation of extendible hash table that is backed by a buffer pool
  * manager. Non-unique keys are supported. Supports insert and delete. The
  * table grows/shrinks dynamically as buckets become full/empty.
+ *
+ * The directory spans several pages under a header page. The header page is a
+ * HashTableDirectoryPage whose entries are directory pages instead of buckets:
+ * it picks one by the low bits of the hash, with the local depth of an entry
+ * saying how many bits the directory page owns, and the directory page picks
+ * the bucket by the bits above them. A directory page doubles on its own, and
+ * once it is full it splits in two on its lowest bit, which every bucket in
+ * it already agrees on, so no bucket is rehashed; the header doubles when a
+ * directory page that splits owns as many bits as it resolves. This allows
+ * for DIRECTORY_ARRAY_SIZE directory pages of DIRECTORY_ARRAY_SIZE buckets.
+ *
+ * Concurrency: operations latch the header page, then the directory page, and
+ * let go of the header page, then latch the bucket and let go of the directory
+ * page. Splitting or merging buckets read-latches the directory page and
+ * write-latches the pair of buckets: the directory entries of a bucket only
+ * change under its write latch, so splits and merges of other buckets go on
+ * at the same time, and a lookup checks the entry again once it holds the
+ * latch of the bucket it read there. Only doubling or shrinking a directory
+ * page write-latches it, splitting a directory page the header page as well.
+ *
+ * Lookups latch nothing. They read each page and validate it against its page
+ * version (see Page::GetVersion()), which write latches bump, and start over
+ * if a writer got in between: the header page and the directory page once the
+ * next page's version is taken, the directory entry once more as it changes
+ * under the bucket latch only, and the bucket after it was read.
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class ExtendibleHashTable {
@@ -40,9 +71,22 @@ class ExtendibleHashTable {
    * @param buffer_pool_manager buffer pool manager to be used
    * @param comparator comparator for keys
    * @param hash_fn the hash function
+   * @param log_manager if not null, page changes are logged while logging is enabled
    */
   explicit ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn);
+                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                               LogManager *log_manager = nullptr);
+
+  /**
+   * Opens an ExtendibleHashTable whose pages already exist, e.g. after they were restored by LogRecovery.
+   *
+   * @param header_page_id the header page of the existing table
+   */
+  ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
+                      HashFunction<KeyType> hash_fn, page_id_t header_page_id, LogManager *log_manager = nullptr);
+
+  /** Stops the maintenance thread, if any. The buckets still queued are left empty. */
+  ~ExtendibleHashTable();
 
   /**
    * Inserts a key-value pair into the hash table.
@@ -75,12 +119,65 @@ class ExtendibleHashTable {
   bool GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result);
 
   /**
-   * Returns the global depth.  Do not touch.
+   * Performs a batch of point queries. All keys are hashed first and sorted by the buckets they map to. Each directory
+   * page is then latched once for all of its keys, and the bucket pages of PREFETCH_GROUP_SIZE keys at a time are
+   * pinned and prefetched before any of them is probed, so the misses of a group overlap. Like GetValue, the
+   * buckets are read without latching them.
+   *
+   * @param transaction the current transaction
+   * @param keys the keys to look up
+   * @param[out] results the values of keys[i] go to (*results)[i]
+   */
+  void GetValues(Transaction *transaction, const std::vector<KeyType> &keys,
+                 std::vector<std::vector<ValueType>> *results);
+
+  /** The number of keys of a batch lookup whose bucket pages are fetched before the first of them is probed. */
+  static constexpr size_t PREFETCH_GROUP_SIZE = 8;
+
+  /**
+   * Pre-sizes the directory of an empty hash table for about num_entries entries, so that loading them does not
+   * split the buckets one at a time. Does nothing if the table holds entries or was split already.
+   *
+   * @param num_entries the number of entries expected
+   */
+  void Reserve(size_t num_entries);
+
+  /**
+   * Inserts many key-value pairs at once. The directory is pre-sized first, and the pairs are inserted grouped by
+   * bucket so that every bucket page is fetched once for all of its pairs.
+   *
+   * @param transaction the current transaction
+   * @param entries the pairs to insert
+   */
+  void BulkInsert(Transaction *transaction, const std::vector<MappingType> &entries);
+
+  /**
+   * Moves merging the buckets that Remove empties, and shrinking the directory pages, to a maintenance thread. Remove
+   * queues such buckets instead, and the thread merges at most merges_per_round of them every round_interval. Pages
+   * freed while an optimistic lookup still pins them are deleted in a later round.
+   *
+   * @param merges_per_round the most merges done at once
+   * @param round_interval the pause after each round
+   */
+  void StartBackgroundMerge(size_t merges_per_round = 64,
+                            std::chrono::milliseconds round_interval = std::chrono::milliseconds(10));
+
+  /** Stops the maintenance thread and merges the buckets still queued, Remove merges right away again afterwards. */
+  void StopBackgroundMerge();
+
+  /** Blocks until the maintenance thread has merged every queued bucket. */
+  void WaitForMerges();
+
+  /** The most buckets waiting for the maintenance thread, Remove merges further ones by itself. */
+  static constexpr size_t MAX_MERGE_QUEUE = 4096;
+
+  /**
+   * Returns the global depth, the most hash bits the header and a directory page resolve together.
    */
   uint32_t GetGlobalDepth();
 
   /**
-   * Helper function to verify the integrity of the extendible hash table's directory.  Do not touch.
+   * Helper function to verify the integrity of the extendible hash table's header and directory pages.
    */
   void VerifyIntegrity();
 
@@ -89,6 +186,9 @@ class ExtendibleHashTable {
 
   void RemoveAllItem(Transaction *transaction, uint32_t bucket_idx);
 
+  /** @return the page id of the header page */
+  page_id_t GetHeaderPageId() const { return header_page_id_; }
+
  private:
   /**
    * Hash - simple helper to downcast MurmurHash's 64-bit hash to 32-bit
@@ -99,17 +199,49 @@ class ExtendibleHashTable {
    */
   inline uint32_t Hash(KeyType key);
 
+  /** @return the bits of hash in reverse order, sorting by them groups hashes by their low bits */
+  static uint32_t ReverseBits(uint32_t hash);
+
+  /** The hash bits the header and directory pages can split on at their deepest, keys agreeing in them never part. */
+  static constexpr uint32_t SPLITTABLE_HASH_MASK = (1U << (2 * DIRECTORY_MAX_DEPTH)) - 1;
+
+  /** @return the version of a page once no writer holds it */
+  static uint64_t ReadVersion(Page *page);
+
+  /**
+   * Looks a key up without latching any page.
+   *
+   * @param hash the hash of the key
+   * @param key the key to look up
+   * @param[out] result the values of the key are appended to it
+   * @return false if a writer changed a page on the way, result is left alone then
+   */
+  bool GetValueOptimistic(uint32_t hash, const KeyType &key, std::vector<ValueType> *result);
+
+  /**
+   * Reads the values of a key in a pinned bucket and its overflow chain, validating them against the version of
+   * the bucket, whose latch covers the chain.
+   *
+   * @param bucket the pinned bucket page
+   * @param bucket_version the version of the bucket, from ReadVersion()
+   * @param key the key to look up
+   * @param[out] result the values of the key are appended to it
+   * @return false if a writer changed the bucket, result is left alone then
+   */
+  bool GetBucketValueOptimistic(Page *bucket, uint64_t bucket_version, const KeyType &key,
+                                std::vector<ValueType> *result);
+
   /**
    * KeyToDirectoryIndex - maps a key to a directory index
    *
    * In Extendible Hashing we map a key to a directory index
    * using the following hash + mask function.
    *
-   * DirectoryIndex = Hash(key) & GLOBAL_DEPTH_MASK
+   * DirectoryIndex = (Hash(key) >> HASH_SHIFT) & GLOBAL_DEPTH_MASK
    *
    * where GLOBAL_DEPTH_MASK is a mask with exactly GLOBAL_DEPTH 1's from LSB
    * upwards.  For example, global depth 3 corresponds to 0x00000007 in a 32-bit
-   * representation.
+   * representation. HASH_SHIFT is the number of bits the header page resolves.
    *
    * @param key the key to use for lookup
    * @param dir_page to use for lookup of global depth
@@ -126,16 +258,29 @@ class ExtendibleHashTable {
    */
   inline page_id_t KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page);
 
-  HashTableDirectoryPage *CreateDirectoryPage(page_id_t *bucket_page_id);
+  HashTableDirectoryPage *CreateDirectoryPage(page_id_t *directory_page_id);
 
   HASH_TABLE_BUCKET_TYPE *CreateBucketPage(page_id_t *bucket_page_id);
 
   /**
-   * Fetches the directory page from the buffer pool manager.
+   * Fetches a directory page, or the header page, from the buffer pool manager.
    *
+   * @param directory_page_id the page_id to fetch
    * @return a pointer to the directory page
    */
-  HashTableDirectoryPage *FetchDirectoryPage();
+  HashTableDirectoryPage *FetchDirectoryPage(page_id_t directory_page_id);
+
+  /**
+   * Fetches and latches the directory page a hash goes to, crabbing down from the header page.
+   *
+   * @param hash the hash of the key
+   * @param exclusive whether to write-latch the directory page rather than read-latch it
+   * @return a pointer to the latched directory page
+   */
+  HashTableDirectoryPage *FetchDirectoryPageFor(uint32_t hash, bool exclusive);
+
+  /** Unlatches and unpins a directory page returned by FetchDirectoryPageFor. */
+  void ReleaseDirectoryPage(HashTableDirectoryPage *dir_page, bool exclusive, bool is_dirty);
 
   /**
    * Fetches the a bucket page from the buffer pool manager using the bucket's page_id.
@@ -145,6 +290,19 @@ class ExtendibleHashTable {
    */
   HASH_TABLE_BUCKET_TYPE *FetchBucketPage(page_id_t bucket_page_id);
 
+  /**
+   * Fetches and latches the bucket a key goes to, looking it up again if a split or merge repointed the entry
+   * before the latch was acquired.
+   *
+   * @param key the key for lookup
+   * @param dir_page the latched directory page the key goes to
+   * @param exclusive whether to write-latch the bucket rather than read-latch it
+   * @param[out] bucket_page_id the page_id of the bucket
+   * @return a pointer to the latched bucket page
+   */
+  HASH_TABLE_BUCKET_TYPE *FetchBucketPageFor(const KeyType &key, HashTableDirectoryPage *dir_page, bool exclusive,
+                                             page_id_t *bucket_page_id);
+
   /**
    * Performs insertion with an optional bucket splitting.
    *
@@ -155,31 +313,140 @@ class ExtendibleHashTable {
    */
   bool SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value);
 
+  /**
+   * Appends the values of key in a latched bucket and its overflow chain to result.
+   *
+   * @return whether any value was found
+   */
+  bool GetChainValue(HASH_TABLE_BUCKET_TYPE *bucket_page, const KeyType &key, std::vector<ValueType> *result);
+
+  /**
+   * Finds the hash of the overflow chain of a latched bucket, in the bits the directory splits on. Only the keys of
+   * that hash go to the overflow pages, once they took up half of the bucket that no split could separate.
+   *
+   * @param bucket_page the latched bucket
+   * @param[out] chain_hash the hash of the keys in the overflow pages
+   * @return false if the bucket has no overflow chain
+   */
+  bool GetChainHash(HASH_TABLE_BUCKET_TYPE *bucket_page, uint32_t *chain_hash);
+
+  /**
+   * Inserts into a write-latched bucket if it has room and into its overflow chain otherwise.
+   *
+   * @param transaction a pointer to the current transaction
+   * @param bucket_page the write-latched bucket, key has the hash of its overflow chain
+   * @param key the key to insert
+   * @param value the value to insert
+   * @return false if the pair is in the bucket already
+   */
+  bool ChainInsert(Transaction *transaction, HASH_TABLE_BUCKET_TYPE *bucket_page, const KeyType &key,
+                   const ValueType &value);
+
+  /**
+   * Inserts into the first overflow page of a write-latched bucket that has room, linking a new one in right after
+   * the bucket if none has.
+   */
+  void InsertIntoOverflow(Transaction *transaction, HASH_TABLE_BUCKET_TYPE *bucket_page, const KeyType &key,
+                          const ValueType &value);
+
+  /** Moves the keys of the chain's hash out of a full write-latched bucket page into its overflow chain. */
+  void MoveToChain(HASH_TABLE_BUCKET_TYPE *bucket_page, uint32_t chain_hash);
+
+  /**
+   * Removes a pair from the overflow chain of a write-latched bucket, an overflow page left empty is unlinked and
+   * deleted.
+   *
+   * @return whether the pair was found
+   */
+  bool ChainRemove(Transaction *transaction, HASH_TABLE_BUCKET_TYPE *bucket_page, const KeyType &key,
+                   const ValueType &value);
+
+  /**
+   * Doubles the directory page a hash goes to if its bucket is as deep, or splits it if it is full.
+   *
+   * @param hash the hash of the key whose bucket has to split
+   * @return false if the directory page cannot grow or split
+   */
+  bool GrowDirectory(uint32_t hash);
+
+  /**
+   * Splits the full directory page a hash goes to in two, doubling the header page if needed.
+   *
+   * @param hash the hash of the key whose bucket has to split
+   * @return false if the header page is full as well
+   */
+  bool SplitDirectory(uint32_t hash);
+
   /**
    * Optionally merges an empty bucket into it's pair.  This is called by Remove,
-   * if Remove makes a bucket empty.
+   * if Remove makes a bucket empty, or by the maintenance thread.
    *
    * There are three conditions under which we skip the merge:
    * 1. The bucket is no longer empty.
    * 2. The bucket has local depth 0.
    * 3. The bucket's local depth doesn't match its split image's local depth.
    *
-   * @param transaction a pointer to the current transaction
-   * @param key the key that was removed
-   * @param value the value that was removed
+   * @param hash the hash of the key that was removed
+   * @return true if the merged bucket is empty as well and may merge again
+   */
+  bool Merge(uint32_t hash);
+
+  /**
+   * Hands the bucket a hash goes to over to the maintenance thread.
+   *
+   * @return false if there is no maintenance thread or its queue is full
+   */
+  bool QueueMerge(uint32_t hash);
+
+  /** Merges queued buckets, a round at a time, until StopBackgroundMerge(). */
+  void MergeLoop();
+
+  /**
+   * Deletes a page no longer linked in, and retries the ones an optimistic lookup had pinned before. A page that is
+   * still pinned is kept for the next call; INVALID_PAGE_ID only retries.
+   */
+  void FreePage(page_id_t page_id);
+
+  /** @return true if page changes have to be logged */
+  inline bool IsLogging() const { return enable_logging && log_manager_ != nullptr; }
+
+  /**
+   * Logs an entry inserted into or removed from a bucket and stamps the bucket with the record's LSN.
+   * The record is chained into the transaction (if any) so that recovery can undo it. Does nothing when not logging.
    */
-  void Merge(Transaction *transaction, const KeyType &key, const ValueType &value);
+  void LogBucketEntry(Transaction *transaction, LogRecordType type, page_id_t bucket_page_id,
+                      HASH_TABLE_BUCKET_TYPE *bucket_page, uint32_t bucket_idx);
 
-  bool ExtraMerge(Transaction *transaction, const KeyType &key, const ValueType &value);  // 额外的合并操作
+  /** Logs an after-image of a directory or header page following a split or merge. Does nothing when not logging. */
+  void LogDirectoryImage(HashTableDirectoryPage *dir_page);
+
+  /** Logs an after-image of a bucket page whose overflow link changed. Does nothing when not logging. */
+  void LogBucketImage(HASH_TABLE_BUCKET_TYPE *bucket_page);
 
   // member variables
-  page_id_t directory_page_id_;
+  page_id_t header_page_id_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
-
-  // Readers includes inserts and removes, writers are splits and merges
-  ReaderWriterLatch table_latch_;
   HashFunction<KeyType> hash_fn_;
+  LogManager *log_manager_;
+  // serializes the directory page images in the log
+  std::mutex directory_log_latch_;
+
+  // protects the members of the maintenance thread below
+  std::mutex merge_latch_;
+  // signals queued buckets and stopping to the maintenance thread, and finished rounds to WaitForMerges()
+  std::condition_variable merge_cv_;
+  // hashes of keys whose buckets Remove emptied
+  std::deque<uint32_t> merge_queue_;
+  // pages that were pinned when they were freed, whether or not the maintenance thread runs
+  std::vector<page_id_t> unfreed_pages_;
+  size_t merges_per_round_{0};
+  std::chrono::milliseconds merge_interval_{0};
+  bool merge_running_{false};
+  bool merge_stop_{false};
+  // a round is being merged
+  bool merging_{false};
+  std::thread merge_thread_;
 };
 
 }  // namespace bustub
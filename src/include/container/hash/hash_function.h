@@ -13,12 +13,28 @@
 #pragma once
 
 #include <cstdint>
+#include <type_traits>
 
+#include "common/util/hash_util.h"
 #include "murmur3/MurmurHash3.h"
 
 namespace bustub {
 
+/** The previous hash of every key, murmur3 over the key bytes, kept for comparison. */
+struct Murmur3HashPolicy {
+  static inline uint64_t Hash(const char *bytes, size_t length) {
+    uint64_t hash[2];
+    murmur3::MurmurHash3_x64_128(reinterpret_cast<const void *>(bytes), static_cast<int>(length), 0,
+                                 reinterpret_cast<void *>(&hash));
+    return hash[0];
+  }
+};
+
+/** The hash policy of a key type, chosen at compile time from its size. */
 template <typename KeyType>
+using DefaultHashPolicy = std::conditional_t<sizeof(KeyType) <= sizeof(uint64_t), IntegerHashPolicy, BytesHashPolicy>;
+
+template <typename KeyType, typename HashPolicy = DefaultHashPolicy<KeyType>>
 class HashFunction {
  public:
   /**
@@ -26,10 +42,7 @@ class HashFunction {
    * @return the hashed value
    */
   virtual uint64_t GetHash(KeyType key) {
-    uint64_t hash[2];
-    murmur3::MurmurHash3_x64_128(reinterpret_cast<const void *>(&key), static_cast<int>(sizeof(KeyType)), 0,
-                                 reinterpret_cast<void *>(&hash));
-    return hash[0];
+    return HashPolicy::Hash(reinterpret_cast<const char *>(&key), sizeof(KeyType));
   }
 };
 
@@ -12,7 +12,6 @@
 
 #pragma once
 
-#include <queue>
 #include <string>
 #include <vector>
 
@@ -26,12 +25,22 @@
 
 namespace bustub {
 
-#define HASH_TABLE_TYPE LinearProbeHashTable<KeyType, ValueType, KeyComparator>
+#define LINEAR_PROBE_HASH_TABLE_TYPE LinearProbeHashTable<KeyType, ValueType, KeyComparator>
 
 /**
  * Implementation of linear probing hash table that is backed by a buffer pool
  * manager. Non-unique keys are supported. Supports insert and delete. The
- * table dynamically grows once full.
+ * table dynamically grows once three quarters of its slots are taken.
+ *
+ * A table is a header page listing the block pages that hold its slots. A key
+ * starts probing at slot hash % size and walks forward until it reaches a slot
+ * that was never taken. Removed entries leave tombstones behind, which are
+ * dropped when the table grows.
+ *
+ * Growing never stops the world: Resize only allocates the new table, and the
+ * old one is kept beside it while every insert and remove moves the entries of
+ * MIGRATE_BLOCKS_PER_WRITE old blocks. Lookups and removes look in both tables
+ * until the old one is empty and freed.
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class LinearProbeHashTable : public HashTable<KeyType, ValueType, KeyComparator> {
@@ -75,7 +84,8 @@ class LinearProbeHashTable : public HashTable<KeyType, ValueType, KeyComparator>
   bool GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) override;
 
   /**
-   * Resizes the table to at least twice the initial size provided.
+   * Resizes the table to at least twice the initial size provided. The entries are moved over by the following
+   * inserts and removes.
    * @param initial_size the initial size of the hash table
    */
   void Resize(size_t initial_size);
@@ -86,13 +96,65 @@ class LinearProbeHashTable : public HashTable<KeyType, ValueType, KeyComparator>
    */
   size_t GetSize();
 
+  /**
+   * @return whether the entries of a smaller table are still being moved over
+   */
+  bool IsResizing();
+
+  /** The number of old blocks whose entries each insert or remove moves to the new table while resizing. */
+  static constexpr size_t MIGRATE_BLOCKS_PER_WRITE = 1;
+
  private:
+  /** @return a new table of num_blocks block pages */
+  page_id_t CreateTable(size_t num_blocks);
+
+  /** Free the header and block pages of a table. */
+  void DeleteTable(page_id_t header_page_id);
+
+  /** @return the number of slots of a table */
+  size_t NumSlots(page_id_t header_page_id);
+
+  /**
+   * Walk the probe sequence of key in a table. visit(block_page, slot, &dirty) is called on each slot up to and
+   * including the first one never taken, or until it returns true.
+   */
+  template <typename Visitor>
+  void Probe(page_id_t header_page_id, const KeyType &key, Visitor visit);
+
+  /** Collect the values of key from a table. */
+  bool GetValueFrom(page_id_t header_page_id, const KeyType &key, std::vector<ValueType> *result);
+
+  /**
+   * Put a pair in the first free slot of its probe sequence.
+   * @return false if the pair is already in the table and check_duplicate is set, or if the table is full
+   */
+  bool InsertInto(page_id_t header_page_id, const KeyType &key, const ValueType &value, bool check_duplicate);
+
+  /**
+   * Find a pair in a table, and turn it into a tombstone if remove is set.
+   * @return whether the pair was found
+   */
+  bool FindIn(page_id_t header_page_id, const KeyType &key, const ValueType &value, bool remove);
+
+  /** Start growing the table to at least twice initial_size slots, table_latch_ must be write-held. */
+  void BeginResize(size_t initial_size);
+
+  /** Move the entries of up to num_blocks old blocks to the new table, table_latch_ must be write-held. */
+  void MigrateBlocks(size_t num_blocks);
+
   // member variable
   page_id_t header_page_id_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
 
-  // Readers includes inserts and removes, writer is only resize
+  // the table being emptied into header_page_id_ while resizing, INVALID_PAGE_ID otherwise
+  page_id_t old_header_page_id_{INVALID_PAGE_ID};
+  // the next block of the old table to migrate
+  size_t migrate_block_{0};
+  // the taken slots of the current table, tombstones included
+  size_t num_occupied_{0};
+
+  // Readers are lookups, writers are inserts, removes and the resize steps they carry out
   ReaderWriterLatch table_latch_;
 
   // Hash function
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include "common/rid.h"
@@ -23,9 +24,12 @@
 namespace bustub {
 
 /**
- * IndexScanExecutor executes an index scan over a table.
+ * IndexScanExecutor executes an index scan over a table, returning its tuples in key order.
+ *
+ * If the output only needs key columns and the index returns its keys, the
+ * scan is index-only: the tuples are built from the keys without reading the
+ * table heap.
  */
-
 class IndexScanExecutor : public AbstractExecutor {
  public:
   /**
@@ -41,8 +45,24 @@ class IndexScanExecutor : public AbstractExecutor {
 
   bool Next(Tuple *tuple, RID *rid) override;
 
+  /** @return true if the scan reads no tuples from the table heap, valid after Init() */
+  bool IsIndexOnly() const { return index_only_; }
+
  private:
+  /** @return true if expr only reads table columns that are part of the index key */
+  bool CoveredByKey(const AbstractExpression *expr) const;
+
+  /** @return a tuple of the table schema holding the key's values, with the other columns null or empty */
+  Tuple KeyToTableTuple(const Tuple &key) const;
+
   /** The index scan plan node to be executed. */
   const IndexScanPlanNode *plan_;
+  /** The index to scan and the table it is created on. */
+  IndexInfo *index_info_;
+  TableInfo *table_info_;
+  /** The cursor over the index entries. */
+  std::unique_ptr<IndexScanIterator> iter_;
+  /** Whether the tuples are built from the index keys. */
+  bool index_only_{false};
 };
 }  // namespace bustub
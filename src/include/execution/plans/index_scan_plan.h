@@ -18,7 +18,10 @@
 
 namespace bustub {
 /**
- * IndexScanPlanNode identifies a table that should be scanned with an optional predicate.
+ * IndexScanPlanNode identifies a table that should be scanned through one of its indexes with an optional predicate,
+ * optionally in a key range and in descending key order. The table is the one the index is created on. A hash index
+ * only serves point lookups, with the low key equal to the high key; see Catalog::GetIndexForAccess() for picking an
+ * index that serves the scan.
  */
 class IndexScanPlanNode : public AbstractPlanNode {
  public:
@@ -27,24 +30,47 @@ class IndexScanPlanNode : public AbstractPlanNode {
    * @param output the output format of this scan plan node
    * @param predicate the predicate to scan with, tuples are returned if predicate(tuple) == true or predicate ==
    * nullptr
-   * @param table_oid the identifier of table to be scanned
+   * @param index_oid the identifier of the index to scan with
+   * @param low_key the inclusive lower bound of the scan in the index key schema, nullptr for none
+   * @param high_key the inclusive upper bound of the scan in the index key schema, nullptr for none
+   * @param reverse whether to scan in descending key order
    */
-  IndexScanPlanNode(const Schema *output, const AbstractExpression *predicate, index_oid_t index_oid)
-      : AbstractPlanNode(output, {}), predicate_{predicate}, index_oid_(index_oid) {}
+  IndexScanPlanNode(const Schema *output, const AbstractExpression *predicate, index_oid_t index_oid,
+                    const Tuple *low_key = nullptr, const Tuple *high_key = nullptr, bool reverse = false)
+      : AbstractPlanNode(output, {}),
+        predicate_{predicate},
+        index_oid_(index_oid),
+        low_key_(low_key),
+        high_key_(high_key),
+        reverse_(reverse) {}
 
   PlanType GetType() const override { return PlanType::IndexScan; }
 
   /** @return the predicate to test tuples against; tuples should only be returned if they evaluate to true */
   const AbstractExpression *GetPredicate() const { return predicate_; }
 
-  /** @return the identifier of the table that should be scanned */
+  /** @return the identifier of the index that should be scanned */
   index_oid_t GetIndexOid() const { return index_oid_; }
 
+  /** @return the inclusive lower bound of the keys to scan, nullptr for none */
+  const Tuple *GetLowKey() const { return low_key_; }
+
+  /** @return the inclusive upper bound of the keys to scan, nullptr for none */
+  const Tuple *GetHighKey() const { return high_key_; }
+
+  /** @return true if the keys are scanned in descending order */
+  bool IsReverse() const { return reverse_; }
+
  private:
   /** The predicate that all returned tuples must satisfy. */
   const AbstractExpression *predicate_;
-  /** The table whose tuples should be scanned. */
+  /** The index to scan with. */
   index_oid_t index_oid_;
+  /** The bounds of the scan, the bounds of a key type that is cut off may let through more keys than the range. */
+  const Tuple *low_key_;
+  const Tuple *high_key_;
+  /** Whether to scan from the high key down. */
+  bool reverse_;
 };
 
 }  // namespace bustub
@@ -13,9 +13,13 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>              // NOLINT
 #include <condition_variable>  // NOLINT
 #include <future>              // NOLINT
-#include <mutex>               // NOLINT
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "recovery/log_record.h"
 #include "storage/disk/disk_manager.h"
@@ -25,50 +29,141 @@ namespace bustub {
 /**
  * LogManager maintains a separate thread that is awakened whenever the log buffer is full or whenever a timeout
  * happens. When the thread is awakened, the log buffer's content is written into the disk log file.
+ *
+ * The log can be split into several streams, each with its own buffers, latch, flush thread and log files, so that
+ * appenders on different threads do not contend on one buffer. Every thread appends to one stream; LSNs still come
+ * from a single counter and order the records across streams. Each flush of a stream ends with a WATERMARK record
+ * telling up to which LSN the stream is complete, recovery replays the merged streams up to the smallest of them.
+ * A synchronous commit only flushes the streams that still buffer records up to its COMMIT record; the watermark of
+ * its own stream records how far the others are complete.
  */
 class LogManager {
  public:
-  explicit LogManager(DiskManager *disk_manager)
+  explicit LogManager(DiskManager *disk_manager, int num_streams = 1)
       : next_lsn_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
-    flush_buffer_ = new char[LOG_BUFFER_SIZE];
+    for (int i = 0; i < std::max(num_streams, 1); i++) {
+      streams_.push_back(std::make_unique<LogStream>());
+    }
+    for (auto &stream : streams_) {
+      stream->complete_lsns_.assign(streams_.size(), INVALID_LSN);
+    }
+    RestoreLSN();
   }
 
-  ~LogManager() {
-    delete[] log_buffer_;
-    delete[] flush_buffer_;
-    log_buffer_ = nullptr;
-    flush_buffer_ = nullptr;
-  }
+  ~LogManager() = default;
 
   void RunFlushThread();
   void StopFlushThread();
 
   lsn_t AppendLogRecord(LogRecord *log_record);
 
+  /**
+   * Wake up the flush thread and wait until every log record appended so far is persistent.
+   * Does nothing when logging is disabled.
+   */
+  void Flush();
+
+  /**
+   * Wait until the log record with the given LSN, appended by the calling thread, is persistent (synchronous commit).
+   * Only the streams that buffer records up to it are flushed, the one of the calling thread included.
+   * Does nothing when logging is disabled.
+   * @param lsn the LSN to wait for
+   */
+  void WaitForFlush(lsn_t lsn);
+
+  /**
+   * Make sure everything appended so far is flushed within the commit delay, without waiting for it
+   * (asynchronous commit).
+   */
+  void ScheduleFlush();
+
+  /**
+   * Write a watermark into every stream and wait for it, so that each stream has log files telling how far it is
+   * complete. Called when the flush threads start and after a checkpoint recycled the log, which also leaves the
+   * last LSN in the log for RestoreLSN() after a restart.
+   */
+  void WriteWatermarks();
+
+  /**
+   * Set the longest time an asynchronous commit may stay in the log buffer. The flush thread still wakes up at
+   * least every log_timeout, so the effective bound is the smaller of the two.
+   * @param commit_delay the new bound
+   */
+  inline void SetCommitDelay(std::chrono::milliseconds commit_delay) { commit_delay_ = commit_delay; }
+  inline std::chrono::milliseconds GetCommitDelay() { return commit_delay_; }
+
   inline lsn_t GetNextLSN() { return next_lsn_; }
   inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
-  inline char *GetLogBuffer() { return log_buffer_; }
+  inline char *GetLogBuffer() { return streams_[0]->log_buffer_; }
+  inline int GetNumStreams() { return static_cast<int>(streams_.size()); }
+  inline DiskManager *GetDiskManager() { return disk_manager_; }
 
  private:
-  // TODO(students): you may add your own member variables
+  /** The buffers and flush thread of one log stream. */
+  struct LogStream {
+    LogStream() : log_buffer_(new char[LOG_BUFFER_SIZE]), flush_buffer_(new char[LOG_BUFFER_SIZE]) {}
+    ~LogStream() {
+      delete[] log_buffer_;
+      delete[] flush_buffer_;
+    }
+
+    char *log_buffer_;
+    char *flush_buffer_;
+    /** Number of bytes used in log_buffer_. */
+    int offset_{0};
+    /** LSN of the first record in log_buffer_, if offset_ > 0. */
+    lsn_t first_lsn_{INVALID_LSN};
+    /** Number of buffers written out so far. */
+    uint64_t num_flushes_{0};
+    /** How far each stream is complete, as far as known here; written with every watermark of this stream. */
+    std::vector<lsn_t> complete_lsns_;
+    /** Every record of this stream with an LSN up to durable_lsn_ is on disk. */
+    std::atomic<lsn_t> durable_lsn_{INVALID_LSN};
+    /** Set when someone is waiting for the flush thread, instead of letting it sleep until log_timeout. */
+    bool need_flush_{false};
+    /** Set when the next flush must write a watermark even if the buffer is empty. */
+    bool need_watermark_{false};
+    /** Set while the flush thread writes flush_buffer_ with the latch released. */
+    bool writing_{false};
+    /** Latest time by which the oldest unflushed asynchronous commit must be written out. */
+    std::chrono::steady_clock::time_point commit_deadline_{std::chrono::steady_clock::time_point::max()};
+
+    std::mutex latch_;
+
+    std::thread *flush_thread_{nullptr};
+
+    /** Wakes up the flush thread. */
+    std::condition_variable cv_;
+    /** Signaled by the flush thread after each flush, for appenders waiting on space and Flush() callers. */
+    std::condition_variable flushed_cv_;
+  };
+
+  /** The stream the calling thread appends to. */
+  LogStream *GetStream();
+  /** Swap the log buffers of the stream and write out the filled one. Called by the flush thread only. */
+  void FlushBuffer(int stream_no, std::unique_lock<std::mutex> *latch, bool forced);
+  /** Size of a watermark record, which lists the complete LSNs of the streams if there are several. */
+  int WatermarkSize() const;
+  /** Raise persistent_lsn_ to the smallest durable LSN of the streams. */
+  void UpdatePersistentLSN();
+  /**
+   * Continue the LSNs after the last one in the log files left by an earlier run. Pages on disk carry the LSNs of
+   * that run, and recovery tells the records of both runs apart by LSN only.
+   */
+  void RestoreLSN();
 
   /** The atomic counter which records the next log sequence number. */
   std::atomic<lsn_t> next_lsn_;
   /** The log records before and including the persistent lsn have been written to disk. */
   std::atomic<lsn_t> persistent_lsn_;
 
-  char *log_buffer_;
-  char *flush_buffer_;
-
-  std::mutex latch_;
-
-  std::thread *flush_thread_ __attribute__((__unused__));
+  std::vector<std::unique_ptr<LogStream>> streams_;
 
-  std::condition_variable cv_;
+  /** Upper bound on how long an asynchronous commit may stay unflushed. */
+  std::atomic<std::chrono::milliseconds> commit_delay_{std::chrono::milliseconds::max()};
 
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
 };
 
 }  // namespace bustub
@@ -14,8 +14,11 @@
 
 #include <cassert>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
+#include "storage/page/hash_table_bucket_page.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
@@ -32,6 +35,20 @@ enum class LogRecordType {
   ABORT,
   /** Creating a new page in the table heap. */
   NEWPAGE,
+  /** An entry inserted into a hash bucket page. */
+  HASH_BUCKET_INSERT,
+  /** An entry removed from a hash bucket page. */
+  HASH_BUCKET_REMOVE,
+  /** Entries moved from a full hash bucket page into its new split image. Redo only. */
+  HASH_BUCKET_SPLIT,
+  /** After-image of an index page changed by a structure modification (split, merge, directory change). Redo only. */
+  INDEX_PAGE_IMAGE,
+  /**
+   * Written at the end of each flush when the log is split into several streams. Its LSN is not a record of its own:
+   * every record of the stream with an LSN up to it is on disk. It may also tell up to which LSN other streams are
+   * complete.
+   */
+  WATERMARK,
 };
 
 /**
@@ -54,9 +71,30 @@ enum class LogRecordType {
  * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size | new_tuple_data |
  *-----------------------------------------------------------------------------------
  * For new page type log record
- *--------------------------
- * | HEADER | prev_page_id |
- *--------------------------
+ *-------------------------------------
+ * | HEADER | prev_page_id | page_id |
+ *-------------------------------------
+ * For hash bucket insert/remove type log record (header_page_id and key_hash locate the bucket of the key when the
+ * change is undone, after splits may have moved the entry)
+ *------------------------------------------------------------------------------------
+ * | HEADER | page_id | header_page_id | key_hash | bucket_slot | entry_data(char[]) |
+ *------------------------------------------------------------------------------------
+ * For hash bucket split type log record (bucket_slot.slot_idx_ holds the number of moved entries, which land in
+ * slots 0..n-1 of the split image)
+ *---------------------------------------------------------------------------------------------
+ * | HEADER | page_id | image_page_id | bucket_slot | moved_slots(uint32_t[]) | entry_data(char[]) |
+ *---------------------------------------------------------------------------------------------
+ * For index page image type log record
+ *----------------------------------------------
+ * | HEADER | page_id | page_data(PAGE_SIZE) |
+ *----------------------------------------------
+ * Index records written outside of a transaction (structure modifications) carry INVALID_TXN_ID and are never
+ * undone.
+ * A watermark record has INVALID_TXN_ID and INVALID_LSN as prevLSN. With several streams it lists, for every stream,
+ * the LSN up to which that stream was known to be complete when the watermark was written, or INVALID_LSN
+ *-----------------------------------------
+ * | HEADER | complete_lsns(lsn_t[streams]) |
+ *-----------------------------------------
  */
 class LogRecord {
   friend class LogManager;
@@ -110,6 +148,48 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(page_id_t) * 2;
   }
 
+  // constructor for HASH_BUCKET_INSERT/HASH_BUCKET_REMOVE type
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, page_id_t page_id,
+            page_id_t header_page_id, uint32_t key_hash, const HashBucketSlot &bucket_slot, const char *entry)
+      : txn_id_(txn_id),
+        prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type),
+        page_id_(page_id),
+        header_page_id_(header_page_id),
+        key_hash_(key_hash),
+        bucket_slot_(bucket_slot),
+        index_data_(entry, bucket_slot.entry_size_) {
+    assert(log_record_type == LogRecordType::HASH_BUCKET_INSERT ||
+           log_record_type == LogRecordType::HASH_BUCKET_REMOVE);
+    size_ = HEADER_SIZE + sizeof(page_id_t) * 2 + sizeof(uint32_t) + sizeof(HashBucketSlot) + index_data_.size();
+  }
+
+  // constructor for HASH_BUCKET_SPLIT type, entries holds the moved entries back to back
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, page_id_t page_id,
+            page_id_t image_page_id, const HashBucketSlot &bucket_slot, std::vector<uint32_t> moved_slots,
+            std::string entries)
+      : txn_id_(txn_id),
+        prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type),
+        page_id_(page_id),
+        image_page_id_(image_page_id),
+        bucket_slot_(bucket_slot),
+        moved_slots_(std::move(moved_slots)),
+        index_data_(std::move(entries)) {
+    bucket_slot_.slot_idx_ = moved_slots_.size();
+    size_ = HEADER_SIZE + sizeof(page_id_t) * 2 + sizeof(HashBucketSlot) + sizeof(uint32_t) * moved_slots_.size() +
+            index_data_.size();
+  }
+
+  // constructor for INDEX_PAGE_IMAGE type
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type, page_id_t page_id, const char *page_data)
+      : size_(HEADER_SIZE + sizeof(page_id_t) + PAGE_SIZE),
+        txn_id_(txn_id),
+        prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type),
+        page_id_(page_id),
+        index_data_(page_data, PAGE_SIZE) {}
+
   ~LogRecord() = default;
 
   inline Tuple &GetDeleteTuple() { return delete_tuple_; }
@@ -128,6 +208,20 @@ class LogRecord {
 
   inline page_id_t GetNewPageRecord() { return prev_page_id_; }
 
+  inline page_id_t GetIndexPageId() { return page_id_; }
+
+  inline page_id_t GetSplitImagePageId() { return image_page_id_; }
+
+  inline page_id_t GetHeaderPageId() { return header_page_id_; }
+
+  inline uint32_t GetKeyHash() { return key_hash_; }
+
+  inline HashBucketSlot &GetBucketSlot() { return bucket_slot_; }
+
+  inline std::vector<uint32_t> &GetMovedSlots() { return moved_slots_; }
+
+  inline std::string &GetIndexData() { return index_data_; }
+
   inline int32_t GetSize() { return size_; }
 
   inline lsn_t GetLSN() { return lsn_; }
@@ -176,6 +270,19 @@ class LogRecord {
   // case4: for new page operation
   page_id_t prev_page_id_{INVALID_PAGE_ID};
   page_id_t page_id_{INVALID_PAGE_ID};
+
+  // case5: for index page operations, page_id_ is the page changed
+  page_id_t image_page_id_{INVALID_PAGE_ID};
+  // the header page of the hash table and the hash of the key of a bucket entry
+  page_id_t header_page_id_{INVALID_PAGE_ID};
+  uint32_t key_hash_{0};
+  HashBucketSlot bucket_slot_{};
+  std::vector<uint32_t> moved_slots_;
+  // the entry, the moved entries or the page image
+  std::string index_data_;
+
+  // case6: for watermark, indexed by stream
+  std::vector<lsn_t> complete_lsns_;
   static const int HEADER_SIZE = 20;
 };  // namespace bustub
 
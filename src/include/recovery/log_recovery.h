@@ -14,7 +14,11 @@
 
 #include <algorithm>
 #include <mutex>  // NOLINT
+#include <queue>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
@@ -28,7 +32,7 @@ namespace bustub {
 class LogRecovery {
  public:
   LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
-      : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), offset_(0) {
+      : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager) {
     log_buffer_ = new char[LOG_BUFFER_SIZE];
   }
 
@@ -41,16 +45,69 @@ class LogRecovery {
   void Undo();
   bool DeserializeLogRecord(const char *data, LogRecord *log_record);
 
+  /** @return the largest LSN in the log files of any stream, INVALID_LSN if there is none */
+  lsn_t FindLastLSN();
+
+  /**
+   * @return the header pages of the hash indexes that Undo() could not put an entry back into, because its bucket
+   * was full and making room takes a split. Such an index lacks an entry its table has, it has to be rebuilt from the
+   * table.
+   */
+  const std::unordered_set<page_id_t> &GetHashIndexesToRebuild() const { return hash_indexes_to_rebuild_; }
+
  private:
-  DiskManager *disk_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /** Reading position in one log stream. */
+  struct LogCursor {
+    LogCursor(int stream, int64_t offset) : stream_(stream), offset_(offset), buffer_(LOG_BUFFER_SIZE) {}
+
+    int stream_;
+    /** Log offset of buffer_[0]. */
+    int64_t offset_;
+    /** Position of the next record in buffer_, -1 if nothing is loaded yet. */
+    int pos_{-1};
+    std::vector<char> buffer_;
+    /** The current record and its log offset. */
+    LogRecord log_record_;
+    int64_t record_offset_{0};
+  };
+
+  /** Move the cursor to the next record of its stream. @return false at the end of the stream */
+  bool NextLogRecord(LogCursor *cursor);
+  /** The LSN up to which every stream is complete, i.e. the smallest last watermark of the streams. */
+  lsn_t FindRedoLimit(int num_streams);
+  bool DeserializeLogRecord(const char *data, int remaining, LogRecord *log_record);
+  /** Reapply a logged table page change if the page has not seen it yet. */
+  void RedoLogRecord(LogRecord *log_record);
+  /** Reapply a logged index page change if the page(s) have not seen it yet. */
+  void RedoIndexLogRecord(LogRecord *log_record);
+  /** Revert a logged table or hash bucket change of a loser transaction. */
+  void UndoLogRecord(LogRecord *log_record);
+  /**
+   * Revert a hash bucket insert or remove by key: take the entry out of the bucket the key belongs to now, or put it
+   * back there. Splits after the change may have moved the entry, and other entries may have taken its slot.
+   */
+  void UndoIndexLogRecord(LogRecord *log_record);
+  /** @return the bucket page a hash maps to in the hash table with the given header page */
+  page_id_t FindBucketPage(page_id_t header_page_id, uint32_t hash);
+  /**
+   * Fetch a zeroed page for a new hash overflow page. Its id is past every page on disk or in the log, the buffer
+   * pool only hands out ids it allocated itself since the restart.
+   * @return the pinned page, nullptr if there is no frame for it
+   */
+  Page *NewOverflowPage(page_id_t *page_id);
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *buffer_pool_manager_;
 
   /** Maintain active transactions and its corresponding latest lsn. */
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
-  /** Mapping the log sequence number to log file offset for undos. */
-  std::unordered_map<lsn_t, int> lsn_mapping_;
+  /** Mapping the log sequence number to log stream and offset for undos. */
+  std::unordered_map<lsn_t, std::pair<int, int64_t>> lsn_mapping_;
+  /** The largest page id in the log records seen by Redo(). */
+  page_id_t max_page_id_{INVALID_PAGE_ID};
+  /** Header pages of the hash indexes that lost an entry in Undo(). */
+  std::unordered_set<page_id_t> hash_indexes_to_rebuild_;
 
-  int offset_ __attribute__((__unused__));
   char *log_buffer_;
 };
 
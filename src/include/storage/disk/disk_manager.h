@@ -13,28 +13,38 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
 #include <fstream>
 #include <future>  // NOLINT
-#include <mutex>   // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <vector>
 
 #include "common/config.h"
 
 namespace bustub {
 
+/** Size of one preallocated log segment file in bytes. */
+static constexpr int LOG_SEGMENT_SIZE = 1 << 20;
+/** Number of zeroed, recycled segments kept around for reuse before old segments are deleted instead. */
+static constexpr int LOG_SPARE_SEGMENTS = 4;
+
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ * The page and log I/O methods are virtual so that tests can put a fault-injecting disk manager in its place.
  */
 class DiskManager {
  public:
   /**
    * Creates a new disk manager that writes to the specified database file.
    * @param db_file the file name of the database file to write to
+   * @param log_segment_size the size of each log segment file in bytes
    */
-  explicit DiskManager(const std::string &db_file);
+  explicit DiskManager(const std::string &db_file, int log_segment_size = LOG_SEGMENT_SIZE);
 
-  ~DiskManager() = default;
+  virtual ~DiskManager() = default;
 
   /**
    * Shut down the disk manager and close all the file resources.
@@ -46,30 +56,63 @@ class DiskManager {
    * @param page_id id of the page
    * @param page_data raw page data
    */
-  void WritePage(page_id_t page_id, const char *page_data);
+  virtual void WritePage(page_id_t page_id, const char *page_data);
 
   /**
    * Read a page from the database file.
    * @param page_id id of the page
    * @param[out] page_data output buffer
    */
-  void ReadPage(page_id_t page_id, char *page_data);
+  virtual void ReadPage(page_id_t page_id, char *page_data);
 
   /**
-   * Flush the entire log buffer into disk.
+   * Flush the entire log buffer into disk. Each log stream is a logical byte stream that is split across fixed-size
+   * segment files, so a write may span several segments. Different streams are written independently.
    * @param log_data raw log data
    * @param size size of log entry
+   * @param stream the log stream to append to (LogManager may use several)
    */
-  void WriteLog(char *log_data, int size);
+  virtual void WriteLog(char *log_data, int size, int stream = 0);
 
   /**
-   * Read a log entry from the log file.
+   * Read a log entry from the log. Reads that cross a segment boundary continue in the next segment.
    * @param[out] log_data output buffer
    * @param size size of the log entry
-   * @param offset offset of the log entry in the file
+   * @param offset logical offset of the log entry in the log stream
+   * @param stream the log stream to read from
    * @return true if the read was successful, false otherwise
    */
-  bool ReadLog(char *log_data, int size, int offset);
+  virtual bool ReadLog(char *log_data, int size, int64_t offset, int stream = 0);
+
+  /**
+   * Pad the current log segment so that the next write starts at the beginning of a fresh segment. The padding is
+   * left zero-filled, which readers of the log treat as "continue at the next segment".
+   * @param stream the log stream
+   */
+  void SwitchLogSegment(int stream = 0);
+
+  /**
+   * Recycle every log segment that lies wholly below the given offset, e.g. the redo point of the last checkpoint.
+   * Recycled segments are zeroed and kept as spares for reuse, or deleted once enough spares exist.
+   * @param offset logical log offset below which the log is no longer needed
+   * @param stream the log stream
+   */
+  void RecycleLogSegments(int64_t offset, int stream = 0);
+
+  /** @return the logical offset of the oldest byte still retained in the log stream */
+  int64_t GetLogStartOffset(int stream = 0);
+
+  /** @return the logical offset at which the next write to the log stream lands */
+  int64_t GetLogTailOffset(int stream = 0);
+
+  /** @return the number of pages the database file has room for, the written page with the largest id + 1 */
+  int GetNumPages();
+
+  /** @return the number of log streams, including the ones found on disk from a previous run */
+  int GetNumLogStreams();
+
+  /** @return the size of each log segment file in bytes */
+  inline int GetLogSegmentSize() const { return log_segment_size_; }
 
   /** @return the number of disk flushes */
   int GetNumFlushes() const;
@@ -90,16 +133,48 @@ class DiskManager {
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
  private:
+  /** Segment files and file streams of one log stream. Each has its own latch, so streams are written in parallel. */
+  struct LogStream {
+    // stream to write the current log segment
+    std::fstream write_io_;
+    int64_t write_segment_{-1};
+    // stream to read log segments, kept open across sequential reads
+    std::fstream read_io_;
+    int64_t read_segment_{-1};
+    // segment files are named "<name_>.<segment_no>"
+    std::string name_;
+    // oldest retained segment and logical offset of the next log write
+    int64_t first_segment_{0};
+    int64_t tail_{0};
+    // buffer of the previous write, to enforce that the log manager swaps buffers
+    const char *last_buffer_{nullptr};
+    // protects the file streams and segment bookkeeping
+    std::mutex latch_;
+  };
+
   int GetFileSize(const std::string &file_name);
-  // stream to write log file
-  std::fstream log_io_;
+  LogStream *GetLogStream(int stream);
+  std::string LogStreamName(int stream) const;
+  std::string SpareSegmentName(int spare_no) const;
+  void OpenLogSegment(LogStream *log_stream, int64_t segment_no);
+  bool ReadLogSegment(LogStream *log_stream, int64_t segment_no);
+  void CreateLogSegment(const std::string &segment_name);
+  // base name of the log, stream k > 0 is named "<log_name_><k>"
   std::string log_name_;
+  int log_segment_size_;
+  std::vector<std::unique_ptr<LogStream>> log_streams_;
+  // protects log_streams_ itself
+  std::mutex log_streams_latch_;
+  // zeroed segment files waiting to be reused by any stream
+  std::vector<std::string> spare_segments_;
+  int next_spare_no_{0};
+  std::mutex spare_latch_;
   // stream to write db file
   std::fstream db_io_;
   std::string file_name_;
-  int num_flushes_;
+  std::atomic<int> num_flushes_;
   int num_writes_;
-  bool flush_log_;
+  std::atomic<bool> flush_log_;
   std::future<void> *flush_log_f_;
   // With multiple buffer pool instances, need to protect file access
   std::mutex db_io_latch_;
@@ -0,0 +1,171 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// adaptive_radix_tree.h
+//
+// Identification: src/include/storage/index/adaptive_radix_tree.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/macros.h"
+#include "common/rid.h"
+
+namespace bustub {
+
+class AdaptiveRadixTree;
+struct ARTNode;
+
+/**
+ * Iterator over the entries of an AdaptiveRadixTree, in key order or in reverse.
+ *
+ * It copies the entries in batches and holds nothing in between. A batch is
+ * what its part of the tree held at one point; the next one starts after the
+ * last key returned and sees the changes made since. Batches start small so
+ * that short scans copy little, and double up to MAX_BATCH_SIZE.
+ */
+class ARTIterator {
+ public:
+  static constexpr size_t FIRST_BATCH_SIZE = 16;
+  static constexpr size_t MAX_BATCH_SIZE = 256;
+
+  /** Construct End(). */
+  ARTIterator() = default;
+
+  bool IsEnd() const { return position_ >= entries_.size(); }
+
+  const std::pair<std::string, RID> &operator*() const { return entries_[position_]; }
+
+  ARTIterator &operator++();
+
+ private:
+  friend class AdaptiveRadixTree;
+
+  /** Start at key, the first key of the tree (or the last one in reverse) if it is nullptr. */
+  ARTIterator(AdaptiveRadixTree *tree, const std::string *key, bool reverse);
+
+  /** Copy the next batch of entries past bound_. */
+  void Load();
+
+  AdaptiveRadixTree *tree_{nullptr};
+  bool reverse_{false};
+  std::vector<std::pair<std::string, RID>> entries_;
+  size_t position_{0};
+  size_t batch_size_{FIRST_BATCH_SIZE};
+  // the entries to load are after this key, or before it in reverse, and include it if inclusive_ is set
+  std::optional<std::string> bound_;
+  bool inclusive_{false};
+};
+
+/**
+ * Adaptive radix tree of byte string keys with RID values, held in memory
+ * only (Leis et al., "The Adaptive Radix Tree: ARTful Indexing for Main-Memory
+ * Databases").
+ *
+ * An inner node branches on one key byte and has room for 4, 16, 48 or 256
+ * children, growing and shrinking as children come and go. It also stores the
+ * bytes that all keys below it share before that byte (path compression). A
+ * key sits in a leaf right below the first node where no other key shares its
+ * path (lazy expansion), so the tree is only as deep as it takes to tell the
+ * keys apart. Keys compare byte by byte like in VarlenBPlusTree, but no key
+ * may be a prefix of another, which normalized keys of one schema never are
+ * (see NormalizedEncoding). Only unique keys are supported.
+ *
+ * Concurrency: optimistic lock coupling (Leis et al., "The ART of Practical
+ * Synchronization"). Every inner node has a version. Readers write nothing to
+ * the tree: they check that a node's version is unchanged after reading from
+ * it and restart from the root otherwise. Writers lock only the nodes they
+ * change, the one holding the child they add or remove, and its parent when
+ * the node is replaced by a bigger or smaller copy or gets its prefix split.
+ * A replaced node is marked obsolete, and it and removed leaves are freed once
+ * no operation that started before they were unlinked is still running.
+ */
+class AdaptiveRadixTree {
+ public:
+  AdaptiveRadixTree();
+
+  ~AdaptiveRadixTree();
+
+  DISALLOW_COPY_AND_MOVE(AdaptiveRadixTree);
+
+  // Insert a key-value pair into this tree, false if the key exists.
+  bool Insert(const std::string &key, const RID &value);
+
+  // Remove a key and its value from this tree, false if it is not there.
+  bool Remove(const std::string &key);
+
+  // return the value associated with a given key
+  bool GetValue(const std::string &key, std::vector<RID> *result);
+
+  // index iterator
+  ARTIterator Begin();
+  ARTIterator Begin(const std::string &key);
+
+  // reverse index iterator, starting at the last key not greater than key
+  ARTIterator RBegin();
+  ARTIterator RBegin(const std::string &key);
+
+ private:
+  friend class ARTIterator;
+
+  /**
+   * Counts an operation as running from construction to destruction, under the generation it started in, which
+   * keeps Reclaim() from freeing what it may still read.
+   */
+  class OperationGuard {
+   public:
+    explicit OperationGuard(AdaptiveRadixTree *tree);
+    ~OperationGuard();
+    DISALLOW_COPY_AND_MOVE(OperationGuard);
+
+   private:
+    std::atomic<int64_t> *running_;
+  };
+
+  // the running operations of each generation are counted apart by the threads of each stripe
+  static constexpr size_t OPERATION_STRIPES = 16;
+  // writers free retired nodes once there are this many
+  static constexpr size_t RECLAIM_THRESHOLD = 128;
+
+  struct alignas(64) OperationStripe {
+    std::atomic<int64_t> running_[2]{};
+  };
+
+  /** The attempts of each operation, false if a node changed under them and they have to restart. */
+  bool TryGetValue(const std::string &key, std::vector<RID> *result);
+  bool TryInsert(const std::string &key, const RID &value, bool *inserted);
+  bool TryRemove(const std::string &key, bool *removed);
+  bool TryScan(ARTNode *node, uint64_t version, size_t depth, const std::string *bound, bool inclusive, bool reverse,
+               size_t limit, std::vector<std::pair<std::string, RID>> *entries);
+
+  /** Copy up to limit entries past bound (before it in reverse), or from the first (last) key if it is nullptr. */
+  void Scan(const std::string *bound, bool inclusive, bool reverse, size_t limit,
+            std::vector<std::pair<std::string, RID>> *entries);
+
+  /** Free a node or leaf once no running operation can reach it. */
+  void Retire(ARTNode *node);
+
+  /** Start a new generation, wait for the operations of the old one and free what was retired before. */
+  void Reclaim();
+
+  ARTNode *root_;
+  std::atomic<uint32_t> generation_{0};
+  OperationStripe stripes_[OPERATION_STRIPES];
+  std::mutex retired_latch_;
+  std::vector<ARTNode *> retired_;
+  std::mutex reclaim_latch_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,52 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// adaptive_radix_tree_index.h
+//
+// Identification: src/include/storage/index/adaptive_radix_tree_index.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "storage/index/adaptive_radix_tree.h"
+#include "storage/index/index.h"
+
+namespace bustub {
+
+/**
+ * Index held in memory only, in an AdaptiveRadixTree of the normalized key
+ * columns (see NormalizedEncoding). A lookup neither pins pages nor takes
+ * latches, which suits tables that fit in memory and are probed often. Nothing
+ * of it is written to disk: it is built from the table heap when it is created.
+ */
+class AdaptiveRadixTreeIndex : public Index {
+ public:
+  explicit AdaptiveRadixTreeIndex(std::unique_ptr<IndexMetadata> &&metadata);
+
+  void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
+
+  bool SupportsRangeScan() const override { return true; }
+
+  /** The keys are always stored whole. */
+  bool ReturnsKeys() const override { return true; }
+
+  std::unique_ptr<IndexScanIterator> ScanRange(const Tuple *low_key, const Tuple *high_key, bool reverse,
+                                               Transaction *transaction) override;
+
+ protected:
+  // container
+  AdaptiveRadixTree container_;
+};
+
+}  // namespace bustub
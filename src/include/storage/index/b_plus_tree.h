@@ -10,11 +10,16 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <optional>
 #include <queue>
 #include <string>
 #include <vector>
 
+#include "common/rwlatch.h"
 #include "concurrency/transaction.h"
+#include "recovery/log_manager.h"
 #include "storage/index/index_iterator.h"
 #include "storage/page/b_plus_tree_internal_page.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
@@ -23,6 +28,9 @@ namespace bustub {
 
 #define BPLUSTREE_TYPE BPlusTree<KeyType, ValueType, KeyComparator>
 
+/** How a B+ tree handles concurrent splits, see BPlusTree. */
+enum class BPlusTreeMode { CRABBING, B_LINK };
+
 /**
  * Main class providing the API for the Interactive B+ Tree.
  *
@@ -32,6 +40,38 @@ namespace bustub {
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
  * (4) Implement index iterator for range scan
+ *
+ * Concurrency: readers and the first pass of writers descend with optimistic
+ * lock coupling. Internal pages are never latched: each one is read and then
+ * validated against its page version (see Page::GetVersion()), so lookups
+ * don't write to the shared upper levels of the tree. Point lookups read the
+ * leaf the same way, writers write-latch it and scans read-latch it. If the
+ * leaf might split or merge, a writer restarts and crabs down with write
+ * latches, releasing the ancestors as soon as a node is safe. Pessimistic
+ * writers serialize on root_latch_ while the root may change, which is
+ * recorded in the page set as a nullptr entry; root_page_id_ itself is only
+ * changed with the old root write-latched, so optimistic readers validate it
+ * through the old root's version.
+ *
+ * Appends, inserts of a key past the last key of the tree, skip the descent:
+ * the rightmost leaf is cached and validated once it is latched. When the
+ * rightmost page of a level splits because of an append, it keeps 90% of its
+ * entries instead of half, so an index on an increasing key fills its pages.
+ *
+ * In B_LINK mode the tree is a right-link (B-link) tree instead. Every page
+ * keeps a link to its right sibling and a high key, the lowest key that
+ * belongs to the pages to its right. A split links the new page in before it
+ * is known to the parent, so a search that reaches a page the key has moved
+ * away from follows the right links, and a writer never holds more than one
+ * latch per level: it splits the leaf, releases it and then latches the
+ * parent, moving right from there as well. Pages never merge in this mode,
+ * which is what keeps stale parent ids and child pointers safe to follow;
+ * deletes only remove the entry from the leaf.
+ *
+ * With a log manager, every page the tree changes, the header page record
+ * included, is logged as an after-image before it is released, so redo
+ * brings the tree to the state of the last change in the log. The tree isn't
+ * transactional: undo leaves it alone.
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTree {
@@ -40,7 +80,12 @@ class BPlusTree {
 
  public:
   explicit BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE);
+                     int leaf_max_size = LEAF_PAGE_SIZE, int internal_max_size = INTERNAL_PAGE_SIZE,
+                     BPlusTreeMode mode = BPlusTreeMode::CRABBING, page_id_t header_page_id = HEADER_PAGE_ID,
+                     LogManager *log_manager = nullptr);
+
+  // Open the tree whose root page id the header page already records, e.g. after recovery.
+  bool OpenFromHeaderPage();
 
   // Returns true if this B+ tree has no keys and values.
   bool IsEmpty() const;
@@ -54,11 +99,18 @@ class BPlusTree {
   // return the value associated with a given key
   bool GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction = nullptr);
 
+  // Build an empty B+ tree bottom-up from sorted, unique key & value pairs.
+  void BulkLoad(size_t num_entries, const std::function<bool(MappingType *)> &next_entry, double fill_factor = 1.0);
+
   // index iterator
   INDEXITERATOR_TYPE Begin();
   INDEXITERATOR_TYPE Begin(const KeyType &key);
   INDEXITERATOR_TYPE End();
 
+  // reverse index iterator, compares equal to End() once it is past the first entry
+  INDEXITERATOR_TYPE RBegin();
+  INDEXITERATOR_TYPE RBegin(const KeyType &key);
+
   void Print(BufferPoolManager *bpm) {
     ToString(reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(root_page_id_)->GetData()), bpm);
   }
@@ -80,6 +132,35 @@ class BPlusTree {
   Page *FindLeafPage(const KeyType &key, bool leftMost = false);
 
  private:
+  enum class Operation { INSERT, DELETE };
+  enum class LatchMode { OPTIMISTIC, READ, WRITE };
+  // the leaf a search goes to: the one holding the key, the greatest keys below it, the first or the last one
+  enum class Target { KEY, BEFORE_KEY, LEFT_MOST, RIGHT_MOST };
+
+  Page *FetchPage(page_id_t page_id);
+
+  uint64_t ReadVersion(Page *page) const;
+
+  Page *FindLeafPageOptimistic(const KeyType &key, Target target, LatchMode leaf_mode, uint64_t *leaf_version,
+                               std::optional<KeyType> *low_key = nullptr);
+
+  Page *FindPrevLeafPage(const KeyType &key, std::optional<KeyType> *low_key, int *index);
+
+  Page *FindLeafPageWrite(const KeyType &key, Operation op, Transaction *transaction);
+
+  Page *FindRightmostLeafPage(const KeyType &key);
+
+  page_id_t RightLink(BPlusTreePage *node, const KeyType &key, Target target, KeyType *high_key = nullptr) const;
+
+  Page *MoveRight(Page *page, const KeyType &key, LatchMode mode, uint64_t *version, Target target = Target::KEY,
+                  std::optional<KeyType> *low_key = nullptr);
+
+  bool IsSafe(BPlusTreePage *node, Operation op) const;
+
+  void ReleaseLatches(Transaction *transaction, bool dirty);
+
+  void DeletePages(Transaction *transaction);
+
   void StartNewTree(const KeyType &key, const ValueType &value);
 
   bool InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction = nullptr);
@@ -87,8 +168,14 @@ class BPlusTree {
   void InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
                         Transaction *transaction = nullptr);
 
+  bool InsertBLink(const KeyType &key, const ValueType &value);
+
+  void InsertIntoParentBLink(Page *old_page, const KeyType &key, BPlusTreePage *new_node);
+
+  void RemoveBLink(const KeyType &key);
+
   template <typename N>
-  N *Split(N *node);
+  N *Split(N *node, bool append = false);
 
   template <typename N>
   bool CoalesceOrRedistribute(N *node, Transaction *transaction = nullptr);
@@ -102,8 +189,24 @@ class BPlusTree {
 
   bool AdjustRoot(BPlusTreePage *old_root_node);
 
+  static std::vector<int> BulkLoadPageSizes(size_t num_entries, int fill, int min_size, int max_size);
+
+  Page *BulkLoadNewPage(size_t level, const KeyType &first_key, const std::vector<std::vector<int>> &page_sizes,
+                        std::vector<Page *> *open_pages, std::vector<size_t> *page_counts);
+
   void UpdateRootPageId(int insert_record = 0);
 
+  inline bool IsLogging() const { return enable_logging && log_manager_ != nullptr; }
+
+  // Log an after-image of a page the tree changed, while it is still latched, and set the page LSN.
+  void LogPage(Page *page);
+
+  // Log a page the caller has pinned by its node.
+  void LogPage(BPlusTreePage *node);
+
+  // Log the children in [begin, end) of an internal page, which a move of entries gave a new parent page id.
+  void LogChildren(InternalPage *node, int begin, int end);
+
   /* Debug Routines for FREE!! */
   void ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::ofstream &out) const;
 
@@ -111,11 +214,18 @@ class BPlusTree {
 
   // member variable
   std::string index_name_;
-  page_id_t root_page_id_;
+  std::atomic<page_id_t> root_page_id_;
+  // cached rightmost leaf for appends, only changed with that leaf write-latched
+  std::atomic<page_id_t> rightmost_leaf_page_id_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
   int leaf_max_size_;
   int internal_max_size_;
+  BPlusTreeMode mode_;
+  // the header page that records the root page id under index_name_
+  page_id_t header_page_id_;
+  LogManager *log_manager_;
+  ReaderWriterLatch root_latch_;
 };
 
 }  // namespace bustub
@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -26,7 +27,12 @@ namespace bustub {
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeIndex : public Index {
  public:
-  BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager);
+  /**
+   * @param header_page_id the header page the tree records its root page id in, which the caller creates
+   * @param log_manager if not null, page changes are logged while logging is enabled
+   */
+  BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                 page_id_t header_page_id = HEADER_PAGE_ID, LogManager *log_manager = nullptr);
 
   void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
 
@@ -34,17 +40,41 @@ class BPlusTreeIndex : public Index {
 
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
+  /**
+   * Builds the tree bottom-up: the entries are sorted, spilling to disk if they do not fit in memory, and then
+   * packed into pages at the fill factor.
+   */
+  void BulkInsertEntries(const std::function<bool(Tuple *key, RID *rid)> &next_entry,
+                         Transaction *transaction) override;
+
+  bool SupportsRangeScan() const override { return true; }
+
+  /** The keys are returned if they are stored whole: a fixed size key schema that fits into KeyType. */
+  bool ReturnsKeys() const override;
+
+  std::unique_ptr<IndexScanIterator> ScanRange(const Tuple *low_key, const Tuple *high_key, bool reverse,
+                                               Transaction *transaction) override;
+
+  /** Set the fraction of each page that a bulk load fills, leaving the rest for later inserts. */
+  void SetFillFactor(double fill_factor) { fill_factor_ = fill_factor; }
+
   INDEXITERATOR_TYPE GetBeginIterator();
 
   INDEXITERATOR_TYPE GetBeginIterator(const KeyType &key);
 
   INDEXITERATOR_TYPE GetEndIterator();
 
+  INDEXITERATOR_TYPE GetReverseBeginIterator();
+
+  INDEXITERATOR_TYPE GetReverseBeginIterator(const KeyType &key);
+
  protected:
   // comparator for key
   KeyComparator comparator_;
   // container
   BPlusTree<KeyType, ValueType, KeyComparator> container_;
+  // how full bulk loaded pages are
+  double fill_factor_{0.9};
 };
 
 }  // namespace bustub
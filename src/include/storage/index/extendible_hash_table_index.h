@@ -29,7 +29,7 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 class ExtendibleHashTableIndex : public Index {
  public:
   ExtendibleHashTableIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
-                           const HashFunction<KeyType> &hash_fn);
+                           const HashFunction<KeyType> &hash_fn, LogManager *log_manager = nullptr);
 
   ~ExtendibleHashTableIndex() override = default;
 
@@ -39,6 +39,12 @@ class ExtendibleHashTableIndex : public Index {
 
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
+  void ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                Transaction *transaction) override;
+
+  void BulkInsertEntries(const std::function<bool(Tuple *key, RID *rid)> &next_entry,
+                         Transaction *transaction) override;
+
  protected:
   // comparator for key
   KeyComparator comparator_;
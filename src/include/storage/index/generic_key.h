@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstring>
 
 #include "storage/table/tuple.h"
@@ -32,9 +33,13 @@ class GenericKey {
   inline void SetFromKey(const Tuple &tuple) {
     // intialize to 0
     memset(data_, 0, KeySize);
-    memcpy(data_, tuple.GetData(), tuple.GetLength());
+    // a longer key (e.g. a long varchar) is cut off instead of overflowing, see VarlenBPlusTree for such keys
+    memcpy(data_, tuple.GetData(), std::min(static_cast<size_t>(tuple.GetLength()), KeySize));
   }
 
+  // a generic key keeps the layout of the key tuple, which needs no schema
+  inline void SetFromKey(const Tuple &tuple, const Schema * /* key_schema */) { SetFromKey(tuple); }
+
   // NOTE: for test purpose only
   inline void SetFromInteger(int64_t key) {
     memset(data_, 0, KeySize);
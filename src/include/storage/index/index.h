@@ -12,12 +12,14 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "catalog/schema.h"
+#include "common/exception.h"
 #include "storage/table/tuple.h"
 #include "type/value.h"
 
@@ -25,6 +27,13 @@ namespace bustub {
 
 class Transaction;
 
+/**
+ * The structure behind an index. Hash tables only serve point lookups, B+ trees also ordered and range scans. A
+ * VARLEN_B_PLUS_TREE stores keys of any length instead of fixed size keys. An ADAPTIVE_RADIX_TREE does too, but in
+ * memory instead of in pages of the buffer pool.
+ */
+enum class IndexType { EXTENDIBLE_HASH, B_PLUS_TREE, LINEAR_PROBE_HASH, VARLEN_B_PLUS_TREE, ADAPTIVE_RADIX_TREE };
+
 /**
  * class IndexMetadata - Holds metadata of an index object.
  *
@@ -96,6 +105,26 @@ class IndexMetadata {
   Schema *key_schema_;
 };
 
+/////////////////////////////////////////////////////////////////////
+// IndexScanIterator class definition
+/////////////////////////////////////////////////////////////////////
+
+/**
+ * class IndexScanIterator - Cursor over the entries of an ordered index in a key range, see Index::ScanRange().
+ */
+class IndexScanIterator {
+ public:
+  virtual ~IndexScanIterator() = default;
+
+  /**
+   * Move to the next entry in the range.
+   * @param[out] key The index key of the entry, set only if the index returns keys (see Index::ReturnsKeys())
+   * @param[out] rid The RID of the entry
+   * @return `true` if there was an entry, `false` once the range is exhausted
+   */
+  virtual bool Next(Tuple *key, RID *rid) = 0;
+};
+
 /////////////////////////////////////////////////////////////////////
 // Index class definition
 /////////////////////////////////////////////////////////////////////
@@ -175,6 +204,63 @@ class Index {
    */
   virtual void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) = 0;
 
+  /**
+   * Search the index for a batch of keys, as from the outer side of an index join or an IN list. By default the keys
+   * are looked up one by one; an index type overrides this to overlap the page misses of the batch.
+   * @param keys The index keys
+   * @param results The RIDs of keys[i] go to (*results)[i]
+   * @param transaction The transaction context
+   */
+  virtual void ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                        Transaction *transaction) {
+    results->assign(keys.size(), {});
+    for (size_t i = 0; i < keys.size(); i++) {
+      ScanKey(keys[i], &(*results)[i], transaction);
+    }
+  }
+
+  ///////////////////////////////////////////////////////////////////
+  // Bulk Load
+  ///////////////////////////////////////////////////////////////////
+
+  /**
+   * Insert all entries of a new index at once. By default the entries are inserted one by one; an index type
+   * overrides this to build its structure in bulk.
+   * @param next_entry Produces the next (key, RID) pair, returns false when there are no more entries
+   * @param transaction The transaction context
+   */
+  virtual void BulkInsertEntries(const std::function<bool(Tuple *key, RID *rid)> &next_entry,
+                                 Transaction *transaction) {
+    Tuple key;
+    RID rid;
+    while (next_entry(&key, &rid)) {
+      InsertEntry(key, rid, transaction);
+    }
+  }
+
+  ///////////////////////////////////////////////////////////////////
+  // Range Scan
+  ///////////////////////////////////////////////////////////////////
+
+  /** @return `true` if the index keeps its keys in order and implements ScanRange() */
+  virtual bool SupportsRangeScan() const { return false; }
+
+  /** @return `true` if ScanRange() returns the exact keys, so a scan can skip the table heap */
+  virtual bool ReturnsKeys() const { return false; }
+
+  /**
+   * Scan the entries whose keys lie in a range, in key order. The iterator holds no latches between calls.
+   * @param low_key The inclusive lower bound, nullptr for none
+   * @param high_key The inclusive upper bound, nullptr for none
+   * @param reverse Whether to scan from the upper bound down instead
+   * @param transaction The transaction context
+   * @return An iterator over the entries in the range
+   */
+  virtual std::unique_ptr<IndexScanIterator> ScanRange(const Tuple * /* low_key */, const Tuple * /* high_key */,
+                                                       bool /* reverse */, Transaction * /* transaction */) {
+    throw NotImplementedException("range scan is not supported by this index type");
+  }
+
  private:
   /** The Index structure owns its metadata */
   std::unique_ptr<IndexMetadata> metadata_;
@@ -13,6 +13,11 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "common/macros.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
 
 namespace bustub {
@@ -21,23 +26,75 @@ namespace bustub {
 
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
+  using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
+
  public:
-  // you may define your own constructor based on your member variables
-  IndexIterator();
+  /**
+   * Finds the leaf holding the greatest keys below a low fence, see BPlusTree::FindPrevLeafPage(). Takes the fence,
+   * and returns the leaf pinned and read-latched, its low fence and the position of its last entry below the fence.
+   */
+  using FindPrevLeaf = std::function<Page *(const KeyType &, std::optional<KeyType> *, int *)>;
+
+  /** Construct End(). */
+  IndexIterator() = default;
+
+  /**
+   * Construct a forward iterator.
+   * @param buffer_pool_manager buffer pool the leaf pages are fetched from
+   * @param comparator comparator of the tree, which must outlive the iterator
+   * @param page leaf page to start at, pinned and read-latched; the iterator takes over both. nullptr for End()
+   * @param index position of the first entry within the leaf page
+   */
+  IndexIterator(BufferPoolManager *buffer_pool_manager, const KeyComparator *comparator, Page *page, int index);
+
+  /**
+   * Construct a reverse iterator, which moves to smaller keys.
+   * @param buffer_pool_manager buffer pool the leaf pages are fetched from
+   * @param page leaf page to start at, pinned and read-latched; the iterator releases both. nullptr for End()
+   * @param index position of the first entry within the leaf page, -1 to start in the leaf before it
+   * @param low_key low fence of the leaf page, nullopt for the left most leaf
+   * @param find_prev_leaf finds the leaf before a low fence
+   */
+  IndexIterator(BufferPoolManager *buffer_pool_manager, Page *page, int index, std::optional<KeyType> low_key,
+                FindPrevLeaf find_prev_leaf);
+
   ~IndexIterator();
 
+  DISALLOW_COPY(IndexIterator);
+  IndexIterator(IndexIterator &&other) noexcept;
+  IndexIterator &operator=(IndexIterator &&other) noexcept;
+
   bool IsEnd();
 
   const MappingType &operator*();
 
   IndexIterator &operator++();
 
-  bool operator==(const IndexIterator &itr) const { throw std::runtime_error("unimplemented"); }
+  bool operator==(const IndexIterator &itr) const { return page_id_ == itr.page_id_ && index_ == itr.index_; }
 
-  bool operator!=(const IndexIterator &itr) const { throw std::runtime_error("unimplemented"); }
+  bool operator!=(const IndexIterator &itr) const { return !(*this == itr); }
 
  private:
-  // add your own private member variables here
+  /** Copy the entries of a read-latched leaf page that are still ahead of the iterator, starting at index. */
+  void Load(Page *page, int index);
+  /** Move to the next (or previous) leaf page while the current position is past the end of the current one. */
+  void SkipExhaustedPages();
+  /** Unpin the current leaf page and turn into End(). */
+  void Release();
+
+  BufferPoolManager *buffer_pool_manager_{nullptr};
+  const KeyComparator *comparator_{nullptr};
+  // forward iterators keep the current leaf page pinned, not latched
+  Page *page_{nullptr};
+  page_id_t page_id_{INVALID_PAGE_ID};
+  // entries of the current leaf page ahead of the iterator, in iteration order
+  std::vector<MappingType> entries_;
+  int index_{0};
+  // greatest key returned from the previous leaf page, forward only
+  std::optional<KeyType> last_key_;
+  // low fence of the current leaf page, reverse only
+  std::optional<KeyType> low_key_;
+  FindPrevLeaf find_prev_leaf_;
 };
 
 }  // namespace bustub
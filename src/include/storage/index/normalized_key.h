@@ -0,0 +1,316 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// normalized_key.h
+//
+// Identification: src/include/storage/index/normalized_key.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+#include "common/macros.h"
+#include "storage/table/tuple.h"
+#include "type/value.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+/**
+ * The binary comparable encoding of key columns, see NormalizedKey.
+ *
+ * Values are written into a buffer of a given size and cut off at its end,
+ * and read back with the bytes past the end taken as zero.
+ */
+class NormalizedEncoding {
+ public:
+  static constexpr uint64_t SIGN_BIT = 1ULL << 63;
+
+  /** @return the size of the full encoding of a key */
+  static inline size_t EncodedSize(const Tuple &tuple, const Schema *key_schema) {
+    size_t size = 0;
+    for (uint32_t i = 0; i < key_schema->GetColumnCount(); i++) {
+      size += EncodedSize(tuple.GetValue(key_schema, i));
+    }
+    return size;
+  }
+
+  /** @return the full encoding of a key, not cut off at any size */
+  static inline std::string Encode(const Tuple &tuple, const Schema *key_schema) {
+    std::string key(EncodedSize(tuple, key_schema), '\0');
+    size_t offset = 0;
+    for (uint32_t i = 0; i < key_schema->GetColumnCount(); i++) {
+      offset = Append(tuple.GetValue(key_schema, i), key.data(), key.size(), offset);
+    }
+    return key;
+  }
+
+  /** Write the low width bytes of bits, most significant first, up to the end of the buffer. */
+  static inline size_t AppendBytes(uint64_t bits, size_t width, char *data, size_t size, size_t offset) {
+    for (size_t i = width; i-- > 0 && offset < size;) {
+      data[offset++] = static_cast<char>(bits >> (8 * i));
+    }
+    return offset;
+  }
+
+  /** Write value at offset. @return the offset past it */
+  static inline size_t Append(const Value &value, char *data, size_t size, size_t offset) {
+    switch (value.GetTypeId()) {
+      case TypeId::BOOLEAN:
+      case TypeId::TINYINT:
+        return AppendSigned(value.GetAs<int8_t>(), sizeof(int8_t), data, size, offset);
+      case TypeId::SMALLINT:
+        return AppendSigned(value.GetAs<int16_t>(), sizeof(int16_t), data, size, offset);
+      case TypeId::INTEGER:
+        return AppendSigned(value.GetAs<int32_t>(), sizeof(int32_t), data, size, offset);
+      case TypeId::BIGINT:
+        return AppendSigned(value.GetAs<int64_t>(), sizeof(int64_t), data, size, offset);
+      case TypeId::DECIMAL: {
+        auto decimal = value.GetAs<double>();
+        uint64_t bits;
+        memcpy(&bits, &decimal, sizeof(bits));
+        return AppendBytes((bits & SIGN_BIT) != 0 ? ~bits : bits | SIGN_BIT, sizeof(bits), data, size, offset);
+      }
+      case TypeId::TIMESTAMP:
+        return AppendBytes(value.GetAs<uint64_t>(), sizeof(uint64_t), data, size, offset);
+      case TypeId::VARCHAR: {
+        // a null varchar sorts before the empty one
+        if (value.IsNull()) {
+          return AppendBytes(0x0000, 2, data, size, offset);
+        }
+        const char *chars = value.GetData();
+        uint32_t length = VarcharLength(value);
+        for (uint32_t i = 0; i < length && offset < size; i++) {
+          offset = chars[i] == '\0' ? AppendBytes(0x00ff, 2, data, size, offset)
+                                    : AppendBytes(static_cast<uint8_t>(chars[i]), 1, data, size, offset);
+        }
+        return AppendBytes(0x0001, 2, data, size, offset);
+      }
+      default:
+        UNREACHABLE("cannot normalize a value of this type");
+    }
+  }
+
+  /** The inverse of Append(): read a value of the given type at offset and move offset past it. */
+  static inline Value Read(TypeId type, const char *data, size_t size, size_t *offset) {
+    switch (type) {
+      case TypeId::BOOLEAN:
+        return Value(type, static_cast<int8_t>(ReadSigned(sizeof(int8_t), data, size, offset)));
+      case TypeId::TINYINT:
+        return Value(type, static_cast<int8_t>(ReadSigned(sizeof(int8_t), data, size, offset)));
+      case TypeId::SMALLINT:
+        return Value(type, static_cast<int16_t>(ReadSigned(sizeof(int16_t), data, size, offset)));
+      case TypeId::INTEGER:
+        return Value(type, static_cast<int32_t>(ReadSigned(sizeof(int32_t), data, size, offset)));
+      case TypeId::BIGINT:
+        return Value(type, ReadSigned(sizeof(int64_t), data, size, offset));
+      case TypeId::DECIMAL: {
+        uint64_t bits = ReadBytes(sizeof(bits), data, size, offset);
+        bits = (bits & SIGN_BIT) != 0 ? bits ^ SIGN_BIT : ~bits;
+        double decimal;
+        memcpy(&decimal, &bits, sizeof(decimal));
+        return Value(type, decimal);
+      }
+      case TypeId::TIMESTAMP:
+        return Value(type, ReadBytes(sizeof(uint64_t), data, size, offset));
+      case TypeId::VARCHAR: {
+        std::string chars;
+        while (*offset < size) {
+          auto byte = static_cast<uint8_t>(data[(*offset)++]);
+          if (byte != 0x00) {
+            chars.push_back(static_cast<char>(byte));
+            continue;
+          }
+          // 0x00 0xff is an escaped 0x00 byte, 0x00 0x01 ends the varchar and 0x00 0x00 is null
+          auto escape = ReadBytes(1, data, size, offset);
+          if (escape == 0xff) {
+            chars.push_back('\0');
+            continue;
+          }
+          if (escape == 0x00) {
+            return ValueFactory::GetNullValueByType(type);
+          }
+          break;
+        }
+        return Value(type, chars);
+      }
+      default:
+        UNREACHABLE("cannot decode a value of this type");
+    }
+  }
+
+ private:
+  /** @return the length of a varchar without the terminating 0 byte it is stored with */
+  static inline uint32_t VarcharLength(const Value &value) {
+    uint32_t length = value.GetLength();
+    return length > 0 && value.GetData()[length - 1] == '\0' ? length - 1 : length;
+  }
+
+  static inline size_t EncodedSize(const Value &value) {
+    if (value.GetTypeId() != TypeId::VARCHAR) {
+      return Type::GetTypeSize(value.GetTypeId());
+    }
+    if (value.IsNull()) {
+      return 2;
+    }
+    const char *chars = value.GetData();
+    uint32_t length = VarcharLength(value);
+    return length + std::count(chars, chars + length, '\0') + 2;
+  }
+
+  static inline size_t AppendSigned(int64_t value, size_t width, char *data, size_t size, size_t offset) {
+    return AppendBytes(static_cast<uint64_t>(value) ^ (1ULL << (8 * width - 1)), width, data, size, offset);
+  }
+
+  /** Read width bytes, most significant first, zero past the end of the buffer. */
+  static inline uint64_t ReadBytes(size_t width, const char *data, size_t size, size_t *offset) {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < width; i++, (*offset)++) {
+      bits = (bits << 8) | (*offset < size ? static_cast<uint8_t>(data[*offset]) : 0);
+    }
+    return bits;
+  }
+
+  static inline int64_t ReadSigned(size_t width, const char *data, size_t size, size_t *offset) {
+    uint64_t bits = ReadBytes(width, data, size, offset) ^ (1ULL << (8 * width - 1));
+    // sign extend
+    return static_cast<int64_t>(bits << (64 - 8 * width)) >> (64 - 8 * width);
+  }
+};
+
+/**
+ * Normalized key is used for indexing with binary comparable data.
+ *
+ * The columns of the key are encoded one after another so that comparing two
+ * keys byte by byte orders them like comparing their values column by column:
+ * integers are stored big endian with the sign bit flipped, decimals with the
+ * sign bit flipped (and all other bits too when negative), and varchars with
+ * their 0x00 bytes escaped to 0x00 0xff and ended by 0x00 0x01. The rest of
+ * the key is zero. A key longer than KeySize is cut off, so keys that only
+ * differ past KeySize bytes compare equal; VarlenBPlusTree keeps such keys
+ * whole.
+ */
+template <size_t KeySize>
+class NormalizedKey {
+ public:
+  inline void SetFromKey(const Tuple &tuple, const Schema *key_schema) {
+    memset(data_, 0, KeySize);
+    size_t offset = 0;
+    for (uint32_t i = 0; i < key_schema->GetColumnCount() && offset < KeySize; i++) {
+      offset = NormalizedEncoding::Append(tuple.GetValue(key_schema, i), data_, KeySize, offset);
+    }
+  }
+
+  /**
+   * Decode a column of the key. The columns are read one after another up to
+   * column_idx, which must not be cut off.
+   */
+  inline Value ToValue(Schema *schema, uint32_t column_idx) const {
+    size_t offset = 0;
+    for (uint32_t i = 0; i < column_idx; i++) {
+      NormalizedEncoding::Read(schema->GetColumn(i).GetType(), data_, KeySize, &offset);
+    }
+    return NormalizedEncoding::Read(schema->GetColumn(column_idx).GetType(), data_, KeySize, &offset);
+  }
+
+  // NOTE: for test purpose only
+  inline void SetFromInteger(int64_t key) {
+    memset(data_, 0, KeySize);
+    NormalizedEncoding::AppendBytes(static_cast<uint64_t>(key) ^ NormalizedEncoding::SIGN_BIT, sizeof(int64_t), data_,
+                                    KeySize, 0);
+  }
+
+  // NOTE: for test purpose only
+  // decode the first 8 bytes as int64_t from data vector
+  inline int64_t ToString() const {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < std::min(sizeof(int64_t), KeySize); i++) {
+      bits = (bits << 8) | static_cast<uint8_t>(data_[i]);
+    }
+    return static_cast<int64_t>(bits ^ NormalizedEncoding::SIGN_BIT);
+  }
+
+  // NOTE: for test purpose only
+  friend std::ostream &operator<<(std::ostream &os, const NormalizedKey &key) {
+    os << key.ToString();
+    return os;
+  }
+
+  // actual location of data, extends past the end.
+  char data_[KeySize];
+};
+
+/**
+ * Function object that compares normalized keys by their bytes.
+ *
+ * Besides the full comparison it can compare past a prefix the keys are known
+ * to share, and find the shortest separator between two keys.
+ */
+template <size_t KeySize>
+class NormalizedComparator {
+ public:
+  /** Marks comparators that order keys by their bytes, see IsBinaryComparable. */
+  static constexpr bool BINARY_COMPARABLE = true;
+
+  inline int operator()(const NormalizedKey<KeySize> &lhs, const NormalizedKey<KeySize> &rhs) const {
+    return memcmp(lhs.data_, rhs.data_, KeySize);
+  }
+
+  /** Compare keys that share their first offset bytes. */
+  inline int operator()(const NormalizedKey<KeySize> &lhs, const NormalizedKey<KeySize> &rhs, size_t offset) const {
+    return memcmp(lhs.data_ + offset, rhs.data_ + offset, KeySize - offset);
+  }
+
+  /** @return the first 8 bytes of key as a big endian integer, which orders keys like those bytes do */
+  static inline uint64_t Head(const NormalizedKey<KeySize> &key) {
+    uint64_t head = 0;
+    memcpy(&head, key.data_, std::min(KeySize, sizeof(head)));
+    // loaded little endian
+    return __builtin_bswap64(head);
+  }
+
+  /** @return the number of leading bytes lhs and rhs have in common */
+  static inline size_t CommonPrefix(const NormalizedKey<KeySize> &lhs, const NormalizedKey<KeySize> &rhs) {
+    return std::mismatch(lhs.data_, lhs.data_ + KeySize, rhs.data_).first - lhs.data_;
+  }
+
+  /**
+   * @return the shortest prefix of rhs that is greater than lhs, zero padded,
+   * which sorts after lhs and not after rhs. lhs must be less than rhs.
+   */
+  static inline NormalizedKey<KeySize> Separator(const NormalizedKey<KeySize> &lhs,
+                                                 const NormalizedKey<KeySize> &rhs) {
+    NormalizedKey<KeySize> separator;
+    memset(separator.data_, 0, KeySize);
+    memcpy(separator.data_, rhs.data_, std::min(CommonPrefix(lhs, rhs) + 1, KeySize));
+    return separator;
+  }
+
+  NormalizedComparator(const NormalizedComparator &other) = default;
+
+  // constructor, the encoding of the keys makes the key schema unnecessary
+  explicit NormalizedComparator(Schema * /* key_schema */ = nullptr) {}
+};
+
+/**
+ * True for a KeyComparator that orders keys by their bytes, like
+ * NormalizedComparator. B+ tree pages skip the prefix their keys share when
+ * searching with one, and splits push up the shortest separator.
+ */
+template <typename KeyComparator, typename = void>
+struct IsBinaryComparable : std::false_type {};
+
+template <typename KeyComparator>
+struct IsBinaryComparable<KeyComparator, std::void_t<decltype(KeyComparator::BINARY_COMPARABLE)>>
+    : std::bool_constant<KeyComparator::BINARY_COMPARABLE> {};
+
+}  // namespace bustub
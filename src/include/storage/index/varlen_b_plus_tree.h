@@ -0,0 +1,159 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// varlen_b_plus_tree.h
+//
+// Identification: src/include/storage/index/varlen_b_plus_tree.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/rid.h"
+#include "common/rwlatch.h"
+#include "storage/page/b_plus_tree_slotted_page.h"
+
+namespace bustub {
+
+class VarlenBPlusTree;
+
+/**
+ * Iterator over the entries of a VarlenBPlusTree, in key order or in reverse.
+ *
+ * Like IndexIterator, it copies the entries of a leaf while the leaf is
+ * read-latched and holds no latch or pin in between. Moving forward it goes
+ * back to the last leaf it read to follow the next page link, skipping the
+ * keys it already returned, which a split may have moved to the right.
+ * Leaves have no link to the left, so moving backward searches the tree for
+ * the keys before the first one returned.
+ */
+class VarlenIndexIterator {
+ public:
+  /** Construct End(). */
+  VarlenIndexIterator() = default;
+
+  bool IsEnd() const { return position_ >= entries_.size(); }
+
+  const std::pair<std::string, RID> &operator*() const { return entries_[position_]; }
+
+  VarlenIndexIterator &operator++();
+
+ private:
+  friend class VarlenBPlusTree;
+
+  /** Start at key, the first key of the tree (or the last one in reverse) if it is nullptr. */
+  VarlenIndexIterator(VarlenBPlusTree *tree, const std::string *key, bool reverse);
+
+  /** Copy the next entries past bound_, from the following leaves that have any. */
+  void Load();
+  void LoadForward();
+  void LoadReverse();
+
+  VarlenBPlusTree *tree_{nullptr};
+  bool reverse_{false};
+  std::vector<std::pair<std::string, RID>> entries_;
+  size_t position_{0};
+  // the entries to load are after this key, or before it in reverse, and include it if inclusive_ is set
+  std::optional<std::string> bound_;
+  bool inclusive_{false};
+  // the leaf the entries were copied from, moving forward
+  page_id_t page_id_{INVALID_PAGE_ID};
+};
+
+/**
+ * B+ tree of keys of any length, compared byte by byte, with RID values.
+ *
+ * The keys are stored in slotted pages (see BPlusTreeSlottedPage), so a page
+ * holds as many keys as their actual sizes allow instead of a fixed number of
+ * fixed size keys; keys longer than an eighth of a page continue in overflow
+ * pages. When a leaf splits, its parent gets the shortest prefix of the first
+ * key of the new leaf that is greater than the last key of the old one.
+ * VarlenBPlusTreeIndex stores normalized keys (see NormalizedEncoding), whose
+ * bytes order them like their values, in it.
+ *
+ * Only unique keys are supported. Pages never merge: a delete removes the
+ * entry from its leaf and the space is reused by later inserts into the leaf.
+ * Since pages are never deleted, an iterator can go back to a leaf it has let
+ * go of.
+ *
+ * Concurrency: readers crab down with read latches. Writers first do the same
+ * but write-latch the leaf, which is enough unless the leaf has to split. An
+ * insert that splits restarts and crabs down with write latches, releasing
+ * the ancestors of a page with room for any separator. It holds root_latch_
+ * while the root may split, and readers read the root page id under it.
+ */
+class VarlenBPlusTree {
+ public:
+  /**
+   * @param name name of the tree, under which the header page records its root
+   * @param buffer_pool_manager buffer pool the pages of the tree live in
+   * @param header_page_id the header page the tree records its root page id in, which the caller creates
+   */
+  VarlenBPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, page_id_t header_page_id = HEADER_PAGE_ID);
+
+  // Returns true if this B+ tree has no pages yet.
+  bool IsEmpty() const;
+
+  // Insert a key-value pair into this B+ tree, false if the key exists.
+  bool Insert(const std::string &key, const RID &value);
+
+  // Remove a key and its value from this B+ tree.
+  void Remove(const std::string &key);
+
+  // return the value associated with a given key
+  bool GetValue(const std::string &key, std::vector<RID> *result);
+
+  // index iterator
+  VarlenIndexIterator Begin();
+  VarlenIndexIterator Begin(const std::string &key);
+
+  // reverse index iterator, starting at the last key not greater than key
+  VarlenIndexIterator RBegin();
+  VarlenIndexIterator RBegin(const std::string &key);
+
+ private:
+  friend class VarlenIndexIterator;
+
+  // the leaf a search goes to: the one holding the key, the greatest keys below it, the first or the last one
+  enum class Target { KEY, BEFORE_KEY, LEFT_MOST, RIGHT_MOST };
+
+  Page *FetchPage(page_id_t page_id);
+
+  Page *NewPage(uint16_t level);
+
+  Page *FindLeafPage(Target target, const std::string *key, bool write, std::optional<std::string> *low_key = nullptr);
+
+  Page *FindLeafPageWrite(const std::string &key, std::vector<Page *> *path);
+
+  bool IsSafe(const BPlusTreeSlottedPage *node, const std::string &key) const;
+
+  void ReleasePath(std::vector<Page *> *path, bool dirty);
+
+  bool InsertPessimistic(const std::string &key, const RID &value);
+
+  void InsertIntoParent(std::vector<Page *> *path, std::string separator, page_id_t new_page_id);
+
+  static std::string Separator(const std::string &lhs, const std::string &rhs);
+
+  void UpdateRootPageId(int insert_record = 0);
+
+  // member variable
+  std::string index_name_;
+  std::atomic<page_id_t> root_page_id_;
+  BufferPoolManager *buffer_pool_manager_;
+  // the header page that records the root page id under index_name_
+  page_id_t header_page_id_;
+  ReaderWriterLatch root_latch_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,57 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// varlen_b_plus_tree_index.h
+//
+// Identification: src/include/storage/index/varlen_b_plus_tree_index.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "storage/index/index.h"
+#include "storage/index/varlen_b_plus_tree.h"
+
+namespace bustub {
+
+/**
+ * B+ tree index whose keys take only the space they need, and can be of any
+ * length: the key columns are normalized (see NormalizedEncoding) and stored
+ * whole in a VarlenBPlusTree. Suits varchar keys, which a BPlusTreeIndex
+ * pads to or cuts off at its fixed key size.
+ */
+class VarlenBPlusTreeIndex : public Index {
+ public:
+  /**
+   * @param header_page_id the header page the tree records its root page id in, which the caller creates
+   */
+  VarlenBPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                       page_id_t header_page_id = HEADER_PAGE_ID);
+
+  void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) override;
+
+  void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
+
+  bool SupportsRangeScan() const override { return true; }
+
+  /** The keys are always stored whole. */
+  bool ReturnsKeys() const override { return true; }
+
+  std::unique_ptr<IndexScanIterator> ScanRange(const Tuple *low_key, const Tuple *high_key, bool reverse,
+                                               Transaction *transaction) override;
+
+ protected:
+  // container
+  VarlenBPlusTree container_;
+};
+
+}  // namespace bustub
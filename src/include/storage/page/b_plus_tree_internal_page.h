@@ -17,7 +17,7 @@
 namespace bustub {
 
 #define B_PLUS_TREE_INTERNAL_PAGE_TYPE BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>
-#define INTERNAL_PAGE_HEADER_SIZE 24
+#define INTERNAL_PAGE_HEADER_SIZE (28 + sizeof(KeyType))
 #define INTERNAL_PAGE_SIZE ((PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) / (sizeof(MappingType)))
 /**
  * Store n indexed keys and n+1 child pointers (page_id) within internal page.
@@ -31,6 +31,12 @@ namespace bustub {
  *  --------------------------------------------------------------------------
  * | HEADER | KEY(1)+PAGE_ID(1) | KEY(2)+PAGE_ID(2) | ... | KEY(n)+PAGE_ID(n) |
  *  --------------------------------------------------------------------------
+ *
+ * Like a leaf page, the header ends with the next page on the same level and
+ * the high key, the lowest key of that page's subtree:
+ *  ----------------------------------------------------------------
+ * | BPlusTreePage (24) | NextPageId (4) | HighKey (key) |
+ *  ----------------------------------------------------------------
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeInternalPage : public BPlusTreePage {
@@ -42,16 +48,24 @@ class BPlusTreeInternalPage : public BPlusTreePage {
   void SetKeyAt(int index, const KeyType &key);
   int ValueIndex(const ValueType &value) const;
   ValueType ValueAt(int index) const;
+  void SetValueAt(int index, const ValueType &value);
+  page_id_t GetNextPageId() const;
+  void SetNextPageId(page_id_t next_page_id);
+  KeyType GetHighKey() const;
+  void SetHighKey(const KeyType &high_key);
 
   ValueType Lookup(const KeyType &key, const KeyComparator &comparator) const;
+  int LookupIndex(const KeyType &key, const KeyComparator &comparator, bool before = false) const;
   void PopulateNewRoot(const ValueType &old_value, const KeyType &new_key, const ValueType &new_value);
   int InsertNodeAfter(const ValueType &old_value, const KeyType &new_key, const ValueType &new_value);
+  int Insert(const KeyType &key, const ValueType &value, const KeyComparator &comparator);
   void Remove(int index);
   ValueType RemoveAndReturnOnlyChild();
 
   // Split and Merge utility methods
   void MoveAllTo(BPlusTreeInternalPage *recipient, const KeyType &middle_key, BufferPoolManager *buffer_pool_manager);
   void MoveHalfTo(BPlusTreeInternalPage *recipient, BufferPoolManager *buffer_pool_manager);
+  void MoveTailTo(BPlusTreeInternalPage *recipient, int size, BufferPoolManager *buffer_pool_manager);
   void MoveFirstToEndOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
                         BufferPoolManager *buffer_pool_manager);
   void MoveLastToFrontOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key,
@@ -61,6 +75,9 @@ class BPlusTreeInternalPage : public BPlusTreePage {
   void CopyNFrom(MappingType *items, int size, BufferPoolManager *buffer_pool_manager);
   void CopyLastFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
   void CopyFirstFrom(const MappingType &pair, BufferPoolManager *buffer_pool_manager);
+  void Adopt(page_id_t page_id, BufferPoolManager *buffer_pool_manager);
+  page_id_t next_page_id_;
+  KeyType high_key_;
   MappingType array_[0];
 };
 }  // namespace bustub
@@ -17,6 +17,8 @@
 
 #include "buffer/buffer_pool_manager.h"
 #include "storage/index/generic_key.h"
+#include "storage/index/normalized_key.h"
+#include "storage/page/b_plus_tree_search.h"
 
 namespace bustub {
 
@@ -60,16 +62,17 @@ class BPlusTreePage {
   page_id_t GetPageId() const;
   void SetPageId(page_id_t page_id);
 
+  lsn_t GetLSN() const;
   void SetLSN(lsn_t lsn = INVALID_LSN);
 
  private:
   // member variable, attributes that both internal and leaf page share
-  IndexPageType page_type_ __attribute__((__unused__));
-  lsn_t lsn_ __attribute__((__unused__));
-  int size_ __attribute__((__unused__));
-  int max_size_ __attribute__((__unused__));
-  page_id_t parent_page_id_ __attribute__((__unused__));
-  page_id_t page_id_ __attribute__((__unused__));
+  IndexPageType page_type_;
+  lsn_t lsn_;
+  int size_;
+  int max_size_;
+  page_id_t parent_page_id_;
+  page_id_t page_id_;
 };
 
 }  // namespace bustub
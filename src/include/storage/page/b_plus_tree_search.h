@@ -0,0 +1,147 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_search.h
+//
+// Identification: src/include/storage/page/b_plus_tree_search.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "storage/index/normalized_key.h"
+
+namespace bustub {
+
+/**
+ * Binary search that works with any KeyComparator. With a binary comparable
+ * one, the prefix that the first and the last entry share, and so every entry
+ * between them, is only compared once.
+ */
+struct ScalarKeySearch {
+  template <typename Entry, typename KeyType, typename KeyComparator>
+  static const Entry *Search(const Entry *first, const Entry *last, const KeyType &key, const KeyComparator &comparator,
+                             bool upper) {
+    size_t prefix = 0;
+    if constexpr (IsBinaryComparable<KeyComparator>::value) {
+      if (first != last) {
+        prefix = KeyComparator::CommonPrefix(first->first, (last - 1)->first);
+        if (KeyComparator::CommonPrefix(first->first, key) < prefix) {
+          // the key sorts before or after all entries
+          return comparator(key, first->first) < 0 ? first : last;
+        }
+      }
+    }
+    while (first < last) {
+      const Entry *mid = first + (last - first) / 2;
+      int cmp;
+      if constexpr (IsBinaryComparable<KeyComparator>::value) {
+        cmp = comparator(mid->first, key, prefix);
+      } else {
+        cmp = comparator(mid->first, key);
+      }
+      if (cmp < 0 || (upper && cmp == 0)) {
+        first = mid + 1;
+      } else {
+        last = mid;
+      }
+    }
+    return first;
+  }
+};
+
+/** The search used for the keys of a KeyComparator, the scalar one unless specialized below. */
+template <typename KeyComparator>
+struct KeySearch : ScalarKeySearch {};
+
+/**
+ * Search specialized for fixed-width normalized keys. Keys are compared by
+ * their head, the first 8 bytes read as a big endian integer, and only keys
+ * with equal heads compare the rest of their bytes. A branch-free binary
+ * search narrows the entries down to a few cache lines, which are then
+ * counted linearly, 4 heads at a time with AVX2.
+ */
+template <size_t KeySize>
+struct KeySearch<NormalizedComparator<KeySize>> {
+  using Comparator = NormalizedComparator<KeySize>;
+
+  template <typename Entry>
+  static const Entry *Search(const Entry *first, const Entry *last, const NormalizedKey<KeySize> &key,
+                             const Comparator &comparator, bool upper) {
+    // entries left to the linear search, about 4 cache lines
+    constexpr size_t linear_entries = std::max<size_t>(4, 256 / sizeof(Entry));
+    const uint64_t key_head = Comparator::Head(key);
+    auto before = [&](const Entry &entry) {
+      uint64_t head = Comparator::Head(entry.first);
+      if constexpr (KeySize > sizeof(uint64_t)) {
+        if (head == key_head) {
+          int cmp = comparator(entry.first, key, sizeof(uint64_t));
+          return cmp < 0 || (upper && cmp == 0);
+        }
+      }
+      return head < key_head || (upper && head == key_head);
+    };
+
+    // the answer stays within [first, first + n]
+    auto n = static_cast<size_t>(last - first);
+    while (n > linear_entries) {
+      size_t half = n / 2;
+      first = before(first[half - 1]) ? first + half : first;
+      n -= half;
+    }
+
+    size_t count = 0;
+    size_t i = 0;
+#ifdef __AVX2__
+    // AVX2 only compares signed 64-bit integers, so the heads get their sign bit flipped
+    constexpr uint64_t sign_bit = 1ULL << 63;
+    constexpr uint64_t head_mask = KeySize >= sizeof(uint64_t) ? ~0ULL : ~0ULL << (8 * (sizeof(uint64_t) - KeySize));
+    const __m256i offsets = _mm256_setr_epi64x(0, sizeof(Entry), 2 * sizeof(Entry), 3 * sizeof(Entry));
+    const __m256i byte_swap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,  // NOLINT
+                                               7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    const __m256i mask = _mm256_set1_epi64x(static_cast<int64_t>(head_mask));
+    const __m256i sign = _mm256_set1_epi64x(static_cast<int64_t>(sign_bit));
+    const __m256i target = _mm256_set1_epi64x(static_cast<int64_t>(key_head ^ sign_bit));
+    for (; i + 4 <= n; i += 4) {
+      __m256i heads = _mm256_i64gather_epi64(reinterpret_cast<const long long *>(first[i].first.data_),  // NOLINT
+                                             offsets, 1);
+      heads = _mm256_xor_si256(_mm256_and_si256(_mm256_shuffle_epi8(heads, byte_swap), mask), sign);
+      int less = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(target, heads)));
+      int equal = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(target, heads)));
+      if (KeySize > sizeof(uint64_t) && equal != 0) {
+        for (size_t j = i; j < i + 4; j++) {
+          count += before(first[j]) ? 1 : 0;
+        }
+      } else {
+        count += __builtin_popcount(upper ? less | equal : less);
+      }
+    }
+#endif
+    for (; i < n; i++) {
+      count += before(first[i]) ? 1 : 0;
+    }
+    return first + count;
+  }
+};
+
+/**
+ * Binary search the sorted entries [first, last) for the first one whose key
+ * is not less than key, or with upper set, greater than key.
+ */
+template <typename Entry, typename KeyType, typename KeyComparator>
+const Entry *SearchKeys(const Entry *first, const Entry *last, const KeyType &key, const KeyComparator &comparator,
+                        bool upper) {
+  return KeySearch<KeyComparator>::Search(first, last, key, comparator, upper);
+}
+
+}  // namespace bustub
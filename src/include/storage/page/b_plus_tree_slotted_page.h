@@ -0,0 +1,151 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_slotted_page.h
+//
+// Identification: src/include/storage/page/b_plus_tree_slotted_page.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+#pragma once
+
+#include <string>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/rid.h"
+#include "storage/page/b_plus_tree_page.h"
+
+namespace bustub {
+
+/**
+ * A page of VarlenBPlusTree, which stores keys of any length.
+ *
+ * Slotted page format (keys are stored in order):
+ *  ----------------------------------------------------------------------------
+ * | HEADER | SLOT(0) | SLOT(1) | ... | SLOT(n-1) | FREE SPACE | ... RECORDS |
+ *  ----------------------------------------------------------------------------
+ *
+ *  Header format (size in byte, 32 bytes in total):
+ *  ---------------------------------------------------------------------
+ * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
+ *  ---------------------------------------------------------------------
+ *  -----------------------------------------------------------------------------------
+ * | ParentPageId (4) | PageId (4) | NextPageId (4) | FreeSpacePointer (2) | Level (2) |
+ *  -----------------------------------------------------------------------------------
+ *
+ * The slot array grows from the header and the records grow down from the end
+ * of the page, starting at the free space pointer. A slot is the offset (2) of
+ * its record and the size (2) of its key. A record is the value, a RID in a
+ * leaf page and a child page id in an internal page, followed by the key. A key
+ * longer than MAX_INLINE_KEY_SIZE keeps that many bytes in the record and the
+ * rest in a chain of overflow pages, whose first page id ends the record; the
+ * top bit of the key size marks such a key. Removed records leave holes that
+ * are compacted away when an insert runs out of free space.
+ *
+ * Keys compare byte by byte, a prefix before the longer key. In an internal
+ * page the key of slot 0 is empty and child i holds the keys from key i up to
+ * key i + 1. Leaves are linked through NextPageId, the level is 0 for a leaf
+ * and one more than the level of its children for an internal page. The size
+ * of a page is its number of slots; max size and parent page id are unused.
+ *
+ * Overflow page format:
+ *  ------------------------------------------------
+ * | NextPageId (4) | Size (4) | KEY BYTES (Size) |
+ *  ------------------------------------------------
+ */
+class BPlusTreeSlottedPage : public BPlusTreePage {
+ public:
+  static constexpr size_t HEADER_SIZE = 32;
+  static constexpr size_t SLOT_SIZE = 4;
+  /** The longest key kept whole in a page, so that a page always holds at least eight records. */
+  static constexpr size_t MAX_INLINE_KEY_SIZE = (PAGE_SIZE - HEADER_SIZE) / 8 - SLOT_SIZE - sizeof(RID) -
+                                                sizeof(page_id_t);
+
+  static_assert(PAGE_SIZE <= 0x8000, "slot offsets and key sizes are 15 bits");
+
+  // After creating a new page from buffer pool, must call initialize method to set default values
+  void Init(page_id_t page_id, uint16_t level);
+
+  page_id_t GetNextPageId() const { return next_page_id_; }
+  void SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+  uint16_t GetLevel() const { return level_; }
+
+  /** @return the whole key of a slot, read from its overflow pages if it has any */
+  std::string KeyAt(int index, BufferPoolManager *bpm) const;
+  RID RidAt(int index) const;
+  page_id_t ChildAt(int index) const;
+
+  /** @return less than, equal to or greater than zero as key is less than, equal to or greater than key index */
+  int Compare(const std::string &key, int index, BufferPoolManager *bpm) const;
+
+  /** @return the first slot of a leaf whose key is not less than key, or the size if there is none */
+  int LowerBound(const std::string &key, BufferPoolManager *bpm) const;
+
+  /** @return the slot of an internal page whose child holds key, or holds the keys before it if before is set */
+  int ChildIndex(const std::string &key, bool before, BufferPoolManager *bpm) const;
+
+  /** @return true if a slot with a key of this size can be inserted, after compacting the page if needed */
+  bool HasRoomFor(size_t key_size) const;
+
+  /** Insert a slot before index, the page must have room for it. Overflow pages are allocated for a long key. */
+  void InsertLeaf(int index, const std::string &key, const RID &rid, BufferPoolManager *bpm);
+  void InsertChild(int index, const std::string &key, page_id_t child, BufferPoolManager *bpm);
+
+  /** Remove a slot and free the overflow pages of its key. */
+  void Remove(int index, BufferPoolManager *bpm);
+
+  /** Empty the key of a slot, which becomes slot 0 of an internal page. */
+  void ClearKey(int index, BufferPoolManager *bpm);
+
+  /** @return the slot at which a split leaves about half of the record bytes on either side */
+  int SplitIndex() const;
+
+  /** Move the slots from index on to the end of an empty recipient, along with their overflow pages. */
+  void MoveTailTo(int index, BPlusTreeSlottedPage *recipient);
+
+ private:
+  static constexpr uint16_t OVERFLOW_FLAG = 0x8000;
+
+  struct Slot {
+    uint16_t offset_;
+    uint16_t key_size_;
+  };
+
+  // the header of an overflow page, followed by the key bytes
+  struct OverflowHeader {
+    page_id_t next_page_id_;
+    uint32_t size_;
+  };
+
+  static constexpr size_t OVERFLOW_DATA_SIZE = PAGE_SIZE - sizeof(OverflowHeader);
+
+  Slot *Slots() { return reinterpret_cast<Slot *>(reinterpret_cast<char *>(this) + HEADER_SIZE); }
+  const Slot *Slots() const {
+    return reinterpret_cast<const Slot *>(reinterpret_cast<const char *>(this) + HEADER_SIZE);
+  }
+  char *RecordAt(int index) { return reinterpret_cast<char *>(this) + Slots()[index].offset_; }
+  const char *RecordAt(int index) const { return reinterpret_cast<const char *>(this) + Slots()[index].offset_; }
+
+  size_t ValueSize() const { return IsLeafPage() ? sizeof(RID) : sizeof(page_id_t); }
+  size_t InlineKeySize(int index) const { return Slots()[index].key_size_ & ~OVERFLOW_FLAG; }
+  bool HasOverflow(int index) const { return (Slots()[index].key_size_ & OVERFLOW_FLAG) != 0; }
+  page_id_t OverflowPageId(int index) const;
+  size_t RecordSize(int index) const;
+  size_t NewRecordSize(size_t key_size) const;
+
+  void Insert(int index, const std::string &key, const char *value, BufferPoolManager *bpm);
+  void InsertRecord(int index, const char *record, size_t size, uint16_t key_size);
+  void Compact();
+
+  static page_id_t WriteOverflow(const char *data, size_t size, BufferPoolManager *bpm);
+  static void ReadOverflow(page_id_t page_id, std::string *key, BufferPoolManager *bpm);
+  static void DeleteOverflow(page_id_t page_id, BufferPoolManager *bpm);
+
+  page_id_t next_page_id_;
+  uint16_t free_space_pointer_;
+  uint16_t level_;
+};
+
+}  // namespace bustub
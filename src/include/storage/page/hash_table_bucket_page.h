@@ -12,26 +12,56 @@
 
 #pragma once
 
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "common/config.h"
+#include "container/hash/hash_function.h"
 #include "storage/index/int_comparator.h"
 #include "storage/page/hash_table_page_defs.h"
 
 namespace bustub {
 /**
- * Store indexed key and and value together within bucket page. Supports
- * non-unique keys.
+ * Byte layout of one bucket slot. It is logged with every bucket change so that recovery can replay the change
+ * without knowing the key and value types.
+ */
+struct HashBucketSlot {
+  uint32_t slot_idx_;
+  uint16_t occupied_offset_;
+  uint16_t readable_offset_;
+  uint16_t fingerprint_offset_;
+  uint16_t key_offset_;
+  uint16_t value_offset_;
+  uint16_t key_size_;
+  uint16_t value_size_;
+  // a logged entry is the fingerprint byte, the key and the value
+  uint16_t entry_size_;
+  // the number of slots of the page
+  uint16_t num_slots_;
+};
+
+/**
+ * Store indexed key and and value within bucket page. Supports non-unique
+ * keys.
  *
- * Bucket page format (keys are stored in order):
- *  ----------------------------------------------------------------
- * | KEY(1) + VALUE(1) | KEY(2) + VALUE(2) | ... | KEY(n) + VALUE(n)
- *  ----------------------------------------------------------------
+ * Bucket page format:
+ *  ---------------------------------------------------------------------------------------------------
+ * | PageId(4) | LSN(4) | HasOverflow(4) | OverflowPageId(4) | OCCUPIED | READABLE | FP(1) ... FP(n) |
+ *  ---------------------------------------------------------------------------------------------------
+ * | KEY(1) ... KEY(n) | VALUE(1) ... VALUE(n)
+ *  ---------------------------------------------------------------------------------------------------
  *
- *  Here '+' means concatenation.
- *  The above format omits the space required for the occupied_ and
- *  readable_ arrays. More information is in storage/page/hash_table_page_defs.h.
+ *  Every slot has a one byte fingerprint, taken from the hash of its key, in
+ *  an array of its own. A lookup compares the fingerprints of GROUP_SIZE slots
+ *  at once (with SSE2 where available) and only compares the keys of readable
+ *  slots whose fingerprint matches, which the separate key array keeps close
+ *  together. The flags and fingerprints are padded to whole groups. More
+ *  information is in storage/page/hash_table_page_defs.h.
+ *
+ *  The entries of one hash can not be split apart. Once they take up half
+ *  of a bucket, they move to a chain of overflow pages of the same format.
+ *  A zeroed page has no overflow page.
  *
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
@@ -47,22 +77,33 @@ class HashTableBucketPage {
    */
   bool GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result);
 
+  /**
+   * Copy the readable entries whose fingerprint matches the key, without comparing any key. A reader that holds no
+   * latch compares the copies only once it made sure no writer changed them, a comparator may follow the offsets in
+   * a torn key out of the page.
+   *
+   * @param[out] candidates the entries are appended to it
+   */
+  void GetCandidates(const KeyType &key, std::vector<MappingType> *candidates) const;
+
   /**
    * Attempts to insert a key and value in the bucket.  Uses the occupied_
    * and readable_ arrays to keep track of each slot's availability.
    *
    * @param key key to insert
    * @param value value to insert
+   * @param[out] bucket_idx if not null, the index the pair was inserted at
    * @return true if inserted, false if duplicate KV pair or bucket is full
    */
-  bool Insert(KeyType key, ValueType value, KeyComparator cmp);
+  bool Insert(KeyType key, ValueType value, KeyComparator cmp, uint32_t *bucket_idx = nullptr);
 
   /**
    * Removes a key and value.
    *
+   * @param[out] bucket_idx if not null, the index the pair was removed from
    * @return true if removed, false if not found
    */
-  bool Remove(KeyType key, ValueType value, KeyComparator cmp);
+  bool Remove(KeyType key, ValueType value, KeyComparator cmp, uint32_t *bucket_idx = nullptr);
 
   /**
    * Gets the key at an index in the bucket.
@@ -147,24 +188,83 @@ class HashTableBucketPage {
 
   void SetUnreadable(uint32_t bucket_idx);
 
+  page_id_t GetPageId() const { return page_id_; }
+  void SetPageId(page_id_t page_id) { page_id_ = page_id; }
+  lsn_t GetLSN() const { return lsn_; }
+  void SetLSN(lsn_t lsn) { lsn_ = lsn; }
+
+  bool HasOverflow() const { return has_overflow_ != 0; }
+  /** @return the next page of the overflow chain, INVALID_PAGE_ID if there is none */
+  page_id_t GetOverflowPageId() const { return HasOverflow() ? overflow_page_id_ : INVALID_PAGE_ID; }
+  void SetOverflowPageId(page_id_t overflow_page_id) {
+    has_overflow_ = overflow_page_id != INVALID_PAGE_ID ? 1 : 0;
+    overflow_page_id_ = overflow_page_id;
+  }
+
+  /**
+   * @return where the entry at bucket_idx and its flags live in the page, for logging
+   */
+  HashBucketSlot GetSlot(uint32_t bucket_idx) const;
+
+  /**
+   * @return the raw bytes of the entry at bucket_idx, its fingerprint, key and value, for logging
+   */
+  std::string EntryAt(uint32_t bucket_idx) const;
+
   std::vector<MappingType> GetAllItem() {
     uint32_t bucket_size = BUCKET_ARRAY_SIZE;
     std::vector<MappingType> items;
     items.reserve(bucket_size);
     for (uint32_t i = 0; i < bucket_size; i++) {
       if (IsReadable(i)) {
-        items.emplace_back(array_[i]);
+        items.emplace_back(keys_[i], values_[i]);
       }
     }
     return items;
   }
 
+  /**
+   * @return the fingerprint of a key, the top byte of its 64-bit hash; the extendible hash table uses the low bits
+   */
+  static uint8_t Fingerprint(const KeyType &key) {
+    return static_cast<uint8_t>(HashFunction<KeyType>().GetHash(key) >> 56);
+  }
+
+  /** Hint the processor to load the flags and fingerprints, which every probe reads before any key. */
+  void Prefetch() const {
+    auto begin = reinterpret_cast<const char *>(this);
+    auto end = reinterpret_cast<const char *>(keys_);
+    for (const char *line = begin; line < end; line += 64) {
+      __builtin_prefetch(line);
+    }
+  }
+
+  /** The number of slots whose fingerprints are compared at once. */
+  static constexpr uint32_t GROUP_SIZE = 16;
+
  private:
+  static constexpr uint32_t NUM_GROUPS = (BUCKET_ARRAY_SIZE - 1) / GROUP_SIZE + 1;
+
+  /** @return the flags of the slots of a group, one bit per slot */
+  static uint32_t GroupBits(const char *flags, uint32_t group) {
+    auto bytes = reinterpret_cast<const uint8_t *>(flags) + 2 * group;
+    return bytes[0] | static_cast<uint32_t>(bytes[1]) << 8;
+  }
+
+  /** @return the readable slots of a group whose fingerprint is fingerprint, one bit per slot */
+  uint32_t MatchGroup(uint32_t group, uint8_t fingerprint) const;
+
+  page_id_t page_id_;
+  lsn_t lsn_;
+  uint32_t has_overflow_;
+  page_id_t overflow_page_id_;
   //  For more on BUCKET_ARRAY_SIZE see storage/page/hash_table_page_defs.h
-  char occupied_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
+  char occupied_[NUM_GROUPS * GROUP_SIZE / 8];
   // 0 if tombstone/brand new (never occupied), 1 otherwise.
-  char readable_[(BUCKET_ARRAY_SIZE - 1) / 8 + 1];
-  MappingType array_[0];
+  char readable_[NUM_GROUPS * GROUP_SIZE / 8];
+  uint8_t fingerprints_[NUM_GROUPS * GROUP_SIZE];
+  KeyType keys_[BUCKET_ARRAY_SIZE];
+  ValueType values_[BUCKET_ARRAY_SIZE];
 };
 
 }  // namespace bustub
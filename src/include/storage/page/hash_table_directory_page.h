@@ -27,9 +27,13 @@ namespace bustub {
  * Directory Page for extendible hash table.
  *
  * Directory format (size in byte):
- * --------------------------------------------------------------------------------------------
- * | LSN (4) | PageId(4) | GlobalDepth(4) | LocalDepths(512) | BucketPageIds(2048) | Free(1524)
- * --------------------------------------------------------------------------------------------
+ * ---------------------------------------------------------------------------------------------------------
+ * | PageId(4) | LSN (4) | GlobalDepth(4) | HashShift(4) | LocalDepths(512) | BucketPageIds(2048) | Free(1520)
+ * ---------------------------------------------------------------------------------------------------------
+ *
+ * A directory indexes the hash bits from HashShift up, the lower ones pick the
+ * directory page in the header page of the table (see ExtendibleHashTable),
+ * which has the same format and whose entries are directory pages.
  */
 class HashTableDirectoryPage {
  public:
@@ -114,7 +118,19 @@ class HashTableDirectoryPage {
   uint32_t GetGlobalDepth();
 
   /**
-   * Increment the global depth of the directory
+   * @return the number of low hash bits resolved before this directory, whose index starts at the next bit
+   */
+  uint32_t GetHashShift();
+
+  /**
+   * Sets the number of low hash bits resolved before this directory
+   *
+   * @param hash_shift the number of bits
+   */
+  void SetHashShift(uint32_t hash_shift);
+
+  /**
+   * Increment the global depth of the directory, which must not be full
    */
   void IncrGlobalDepth();
 
@@ -128,6 +144,21 @@ class HashTableDirectoryPage {
    */
   bool CanShrink();
 
+  /**
+   * @return true if the directory is at DIRECTORY_MAX_DEPTH and cannot double
+   */
+  bool IsFull();
+
+  /**
+   * Split a full directory on its lowest index bit: the entries where it is 0
+   * stay here, the others move to image, and both index the hash bits above it.
+   * Every bucket falls on one side, since the ones of local depth 0 cannot share
+   * a directory with a bucket that has to split.
+   *
+   * @param image an empty directory page
+   */
+  void SplitTo(HashTableDirectoryPage *image);
+
   /**
    * @return the current directory size
    */
@@ -190,6 +221,7 @@ class HashTableDirectoryPage {
   page_id_t page_id_;
   lsn_t lsn_;
   uint32_t global_depth_{0};
+  uint32_t hash_shift_{0};
   uint8_t local_depths_[DIRECTORY_ARRAY_SIZE];
   page_id_t bucket_page_ids_[DIRECTORY_ARRAY_SIZE];
 };
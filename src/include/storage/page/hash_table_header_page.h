@@ -89,12 +89,21 @@ class HashTableHeaderPage {
    */
   size_t NumBlocks();
 
+  /**
+   * @return the number of block page ids that fit in a header page
+   */
+  static constexpr size_t MaxBlocks();
+
  private:
-  __attribute__((unused)) lsn_t lsn_;
-  __attribute__((unused)) size_t size_;
-  __attribute__((unused)) page_id_t page_id_;
-  __attribute__((unused)) size_t next_ind_;
-  __attribute__((unused)) page_id_t block_page_ids_[0];
+  lsn_t lsn_;
+  size_t size_;
+  page_id_t page_id_;
+  size_t next_ind_;
+  page_id_t block_page_ids_[0];
 };
 
+constexpr size_t HashTableHeaderPage::MaxBlocks() {
+  return (PAGE_SIZE - sizeof(HashTableHeaderPage)) / sizeof(page_id_t);
+}
+
 }  // namespace bustub
@@ -33,12 +33,15 @@
  */
 #define HASH_TABLE_BUCKET_TYPE HashTableBucketPage<KeyType, ValueType, KeyComparator>
 #define DIRECTORY_ARRAY_SIZE 512
+#define DIRECTORY_MAX_DEPTH 9
 
 /**
  * BUCKET_ARRAY_SIZE is the number of (key, value) pairs that can be stored in an extendible hashing bucket page.
- * It is an approximate calculation based on the size of MappingType (which is a std::pair of KeyType and ValueType).
- * For each key/value pair, we need two additional bits for occupied_ and readable_. 4 * (PAGE_SIZE - 4) / (4 * sizeof
- * (MappingType) + 1) = (PAGE_SIZE - 4)/(sizeof (MappingType) + 0.25) because 0.25 bytes = 2 bits is the space required
- * to maintain the occupied and readable flags for a key value pair.
+ * It is an approximate calculation based on the sizes of KeyType and ValueType, which the page keeps in separate
+ * arrays. For each key/value pair, we need a fingerprint byte and two additional bits for occupied_ and readable_.
+ * 4 * (PAGE_SIZE - 40) / (4 * (sizeof(KeyType) + sizeof(ValueType) + 1) + 1) = (PAGE_SIZE - 40) / (sizeof(KeyType) +
+ * sizeof(ValueType) + 1.25) because 0.25 bytes = 2 bits is the space required to maintain the occupied and readable
+ * flags for a key value pair. The page id, LSN and overflow link take 16 bytes, and 24 more are left for padding the
+ * fingerprints and flags to whole groups and aligning the arrays.
  */
-#define BUCKET_ARRAY_SIZE (4 * PAGE_SIZE / (4 * sizeof(MappingType) + 1))
+#define BUCKET_ARRAY_SIZE (4 * (PAGE_SIZE - 40) / (4 * (sizeof(KeyType) + sizeof(ValueType) + 1) + 1))
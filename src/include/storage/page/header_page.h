@@ -22,9 +22,11 @@ namespace bustub {
  * 32 bytes) and their corresponding root_id
  *
  * Format (size in byte):
- *  -----------------------------------------------------------------
- * | RecordCount (4) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
- *  -----------------------------------------------------------------
+ *  ---------------------------------------------------------------------------
+ * | RecordCount (4) | LSN (4) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
+ *  ---------------------------------------------------------------------------
+ * The LSN is where every other page keeps it, so that a logged change of a
+ * record is redone like the change of any other page.
  */
 class HeaderPage : public Page {
  public:
@@ -47,5 +49,7 @@ class HeaderPage : public Page {
   int FindRecord(const std::string &name);
 
   void SetRecordCount(int record_count);
+
+  static constexpr int RECORDS_OFFSET = OFFSET_LSN + sizeof(lsn_t);
 };
 }  // namespace bustub
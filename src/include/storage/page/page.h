@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
@@ -49,10 +50,16 @@ class Page {
   inline bool IsDirty() { return is_dirty_; }
 
   /** Acquire the page write latch. */
-  inline void WLatch() { rwlatch_.WLock(); }
+  inline void WLatch() {
+    rwlatch_.WLock();
+    version_.fetch_add(1, std::memory_order_acq_rel);
+  }
 
   /** Release the page write latch. */
-  inline void WUnlatch() { rwlatch_.WUnlock(); }
+  inline void WUnlatch() {
+    version_.fetch_add(1, std::memory_order_release);
+    rwlatch_.WUnlock();
+  }
 
   /** Acquire the page read latch. */
   inline void RLatch() { rwlatch_.RLock(); }
@@ -60,6 +67,18 @@ class Page {
   /** Release the page read latch. */
   inline void RUnlatch() { rwlatch_.RUnlock(); }
 
+  /**
+   * @return the page version, which is odd while the page is write-latched. Together with ValidateVersion() this
+   * lets a reader that holds a pin read the page without latching it.
+   */
+  inline uint64_t GetVersion() const { return version_.load(std::memory_order_acquire); }
+
+  /** @return true if the page has not been write-latched since GetVersion() returned version */
+  inline bool ValidateVersion(uint64_t version) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+  }
+
   /** @return the page LSN. */
   inline lsn_t GetLSN() { return *reinterpret_cast<lsn_t *>(GetData() + OFFSET_LSN); }
 
@@ -88,6 +107,8 @@ class Page {
   bool is_dirty_ = false;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
+  /** Page version, bumped when the write latch is acquired and when it is released. */
+  std::atomic<uint64_t> version_{0};
 };
 
 }  // namespace bustub
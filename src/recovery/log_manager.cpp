@@ -12,6 +12,8 @@
 
 #include "recovery/log_manager.h"
 
+#include "recovery/log_recovery.h"
+
 namespace bustub {
 /*
  * set enable_logging = true
@@ -21,13 +23,250 @@ namespace bustub {
  * a larger LSN than persistent LSN)
  *
  * This thread runs forever until system shutdown/StopFlushThread
+ * With several log streams there is one such thread per stream.
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  if (enable_logging) {
+    return;
+  }
+  enable_logging = true;
+  for (size_t i = 0; i < streams_.size(); i++) {
+    LogStream *stream = streams_[i].get();
+    stream->flush_thread_ = new std::thread([this, stream, i] {
+      std::unique_lock<std::mutex> latch(stream->latch_);
+      while (enable_logging) {
+        // sleep for log_timeout, or until an asynchronous commit is about to exceed its delay
+        auto timeout = std::chrono::steady_clock::now() + log_timeout;
+        while (!stream->need_flush_ && enable_logging) {
+          auto wake = std::min(timeout, stream->commit_deadline_);
+          if (std::chrono::steady_clock::now() >= wake) {
+            break;
+          }
+          stream->cv_.wait_until(latch, wake);
+        }
+        bool forced = stream->need_flush_ || std::chrono::steady_clock::now() >= stream->commit_deadline_;
+        FlushBuffer(i, &latch, forced);
+      }
+      // write out whatever was appended before shutdown
+      FlushBuffer(i, &latch, true);
+    });
+  }
+  // every stream must be on disk before any of them holds records that depend on another one
+  WriteWatermarks();
+}
 
 /*
  * Stop and join the flush thread, set enable_logging = false
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  if (streams_[0]->flush_thread_ == nullptr) {
+    return;
+  }
+  enable_logging = false;
+  for (auto &stream : streams_) {
+    // taking the latch makes sure the flush thread is either before its check or waiting
+    { std::scoped_lock latch(stream->latch_); }
+    stream->cv_.notify_one();
+  }
+  for (auto &stream : streams_) {
+    stream->flush_thread_->join();
+    delete stream->flush_thread_;
+    stream->flush_thread_ = nullptr;
+  }
+}
+
+/*
+ * Swap log_buffer_ with flush_buffer_ of the stream and write the filled buffer to disk. The latch is released during
+ * the disk write so that transactions can keep appending to the other buffer.
+ * With several streams the buffer is closed by a watermark. A forced flush writes a watermark even if the stream has
+ * nothing buffered, an idle stream would otherwise hold back the recovery of the other streams. A single stream only
+ * writes the watermarks asked for by WriteWatermarks() and WaitForFlush(). Once written, a watermark also makes the
+ * other streams durable as far as it tells they are complete.
+ */
+void LogManager::FlushBuffer(int stream_no, std::unique_lock<std::mutex> *latch, bool forced) {
+  LogStream *stream = streams_[stream_no].get();
+  stream->need_flush_ = false;
+  stream->commit_deadline_ = std::chrono::steady_clock::time_point::max();
+  // records are appended to a stream under its latch, so the stream holds every one of its records up to here
+  lsn_t flush_lsn = next_lsn_ - 1;
+  bool watermark = stream->need_watermark_ || (streams_.size() > 1 && (stream->offset_ > 0 ||
+                                                                       (forced && flush_lsn > stream->durable_lsn_)));
+  if (stream->offset_ == 0 && !watermark) {
+    if (streams_.size() == 1) {
+      stream->durable_lsn_ = flush_lsn;
+      UpdatePersistentLSN();
+    }
+    stream->flushed_cv_.notify_all();
+    return;
+  }
+  std::vector<lsn_t> complete_lsns;
+  if (watermark) {
+    LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::WATERMARK);
+    log_record.size_ = WatermarkSize();
+    log_record.lsn_ = flush_lsn;
+    memcpy(stream->log_buffer_ + stream->offset_, &log_record, LogRecord::HEADER_SIZE);
+    if (streams_.size() > 1) {
+      complete_lsns = stream->complete_lsns_;
+      memcpy(stream->log_buffer_ + stream->offset_ + LogRecord::HEADER_SIZE, complete_lsns.data(),
+             sizeof(lsn_t) * complete_lsns.size());
+    }
+    stream->offset_ += log_record.size_;
+  }
+  std::swap(stream->log_buffer_, stream->flush_buffer_);
+  int flush_size = stream->offset_;
+  stream->offset_ = 0;
+  stream->need_watermark_ = false;
+  stream->writing_ = true;
+  latch->unlock();
+  disk_manager_->WriteLog(stream->flush_buffer_, flush_size, stream_no);
+  latch->lock();
+  stream->writing_ = false;
+  stream->num_flushes_++;
+  stream->durable_lsn_ = flush_lsn;
+  for (size_t i = 0; i < complete_lsns.size(); i++) {
+    lsn_t durable_lsn = streams_[i]->durable_lsn_;
+    while (durable_lsn < complete_lsns[i] && !streams_[i]->durable_lsn_.compare_exchange_weak(durable_lsn,
+                                                                                             complete_lsns[i])) {
+    }
+  }
+  UpdatePersistentLSN();
+  stream->flushed_cv_.notify_all();
+}
+
+int LogManager::WatermarkSize() const {
+  return LogRecord::HEADER_SIZE + (streams_.size() > 1 ? static_cast<int>(sizeof(lsn_t) * streams_.size()) : 0);
+}
+
+void LogManager::UpdatePersistentLSN() {
+  lsn_t lsn = streams_[0]->durable_lsn_;
+  for (auto &stream : streams_) {
+    lsn = std::min<lsn_t>(lsn, stream->durable_lsn_);
+  }
+  lsn_t persistent_lsn = persistent_lsn_;
+  while (persistent_lsn < lsn && !persistent_lsn_.compare_exchange_weak(persistent_lsn, lsn)) {
+  }
+}
+
+/*
+ * Force a flush and block until all the log records appended before this call are on disk
+ */
+void LogManager::Flush() { WaitForFlush(next_lsn_ - 1); }
+
+/*
+ * Block until the log record with the given lsn is on disk, used by synchronous commits.
+ * The record may depend on records with smaller LSNs in any stream, so every stream has to get that far. Another
+ * stream than the one of the calling thread is only flushed if it buffers records up to lsn. If it doesn't, every one
+ * of its records up to lsn is on disk already, and the next watermark of the calling thread's stream says so instead
+ * of a watermark of its own: all records appended to a stream after its latch is released get a larger LSN.
+ */
+void LogManager::WaitForFlush(lsn_t lsn) {
+  LogStream *own_stream = GetStream();
+  std::vector<lsn_t> complete_lsns(streams_.size(), INVALID_LSN);
+  bool other_streams_complete = false;
+  for (size_t i = 0; i < streams_.size(); i++) {
+    LogStream *stream = streams_[i].get();
+    if (stream == own_stream) {
+      continue;
+    }
+    std::unique_lock<std::mutex> latch(stream->latch_);
+    // a buffer being written may hold records up to lsn
+    while (stream->writing_ && stream->durable_lsn_ < lsn && enable_logging) {
+      stream->flushed_cv_.wait(latch);
+    }
+    if (!enable_logging) {
+      return;
+    }
+    if (stream->durable_lsn_ >= lsn) {
+      continue;
+    }
+    lsn_t complete_lsn = stream->offset_ == 0 ? next_lsn_ - 1 : stream->first_lsn_ - 1;
+    if (complete_lsn >= lsn) {
+      complete_lsns[i] = complete_lsn;
+      other_streams_complete = true;
+      continue;
+    }
+    while (stream->durable_lsn_ < lsn && enable_logging) {
+      stream->need_flush_ = true;
+      stream->cv_.notify_one();
+      stream->flushed_cv_.wait(latch);
+    }
+  }
+
+  std::unique_lock<std::mutex> latch(own_stream->latch_);
+  if (!enable_logging) {
+    return;
+  }
+  // the watermark has to be in a buffer that isn't being written yet
+  uint64_t num_flushes = own_stream->num_flushes_;
+  if (other_streams_complete) {
+    for (size_t i = 0; i < streams_.size(); i++) {
+      own_stream->complete_lsns_[i] = std::max(own_stream->complete_lsns_[i], complete_lsns[i]);
+    }
+    own_stream->need_watermark_ = true;
+    num_flushes += own_stream->writing_ ? 2 : 1;
+  }
+  while ((own_stream->durable_lsn_ < lsn || own_stream->num_flushes_ < num_flushes) && enable_logging) {
+    own_stream->need_flush_ = true;
+    own_stream->cv_.notify_one();
+    own_stream->flushed_cv_.wait(latch);
+  }
+}
+
+/*
+ * Bound the time the records appended so far stay in the log buffer, used by asynchronous commits.
+ * Only the first commit after a flush moves the deadline; later ones are covered by it.
+ */
+void LogManager::ScheduleFlush() {
+  auto delay = std::min<std::chrono::milliseconds>(commit_delay_.load(),
+                                                   std::chrono::duration_cast<std::chrono::milliseconds>(log_timeout));
+  for (auto &stream : streams_) {
+    std::scoped_lock latch(stream->latch_);
+    if (!enable_logging) {
+      return;
+    }
+    if (stream->commit_deadline_ != std::chrono::steady_clock::time_point::max()) {
+      continue;
+    }
+    stream->commit_deadline_ = std::chrono::steady_clock::now() + delay;
+    stream->cv_.notify_one();
+  }
+}
+
+void LogManager::WriteWatermarks() {
+  for (auto &stream : streams_) {
+    std::scoped_lock latch(stream->latch_);
+    stream->need_watermark_ = true;
+    stream->need_flush_ = true;
+    stream->cv_.notify_one();
+  }
+  for (auto &stream : streams_) {
+    std::unique_lock<std::mutex> latch(stream->latch_);
+    while ((stream->need_watermark_ || stream->writing_) && enable_logging) {
+      stream->flushed_cv_.wait(latch);
+    }
+  }
+}
+
+void LogManager::RestoreLSN() {
+  // the log was recycled up to a checkpoint at most, which left a watermark with the last LSN behind
+  LogRecovery log_recovery(disk_manager_, nullptr);
+  lsn_t last_lsn = log_recovery.FindLastLSN();
+  if (last_lsn == INVALID_LSN) {
+    return;
+  }
+  next_lsn_ = last_lsn + 1;
+  persistent_lsn_ = last_lsn;
+  for (auto &stream : streams_) {
+    stream->durable_lsn_ = last_lsn;
+  }
+}
+
+LogManager::LogStream *LogManager::GetStream() {
+  // threads are spread over the streams round robin, in the order they first append
+  static std::atomic<size_t> next_thread_no{0};
+  thread_local size_t thread_no = next_thread_no++;
+  return streams_[thread_no % streams_.size()].get();
+}
 
 /*
  * append a log record into log buffer
@@ -49,6 +288,85 @@ void LogManager::StopFlushThread() {}
  *  }
  *
  */
-lsn_t LogManager::AppendLogRecord(LogRecord *log_record) { return INVALID_LSN; }
+lsn_t LogManager::AppendLogRecord(LogRecord *log_record) {
+  LogStream *stream = GetStream();
+  std::unique_lock<std::mutex> latch(stream->latch_);
+  // a flush may end with a watermark, keep room for it
+  int capacity = LOG_BUFFER_SIZE - WatermarkSize();
+  // wait for the flush thread to swap buffers if the record does not fit
+  while (stream->offset_ + log_record->size_ > capacity) {
+    stream->need_flush_ = true;
+    stream->cv_.notify_one();
+    stream->flushed_cv_.wait(latch);
+  }
+
+  // First, serialize the must have fields(20 bytes in total)
+  char *log_buffer = stream->log_buffer_;
+  log_record->lsn_ = next_lsn_++;
+  if (stream->offset_ == 0) {
+    stream->first_lsn_ = log_record->lsn_;
+  }
+  memcpy(log_buffer + stream->offset_, log_record, LogRecord::HEADER_SIZE);
+  int pos = stream->offset_ + LogRecord::HEADER_SIZE;
+
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      memcpy(log_buffer + pos, &log_record->insert_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->insert_tuple_.SerializeTo(log_buffer + pos);
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(log_buffer + pos, &log_record->delete_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->delete_tuple_.SerializeTo(log_buffer + pos);
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(log_buffer + pos, &log_record->update_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->old_tuple_.SerializeTo(log_buffer + pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.SerializeTo(log_buffer + pos);
+      break;
+    case LogRecordType::NEWPAGE:
+      memcpy(log_buffer + pos, &log_record->prev_page_id_, sizeof(page_id_t));
+      pos += sizeof(page_id_t);
+      memcpy(log_buffer + pos, &log_record->page_id_, sizeof(page_id_t));
+      break;
+    case LogRecordType::HASH_BUCKET_INSERT:
+    case LogRecordType::HASH_BUCKET_REMOVE:
+      memcpy(log_buffer + pos, &log_record->page_id_, sizeof(page_id_t));
+      pos += sizeof(page_id_t);
+      memcpy(log_buffer + pos, &log_record->header_page_id_, sizeof(page_id_t));
+      pos += sizeof(page_id_t);
+      memcpy(log_buffer + pos, &log_record->key_hash_, sizeof(uint32_t));
+      pos += sizeof(uint32_t);
+      memcpy(log_buffer + pos, &log_record->bucket_slot_, sizeof(HashBucketSlot));
+      pos += sizeof(HashBucketSlot);
+      memcpy(log_buffer + pos, log_record->index_data_.data(), log_record->index_data_.size());
+      break;
+    case LogRecordType::HASH_BUCKET_SPLIT:
+      memcpy(log_buffer + pos, &log_record->page_id_, sizeof(page_id_t));
+      pos += sizeof(page_id_t);
+      memcpy(log_buffer + pos, &log_record->image_page_id_, sizeof(page_id_t));
+      pos += sizeof(page_id_t);
+      memcpy(log_buffer + pos, &log_record->bucket_slot_, sizeof(HashBucketSlot));
+      pos += sizeof(HashBucketSlot);
+      memcpy(log_buffer + pos, log_record->moved_slots_.data(), sizeof(uint32_t) * log_record->moved_slots_.size());
+      pos += sizeof(uint32_t) * log_record->moved_slots_.size();
+      memcpy(log_buffer + pos, log_record->index_data_.data(), log_record->index_data_.size());
+      break;
+    case LogRecordType::INDEX_PAGE_IMAGE:
+      memcpy(log_buffer + pos, &log_record->page_id_, sizeof(page_id_t));
+      pos += sizeof(page_id_t);
+      memcpy(log_buffer + pos, log_record->index_data_.data(), PAGE_SIZE);
+      break;
+    default:
+      break;
+  }
+  stream->offset_ += log_record->size_;
+  return log_record->lsn_;
+}
 
 }  // namespace bustub
@@ -12,6 +12,11 @@
 
 #include "recovery/log_recovery.h"
 
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include "storage/page/hash_table_directory_page.h"
 #include "storage/page/table_page.h"
 
 namespace bustub {
@@ -20,7 +25,224 @@ namespace bustub {
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
  */
-bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) { return false; }
+bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) {
+  return DeserializeLogRecord(data, LOG_BUFFER_SIZE - static_cast<int>(data - log_buffer_), log_record);
+}
+
+bool LogRecovery::DeserializeLogRecord(const char *data, int remaining, LogRecord *log_record) {
+  if (remaining < LogRecord::HEADER_SIZE) {
+    return false;
+  }
+  int32_t size = *reinterpret_cast<const int32_t *>(data);
+  auto type = *reinterpret_cast<const LogRecordType *>(data + 16);
+  // zeroed space (unused tail of a segment) or garbage
+  if (size < LogRecord::HEADER_SIZE || size > remaining || type <= LogRecordType::INVALID ||
+      type > LogRecordType::WATERMARK) {
+    return false;
+  }
+  log_record->size_ = size;
+  log_record->lsn_ = *reinterpret_cast<const lsn_t *>(data + 4);
+  log_record->txn_id_ = *reinterpret_cast<const txn_id_t *>(data + 8);
+  log_record->prev_lsn_ = *reinterpret_cast<const lsn_t *>(data + 12);
+  log_record->log_record_type_ = type;
+
+  const char *pos = data + LogRecord::HEADER_SIZE;
+  switch (type) {
+    case LogRecordType::INSERT:
+      log_record->insert_rid_ = *reinterpret_cast<const RID *>(pos);
+      log_record->insert_tuple_.DeserializeFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      log_record->delete_rid_ = *reinterpret_cast<const RID *>(pos);
+      log_record->delete_tuple_.DeserializeFrom(pos + sizeof(RID));
+      break;
+    case LogRecordType::UPDATE:
+      log_record->update_rid_ = *reinterpret_cast<const RID *>(pos);
+      pos += sizeof(RID);
+      log_record->old_tuple_.DeserializeFrom(pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.DeserializeFrom(pos);
+      break;
+    case LogRecordType::NEWPAGE:
+      log_record->prev_page_id_ = *reinterpret_cast<const page_id_t *>(pos);
+      log_record->page_id_ = *reinterpret_cast<const page_id_t *>(pos + sizeof(page_id_t));
+      break;
+    case LogRecordType::HASH_BUCKET_INSERT:
+    case LogRecordType::HASH_BUCKET_REMOVE: {
+      log_record->page_id_ = *reinterpret_cast<const page_id_t *>(pos);
+      pos += sizeof(page_id_t);
+      log_record->header_page_id_ = *reinterpret_cast<const page_id_t *>(pos);
+      pos += sizeof(page_id_t);
+      log_record->key_hash_ = *reinterpret_cast<const uint32_t *>(pos);
+      pos += sizeof(uint32_t);
+      memcpy(&log_record->bucket_slot_, pos, sizeof(HashBucketSlot));
+      pos += sizeof(HashBucketSlot);
+      log_record->index_data_.assign(pos, log_record->bucket_slot_.entry_size_);
+      break;
+    }
+    case LogRecordType::HASH_BUCKET_SPLIT: {
+      log_record->page_id_ = *reinterpret_cast<const page_id_t *>(pos);
+      pos += sizeof(page_id_t);
+      log_record->image_page_id_ = *reinterpret_cast<const page_id_t *>(pos);
+      pos += sizeof(page_id_t);
+      memcpy(&log_record->bucket_slot_, pos, sizeof(HashBucketSlot));
+      pos += sizeof(HashBucketSlot);
+      uint32_t count = log_record->bucket_slot_.slot_idx_;
+      log_record->moved_slots_.resize(count);
+      memcpy(log_record->moved_slots_.data(), pos, sizeof(uint32_t) * count);
+      pos += sizeof(uint32_t) * count;
+      log_record->index_data_.assign(pos, count * log_record->bucket_slot_.entry_size_);
+      break;
+    }
+    case LogRecordType::INDEX_PAGE_IMAGE:
+      log_record->page_id_ = *reinterpret_cast<const page_id_t *>(pos);
+      log_record->index_data_.assign(pos + sizeof(page_id_t), PAGE_SIZE);
+      break;
+    case LogRecordType::WATERMARK: {
+      const auto *complete_lsns = reinterpret_cast<const lsn_t *>(pos);
+      log_record->complete_lsns_.assign(complete_lsns,
+                                        complete_lsns + (size - LogRecord::HEADER_SIZE) / sizeof(lsn_t));
+      break;
+    }
+    default:
+      break;
+  }
+  return true;
+}
+
+namespace {
+
+inline bool GetBit(const char *page_data, uint16_t bitmap_offset, uint32_t slot_idx) {
+  return (page_data[bitmap_offset + slot_idx / 8] & (1 << (slot_idx % 8))) != 0;
+}
+
+inline void SetBit(char *page_data, uint16_t bitmap_offset, uint32_t slot_idx) {
+  page_data[bitmap_offset + slot_idx / 8] |= static_cast<char>(1 << (slot_idx % 8));
+}
+
+inline void UnsetBit(char *page_data, uint16_t bitmap_offset, uint32_t slot_idx) {
+  page_data[bitmap_offset + slot_idx / 8] &= static_cast<char>(~(1 << (slot_idx % 8)));
+}
+
+/** Put an entry, its fingerprint, key and value, into a bucket slot and mark the slot occupied and readable. */
+void PutBucketEntry(char *page_data, const HashBucketSlot &slot, uint32_t slot_idx, const char *entry) {
+  page_data[slot.fingerprint_offset_ + slot_idx] = entry[0];
+  memcpy(page_data + slot.key_offset_ + slot_idx * slot.key_size_, entry + 1, slot.key_size_);
+  memcpy(page_data + slot.value_offset_ + slot_idx * slot.value_size_, entry + 1 + slot.key_size_, slot.value_size_);
+  SetBit(page_data, slot.occupied_offset_, slot_idx);
+  SetBit(page_data, slot.readable_offset_, slot_idx);
+}
+
+/** @return whether a bucket slot holds the key and value of an entry */
+bool SameBucketEntry(const char *page_data, const HashBucketSlot &slot, uint32_t slot_idx, const char *entry) {
+  return memcmp(page_data + slot.key_offset_ + slot_idx * slot.key_size_, entry + 1, slot.key_size_) == 0 &&
+         memcmp(page_data + slot.value_offset_ + slot_idx * slot.value_size_, entry + 1 + slot.key_size_,
+                slot.value_size_) == 0;
+}
+
+// the bucket page header is | PageId(4) | LSN(4) | HasOverflow(4) | OverflowPageId(4) |, see hash_table_bucket_page.h
+constexpr size_t OFFSET_HAS_OVERFLOW = 8;
+constexpr size_t OFFSET_OVERFLOW_PAGE_ID = 12;
+
+page_id_t GetOverflowPageId(const char *page_data) {
+  if (*reinterpret_cast<const uint32_t *>(page_data + OFFSET_HAS_OVERFLOW) == 0) {
+    return INVALID_PAGE_ID;
+  }
+  return *reinterpret_cast<const page_id_t *>(page_data + OFFSET_OVERFLOW_PAGE_ID);
+}
+
+void SetOverflowPageId(char *page_data, page_id_t overflow_page_id) {
+  uint32_t has_overflow = overflow_page_id != INVALID_PAGE_ID ? 1 : 0;
+  memcpy(page_data + OFFSET_HAS_OVERFLOW, &has_overflow, sizeof(uint32_t));
+  memcpy(page_data + OFFSET_OVERFLOW_PAGE_ID, &overflow_page_id, sizeof(page_id_t));
+}
+
+/** @return the first readable slot holding the entry, slot.num_slots_ if there is none */
+uint32_t FindBucketEntry(const char *page_data, const HashBucketSlot &slot, const char *entry) {
+  for (uint32_t i = 0; i < slot.num_slots_; i++) {
+    if (GetBit(page_data, slot.readable_offset_, i) && SameBucketEntry(page_data, slot, i, entry)) {
+      return i;
+    }
+  }
+  return slot.num_slots_;
+}
+
+/** @return the first slot that is not readable, slot.num_slots_ if the page is full */
+uint32_t FindFreeBucketSlot(const char *page_data, const HashBucketSlot &slot) {
+  for (uint32_t i = 0; i < slot.num_slots_; i++) {
+    if (!GetBit(page_data, slot.readable_offset_, i)) {
+      return i;
+    }
+  }
+  return slot.num_slots_;
+}
+
+bool IsBucketEmpty(const char *page_data, const HashBucketSlot &slot) {
+  for (uint32_t i = 0; i < slot.num_slots_; i++) {
+    if (GetBit(page_data, slot.readable_offset_, i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool LogRecovery::NextLogRecord(LogCursor *cursor) {
+  const int segment_size = disk_manager_->GetLogSegmentSize();
+  while (true) {
+    if (cursor->pos_ >= 0 && DeserializeLogRecord(cursor->buffer_.data() + cursor->pos_,
+                                                  LOG_BUFFER_SIZE - cursor->pos_, &cursor->log_record_)) {
+      cursor->record_offset_ = cursor->offset_ + cursor->pos_;
+      cursor->pos_ += cursor->log_record_.size_;
+      return true;
+    }
+    if (cursor->pos_ == 0) {
+      // Nothing valid at offset_: the rest of this segment was never written (e.g. the server restarted or a
+      // checkpoint switched segments), so continue at the start of the next one.
+      cursor->pos_ = segment_size - static_cast<int>(cursor->offset_ % segment_size);
+    }
+    // the record at pos_ may be cut off by the end of the buffer, read again from there
+    cursor->offset_ += std::max(cursor->pos_, 0);
+    cursor->pos_ = 0;
+    if (!disk_manager_->ReadLog(cursor->buffer_.data(), LOG_BUFFER_SIZE, cursor->offset_, cursor->stream_)) {
+      return false;
+    }
+  }
+}
+
+lsn_t LogRecovery::FindRedoLimit(int num_streams) {
+  // a stream is complete up to its last watermark, or further if a watermark of another stream says so; one without
+  // either cannot tell which of its records are missing
+  std::vector<lsn_t> complete_lsns(num_streams, INVALID_LSN);
+  for (int stream = 0; stream < num_streams; stream++) {
+    LogCursor cursor(stream, disk_manager_->GetLogStartOffset(stream));
+    while (NextLogRecord(&cursor)) {
+      const LogRecord &log_record = cursor.log_record_;
+      if (log_record.log_record_type_ != LogRecordType::WATERMARK) {
+        continue;
+      }
+      complete_lsns[stream] = std::max(complete_lsns[stream], log_record.lsn_);
+      for (int i = 0; i < std::min(num_streams, static_cast<int>(log_record.complete_lsns_.size())); i++) {
+        complete_lsns[i] = std::max(complete_lsns[i], log_record.complete_lsns_[i]);
+      }
+    }
+  }
+  return *std::min_element(complete_lsns.begin(), complete_lsns.end());
+}
+
+lsn_t LogRecovery::FindLastLSN() {
+  lsn_t last_lsn = INVALID_LSN;
+  for (int stream = 0; stream < std::max(disk_manager_->GetNumLogStreams(), 1); stream++) {
+    LogCursor cursor(stream, disk_manager_->GetLogStartOffset(stream));
+    while (NextLogRecord(&cursor)) {
+      last_lsn = std::max(last_lsn, cursor.log_record_.lsn_);
+    }
+  }
+  return last_lsn;
+}
 
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
@@ -28,13 +250,390 @@ bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record)
  *log buffer to reduce unnecessary I/O operations), remember to compare page's
  *LSN with log_record's sequence number, and also build active_txn_ table &
  *lsn_mapping_ table
+ *
+ *With several log streams the streams are merged by LSN. A stream may have lost records that other streams already
+ *depend on, so only the records up to the point where every stream is complete are redone; the records after it are
+ *treated as never written.
  */
-void LogRecovery::Redo() {}
+void LogRecovery::Redo() {
+  active_txn_.clear();
+  lsn_mapping_.clear();
+  max_page_id_ = INVALID_PAGE_ID;
+  int num_streams = std::max(disk_manager_->GetNumLogStreams(), 1);
+  lsn_t redo_limit = num_streams > 1 ? FindRedoLimit(num_streams) : std::numeric_limits<lsn_t>::max();
+
+  // everything before the start offset was recycled by a checkpoint
+  std::vector<LogCursor> cursors;
+  for (int stream = 0; stream < num_streams; stream++) {
+    cursors.emplace_back(stream, disk_manager_->GetLogStartOffset(stream));
+  }
+  // k-way merge of the streams, smallest LSN first
+  using Head = std::pair<lsn_t, int>;
+  std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+  for (auto &cursor : cursors) {
+    if (NextLogRecord(&cursor)) {
+      heads.emplace(cursor.log_record_.lsn_, cursor.stream_);
+    }
+  }
+  while (!heads.empty()) {
+    LogCursor &cursor = cursors[heads.top().second];
+    heads.pop();
+    LogRecord &log_record = cursor.log_record_;
+    if (log_record.lsn_ > redo_limit) {
+      continue;
+    }
+    if (log_record.log_record_type_ != LogRecordType::WATERMARK) {
+      lsn_mapping_[log_record.lsn_] = {cursor.stream_, cursor.record_offset_};
+    }
+    if (log_record.log_record_type_ == LogRecordType::COMMIT || log_record.log_record_type_ == LogRecordType::ABORT) {
+      active_txn_.erase(log_record.txn_id_);
+    } else if (log_record.log_record_type_ != LogRecordType::WATERMARK) {
+      // structure modifications of indexes are logged outside of any transaction and never undone
+      if (log_record.txn_id_ != INVALID_TXN_ID) {
+        active_txn_[log_record.txn_id_] = log_record.lsn_;
+      }
+      RedoLogRecord(&log_record);
+    }
+    if (NextLogRecord(&cursor)) {
+      heads.emplace(cursor.log_record_.lsn_, cursor.stream_);
+    }
+  }
+}
 
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
  */
-void LogRecovery::Undo() {}
+void LogRecovery::Undo() {
+  hash_indexes_to_rebuild_.clear();
+  // undo the loser transactions together, newest record first
+  std::priority_queue<lsn_t> undo_lsns;
+  for (const auto &[txn_id, lsn] : active_txn_) {
+    undo_lsns.push(lsn);
+  }
+  while (!undo_lsns.empty()) {
+    lsn_t lsn = undo_lsns.top();
+    undo_lsns.pop();
+    auto iter = lsn_mapping_.find(lsn);
+    if (iter == lsn_mapping_.end()) {
+      continue;
+    }
+    auto [stream, offset] = iter->second;
+    LogRecord log_record;
+    if (!disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, offset, stream) ||
+        !DeserializeLogRecord(log_buffer_, &log_record)) {
+      continue;
+    }
+    UndoLogRecord(&log_record);
+    if (log_record.prev_lsn_ != INVALID_LSN) {
+      undo_lsns.push(log_record.prev_lsn_);
+    }
+  }
+  active_txn_.clear();
+  lsn_mapping_.clear();
+}
+
+void LogRecovery::RedoLogRecord(LogRecord *log_record) {
+  page_id_t page_id;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page_id = log_record->insert_rid_.GetPageId();
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      page_id = log_record->delete_rid_.GetPageId();
+      break;
+    case LogRecordType::UPDATE:
+      page_id = log_record->update_rid_.GetPageId();
+      break;
+    case LogRecordType::NEWPAGE:
+      page_id = log_record->page_id_;
+      break;
+    case LogRecordType::HASH_BUCKET_INSERT:
+    case LogRecordType::HASH_BUCKET_REMOVE:
+    case LogRecordType::HASH_BUCKET_SPLIT:
+    case LogRecordType::INDEX_PAGE_IMAGE:
+      RedoIndexLogRecord(log_record);
+      return;
+    default:
+      return;
+  }
+
+  max_page_id_ = std::max(max_page_id_, page_id);
+  auto *page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  if (page == nullptr) {
+    return;
+  }
+  if (page->GetLSN() >= log_record->lsn_) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    return;
+  }
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT: {
+      RID rid;
+      page->InsertTuple(log_record->insert_tuple_, &rid, nullptr, nullptr, nullptr);
+      break;
+    }
+    case LogRecordType::MARKDELETE:
+      page->MarkDelete(log_record->delete_rid_, nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE:
+      page->ApplyDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::ROLLBACKDELETE:
+      page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE: {
+      Tuple old_tuple;
+      page->UpdateTuple(log_record->new_tuple_, &old_tuple, log_record->update_rid_, nullptr, nullptr, nullptr);
+      break;
+    }
+    case LogRecordType::NEWPAGE: {
+      page->Init(page_id, PAGE_SIZE, log_record->prev_page_id_, nullptr, nullptr);
+      if (log_record->prev_page_id_ != INVALID_PAGE_ID) {
+        auto *prev_page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(log_record->prev_page_id_));
+        if (prev_page != nullptr) {
+          bool dirty = prev_page->GetNextPageId() != page_id;
+          prev_page->SetNextPageId(page_id);
+          buffer_pool_manager_->UnpinPage(log_record->prev_page_id_, dirty);
+        }
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  page->SetLSN(log_record->lsn_);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
+
+void LogRecovery::RedoIndexLogRecord(LogRecord *log_record) {
+  const HashBucketSlot &slot = log_record->bucket_slot_;
+  max_page_id_ = std::max({max_page_id_, log_record->page_id_, log_record->image_page_id_});
+  Page *page = buffer_pool_manager_->FetchPage(log_record->page_id_);
+  if (page == nullptr) {
+    return;
+  }
+  // index records are redone on a page that already has their LSN as well: they write what the record holds, so
+  // doing that twice is harmless, and a new page has LSN 0 just like a record logged first thing
+  bool dirty = page->GetLSN() <= log_record->lsn_;
+  if (dirty) {
+    char *data = page->GetData();
+    switch (log_record->log_record_type_) {
+      case LogRecordType::HASH_BUCKET_INSERT:
+        PutBucketEntry(data, slot, slot.slot_idx_, log_record->index_data_.data());
+        break;
+      case LogRecordType::HASH_BUCKET_REMOVE:
+        UnsetBit(data, slot.readable_offset_, slot.slot_idx_);
+        break;
+      case LogRecordType::HASH_BUCKET_SPLIT:
+        for (uint32_t moved_slot : log_record->moved_slots_) {
+          UnsetBit(data, slot.readable_offset_, moved_slot);
+        }
+        break;
+      case LogRecordType::INDEX_PAGE_IMAGE:
+        memcpy(data, log_record->index_data_.data(), PAGE_SIZE);
+        break;
+      default:
+        break;
+    }
+    page->SetLSN(log_record->lsn_);
+  }
+  buffer_pool_manager_->UnpinPage(log_record->page_id_, dirty);
+
+  if (log_record->log_record_type_ != LogRecordType::HASH_BUCKET_SPLIT) {
+    return;
+  }
+  // the split image starts out empty, so the record alone is enough to rebuild it
+  page = buffer_pool_manager_->FetchPage(log_record->image_page_id_);
+  if (page == nullptr) {
+    return;
+  }
+  dirty = page->GetLSN() <= log_record->lsn_;
+  if (dirty) {
+    char *data = page->GetData();
+    memset(data, 0, PAGE_SIZE);
+    memcpy(data, &log_record->image_page_id_, sizeof(page_id_t));
+    for (uint32_t i = 0; i < log_record->moved_slots_.size(); i++) {
+      PutBucketEntry(data, slot, i, log_record->index_data_.data() + i * slot.entry_size_);
+    }
+    page->SetLSN(log_record->lsn_);
+  }
+  buffer_pool_manager_->UnpinPage(log_record->image_page_id_, dirty);
+}
+
+page_id_t LogRecovery::FindBucketPage(page_id_t header_page_id, uint32_t hash) {
+  auto *header_page = reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->FetchPage(header_page_id));
+  if (header_page == nullptr) {
+    return INVALID_PAGE_ID;
+  }
+  page_id_t directory_page_id = header_page->GetBucketPageId(hash & header_page->GetGlobalDepthMask());
+  buffer_pool_manager_->UnpinPage(header_page_id, false);
+  auto *dir_page = reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->FetchPage(directory_page_id));
+  if (dir_page == nullptr) {
+    return INVALID_PAGE_ID;
+  }
+  page_id_t bucket_page_id =
+      dir_page->GetBucketPageId((hash >> dir_page->GetHashShift()) & dir_page->GetGlobalDepthMask());
+  buffer_pool_manager_->UnpinPage(directory_page_id, false);
+  return bucket_page_id;
+}
+
+void LogRecovery::UndoIndexLogRecord(LogRecord *log_record) {
+  const HashBucketSlot &slot = log_record->bucket_slot_;
+  const char *entry = log_record->index_data_.data();
+  bool undo_insert = log_record->log_record_type_ == LogRecordType::HASH_BUCKET_INSERT;
+  // redo brought the directory up to date, so it leads to wherever splits have taken the key
+  page_id_t bucket_page_id = FindBucketPage(log_record->header_page_id_, log_record->key_hash_);
+
+  // look for the entry in the bucket and its overflow chain, noting the free slots on the way
+  std::vector<std::pair<page_id_t, uint32_t>> free_slots;
+  // only the keys of the chain's hash go to overflow pages, the entry was one of them if it was removed from one
+  bool chain_key = false;
+  page_id_t prev_page_id = INVALID_PAGE_ID;
+  page_id_t page_id = bucket_page_id;
+  while (page_id != INVALID_PAGE_ID) {
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    if (page == nullptr) {
+      return;
+    }
+    char *data = page->GetData();
+    page_id_t next_page_id = GetOverflowPageId(data);
+    chain_key = chain_key || (page_id != bucket_page_id && page_id == log_record->page_id_);
+    uint32_t slot_idx = FindBucketEntry(data, slot, entry);
+    if (slot_idx < slot.num_slots_) {
+      // an entry removed by a loser may be back already, inserted again by someone else
+      bool unlink = false;
+      if (undo_insert) {
+        UnsetBit(data, slot.readable_offset_, slot_idx);
+        // overflow pages are never empty, an emptied one is unlinked like ChainRemove() does
+        unlink = page_id != bucket_page_id && IsBucketEmpty(data, slot);
+      }
+      buffer_pool_manager_->UnpinPage(page_id, undo_insert);
+      Page *prev_page = unlink ? buffer_pool_manager_->FetchPage(prev_page_id) : nullptr;
+      if (prev_page != nullptr) {
+        SetOverflowPageId(prev_page->GetData(), next_page_id);
+        buffer_pool_manager_->UnpinPage(prev_page_id, true);
+        buffer_pool_manager_->DeletePage(page_id);
+      }
+      return;
+    }
+    slot_idx = FindFreeBucketSlot(data, slot);
+    if (slot_idx < slot.num_slots_) {
+      free_slots.emplace_back(page_id, slot_idx);
+    }
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    prev_page_id = page_id;
+    page_id = next_page_id;
+  }
+  if (undo_insert) {
+    return;
+  }
+
+  // the bucket page takes any key, and it comes first
+  for (auto [free_page_id, free_slot] : free_slots) {
+    if (free_page_id != bucket_page_id && !chain_key) {
+      break;
+    }
+    Page *page = buffer_pool_manager_->FetchPage(free_page_id);
+    if (page == nullptr) {
+      return;
+    }
+    PutBucketEntry(page->GetData(), slot, free_slot, entry);
+    buffer_pool_manager_->UnpinPage(free_page_id, true);
+    return;
+  }
+  if (!chain_key) {
+    // making room takes a split, which needs the hash function of the table
+    LOG_WARN("no room to put back an entry removed from hash bucket page %d, rebuild the index with header page %d",
+             log_record->page_id_, log_record->header_page_id_);
+    hash_indexes_to_rebuild_.insert(log_record->header_page_id_);
+    return;
+  }
+  // the chain is full, a new overflow page goes right after the bucket like in InsertIntoOverflow()
+  page_id_t overflow_page_id;
+  Page *overflow_page = NewOverflowPage(&overflow_page_id);
+  Page *page = overflow_page != nullptr ? buffer_pool_manager_->FetchPage(bucket_page_id) : nullptr;
+  if (page == nullptr) {
+    if (overflow_page != nullptr) {
+      buffer_pool_manager_->UnpinPage(overflow_page_id, false);
+    }
+    hash_indexes_to_rebuild_.insert(log_record->header_page_id_);
+    return;
+  }
+  SetOverflowPageId(overflow_page->GetData(), GetOverflowPageId(page->GetData()));
+  PutBucketEntry(overflow_page->GetData(), slot, 0, entry);
+  SetOverflowPageId(page->GetData(), overflow_page_id);
+  buffer_pool_manager_->UnpinPage(overflow_page_id, true);
+  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+}
+
+Page *LogRecovery::NewOverflowPage(page_id_t *page_id) {
+  *page_id = std::max(max_page_id_ + 1, disk_manager_->GetNumPages());
+  Page *page = buffer_pool_manager_->FetchPage(*page_id);
+  if (page == nullptr) {
+    return nullptr;
+  }
+  max_page_id_ = *page_id;
+  memset(page->GetData(), 0, PAGE_SIZE);
+  memcpy(page->GetData(), page_id, sizeof(page_id_t));
+  return page;
+}
+
+void LogRecovery::UndoLogRecord(LogRecord *log_record) {
+  if (log_record->log_record_type_ == LogRecordType::HASH_BUCKET_INSERT ||
+      log_record->log_record_type_ == LogRecordType::HASH_BUCKET_REMOVE) {
+    UndoIndexLogRecord(log_record);
+    return;
+  }
+
+  page_id_t page_id;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page_id = log_record->insert_rid_.GetPageId();
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      page_id = log_record->delete_rid_.GetPageId();
+      break;
+    case LogRecordType::UPDATE:
+      page_id = log_record->update_rid_.GetPageId();
+      break;
+    default:
+      // BEGIN has nothing to revert, and a new page stays linked into the heap (empty after the undo)
+      return;
+  }
+
+  auto *page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  if (page == nullptr) {
+    return;
+  }
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page->ApplyDelete(log_record->insert_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::MARKDELETE:
+      page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE: {
+      RID rid;
+      page->InsertTuple(log_record->delete_tuple_, &rid, nullptr, nullptr, nullptr);
+      break;
+    }
+    case LogRecordType::ROLLBACKDELETE:
+      page->MarkDelete(log_record->delete_rid_, nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE: {
+      Tuple new_tuple;
+      page->UpdateTuple(log_record->old_tuple_, &new_tuple, log_record->update_rid_, nullptr, nullptr, nullptr);
+      break;
+    }
+    default:
+      break;
+  }
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
 
 }  // namespace bustub
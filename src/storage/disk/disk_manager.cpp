@@ -10,9 +10,13 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <filesystem>  // NOLINT
 #include <iostream>
 #include <mutex>  // NOLINT
 #include <string>
@@ -24,14 +28,17 @@
 
 namespace bustub {
 
-static char *buffer_used;
-
 /**
- * Constructor: open/create a single database file & log file
+ * Constructor: open/create a single database file & find the existing log segments
  * @input db_file: database file name
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
+DiskManager::DiskManager(const std::string &db_file, int log_segment_size)
+    : log_segment_size_(log_segment_size),
+      file_name_(db_file),
+      num_flushes_(0),
+      num_writes_(0),
+      flush_log_(false),
+      flush_log_f_(nullptr) {
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
@@ -39,18 +46,46 @@ DiskManager::DiskManager(const std::string &db_file)
   }
   log_name_ = file_name_.substr(0, n) + ".log";
 
-  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app | std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-    if (!log_io_.is_open()) {
-      throw Exception("can't open dblog file");
+  // Segment files are created lazily on the first log write. Pick up the segments of every stream (and the zeroed
+  // spares) left behind by a previous run. Stream 0 uses "<log>.<segment>", stream k "<log><k>.<segment>", spares
+  // "<log>.spare.<n>". A restarted stream always continues at the beginning of a fresh segment, so the unknown tail of
+  // its last segment is never appended to.
+  std::filesystem::path log_path(log_name_);
+  std::filesystem::path log_dir = log_path.has_parent_path() ? log_path.parent_path() : std::filesystem::path(".");
+  std::string log_prefix = log_path.filename().string();
+  std::string spare_prefix = log_prefix + ".spare.";
+  std::vector<int64_t> first_segments;
+  std::vector<int64_t> last_segments;
+  std::error_code ec;
+  for (const auto &entry : std::filesystem::directory_iterator(log_dir, ec)) {
+    std::string name = entry.path().filename().string();
+    if (name.compare(0, spare_prefix.size(), spare_prefix) == 0) {
+      spare_segments_.push_back(entry.path().string());
+      next_spare_no_ = std::max(next_spare_no_, std::atoi(name.c_str() + spare_prefix.size()) + 1);
+      continue;
+    }
+    if (name.compare(0, log_prefix.size(), log_prefix) != 0) {
+      continue;
+    }
+    std::string::size_type dot = name.find('.', log_prefix.size());
+    if (dot == std::string::npos || dot + 1 == name.size() ||
+        name.find_first_not_of("0123456789", log_prefix.size()) != dot ||
+        name.find_first_not_of("0123456789", dot + 1) != std::string::npos) {
+      continue;
     }
+    auto stream = static_cast<size_t>(dot == log_prefix.size() ? 0 : std::atoi(name.c_str() + log_prefix.size()));
+    int64_t segment_no = std::atoll(name.c_str() + dot + 1);
+    if (stream >= first_segments.size()) {
+      first_segments.resize(stream + 1, -1);
+      last_segments.resize(stream + 1, -1);
+    }
+    last_segments[stream] = std::max(last_segments[stream], segment_no);
+    first_segments[stream] = first_segments[stream] == -1 ? segment_no : std::min(first_segments[stream], segment_no);
+  }
+  for (size_t stream = 0; stream < first_segments.size(); stream++) {
+    LogStream *log_stream = GetLogStream(stream);
+    log_stream->first_segment_ = std::max<int64_t>(first_segments[stream], 0);
+    log_stream->tail_ = (last_segments[stream] + 1) * log_segment_size_;
   }
 
   std::scoped_lock scoped_db_io_latch(db_io_latch_);
@@ -67,7 +102,6 @@ DiskManager::DiskManager(const std::string &db_file)
       throw Exception("can't open db file");
     }
   }
-  buffer_used = nullptr;
 }
 
 /**
@@ -78,7 +112,14 @@ void DiskManager::ShutDown() {
     std::scoped_lock scoped_db_io_latch(db_io_latch_);
     db_io_.close();
   }
-  log_io_.close();
+  std::scoped_lock scoped_log_streams_latch(log_streams_latch_);
+  for (auto &log_stream : log_streams_) {
+    std::scoped_lock scoped_log_io_latch(log_stream->latch_);
+    log_stream->write_io_.close();
+    log_stream->read_io_.close();
+    log_stream->write_segment_ = -1;
+    log_stream->read_segment_ = -1;
+  }
 }
 
 /**
@@ -133,10 +174,12 @@ void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
  * Write the contents of the log into disk file
  * Only return when sync is done, and only perform sequence write
  */
-void DiskManager::WriteLog(char *log_data, int size) {
+void DiskManager::WriteLog(char *log_data, int size, int stream) {
+  LogStream *log_stream = GetLogStream(stream);
+  std::scoped_lock scoped_log_io_latch(log_stream->latch_);
   // enforce swap log buffer
-  assert(log_data != buffer_used);
-  buffer_used = log_data;
+  assert(log_data != log_stream->last_buffer_);
+  log_stream->last_buffer_ = log_data;
 
   if (size == 0) {  // no effect on num_flushes_ if log buffer is empty
     return;
@@ -150,16 +193,25 @@ void DiskManager::WriteLog(char *log_data, int size) {
   }
 
   num_flushes_ += 1;
-  // sequence write
-  log_io_.write(log_data, size);
+  // sequence write, the segment files are preallocated so the writes never extend a file
+  while (size > 0) {
+    OpenLogSegment(log_stream, log_stream->tail_ / log_segment_size_);
+    auto segment_offset = static_cast<int>(log_stream->tail_ % log_segment_size_);
+    int write_size = std::min(size, log_segment_size_ - segment_offset);
+    log_stream->write_io_.seekp(segment_offset);
+    log_stream->write_io_.write(log_data, write_size);
 
-  // check for I/O error
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while writing log");
-    return;
+    // check for I/O error
+    if (log_stream->write_io_.bad()) {
+      LOG_DEBUG("I/O error while writing log");
+      return;
+    }
+    // needs to flush to keep disk file in sync
+    log_stream->write_io_.flush();
+    log_data += write_size;
+    log_stream->tail_ += write_size;
+    size -= write_size;
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
   flush_log_ = false;
 }
 
@@ -168,29 +220,126 @@ void DiskManager::WriteLog(char *log_data, int size) {
  * Always read from the beginning and perform sequence read
  * @return: false means already reach the end
  */
-bool DiskManager::ReadLog(char *log_data, int size, int offset) {
-  if (offset >= GetFileSize(log_name_)) {
+bool DiskManager::ReadLog(char *log_data, int size, int64_t offset, int stream) {
+  LogStream *log_stream = GetLogStream(stream);
+  std::scoped_lock scoped_log_io_latch(log_stream->latch_);
+  if (offset < log_stream->first_segment_ * log_segment_size_ ||
+      !ReadLogSegment(log_stream, offset / log_segment_size_)) {
     // LOG_DEBUG("end of log file");
-    // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
+  while (size > 0) {
+    auto segment_offset = static_cast<int>(offset % log_segment_size_);
+    int read_size = std::min(size, log_segment_size_ - segment_offset);
+    // if the log ends before reading "size", the rest is zero-filled
+    if (!ReadLogSegment(log_stream, offset / log_segment_size_)) {
+      memset(log_data, 0, size);
+      break;
+    }
+    log_stream->read_io_.seekg(segment_offset);
+    log_stream->read_io_.read(log_data, read_size);
 
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while reading log");
-    return false;
-  }
-  // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
-  if (read_count < size) {
-    log_io_.clear();
-    memset(log_data + read_count, 0, size - read_count);
+    if (log_stream->read_io_.bad()) {
+      LOG_DEBUG("I/O error while reading log");
+      return false;
+    }
+    int read_count = log_stream->read_io_.gcount();
+    if (read_count < read_size) {
+      log_stream->read_io_.clear();
+      memset(log_data + read_count, 0, read_size - read_count);
+    }
+    log_data += read_size;
+    offset += read_size;
+    size -= read_size;
   }
 
   return true;
 }
 
+/**
+ * Pad the rest of the current segment, the next write starts a new segment
+ */
+void DiskManager::SwitchLogSegment(int stream) {
+  LogStream *log_stream = GetLogStream(stream);
+  std::scoped_lock scoped_log_io_latch(log_stream->latch_);
+  if (log_stream->tail_ % log_segment_size_ != 0) {
+    log_stream->tail_ = (log_stream->tail_ / log_segment_size_ + 1) * log_segment_size_;
+  }
+}
+
+/**
+ * Recycle the segments wholly below offset. Recycling renames and reuses the files instead of deleting and recreating
+ * them, so later log writes never have to allocate blocks or grow a file.
+ */
+void DiskManager::RecycleLogSegments(int64_t offset, int stream) {
+  LogStream *log_stream = GetLogStream(stream);
+  std::scoped_lock scoped_log_io_latch(log_stream->latch_);
+  int64_t end_segment = std::min(offset, log_stream->tail_) / log_segment_size_;
+  std::vector<char> zeros;
+  for (int64_t segment_no = log_stream->first_segment_; segment_no < end_segment; segment_no++) {
+    std::string segment_name = log_stream->name_ + "." + std::to_string(segment_no);
+    if (log_stream->write_segment_ == segment_no) {
+      log_stream->write_io_.close();
+      log_stream->write_segment_ = -1;
+    }
+    if (log_stream->read_segment_ == segment_no) {
+      log_stream->read_io_.close();
+      log_stream->read_segment_ = -1;
+    }
+    if (GetFileSize(segment_name) < 0) {
+      continue;
+    }
+    std::scoped_lock scoped_spare_latch(spare_latch_);
+    if (static_cast<int>(spare_segments_.size()) >= LOG_SPARE_SEGMENTS) {
+      std::remove(segment_name.c_str());
+      continue;
+    }
+    // zero the old content so that a reused segment never exposes stale log records past the log tail
+    zeros.resize(log_segment_size_);
+    std::fstream segment_io(segment_name, std::ios::binary | std::ios::in | std::ios::out);
+    segment_io.write(zeros.data(), log_segment_size_);
+    segment_io.close();
+    std::string spare_name = SpareSegmentName(next_spare_no_++);
+    if (std::rename(segment_name.c_str(), spare_name.c_str()) != 0) {
+      LOG_DEBUG("I/O error while recycling log segment");
+      continue;
+    }
+    spare_segments_.push_back(spare_name);
+  }
+  log_stream->first_segment_ = std::max(log_stream->first_segment_, end_segment);
+}
+
+/**
+ * Returns the logical offset of the oldest retained log segment
+ */
+int64_t DiskManager::GetLogStartOffset(int stream) {
+  LogStream *log_stream = GetLogStream(stream);
+  std::scoped_lock scoped_log_io_latch(log_stream->latch_);
+  return log_stream->first_segment_ * log_segment_size_;
+}
+
+/**
+ * Returns the logical offset of the next log write
+ */
+int64_t DiskManager::GetLogTailOffset(int stream) {
+  LogStream *log_stream = GetLogStream(stream);
+  std::scoped_lock scoped_log_io_latch(log_stream->latch_);
+  return log_stream->tail_;
+}
+
+/**
+ * Returns the number of pages in the database file
+ */
+int DiskManager::GetNumPages() { return std::max(GetFileSize(file_name_), 0) / PAGE_SIZE; }
+
+/**
+ * Returns the number of log streams
+ */
+int DiskManager::GetNumLogStreams() {
+  std::scoped_lock scoped_log_streams_latch(log_streams_latch_);
+  return static_cast<int>(log_streams_.size());
+}
+
 /**
  * Returns number of flushes made so far
  */
@@ -206,6 +355,97 @@ int DiskManager::GetNumWrites() const { return num_writes_; }
  */
 bool DiskManager::GetFlushState() const { return flush_log_; }
 
+/**
+ * Private helper function to get a log stream, creating it (and the ones before it) on first use
+ */
+DiskManager::LogStream *DiskManager::GetLogStream(int stream) {
+  std::scoped_lock scoped_log_streams_latch(log_streams_latch_);
+  while (static_cast<int>(log_streams_.size()) <= stream) {
+    auto log_stream = std::make_unique<LogStream>();
+    log_stream->name_ = LogStreamName(log_streams_.size());
+    log_streams_.push_back(std::move(log_stream));
+  }
+  return log_streams_[stream].get();
+}
+
+/**
+ * Private helper functions to name the segment files
+ */
+std::string DiskManager::LogStreamName(int stream) const {
+  return stream == 0 ? log_name_ : log_name_ + std::to_string(stream);
+}
+
+std::string DiskManager::SpareSegmentName(int spare_no) const {
+  return log_name_ + ".spare." + std::to_string(spare_no);
+}
+
+/**
+ * Private helper function to make segment_no the current write segment of the stream. A missing segment is taken from
+ * the spares, or created and preallocated to its full size.
+ */
+void DiskManager::OpenLogSegment(LogStream *log_stream, int64_t segment_no) {
+  if (log_stream->write_segment_ == segment_no) {
+    return;
+  }
+  log_stream->write_io_.close();
+  std::string segment_name = log_stream->name_ + "." + std::to_string(segment_no);
+  if (GetFileSize(segment_name) < 0) {
+    std::unique_lock spare_latch(spare_latch_);
+    if (!spare_segments_.empty()) {
+      std::rename(spare_segments_.back().c_str(), segment_name.c_str());
+      spare_segments_.pop_back();
+    } else {
+      spare_latch.unlock();
+      CreateLogSegment(segment_name);
+    }
+  }
+  log_stream->write_io_.open(segment_name, std::ios::binary | std::ios::in | std::ios::out);
+  if (!log_stream->write_io_.is_open()) {
+    throw Exception("can't open dblog file");
+  }
+  log_stream->write_segment_ = segment_no;
+}
+
+/**
+ * Private helper function to open segment_no of the stream for reading
+ * @return: false if the segment does not exist
+ */
+bool DiskManager::ReadLogSegment(LogStream *log_stream, int64_t segment_no) {
+  if (log_stream->read_segment_ == segment_no) {
+    return true;
+  }
+  log_stream->read_io_.close();
+  log_stream->read_segment_ = -1;
+  std::string segment_name = log_stream->name_ + "." + std::to_string(segment_no);
+  if (GetFileSize(segment_name) < 0) {
+    return false;
+  }
+  // the write stream may still hold unflushed data of this segment
+  if (log_stream->write_segment_ == segment_no) {
+    log_stream->write_io_.flush();
+  }
+  log_stream->read_io_.open(segment_name, std::ios::binary | std::ios::in);
+  if (!log_stream->read_io_.is_open()) {
+    return false;
+  }
+  log_stream->read_segment_ = segment_no;
+  return true;
+}
+
+/**
+ * Private helper function to create a zero-filled segment file of the full segment size
+ */
+void DiskManager::CreateLogSegment(const std::string &segment_name) {
+  int fd = open(segment_name.c_str(), O_CREAT | O_WRONLY, 0644);
+  if (fd < 0) {
+    throw Exception("can't open dblog file");
+  }
+  if (posix_fallocate(fd, 0, log_segment_size_) != 0) {
+    LOG_DEBUG("I/O error while preallocating log segment");
+  }
+  close(fd);
+}
+
 /**
  * Private helper function to get disk file size
  */
@@ -0,0 +1,920 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// adaptive_radix_tree.cpp
+//
+// Identification: src/storage/index/adaptive_radix_tree.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string_view>
+#include <thread>  // NOLINT
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "storage/index/adaptive_radix_tree.h"
+
+namespace bustub {
+
+enum class ARTNodeType : uint8_t { NODE4, NODE16, NODE48, NODE256 };
+
+/*
+ * A leaf holds the whole key, so a lookup that reaches it compares the key
+ * once instead of checking the bytes the path skipped. The key bytes follow
+ * the leaf in the same allocation. Leaves never change.
+ */
+struct ARTLeaf {
+  static ARTLeaf *Make(const std::string &key, const RID &rid) {
+    auto *leaf = new (::operator new(sizeof(ARTLeaf) + key.size())) ARTLeaf(rid, key.size());
+    memcpy(reinterpret_cast<char *>(leaf + 1), key.data(), key.size());
+    return leaf;
+  }
+
+  static void Free(const ARTLeaf *leaf) { ::operator delete(const_cast<ARTLeaf *>(leaf)); }
+
+  std::string_view Key() const { return {reinterpret_cast<const char *>(this + 1), size_}; }
+
+  const RID rid_;
+  const uint32_t size_;
+
+ private:
+  ARTLeaf(const RID &rid, size_t size) : rid_(rid), size_(static_cast<uint32_t>(size)) {}
+};
+
+/*
+ * The header of every inner node. The version is bumped by LOCKED_BIT to lock
+ * the node and again to unlock it, so it only comes back to a value a reader
+ * saw if nothing changed. The prefix never changes; a node whose prefix has
+ * to be cut is replaced by a copy.
+ */
+struct ARTNode {
+  static constexpr uint64_t OBSOLETE_BIT = 1;
+  static constexpr uint64_t LOCKED_BIT = 2;
+
+  ARTNode(ARTNodeType type, std::string prefix) : type_(type), prefix_(std::move(prefix)) {}
+
+  /** Wait out a writer and set version, false if the node has been replaced. */
+  bool ReadLock(uint64_t *version) const {
+    uint64_t current = version_.load(std::memory_order_acquire);
+    while ((current & LOCKED_BIT) != 0) {
+      std::this_thread::yield();
+      current = version_.load(std::memory_order_acquire);
+    }
+    *version = current;
+    return (current & OBSOLETE_BIT) == 0;
+  }
+
+  /** @return true if the node has not been locked since ReadLock() set version */
+  bool Validate(uint64_t version) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+  }
+
+  /** Lock the node if it has not changed since ReadLock() set version. */
+  bool Upgrade(uint64_t version) {
+    if (!version_.compare_exchange_strong(version, version + LOCKED_BIT, std::memory_order_acquire)) {
+      return false;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+  }
+
+  void Unlock() { version_.fetch_add(LOCKED_BIT, std::memory_order_release); }
+
+  /** Unlock a node that has been unlinked, readers holding it restart. */
+  void UnlockObsolete() { version_.fetch_add(LOCKED_BIT + OBSOLETE_BIT, std::memory_order_release); }
+
+  std::atomic<uint64_t> version_{0};
+  const ARTNodeType type_;
+  uint16_t num_children_{0};
+  const std::string prefix_;
+};
+
+/* Up to 4 or 16 children, with their key bytes in ascending order. */
+template <ARTNodeType Type, size_t Capacity>
+struct ARTSortedNode : public ARTNode {
+  explicit ARTSortedNode(std::string prefix) : ARTNode(Type, std::move(prefix)) {}
+
+  uint8_t keys_[Capacity];
+  ARTNode *children_[Capacity];
+};
+
+using ARTNode4 = ARTSortedNode<ARTNodeType::NODE4, 4>;
+using ARTNode16 = ARTSortedNode<ARTNodeType::NODE16, 16>;
+
+/* Up to 48 children, found through the slot + 1 that each key byte maps to, 0 for none. */
+struct ARTNode48 : public ARTNode {
+  explicit ARTNode48(std::string prefix) : ARTNode(ARTNodeType::NODE48, std::move(prefix)) {}
+
+  uint8_t child_index_[256]{};
+  ARTNode *children_[48]{};
+};
+
+/* A child for every key byte. */
+struct ARTNode256 : public ARTNode {
+  explicit ARTNode256(std::string prefix) : ARTNode(ARTNodeType::NODE256, std::move(prefix)) {}
+
+  ARTNode *children_[256]{};
+};
+
+/*
+ * Children are inner nodes or leaves, told apart by the lowest bit of the
+ * pointer, which is set for leaves.
+ */
+static inline bool IsLeaf(const ARTNode *child) { return (reinterpret_cast<uintptr_t>(child) & 1) != 0; }
+
+static inline const ARTLeaf *AsLeaf(const ARTNode *child) {
+  return reinterpret_cast<const ARTLeaf *>(reinterpret_cast<uintptr_t>(child) & ~static_cast<uintptr_t>(1));
+}
+
+static inline ARTNode *MakeLeaf(const std::string &key, const RID &rid) {
+  return reinterpret_cast<ARTNode *>(reinterpret_cast<uintptr_t>(ARTLeaf::Make(key, rid)) | 1);
+}
+
+static inline uint8_t ByteAt(std::string_view key, size_t i) { return static_cast<uint8_t>(key[i]); }
+
+static ARTNode *NewNode(ARTNodeType type, std::string prefix) {
+  switch (type) {
+    case ARTNodeType::NODE4:
+      return new ARTNode4(std::move(prefix));
+    case ARTNodeType::NODE16:
+      return new ARTNode16(std::move(prefix));
+    case ARTNodeType::NODE48:
+      return new ARTNode48(std::move(prefix));
+    case ARTNodeType::NODE256:
+      return new ARTNode256(std::move(prefix));
+  }
+  UNREACHABLE("unknown node type");
+}
+
+/** Free a leaf, or an inner node but not its children. */
+static void FreeNode(ARTNode *node) {
+  if (IsLeaf(node)) {
+    ARTLeaf::Free(AsLeaf(node));
+    return;
+  }
+  switch (node->type_) {
+    case ARTNodeType::NODE4:
+      delete static_cast<ARTNode4 *>(node);
+      break;
+    case ARTNodeType::NODE16:
+      delete static_cast<ARTNode16 *>(node);
+      break;
+    case ARTNodeType::NODE48:
+      delete static_cast<ARTNode48 *>(node);
+      break;
+    case ARTNodeType::NODE256:
+      delete static_cast<ARTNode256 *>(node);
+      break;
+  }
+}
+
+/*
+ * The functions below read a node that may be changing under an optimistic
+ * reader, which validates the node before using what they return. They only
+ * have to stay inside the node while doing so.
+ */
+
+template <typename Node>
+static ARTNode *FindSortedChild(const Node *node, uint8_t byte) {
+  size_t count = std::min<size_t>(node->num_children_, sizeof(node->keys_));
+#ifdef __SSE2__
+  if constexpr (sizeof(node->keys_) == 16) {
+    __m128i keys = _mm_loadu_si128(reinterpret_cast<const __m128i *>(node->keys_));
+    uint32_t match = _mm_movemask_epi8(_mm_cmpeq_epi8(keys, _mm_set1_epi8(static_cast<char>(byte))));
+    match &= (1U << count) - 1;
+    return match == 0 ? nullptr : node->children_[__builtin_ctz(match)];
+  }
+#endif
+  for (size_t i = 0; i < count; i++) {
+    if (node->keys_[i] == byte) {
+      return node->children_[i];
+    }
+  }
+  return nullptr;
+}
+
+/** @return the child for a key byte, nullptr if there is none */
+static ARTNode *FindChild(const ARTNode *node, uint8_t byte) {
+  switch (node->type_) {
+    case ARTNodeType::NODE4:
+      return FindSortedChild(static_cast<const ARTNode4 *>(node), byte);
+    case ARTNodeType::NODE16:
+      return FindSortedChild(static_cast<const ARTNode16 *>(node), byte);
+    case ARTNodeType::NODE48: {
+      auto *node48 = static_cast<const ARTNode48 *>(node);
+      uint8_t slot = node48->child_index_[byte];
+      return slot == 0 || slot > 48 ? nullptr : node48->children_[slot - 1];
+    }
+    case ARTNodeType::NODE256:
+      return static_cast<const ARTNode256 *>(node)->children_[byte];
+  }
+  UNREACHABLE("unknown node type");
+}
+
+template <typename Node>
+static bool NextSortedChild(const Node *node, int from, bool reverse, uint8_t *byte, ARTNode **child) {
+  int count = std::min<int>(node->num_children_, sizeof(node->keys_));
+  if (reverse) {
+    for (int i = count - 1; i >= 0; i--) {
+      if (node->keys_[i] <= from) {
+        *byte = node->keys_[i];
+        *child = node->children_[i];
+        return true;
+      }
+    }
+    return false;
+  }
+  for (int i = 0; i < count; i++) {
+    if (node->keys_[i] >= from) {
+      *byte = node->keys_[i];
+      *child = node->children_[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+/** Find the child with the first key byte from `from` on, or the last one up to it in reverse. */
+static bool NextChild(const ARTNode *node, int from, bool reverse, uint8_t *byte, ARTNode **child) {
+  int step = reverse ? -1 : 1;
+  switch (node->type_) {
+    case ARTNodeType::NODE4:
+      return NextSortedChild(static_cast<const ARTNode4 *>(node), from, reverse, byte, child);
+    case ARTNodeType::NODE16:
+      return NextSortedChild(static_cast<const ARTNode16 *>(node), from, reverse, byte, child);
+    case ARTNodeType::NODE48: {
+      auto *node48 = static_cast<const ARTNode48 *>(node);
+      for (int i = from; i >= 0 && i < 256; i += step) {
+        uint8_t slot = node48->child_index_[i];
+        if (slot != 0 && slot <= 48 && node48->children_[slot - 1] != nullptr) {
+          *byte = static_cast<uint8_t>(i);
+          *child = node48->children_[slot - 1];
+          return true;
+        }
+      }
+      return false;
+    }
+    case ARTNodeType::NODE256: {
+      auto *node256 = static_cast<const ARTNode256 *>(node);
+      for (int i = from; i >= 0 && i < 256; i += step) {
+        if (node256->children_[i] != nullptr) {
+          *byte = static_cast<uint8_t>(i);
+          *child = node256->children_[i];
+          return true;
+        }
+      }
+      return false;
+    }
+  }
+  UNREACHABLE("unknown node type");
+}
+
+/** Call fn(byte, child) for every child in key order. */
+static void ForEachChild(const ARTNode *node, const std::function<void(uint8_t, ARTNode *)> &fn) {
+  uint8_t byte;
+  ARTNode *child;
+  for (int from = 0; from < 256 && NextChild(node, from, false, &byte, &child); from = byte + 1) {
+    fn(byte, child);
+  }
+}
+
+/*
+ * The functions below change a node, which the caller has locked.
+ */
+
+static bool IsFull(const ARTNode *node) {
+  switch (node->type_) {
+    case ARTNodeType::NODE4:
+      return node->num_children_ == 4;
+    case ARTNodeType::NODE16:
+      return node->num_children_ == 16;
+    case ARTNodeType::NODE48:
+      return node->num_children_ == 48;
+    case ARTNodeType::NODE256:
+      return false;
+  }
+  UNREACHABLE("unknown node type");
+}
+
+/**
+ * @return true if the node is to be replaced once a child is removed: a smaller node takes its children, or the
+ * parent takes its last child, or loses it if it has none. The thresholds are below the capacity of the smaller node
+ * so that a node at the boundary does not flip back and forth.
+ */
+static bool ShrinksAfterRemove(const ARTNode *node) {
+  switch (node->type_) {
+    case ARTNodeType::NODE4:
+      return node->num_children_ <= 2;
+    case ARTNodeType::NODE16:
+      return node->num_children_ <= 4;
+    case ARTNodeType::NODE48:
+      return node->num_children_ <= 13;
+    case ARTNodeType::NODE256:
+      return node->num_children_ <= 41;
+  }
+  UNREACHABLE("unknown node type");
+}
+
+template <typename Node>
+static void AddSortedChild(Node *node, uint8_t byte, ARTNode *child) {
+  size_t count = node->num_children_;
+  size_t pos = 0;
+  while (pos < count && node->keys_[pos] < byte) {
+    pos++;
+  }
+  memmove(node->keys_ + pos + 1, node->keys_ + pos, count - pos);
+  memmove(node->children_ + pos + 1, node->children_ + pos, (count - pos) * sizeof(ARTNode *));
+  node->keys_[pos] = byte;
+  node->children_[pos] = child;
+  node->num_children_++;
+}
+
+/** Add a child for a key byte that has none, the node must not be full. */
+static void AddChild(ARTNode *node, uint8_t byte, ARTNode *child) {
+  switch (node->type_) {
+    case ARTNodeType::NODE4:
+      AddSortedChild(static_cast<ARTNode4 *>(node), byte, child);
+      return;
+    case ARTNodeType::NODE16:
+      AddSortedChild(static_cast<ARTNode16 *>(node), byte, child);
+      return;
+    case ARTNodeType::NODE48: {
+      auto *node48 = static_cast<ARTNode48 *>(node);
+      uint8_t slot = 0;
+      while (node48->children_[slot] != nullptr) {
+        slot++;
+      }
+      node48->children_[slot] = child;
+      node48->child_index_[byte] = slot + 1;
+      node48->num_children_++;
+      return;
+    }
+    case ARTNodeType::NODE256:
+      static_cast<ARTNode256 *>(node)->children_[byte] = child;
+      node->num_children_++;
+      return;
+  }
+}
+
+template <typename Node>
+static void ChangeSortedChild(Node *node, uint8_t byte, ARTNode *child) {
+  size_t pos = 0;
+  while (node->keys_[pos] != byte) {
+    pos++;
+  }
+  node->children_[pos] = child;
+}
+
+/** Point an existing key byte to another child. */
+static void ChangeChild(ARTNode *node, uint8_t byte, ARTNode *child) {
+  switch (node->type_) {
+    case ARTNodeType::NODE4:
+      ChangeSortedChild(static_cast<ARTNode4 *>(node), byte, child);
+      return;
+    case ARTNodeType::NODE16:
+      ChangeSortedChild(static_cast<ARTNode16 *>(node), byte, child);
+      return;
+    case ARTNodeType::NODE48: {
+      auto *node48 = static_cast<ARTNode48 *>(node);
+      node48->children_[node48->child_index_[byte] - 1] = child;
+      return;
+    }
+    case ARTNodeType::NODE256:
+      static_cast<ARTNode256 *>(node)->children_[byte] = child;
+      return;
+  }
+}
+
+template <typename Node>
+static void RemoveSortedChild(Node *node, uint8_t byte) {
+  size_t count = node->num_children_;
+  size_t pos = 0;
+  while (node->keys_[pos] != byte) {
+    pos++;
+  }
+  memmove(node->keys_ + pos, node->keys_ + pos + 1, count - pos - 1);
+  memmove(node->children_ + pos, node->children_ + pos + 1, (count - pos - 1) * sizeof(ARTNode *));
+  node->num_children_--;
+}
+
+static void RemoveChild(ARTNode *node, uint8_t byte) {
+  switch (node->type_) {
+    case ARTNodeType::NODE4:
+      RemoveSortedChild(static_cast<ARTNode4 *>(node), byte);
+      return;
+    case ARTNodeType::NODE16:
+      RemoveSortedChild(static_cast<ARTNode16 *>(node), byte);
+      return;
+    case ARTNodeType::NODE48: {
+      auto *node48 = static_cast<ARTNode48 *>(node);
+      node48->children_[node48->child_index_[byte] - 1] = nullptr;
+      node48->child_index_[byte] = 0;
+      node48->num_children_--;
+      return;
+    }
+    case ARTNodeType::NODE256:
+      static_cast<ARTNode256 *>(node)->children_[byte] = nullptr;
+      node->num_children_--;
+      return;
+  }
+}
+
+/** @return a new node of another type or prefix with the children of node, which the caller has locked */
+static ARTNode *CopyNode(const ARTNode *node, ARTNodeType type, std::string prefix) {
+  ARTNode *copy = NewNode(type, std::move(prefix));
+  ForEachChild(node, [copy](uint8_t byte, ARTNode *child) { AddChild(copy, byte, child); });
+  return copy;
+}
+
+static ARTNodeType GrownType(ARTNodeType type) {
+  switch (type) {
+    case ARTNodeType::NODE4:
+      return ARTNodeType::NODE16;
+    case ARTNodeType::NODE16:
+      return ARTNodeType::NODE48;
+    default:
+      return ARTNodeType::NODE256;
+  }
+}
+
+static ARTNodeType ShrunkType(ARTNodeType type) {
+  switch (type) {
+    case ARTNodeType::NODE256:
+      return ARTNodeType::NODE48;
+    case ARTNodeType::NODE48:
+      return ARTNodeType::NODE16;
+    default:
+      return ARTNodeType::NODE4;
+  }
+}
+
+/** @return the number of bytes of prefix that match the key from depth on */
+static size_t MatchPrefix(const std::string &prefix, const std::string &key, size_t depth) {
+  size_t length = std::min(prefix.size(), key.size() - std::min(depth, key.size()));
+  size_t matched = 0;
+  while (matched < length && prefix[matched] == key[depth + matched]) {
+    matched++;
+  }
+  return matched;
+}
+
+/*
+ * AdaptiveRadixTree
+ */
+
+AdaptiveRadixTree::AdaptiveRadixTree() : root_(new ARTNode256("")) {}
+
+AdaptiveRadixTree::~AdaptiveRadixTree() {
+  std::function<void(ARTNode *)> free_tree = [&free_tree](ARTNode *node) {
+    if (!IsLeaf(node)) {
+      ForEachChild(node, [&free_tree](uint8_t /* byte */, ARTNode *child) { free_tree(child); });
+    }
+    FreeNode(node);
+  };
+  free_tree(root_);
+  for (auto *node : retired_) {
+    FreeNode(node);
+  }
+}
+
+AdaptiveRadixTree::OperationGuard::OperationGuard(AdaptiveRadixTree *tree) {
+  static thread_local size_t stripe = std::hash<std::thread::id>()(std::this_thread::get_id()) % OPERATION_STRIPES;
+  // a reclaim that starts a new generation after the check waits for this operation, one that started it before
+  // the check is not waited for, so count again under the new generation
+  while (true) {
+    uint32_t generation = tree->generation_.load();
+    running_ = &tree->stripes_[stripe].running_[generation];
+    running_->fetch_add(1);
+    if (tree->generation_.load() == generation) {
+      return;
+    }
+    running_->fetch_sub(1);
+  }
+}
+
+AdaptiveRadixTree::OperationGuard::~OperationGuard() { running_->fetch_sub(1, std::memory_order_release); }
+
+bool AdaptiveRadixTree::GetValue(const std::string &key, std::vector<RID> *result) {
+  OperationGuard guard(this);
+  size_t size = result->size();
+  while (!TryGetValue(key, result)) {
+  }
+  return result->size() > size;
+}
+
+bool AdaptiveRadixTree::TryGetValue(const std::string &key, std::vector<RID> *result) {
+  ARTNode *node = root_;
+  uint64_t version;
+  if (!node->ReadLock(&version)) {
+    return false;
+  }
+  size_t depth = 0;
+  while (true) {
+    if (MatchPrefix(node->prefix_, key, depth) < node->prefix_.size()) {
+      return node->Validate(version);
+    }
+    depth += node->prefix_.size();
+    if (depth >= key.size()) {
+      return node->Validate(version);
+    }
+    ARTNode *child = FindChild(node, ByteAt(key, depth));
+    if (!node->Validate(version)) {
+      return false;
+    }
+    if (child == nullptr) {
+      return true;
+    }
+    if (IsLeaf(child)) {
+      if (AsLeaf(child)->Key() == key) {
+        result->push_back(AsLeaf(child)->rid_);
+      }
+      return true;
+    }
+    // the child must still be linked when its version is taken
+    uint64_t child_version;
+    if (!child->ReadLock(&child_version) || !node->Validate(version)) {
+      return false;
+    }
+    node = child;
+    version = child_version;
+    depth++;
+  }
+}
+
+bool AdaptiveRadixTree::Insert(const std::string &key, const RID &value) {
+  bool inserted;
+  {
+    OperationGuard guard(this);
+    while (!TryInsert(key, value, &inserted)) {
+    }
+  }
+  Reclaim();
+  return inserted;
+}
+
+bool AdaptiveRadixTree::TryInsert(const std::string &key, const RID &value, bool *inserted) {
+  // the root has no prefix and room for every byte, so a node that is replaced always has a parent
+  ARTNode *parent = nullptr;
+  uint64_t parent_version = 0;
+  uint8_t parent_byte = 0;
+  ARTNode *node = root_;
+  uint64_t version;
+  if (!node->ReadLock(&version)) {
+    return false;
+  }
+  size_t depth = 0;
+  while (true) {
+    const std::string &prefix = node->prefix_;
+    size_t matched = MatchPrefix(prefix, key, depth);
+    if (matched < prefix.size()) {
+      BUSTUB_ASSERT(depth + matched < key.size(), "no key may be a prefix of another");
+      // the key leaves the path inside the prefix: a new node takes the shared part and branches to a copy of this
+      // node without it and to the new leaf
+      if (!parent->Upgrade(parent_version)) {
+        return false;
+      }
+      if (!node->Upgrade(version)) {
+        parent->Unlock();
+        return false;
+      }
+      ARTNode *branch = NewNode(ARTNodeType::NODE4, prefix.substr(0, matched));
+      AddChild(branch, ByteAt(prefix, matched), CopyNode(node, node->type_, prefix.substr(matched + 1)));
+      AddChild(branch, ByteAt(key, depth + matched), MakeLeaf(key, value));
+      ChangeChild(parent, parent_byte, branch);
+      parent->Unlock();
+      node->UnlockObsolete();
+      Retire(node);
+      *inserted = true;
+      return true;
+    }
+    depth += prefix.size();
+    BUSTUB_ASSERT(depth < key.size(), "no key may be a prefix of another");
+    uint8_t byte = ByteAt(key, depth);
+    ARTNode *child = FindChild(node, byte);
+    if (!node->Validate(version)) {
+      return false;
+    }
+
+    if (child == nullptr) {
+      if (!IsFull(node)) {
+        if (!node->Upgrade(version)) {
+          return false;
+        }
+        AddChild(node, byte, MakeLeaf(key, value));
+        node->Unlock();
+        *inserted = true;
+        return true;
+      }
+      if (!parent->Upgrade(parent_version)) {
+        return false;
+      }
+      if (!node->Upgrade(version)) {
+        parent->Unlock();
+        return false;
+      }
+      ARTNode *grown = CopyNode(node, GrownType(node->type_), prefix);
+      AddChild(grown, byte, MakeLeaf(key, value));
+      ChangeChild(parent, parent_byte, grown);
+      parent->Unlock();
+      node->UnlockObsolete();
+      Retire(node);
+      *inserted = true;
+      return true;
+    }
+
+    if (IsLeaf(child)) {
+      std::string_view leaf_key = AsLeaf(child)->Key();
+      if (leaf_key == key) {
+        *inserted = false;
+        return true;
+      }
+      if (!node->Upgrade(version)) {
+        return false;
+      }
+      // the two keys get a node that holds the bytes they share and branches where they differ
+      size_t start = depth + 1;
+      size_t end = start;
+      while (end < key.size() && end < leaf_key.size() && key[end] == leaf_key[end]) {
+        end++;
+      }
+      BUSTUB_ASSERT(end < key.size() && end < leaf_key.size(), "no key may be a prefix of another");
+      ARTNode *branch = NewNode(ARTNodeType::NODE4, key.substr(start, end - start));
+      AddChild(branch, ByteAt(leaf_key, end), child);
+      AddChild(branch, ByteAt(key, end), MakeLeaf(key, value));
+      ChangeChild(node, byte, branch);
+      node->Unlock();
+      *inserted = true;
+      return true;
+    }
+
+    uint64_t child_version;
+    if (!child->ReadLock(&child_version) || !node->Validate(version)) {
+      return false;
+    }
+    parent = node;
+    parent_version = version;
+    parent_byte = byte;
+    node = child;
+    version = child_version;
+    depth++;
+  }
+}
+
+bool AdaptiveRadixTree::Remove(const std::string &key) {
+  bool removed;
+  {
+    OperationGuard guard(this);
+    while (!TryRemove(key, &removed)) {
+    }
+  }
+  Reclaim();
+  return removed;
+}
+
+bool AdaptiveRadixTree::TryRemove(const std::string &key, bool *removed) {
+  *removed = false;
+  ARTNode *parent = nullptr;
+  uint64_t parent_version = 0;
+  uint8_t parent_byte = 0;
+  ARTNode *node = root_;
+  uint64_t version;
+  if (!node->ReadLock(&version)) {
+    return false;
+  }
+  size_t depth = 0;
+  while (true) {
+    if (MatchPrefix(node->prefix_, key, depth) < node->prefix_.size()) {
+      return node->Validate(version);
+    }
+    depth += node->prefix_.size();
+    if (depth >= key.size()) {
+      return node->Validate(version);
+    }
+    uint8_t byte = ByteAt(key, depth);
+    ARTNode *child = FindChild(node, byte);
+    bool shrinks = node != root_ && ShrinksAfterRemove(node);
+    if (!node->Validate(version)) {
+      return false;
+    }
+    if (child == nullptr) {
+      return true;
+    }
+
+    if (IsLeaf(child)) {
+      if (AsLeaf(child)->Key() != key) {
+        return true;
+      }
+      if (shrinks && !parent->Upgrade(parent_version)) {
+        return false;
+      }
+      if (!node->Upgrade(version)) {
+        if (shrinks) {
+          parent->Unlock();
+        }
+        return false;
+      }
+      RemoveChild(node, byte);
+      *removed = true;
+      Retire(child);
+      if (!shrinks) {
+        node->Unlock();
+        return true;
+      }
+
+      // the parent takes the last child in place of a Node4, a Node4 left with an inner node stays as it is
+      ARTNode *replacement = node;
+      uint8_t last_byte;
+      ARTNode *last_child = nullptr;
+      if (node->type_ != ARTNodeType::NODE4) {
+        replacement = CopyNode(node, ShrunkType(node->type_), node->prefix_);
+      } else if (!NextChild(node, 0, false, &last_byte, &last_child)) {
+        replacement = nullptr;
+      } else if (IsLeaf(last_child)) {
+        replacement = last_child;
+      }
+      if (replacement == nullptr) {
+        RemoveChild(parent, parent_byte);
+      } else if (replacement != node) {
+        ChangeChild(parent, parent_byte, replacement);
+      }
+      parent->Unlock();
+      if (replacement == node) {
+        node->Unlock();
+      } else {
+        node->UnlockObsolete();
+        Retire(node);
+      }
+      return true;
+    }
+
+    uint64_t child_version;
+    if (!child->ReadLock(&child_version) || !node->Validate(version)) {
+      return false;
+    }
+    parent = node;
+    parent_version = version;
+    parent_byte = byte;
+    node = child;
+    version = child_version;
+    depth++;
+  }
+}
+
+void AdaptiveRadixTree::Scan(const std::string *bound, bool inclusive, bool reverse, size_t limit,
+                             std::vector<std::pair<std::string, RID>> *entries) {
+  OperationGuard guard(this);
+  while (true) {
+    entries->clear();
+    uint64_t version;
+    if (root_->ReadLock(&version) && TryScan(root_, version, 0, bound, inclusive, reverse, limit, entries)) {
+      return;
+    }
+  }
+}
+
+/*
+ * Copy the entries below node in order until there are limit of them. All keys
+ * below node start with the first depth bytes of bound, or lie past it if it
+ * is nullptr.
+ */
+bool AdaptiveRadixTree::TryScan(ARTNode *node, uint64_t version, size_t depth, const std::string *bound,
+                                bool inclusive, bool reverse, size_t limit,
+                                std::vector<std::pair<std::string, RID>> *entries) {
+  const std::string &prefix = node->prefix_;
+  if (bound != nullptr) {
+    size_t length = std::min(prefix.size(), bound->size() - depth);
+    int cmp = prefix.compare(0, length, *bound, depth, length);
+    if (cmp == 0 && length == prefix.size() && depth + length < bound->size()) {
+      // the keys below node still start like bound
+      depth += length;
+    } else {
+      // the prefix is past bound or bound ends in it, so all keys below node are greater than bound, or all less
+      if ((cmp >= 0) == reverse) {
+        return true;
+      }
+      bound = nullptr;
+    }
+  }
+  if (bound == nullptr) {
+    depth += prefix.size();
+  }
+
+  int from = bound != nullptr ? ByteAt(*bound, depth) : reverse ? 255 : 0;
+  uint8_t byte;
+  ARTNode *child;
+  for (int i = from; i >= 0 && i < 256 && entries->size() < limit; i = reverse ? byte - 1 : byte + 1) {
+    if (!NextChild(node, i, reverse, &byte, &child)) {
+      break;
+    }
+    if (!node->Validate(version)) {
+      return false;
+    }
+    // only the child on the path of bound holds keys on both sides of it
+    const std::string *child_bound = bound != nullptr && byte == from ? bound : nullptr;
+    if (IsLeaf(child)) {
+      const ARTLeaf *leaf = AsLeaf(child);
+      if (child_bound != nullptr) {
+        int cmp = leaf->Key().compare(*child_bound);
+        if (cmp == 0 ? !inclusive : (cmp > 0) == reverse) {
+          continue;
+        }
+      }
+      entries->emplace_back(leaf->Key(), leaf->rid_);
+      continue;
+    }
+    uint64_t child_version;
+    if (!child->ReadLock(&child_version) || !node->Validate(version)) {
+      return false;
+    }
+    if (!TryScan(child, child_version, depth + 1, child_bound, inclusive, reverse, limit, entries)) {
+      return false;
+    }
+  }
+  return node->Validate(version);
+}
+
+void AdaptiveRadixTree::Retire(ARTNode *node) {
+  std::lock_guard<std::mutex> lock(retired_latch_);
+  retired_.push_back(node);
+}
+
+void AdaptiveRadixTree::Reclaim() {
+  {
+    std::lock_guard<std::mutex> lock(retired_latch_);
+    if (retired_.size() < RECLAIM_THRESHOLD) {
+      return;
+    }
+  }
+  // one writer reclaims at a time, the others go on
+  std::unique_lock<std::mutex> reclaim_lock(reclaim_latch_, std::try_to_lock);
+  if (!reclaim_lock.owns_lock()) {
+    return;
+  }
+  std::vector<ARTNode *> garbage;
+  {
+    std::lock_guard<std::mutex> lock(retired_latch_);
+    garbage.swap(retired_);
+  }
+  // the garbage is unlinked, so only operations of the old generation can still hold it. Those of the generation
+  // before it have been waited for by the last reclaim.
+  uint32_t old_generation = generation_.load();
+  generation_.store(old_generation ^ 1);
+  for (auto &stripe : stripes_) {
+    while (stripe.running_[old_generation].load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+  }
+  for (auto *node : garbage) {
+    FreeNode(node);
+  }
+}
+
+ARTIterator AdaptiveRadixTree::Begin() { return ARTIterator(this, nullptr, false); }
+
+ARTIterator AdaptiveRadixTree::Begin(const std::string &key) { return ARTIterator(this, &key, false); }
+
+ARTIterator AdaptiveRadixTree::RBegin() { return ARTIterator(this, nullptr, true); }
+
+ARTIterator AdaptiveRadixTree::RBegin(const std::string &key) { return ARTIterator(this, &key, true); }
+
+/*
+ * ARTIterator
+ */
+
+ARTIterator::ARTIterator(AdaptiveRadixTree *tree, const std::string *key, bool reverse)
+    : tree_(tree), reverse_(reverse) {
+  if (key != nullptr) {
+    bound_ = *key;
+    inclusive_ = true;
+  }
+  Load();
+}
+
+ARTIterator &ARTIterator::operator++() {
+  position_++;
+  // a batch that is not full had all the entries there were
+  if (position_ == entries_.size() && entries_.size() == batch_size_) {
+    bound_ = std::move(entries_.back().first);
+    inclusive_ = false;
+    batch_size_ = std::min(2 * batch_size_, MAX_BATCH_SIZE);
+    Load();
+  }
+  return *this;
+}
+
+void ARTIterator::Load() {
+  tree_->Scan(bound_.has_value() ? &*bound_ : nullptr, inclusive_, reverse_, batch_size_, &entries_);
+  position_ = 0;
+}
+
+}  // namespace bustub
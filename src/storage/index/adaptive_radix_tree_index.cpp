@@ -0,0 +1,102 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// adaptive_radix_tree_index.cpp
+//
+// Identification: src/storage/index/adaptive_radix_tree_index.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "storage/index/adaptive_radix_tree_index.h"
+#include "storage/index/normalized_key.h"
+
+namespace bustub {
+
+/*
+ * Iterates over an AdaptiveRadixTree from a bound until the other one is passed.
+ */
+class AdaptiveRadixTreeIndexScanIterator : public IndexScanIterator {
+ public:
+  AdaptiveRadixTreeIndexScanIterator(ARTIterator iterator, std::optional<std::string> stop_key, bool reverse,
+                                     Schema *key_schema)
+      : iterator_(std::move(iterator)), stop_key_(std::move(stop_key)), reverse_(reverse), key_schema_(key_schema) {}
+
+  bool Next(Tuple *key, RID *rid) override {
+    if (iterator_.IsEnd()) {
+      return false;
+    }
+    const auto &[index_key, value] = *iterator_;
+    if (stop_key_.has_value()) {
+      int cmp = index_key.compare(*stop_key_);
+      if (reverse_ ? cmp < 0 : cmp > 0) {
+        iterator_ = ARTIterator();
+        return false;
+      }
+    }
+    std::vector<Value> values;
+    values.reserve(key_schema_->GetColumnCount());
+    size_t offset = 0;
+    for (uint32_t i = 0; i < key_schema_->GetColumnCount(); i++) {
+      values.push_back(NormalizedEncoding::Read(key_schema_->GetColumn(i).GetType(), index_key.data(),
+                                                index_key.size(), &offset));
+    }
+    *key = Tuple(values, key_schema_);
+    *rid = value;
+    ++iterator_;
+    return true;
+  }
+
+ private:
+  ARTIterator iterator_;
+  // the bound the scan ends at
+  std::optional<std::string> stop_key_;
+  bool reverse_;
+  Schema *key_schema_;
+};
+
+/*
+ * Constructor
+ */
+AdaptiveRadixTreeIndex::AdaptiveRadixTreeIndex(std::unique_ptr<IndexMetadata> &&metadata)
+    : Index(std::move(metadata)) {}
+
+void AdaptiveRadixTreeIndex::InsertEntry(const Tuple &key, RID rid, Transaction * /* transaction */) {
+  container_.Insert(NormalizedEncoding::Encode(key, GetKeySchema()), rid);
+}
+
+void AdaptiveRadixTreeIndex::DeleteEntry(const Tuple &key, RID /* rid */, Transaction * /* transaction */) {
+  container_.Remove(NormalizedEncoding::Encode(key, GetKeySchema()));
+}
+
+void AdaptiveRadixTreeIndex::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction * /* transaction */) {
+  container_.GetValue(NormalizedEncoding::Encode(key, GetKeySchema()), result);
+}
+
+std::unique_ptr<IndexScanIterator> AdaptiveRadixTreeIndex::ScanRange(const Tuple *low_key, const Tuple *high_key,
+                                                                     bool reverse, Transaction * /* transaction */) {
+  std::optional<std::string> low;
+  std::optional<std::string> high;
+  if (low_key != nullptr) {
+    low = NormalizedEncoding::Encode(*low_key, GetKeySchema());
+  }
+  if (high_key != nullptr) {
+    high = NormalizedEncoding::Encode(*high_key, GetKeySchema());
+  }
+  ARTIterator iterator;
+  if (reverse) {
+    iterator = high.has_value() ? container_.RBegin(*high) : container_.RBegin();
+  } else {
+    iterator = low.has_value() ? container_.Begin(*low) : container_.Begin();
+  }
+  return std::make_unique<AdaptiveRadixTreeIndexScanIterator>(std::move(iterator), reverse ? low : high, reverse,
+                                                              GetKeySchema());
+}
+
+}  // namespace bustub
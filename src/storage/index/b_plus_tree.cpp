@@ -9,7 +9,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <string>
+#include <thread>  // NOLINT
+#include <type_traits>
+#include <utility>
 
 #include "common/exception.h"
 #include "common/rid.h"
@@ -19,19 +23,42 @@
 namespace bustub {
 INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
-                          int leaf_max_size, int internal_max_size)
+                          int leaf_max_size, int internal_max_size, BPlusTreeMode mode, page_id_t header_page_id,
+                          LogManager *log_manager)
     : index_name_(std::move(name)),
       root_page_id_(INVALID_PAGE_ID),
+      rightmost_leaf_page_id_(INVALID_PAGE_ID),
       buffer_pool_manager_(buffer_pool_manager),
       comparator_(comparator),
       leaf_max_size_(leaf_max_size),
-      internal_max_size_(internal_max_size) {}
+      internal_max_size_(internal_max_size),
+      mode_(mode),
+      header_page_id_(header_page_id),
+      log_manager_(log_manager) {}
+
+/*
+ * Take the root page id from the header page record of this tree
+ * @return: false if the header page has no record of it
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::OpenFromHeaderPage() {
+  Page *page = FetchPage(header_page_id_);
+  page_id_t root_page_id;
+  page->RLatch();
+  bool found = static_cast<HeaderPage *>(page)->GetRootId(index_name_, &root_page_id);
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(header_page_id_, false);
+  if (found) {
+    root_page_id_ = root_page_id;
+  }
+  return found;
+}
 
 /*
  * Helper function to decide whether current b+tree is empty
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::IsEmpty() const { return true; }
+bool BPLUSTREE_TYPE::IsEmpty() const { return root_page_id_ == INVALID_PAGE_ID; }
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
@@ -42,7 +69,23 @@ bool BPLUSTREE_TYPE::IsEmpty() const { return true; }
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction) {
-  return false;
+  while (true) {
+    uint64_t version;
+    Page *page = FindLeafPageOptimistic(key, Target::KEY, LatchMode::OPTIMISTIC, &version);
+    if (page == nullptr) {
+      return false;
+    }
+    ValueType value;
+    bool found = reinterpret_cast<LeafPage *>(page->GetData())->Lookup(key, &value, comparator_);
+    bool valid = page->ValidateVersion(version);
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    if (valid) {
+      if (found) {
+        result->push_back(value);
+      }
+      return found;
+    }
+  }
 }
 
 /*****************************************************************************
@@ -56,7 +99,48 @@ bool BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
  * keys return false, otherwise return true.
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) { return false; }
+bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) {
+  if (mode_ == BPlusTreeMode::B_LINK) {
+    return InsertBLink(key, value);
+  }
+
+  // optimistic pass: only the leaf is write-latched, good enough unless the leaf splits
+  Page *page = FindRightmostLeafPage(key);
+  if (page == nullptr) {
+    page = FindLeafPageOptimistic(key, Target::KEY, LatchMode::WRITE, nullptr);
+  }
+  if (page != nullptr) {
+    auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    bool exists = leaf->Lookup(key, nullptr, comparator_);
+    bool safe = !exists && IsSafe(leaf, Operation::INSERT);
+    if (safe) {
+      leaf->Insert(key, value, comparator_);
+      if (leaf->GetNextPageId() == INVALID_PAGE_ID) {
+        rightmost_leaf_page_id_ = page->GetPageId();
+      }
+      LogPage(page);
+    }
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), safe);
+    if (exists || safe) {
+      return safe;
+    }
+  }
+
+  // pessimistic pass
+  Transaction local_transaction(INVALID_TXN_ID);
+  if (transaction == nullptr) {
+    transaction = &local_transaction;
+  }
+  bool inserted = true;
+  if (FindLeafPageWrite(key, Operation::INSERT, transaction) == nullptr) {
+    StartNewTree(key, value);
+  } else {
+    inserted = InsertIntoLeaf(key, value, transaction);
+  }
+  ReleaseLatches(transaction, true);
+  return inserted;
+}
 /*
  * Insert constant key & value pair into an empty tree
  * User needs to first ask for new page from buffer pool manager(NOTICE: throw
@@ -64,19 +148,55 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
  * tree's root page id and insert entry directly into leaf page.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {}
+void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(&page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate new root page");
+  }
+  auto *root = reinterpret_cast<LeafPage *>(page->GetData());
+  root->Init(page_id, INVALID_PAGE_ID, leaf_max_size_);
+  root->Insert(key, value, comparator_);
+  LogPage(page);
+  root_page_id_ = page_id;
+  rightmost_leaf_page_id_ = page_id;
+  UpdateRootPageId(1);
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
 
 /*
  * Insert constant key & value pair into leaf page
  * User needs to first find the right leaf page as insertion target, then look
  * through leaf page to see whether insert key exist or not. If exist, return
  * immdiately, otherwise insert entry. Remember to deal with split if necessary.
+ * The leaf page is the last page in the transaction's page set, write-latched
+ * along with every ancestor that may be affected by a split.
  * @return: since we only support unique key, if user try to insert duplicate
  * keys return false, otherwise return true.
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value, Transaction *transaction) {
-  return false;
+  auto *leaf = reinterpret_cast<LeafPage *>(transaction->GetPageSet()->back()->GetData());
+  if (leaf->Lookup(key, nullptr, comparator_)) {
+    return false;
+  }
+  if (leaf->Insert(key, value, comparator_) >= leaf->GetMaxSize()) {
+    bool append = leaf->GetNextPageId() == INVALID_PAGE_ID && comparator_(key, leaf->KeyAt(leaf->GetSize() - 1)) == 0;
+    LeafPage *new_leaf = Split(leaf, append);
+    if (new_leaf->GetNextPageId() == INVALID_PAGE_ID) {
+      rightmost_leaf_page_id_ = new_leaf->GetPageId();
+    }
+    KeyType separator = new_leaf->KeyAt(0);
+    if constexpr (IsBinaryComparable<KeyComparator>::value) {
+      // any key between the two leaves separates them, the shortest only has the bytes that tell them apart
+      separator = KeyComparator::Separator(leaf->KeyAt(leaf->GetSize() - 1), separator);
+    }
+    leaf->SetHighKey(separator);
+    InsertIntoParent(leaf, separator, new_leaf, transaction);
+    LogPage(new_leaf);
+    buffer_pool_manager_->UnpinPage(new_leaf->GetPageId(), true);
+  }
+  return true;
 }
 
 /*
@@ -85,11 +205,37 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
  * User needs to first ask for new page from buffer pool manager(NOTICE: throw
  * an "out of memory" exception if returned value is nullptr), then move half
  * of key & value pairs from input page to newly created page
+ * If append is set, the page is the rightmost one of its level and the entry
+ * that overflowed it went last: only a tenth of the entries are moved, since
+ * the following appends will fill the new page and leave this one alone. A
+ * new internal page still gets two children, so that every child has a
+ * sibling to merge with.
+ * The new page is linked in as the right sibling of the input page and takes
+ * over its high key; the caller sets the input page's high key to the key it
+ * pushes up.
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-N *BPLUSTREE_TYPE::Split(N *node) {
-  return nullptr;
+N *BPLUSTREE_TYPE::Split(N *node, bool append) {
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(&page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate new page for split");
+  }
+  auto *new_node = reinterpret_cast<N *>(page->GetData());
+  new_node->Init(page_id, node->GetParentPageId(), node->GetMaxSize());
+  int min_moved = node->IsLeafPage() ? 1 : 2;
+  int size = append ? std::max(node->GetSize() / 10, min_moved) : node->GetSize() - node->GetSize() / 2;
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    node->MoveTailTo(new_node, size);
+  } else {
+    node->MoveTailTo(new_node, size, buffer_pool_manager_);
+    LogChildren(new_node, 0, new_node->GetSize());
+  }
+  new_node->SetNextPageId(node->GetNextPageId());
+  new_node->SetHighKey(node->GetHighKey());
+  node->SetNextPageId(page_id);
+  return new_node;
 }
 
 /*
@@ -103,7 +249,285 @@ N *BPLUSTREE_TYPE::Split(N *node) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, BPlusTreePage *new_node,
-                                      Transaction *transaction) {}
+                                      Transaction *transaction) {
+  if (old_node->IsRootPage()) {
+    page_id_t page_id;
+    Page *page = buffer_pool_manager_->NewPage(&page_id);
+    if (page == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate new root page");
+    }
+    auto *root = reinterpret_cast<InternalPage *>(page->GetData());
+    root->Init(page_id, INVALID_PAGE_ID, internal_max_size_);
+    root->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
+    old_node->SetParentPageId(page_id);
+    new_node->SetParentPageId(page_id);
+    LogPage(page);
+    root_page_id_ = page_id;
+    UpdateRootPageId(0);
+    buffer_pool_manager_->UnpinPage(page_id, true);
+    return;
+  }
+
+  // the parent is already write-latched in the page set
+  Page *parent_page = FetchPage(old_node->GetParentPageId());
+  auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+  if (parent->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId()) > parent->GetMaxSize()) {
+    bool append = parent->GetNextPageId() == INVALID_PAGE_ID &&
+                  parent->ValueAt(parent->GetSize() - 1) == new_node->GetPageId();
+    InternalPage *new_parent = Split(parent, append);
+    parent->SetHighKey(new_parent->KeyAt(0));
+    InsertIntoParent(parent, new_parent->KeyAt(0), new_parent, transaction);
+    LogPage(new_parent);
+    buffer_pool_manager_->UnpinPage(new_parent->GetPageId(), true);
+  }
+  buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
+}
+
+/*
+ * Insert constant key & value pair into a B-link tree. Only the leaf is
+ * write-latched; if it splits, the split is finished one level at a time by
+ * InsertIntoParentBLink(). Only starting a new tree takes the root latch.
+ * @return: false if the key already exists
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::InsertBLink(const KeyType &key, const ValueType &value) {
+  Page *page = FindRightmostLeafPage(key);
+  if (page == nullptr) {
+    page = FindLeafPageOptimistic(key, Target::KEY, LatchMode::WRITE, nullptr);
+  }
+  if (page == nullptr) {
+    root_latch_.WLock();
+    if (root_page_id_ == INVALID_PAGE_ID) {
+      StartNewTree(key, value);
+      root_latch_.WUnlock();
+      return true;
+    }
+    root_latch_.WUnlock();
+    page = FindLeafPageOptimistic(key, Target::KEY, LatchMode::WRITE, nullptr);
+  }
+
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  if (leaf->Lookup(key, nullptr, comparator_)) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    return false;
+  }
+  if (leaf->Insert(key, value, comparator_) < leaf->GetMaxSize()) {
+    if (leaf->GetNextPageId() == INVALID_PAGE_ID) {
+      rightmost_leaf_page_id_ = page->GetPageId();
+    }
+    LogPage(page);
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+    return true;
+  }
+  bool append = leaf->GetNextPageId() == INVALID_PAGE_ID && comparator_(key, leaf->KeyAt(leaf->GetSize() - 1)) == 0;
+  LeafPage *new_leaf = Split(leaf, append);
+  if (new_leaf->GetNextPageId() == INVALID_PAGE_ID) {
+    rightmost_leaf_page_id_ = new_leaf->GetPageId();
+  }
+  KeyType separator = new_leaf->KeyAt(0);
+  if constexpr (IsBinaryComparable<KeyComparator>::value) {
+    separator = KeyComparator::Separator(leaf->KeyAt(leaf->GetSize() - 1), separator);
+  }
+  leaf->SetHighKey(separator);
+  InsertIntoParentBLink(page, separator, new_leaf);
+  return true;
+}
+
+/*
+ * Insert the key pushed up by a split of a B-link tree page into its parent.
+ * @param   old_page      the page that was split, pinned and write-latched
+ * @param   key           the high key of old_page, lowest key of new_node
+ * @param   new_node      right sibling of old_page from Split(), pinned
+ * old_page stays latched while it may be the root, so no other split can make
+ * it a child meanwhile. Otherwise it is released before the parent is
+ * latched: the new page is already reachable through the right link. The
+ * parent id may be stale, but only ever points to a page left of the actual
+ * parent, so the parent is found by moving right by key, and the entry is
+ * inserted by key because splits of new_node may have been pushed up first.
+ * All pages are released on return.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::InsertIntoParentBLink(Page *old_page, const KeyType &key, BPlusTreePage *new_node) {
+  auto *old_node = reinterpret_cast<BPlusTreePage *>(old_page->GetData());
+  if (old_node->IsRootPage()) {
+    InsertIntoParent(old_node, key, new_node);
+    LogPage(old_page);
+    LogPage(new_node);
+    old_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(old_page->GetPageId(), true);
+    buffer_pool_manager_->UnpinPage(new_node->GetPageId(), true);
+    return;
+  }
+  page_id_t parent_page_id = old_node->GetParentPageId();
+  LogPage(old_page);
+  old_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(old_page->GetPageId(), true);
+
+  Page *parent_page = FetchPage(parent_page_id);
+  parent_page->WLatch();
+  parent_page = MoveRight(parent_page, key, LatchMode::WRITE, nullptr);
+  auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+  page_id_t new_page_id = new_node->GetPageId();
+  int size = parent->Insert(key, new_page_id, comparator_);
+  // a split of the parent that moved its children can't have seen this entry
+  new_node->SetParentPageId(parent_page->GetPageId());
+  LogPage(new_node);
+  buffer_pool_manager_->UnpinPage(new_page_id, true);
+  if (size <= parent->GetMaxSize()) {
+    LogPage(parent_page);
+    parent_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
+    return;
+  }
+  bool append = parent->GetNextPageId() == INVALID_PAGE_ID && parent->ValueAt(size - 1) == new_page_id;
+  InternalPage *new_parent = Split(parent, append);
+  parent->SetHighKey(new_parent->KeyAt(0));
+  InsertIntoParentBLink(parent_page, new_parent->KeyAt(0), new_parent);
+}
+
+/*****************************************************************************
+ * BULK LOAD
+ *****************************************************************************/
+/*
+ * Build the tree bottom-up from num_entries key & value pairs that next_entry
+ * produces in ascending key order, without duplicates. Pages are filled to
+ * fill_factor of their max size; only the last pages of a level are adjusted
+ * so that none of them is below min size. Every level keeps only the page it
+ * is filling pinned. The tree becomes visible once it is complete.
+ * If the tree is not empty, the pairs are inserted one by one instead.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BulkLoad(size_t num_entries, const std::function<bool(MappingType *)> &next_entry,
+                              double fill_factor) {
+  MappingType item;
+  root_latch_.WLock();
+  if (root_page_id_ != INVALID_PAGE_ID || num_entries == 0) {
+    root_latch_.WUnlock();
+    while (next_entry(&item)) {
+      Insert(item.first, item.second);
+    }
+    return;
+  }
+
+  // a leaf splits once it is full, an internal page once it overflows
+  auto fill = [fill_factor](int max_size, int min_size, int cap) {
+    return std::clamp(static_cast<int>(fill_factor * max_size), min_size, cap);
+  };
+  int leaf_min_size = leaf_max_size_ / 2;
+  int internal_min_size = (internal_max_size_ + 1) / 2;
+  std::vector<std::vector<int>> page_sizes{BulkLoadPageSizes(
+      num_entries, fill(leaf_max_size_, leaf_min_size, leaf_max_size_ - 1), leaf_min_size, leaf_max_size_ - 1)};
+  while (page_sizes.back().size() > 1) {
+    page_sizes.push_back(BulkLoadPageSizes(page_sizes.back().size(),
+                                           fill(internal_max_size_, internal_min_size, internal_max_size_),
+                                           internal_min_size, internal_max_size_));
+  }
+
+  std::vector<Page *> open_pages(page_sizes.size(), nullptr);
+  std::vector<size_t> page_counts(page_sizes.size(), 0);
+  LeafPage *leaf = nullptr;
+  for (size_t i = 0; i < num_entries; i++) {
+    if (!next_entry(&item)) {
+      throw Exception("bulk load ran out of entries");
+    }
+    if (leaf == nullptr || leaf->GetSize() == page_sizes[0][page_counts[0] - 1]) {
+      leaf = reinterpret_cast<LeafPage *>(
+          BulkLoadNewPage(0, item.first, page_sizes, &open_pages, &page_counts)->GetData());
+    }
+    leaf->Insert(item.first, item.second, comparator_);
+  }
+
+  for (Page *page : open_pages) {
+    LogPage(page);
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+  }
+  root_page_id_ = open_pages.back()->GetPageId();
+  rightmost_leaf_page_id_ = open_pages[0]->GetPageId();
+  UpdateRootPageId(1);
+  root_latch_.WUnlock();
+}
+
+/*
+ * Split num_entries entries of one level into pages of fill entries. The rest
+ * goes into one page if it fits, or else into two pages that are both at least
+ * min_size.
+ * @return : the number of entries of each page
+ */
+INDEX_TEMPLATE_ARGUMENTS
+std::vector<int> BPLUSTREE_TYPE::BulkLoadPageSizes(size_t num_entries, int fill, int min_size, int max_size) {
+  auto n = static_cast<int>(num_entries);
+  if (n <= max_size) {
+    return {n};
+  }
+  std::vector<int> sizes((n - 1) / fill - 1, fill);
+  int rest = n - static_cast<int>(sizes.size()) * fill;
+  if (rest <= max_size) {
+    sizes.push_back(rest);
+  } else if (rest - fill >= min_size) {
+    sizes.push_back(fill);
+    sizes.push_back(rest - fill);
+  } else {
+    sizes.push_back(rest - rest / 2);
+    sizes.push_back(rest / 2);
+  }
+  return sizes;
+}
+
+/*
+ * Start the next page of a level while bulk loading. The page is appended to
+ * the page being filled one level up, which is started first if it is full,
+ * so the new page knows its parent right away. The page it replaces is
+ * unpinned, after being linked to the new one.
+ * @return : the new page, pinned
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::BulkLoadNewPage(size_t level, const KeyType &first_key,
+                                      const std::vector<std::vector<int>> &page_sizes, std::vector<Page *> *open_pages,
+                                      std::vector<size_t> *page_counts) {
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(&page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate new page for bulk load");
+  }
+
+  page_id_t parent_page_id = INVALID_PAGE_ID;
+  if (level + 1 < page_sizes.size()) {
+    Page *parent_page = (*open_pages)[level + 1];
+    if (parent_page == nullptr || reinterpret_cast<InternalPage *>(parent_page->GetData())->GetSize() ==
+                                      page_sizes[level + 1][(*page_counts)[level + 1] - 1]) {
+      parent_page = BulkLoadNewPage(level + 1, first_key, page_sizes, open_pages, page_counts);
+    }
+    auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+    parent->IncreaseSize(1);
+    parent->SetKeyAt(parent->GetSize() - 1, first_key);
+    parent->SetValueAt(parent->GetSize() - 1, page_id);
+    parent_page_id = parent_page->GetPageId();
+  }
+
+  Page *old_page = (*open_pages)[level];
+  if (level == 0) {
+    reinterpret_cast<LeafPage *>(page->GetData())->Init(page_id, parent_page_id, leaf_max_size_);
+    if (old_page != nullptr) {
+      reinterpret_cast<LeafPage *>(old_page->GetData())->SetNextPageId(page_id);
+      reinterpret_cast<LeafPage *>(old_page->GetData())->SetHighKey(first_key);
+    }
+  } else {
+    reinterpret_cast<InternalPage *>(page->GetData())->Init(page_id, parent_page_id, internal_max_size_);
+    if (old_page != nullptr) {
+      reinterpret_cast<InternalPage *>(old_page->GetData())->SetNextPageId(page_id);
+      reinterpret_cast<InternalPage *>(old_page->GetData())->SetHighKey(first_key);
+    }
+  }
+  if (old_page != nullptr) {
+    LogPage(old_page);
+    buffer_pool_manager_->UnpinPage(old_page->GetPageId(), true);
+  }
+  (*open_pages)[level] = page;
+  (*page_counts)[level]++;
+  return page;
+}
 
 /*****************************************************************************
  * REMOVE
@@ -116,19 +540,109 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
  * necessary.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {}
+void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
+  if (mode_ == BPlusTreeMode::B_LINK) {
+    RemoveBLink(key);
+    return;
+  }
+
+  // optimistic pass: only the leaf is write-latched, good enough unless the leaf underflows
+  Page *page = FindLeafPageOptimistic(key, Target::KEY, LatchMode::WRITE, nullptr);
+  if (page == nullptr) {
+    return;
+  }
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  bool exists = leaf->Lookup(key, nullptr, comparator_);
+  bool safe = exists && IsSafe(leaf, Operation::DELETE);
+  if (safe) {
+    leaf->RemoveAndDeleteRecord(key, comparator_);
+    LogPage(page);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), safe);
+  if (!exists || safe) {
+    return;
+  }
+
+  // pessimistic pass
+  Transaction local_transaction(INVALID_TXN_ID);
+  if (transaction == nullptr) {
+    transaction = &local_transaction;
+  }
+  page = FindLeafPageWrite(key, Operation::DELETE, transaction);
+  if (page != nullptr) {
+    leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    int size = leaf->GetSize();
+    if (leaf->RemoveAndDeleteRecord(key, comparator_) < size && leaf->GetSize() < leaf->GetMinSize()) {
+      CoalesceOrRedistribute(leaf, transaction);
+    }
+  }
+  ReleaseLatches(transaction, true);
+  DeletePages(transaction);
+}
+
+/*
+ * Delete key & value pair from a B-link tree. Pages of a B-link tree never
+ * merge, so only the leaf is latched, and an emptied tree keeps its root.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::RemoveBLink(const KeyType &key) {
+  Page *page = FindLeafPageOptimistic(key, Target::KEY, LatchMode::WRITE, nullptr);
+  if (page == nullptr) {
+    return;
+  }
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  int size = leaf->GetSize();
+  bool removed = leaf->RemoveAndDeleteRecord(key, comparator_) < size;
+  if (removed) {
+    LogPage(page);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), removed);
+}
 
 /*
  * User needs to first find the sibling of input page. If sibling's size + input
  * page's size > page's max size, then redistribute. Otherwise, merge.
  * Using template N to represent either internal page or leaf page.
+ * The node and its parent are write-latched in the page set, the sibling is
+ * latched here.
  * @return: true means target leaf page should be deleted, false means no
  * deletion happens
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
 bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
-  return false;
+  if (node->IsRootPage()) {
+    if (AdjustRoot(node)) {
+      transaction->AddIntoDeletedPageSet(node->GetPageId());
+      return true;
+    }
+    return false;
+  }
+
+  Page *parent_page = FetchPage(node->GetParentPageId());
+  auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+  int index = parent->ValueIndex(node->GetPageId());
+  Page *neighbor_page = FetchPage(parent->ValueAt(index == 0 ? 1 : index - 1));
+  neighbor_page->WLatch();
+  auto *neighbor = reinterpret_cast<N *>(neighbor_page->GetData());
+
+  // a leaf splits once it is full, an internal page once it overflows
+  int max_size = node->IsLeafPage() ? node->GetMaxSize() - 1 : node->GetMaxSize();
+  bool node_deleted = false;
+  if (neighbor->GetSize() + node->GetSize() <= max_size) {
+    node_deleted = index != 0;
+    Coalesce(&neighbor, &node, &parent, index, transaction);
+  } else {
+    Redistribute(neighbor, node, index);
+  }
+
+  LogPage(neighbor_page);
+  neighbor_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(neighbor_page->GetPageId(), true);
+  buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
+  return node_deleted;
 }
 
 /*
@@ -137,6 +651,8 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
  * take info of deletion into account. Remember to deal with coalesce or
  * redistribute recursively if necessary.
  * Using template N to represent either internal page or leaf page.
+ * The right page of the two is always merged into the left one, so the leaf
+ * chain only needs the left page's next pointer updated.
  * @param   neighbor_node      sibling page of input "node"
  * @param   node               input from method coalesceOrRedistribute()
  * @param   parent             parent page of input "node"
@@ -148,6 +664,26 @@ template <typename N>
 bool BPLUSTREE_TYPE::Coalesce(N **neighbor_node, N **node,
                               BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> **parent, int index,
                               Transaction *transaction) {
+  if (index == 0) {
+    std::swap(*neighbor_node, *node);
+    index = 1;
+  }
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    (*node)->MoveAllTo(*neighbor_node);
+    // the cached rightmost leaf must move off a page before it is deleted
+    if ((*neighbor_node)->GetNextPageId() == INVALID_PAGE_ID) {
+      rightmost_leaf_page_id_ = (*neighbor_node)->GetPageId();
+    }
+  } else {
+    int size = (*neighbor_node)->GetSize();
+    (*node)->MoveAllTo(*neighbor_node, (*parent)->KeyAt(index), buffer_pool_manager_);
+    LogChildren(*neighbor_node, size, (*neighbor_node)->GetSize());
+  }
+  (*parent)->Remove(index);
+  transaction->AddIntoDeletedPageSet((*node)->GetPageId());
+  if ((*parent)->GetSize() < (*parent)->GetMinSize()) {
+    return CoalesceOrRedistribute(*parent, transaction);
+  }
   return false;
 }
 
@@ -157,12 +693,37 @@ bool BPLUSTREE_TYPE::Coalesce(N **neighbor_node, N **node,
  * otherwise move sibling page's last key & value pair into head of input
  * "node".
  * Using template N to represent either internal page or leaf page.
+ * The high key of the left page of the two becomes the new separator.
  * @param   neighbor_node      sibling page of input "node"
  * @param   node               input from method coalesceOrRedistribute()
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {}
+void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {
+  // the parent is already write-latched in the page set
+  Page *parent_page = FetchPage(node->GetParentPageId());
+  auto *parent = reinterpret_cast<InternalPage *>(parent_page->GetData());
+  if (index == 0) {
+    if constexpr (std::is_same_v<N, LeafPage>) {
+      neighbor_node->MoveFirstToEndOf(node);
+    } else {
+      neighbor_node->MoveFirstToEndOf(node, parent->KeyAt(1), buffer_pool_manager_);
+      LogChildren(node, node->GetSize() - 1, node->GetSize());
+    }
+    parent->SetKeyAt(1, neighbor_node->KeyAt(0));
+    node->SetHighKey(parent->KeyAt(1));
+  } else {
+    if constexpr (std::is_same_v<N, LeafPage>) {
+      neighbor_node->MoveLastToFrontOf(node);
+    } else {
+      neighbor_node->MoveLastToFrontOf(node, parent->KeyAt(index), buffer_pool_manager_);
+      LogChildren(node, 0, 1);
+    }
+    parent->SetKeyAt(index, node->KeyAt(0));
+    neighbor_node->SetHighKey(parent->KeyAt(index));
+  }
+  buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
+}
 /*
  * Update root page if necessary
  * NOTE: size of root page can be less than min size and this method is only
@@ -174,7 +735,28 @@ void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, int index) {}
  * happend
  */
 INDEX_TEMPLATE_ARGUMENTS
-bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) { return false; }
+bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
+  if (old_root_node->IsLeafPage()) {
+    if (old_root_node->GetSize() > 0) {
+      return false;
+    }
+    root_page_id_ = INVALID_PAGE_ID;
+    rightmost_leaf_page_id_ = INVALID_PAGE_ID;
+    UpdateRootPageId(0);
+    return true;
+  }
+  if (old_root_node->GetSize() > 1) {
+    return false;
+  }
+  page_id_t root_page_id = reinterpret_cast<InternalPage *>(old_root_node)->RemoveAndReturnOnlyChild();
+  Page *page = FetchPage(root_page_id);
+  reinterpret_cast<BPlusTreePage *>(page->GetData())->SetParentPageId(INVALID_PAGE_ID);
+  LogPage(page);
+  buffer_pool_manager_->UnpinPage(root_page_id, true);
+  root_page_id_ = root_page_id;
+  UpdateRootPageId(0);
+  return true;
+}
 
 /*****************************************************************************
  * INDEX ITERATOR
@@ -185,7 +767,10 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) { return false; }
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() { return INDEXITERATOR_TYPE(); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() {
+  Page *page = FindLeafPageOptimistic(KeyType(), Target::LEFT_MOST, LatchMode::READ, nullptr);
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, &comparator_, page, 0);
+}
 
 /*
  * Input parameter is low key, find the leaf page that contains the input key
@@ -193,7 +778,14 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() { return INDEXITERATOR_TYPE(); }
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) { return INDEXITERATOR_TYPE(); }
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
+  Page *page = FindLeafPageOptimistic(key, Target::KEY, LatchMode::READ, nullptr);
+  if (page == nullptr) {
+    return INDEXITERATOR_TYPE();
+  }
+  int index = reinterpret_cast<LeafPage *>(page->GetData())->KeyIndex(key, comparator_);
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, &comparator_, page, index);
+}
 
 /*
  * Input parameter is void, construct an index iterator representing the end
@@ -203,16 +795,422 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) { return INDEXITERA
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_TYPE::End() { return INDEXITERATOR_TYPE(); }
 
+/*
+ * Input parameter is void, find the right most leaf page first, then construct
+ * a reverse index iterator starting at its last entry
+ * @return : index iterator
+ */
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::RBegin() {
+  std::optional<KeyType> low_key;
+  Page *page = FindLeafPageOptimistic(KeyType(), Target::RIGHT_MOST, LatchMode::READ, nullptr, &low_key);
+  int index = page == nullptr ? 0 : reinterpret_cast<LeafPage *>(page->GetData())->GetSize() - 1;
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, page, index, low_key,
+                            [this](const KeyType &fence, std::optional<KeyType> *prev_fence, int *prev_index) {
+                              return FindPrevLeafPage(fence, prev_fence, prev_index);
+                            });
+}
+
+/*
+ * Input parameter is high key, find the leaf page that contains the input key
+ * first, then construct a reverse index iterator starting at the greatest key
+ * not above it
+ * @return : index iterator
+ */
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::RBegin(const KeyType &key) {
+  std::optional<KeyType> low_key;
+  Page *page = FindLeafPageOptimistic(key, Target::KEY, LatchMode::READ, nullptr, &low_key);
+  int index = 0;
+  if (page != nullptr) {
+    auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+    index = leaf->KeyIndex(key, comparator_);
+    if (index == leaf->GetSize() || comparator_(leaf->KeyAt(index), key) != 0) {
+      index--;
+    }
+  }
+  return INDEXITERATOR_TYPE(buffer_pool_manager_, page, index, low_key,
+                            [this](const KeyType &fence, std::optional<KeyType> *prev_fence, int *prev_index) {
+                              return FindPrevLeafPage(fence, prev_fence, prev_index);
+                            });
+}
+
 /*****************************************************************************
  * UTILITIES AND DEBUG
  *****************************************************************************/
 /*
  * Find leaf page containing particular key, if leftMost flag == true, find
  * the left most leaf page
+ * The page is returned pinned but not latched.
  */
 INDEX_TEMPLATE_ARGUMENTS
 Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
-  throw Exception(ExceptionType::NOT_IMPLEMENTED, "Implement this for test");
+  Page *page = FindLeafPageOptimistic(key, leftMost ? Target::LEFT_MOST : Target::KEY, LatchMode::READ, nullptr);
+  if (page != nullptr) {
+    page->RUnlatch();
+  }
+  return page;
+}
+
+/*
+ * Fetch a page, throwing an "out of memory" exception if the buffer pool is
+ * full
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FetchPage(page_id_t page_id) {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch b+ tree page");
+  }
+  return page;
+}
+
+/*
+ * Wait until no writer holds the page and return its version
+ */
+INDEX_TEMPLATE_ARGUMENTS
+uint64_t BPLUSTREE_TYPE::ReadVersion(Page *page) const {
+  uint64_t version = page->GetVersion();
+  while ((version & 1) != 0) {
+    std::this_thread::yield();
+    version = page->GetVersion();
+  }
+  return version;
+}
+
+/*
+ * Descend to the leaf page with optimistic lock coupling. A page is only
+ * pinned, never latched: its child pointer is used once the page version
+ * shows that no writer touched it meanwhile, and it is validated again after
+ * the child's version was taken, so the child was still linked at that point.
+ * Pinned pages cannot be evicted, and page ids are never reused, so a stale
+ * read at worst sees a deleted page and fails validation. Any failed check
+ * restarts from the root.
+ * The leaf is latched in leaf_mode, or read optimistically as well, in which
+ * case its version is stored in leaf_version for the caller to validate.
+ * In B_LINK mode pages are never deleted, so a child needn't still be linked
+ * to its parent: the search moves right instead if the child has split.
+ * If low_key is given, it is set to the low fence of the leaf, the lowest key
+ * that belongs to it, or nullopt for the left most leaf.
+ * @return : the leaf page, pinned (and latched), or nullptr if the tree is empty
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPageOptimistic(const KeyType &key, Target target, LatchMode leaf_mode,
+                                             uint64_t *leaf_version, std::optional<KeyType> *low_key) {
+  // latch the leaf, or take its version, and check that it is still linked in
+  auto enter_leaf = [this, leaf_mode, leaf_version](Page *page, Page *parent, uint64_t parent_version,
+                                                     page_id_t root_page_id) {
+    if (leaf_mode == LatchMode::READ) {
+      page->RLatch();
+    } else if (leaf_mode == LatchMode::WRITE) {
+      page->WLatch();
+    } else {
+      *leaf_version = ReadVersion(page);
+    }
+    bool linked = mode_ == BPlusTreeMode::B_LINK ||
+                  (parent == nullptr ? root_page_id_ == root_page_id : parent->ValidateVersion(parent_version));
+    if (!linked) {
+      if (leaf_mode == LatchMode::READ) {
+        page->RUnlatch();
+      } else if (leaf_mode == LatchMode::WRITE) {
+        page->WUnlatch();
+      }
+    }
+    return linked;
+  };
+
+  auto child_index = [this, &key, target](InternalPage *internal) {
+    switch (target) {
+      case Target::KEY:
+        return internal->LookupIndex(key, comparator_);
+      case Target::BEFORE_KEY:
+        return internal->LookupIndex(key, comparator_, true);
+      case Target::LEFT_MOST:
+        return 0;
+      default:
+        return std::max(internal->GetSize() - 1, 0);
+    }
+  };
+
+  // in B_LINK mode, a page the key moved away from is left through its right link
+  bool move_right = mode_ == BPlusTreeMode::B_LINK && target != Target::LEFT_MOST;
+  // the low fence of the current page is the last separator left of the path to it
+  std::optional<KeyType> fence;
+  std::optional<KeyType> *fence_out = low_key == nullptr ? nullptr : &fence;
+
+  while (true) {
+    fence.reset();
+    page_id_t root_page_id = root_page_id_;
+    if (root_page_id == INVALID_PAGE_ID) {
+      return nullptr;
+    }
+    Page *page = FetchPage(root_page_id);
+    auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (node->IsLeafPage()) {
+      if (!enter_leaf(page, nullptr, 0, root_page_id)) {
+        buffer_pool_manager_->UnpinPage(root_page_id, false);
+        continue;
+      }
+      if (move_right && (page = MoveRight(page, key, leaf_mode, leaf_version, target, fence_out)) == nullptr) {
+        continue;
+      }
+      if (low_key != nullptr) {
+        *low_key = fence;
+      }
+      return page;
+    }
+    uint64_t version = ReadVersion(page);
+    if (root_page_id_ != root_page_id) {
+      buffer_pool_manager_->UnpinPage(root_page_id, false);
+      continue;
+    }
+
+    while (true) {
+      if (move_right && (page = MoveRight(page, key, LatchMode::OPTIMISTIC, &version, target, fence_out)) == nullptr) {
+        break;
+      }
+      auto *internal = reinterpret_cast<InternalPage *>(page->GetData());
+      int index = child_index(internal);
+      page_id_t child_page_id = internal->ValueAt(index);
+      std::optional<KeyType> separator;
+      if (low_key != nullptr && index > 0) {
+        separator = internal->KeyAt(index);
+      }
+      if (!page->ValidateVersion(version)) {
+        break;
+      }
+      if (separator.has_value()) {
+        fence = separator;
+      }
+      Page *child_page = FetchPage(child_page_id);
+      auto *child = reinterpret_cast<BPlusTreePage *>(child_page->GetData());
+      if (child->IsLeafPage()) {
+        bool linked = enter_leaf(child_page, page, version, INVALID_PAGE_ID);
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+        page = child_page;
+        if (!linked) {
+          break;
+        }
+        if (move_right && (page = MoveRight(page, key, leaf_mode, leaf_version, target, fence_out)) == nullptr) {
+          break;
+        }
+        if (low_key != nullptr) {
+          *low_key = fence;
+        }
+        return page;
+      }
+      uint64_t child_version = ReadVersion(child_page);
+      bool linked = page->ValidateVersion(version);
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      page = child_page;
+      if (!linked) {
+        break;
+      }
+      version = child_version;
+    }
+    if (page != nullptr) {
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    }
+  }
+}
+
+/*
+ * Find the leaf page holding the greatest keys below key, for reverse scans
+ * @param low_key : set to the low fence of the leaf, see FindLeafPageOptimistic()
+ * @param index : set to the position of the last entry below key
+ * @return : the leaf page, pinned and read-latched, or nullptr if the tree is empty
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindPrevLeafPage(const KeyType &key, std::optional<KeyType> *low_key, int *index) {
+  Page *page = FindLeafPageOptimistic(key, Target::BEFORE_KEY, LatchMode::READ, nullptr, low_key);
+  if (page != nullptr) {
+    *index = reinterpret_cast<LeafPage *>(page->GetData())->KeyIndex(key, comparator_) - 1;
+  }
+  return page;
+}
+
+/*
+ * In B_LINK mode, the right sibling to move to if the target is not on node:
+ * key is not below the high key of node (BEFORE_KEY: above it), or node is not
+ * the right most page of its level. Only exists if node has a right sibling.
+ * @param high_key : set to the high key of node when moving right
+ * @return : the right sibling's page id, or INVALID_PAGE_ID if the target is on node
+ */
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t BPLUSTREE_TYPE::RightLink(BPlusTreePage *node, const KeyType &key, Target target,
+                                    KeyType *high_key) const {
+  page_id_t next_page_id;
+  KeyType high;
+  if (node->IsLeafPage()) {
+    auto *leaf = reinterpret_cast<LeafPage *>(node);
+    next_page_id = leaf->GetNextPageId();
+    high = leaf->GetHighKey();
+  } else {
+    auto *internal = reinterpret_cast<InternalPage *>(node);
+    next_page_id = internal->GetNextPageId();
+    high = internal->GetHighKey();
+  }
+  if (next_page_id == INVALID_PAGE_ID || target == Target::LEFT_MOST) {
+    return INVALID_PAGE_ID;
+  }
+  bool right = target == Target::RIGHT_MOST ||
+               (target == Target::BEFORE_KEY ? comparator_(key, high) > 0 : comparator_(key, high) >= 0);
+  if (!right) {
+    return INVALID_PAGE_ID;
+  }
+  if (high_key != nullptr) {
+    *high_key = high;
+  }
+  return next_page_id;
+}
+
+/*
+ * Follow the right links from page until it holds the target. Latched
+ * pages are coupled left to right, the next page is latched in mode before
+ * the current one is released. An optimistically read page is validated
+ * before its right link is followed, and version is updated to the version
+ * of the page that is returned. If low_key is given, it is set to the high
+ * key of the page that was left, the low fence of its right sibling.
+ * @return : the page holding the target, pinned (and latched), or nullptr if
+ * an optimistic read failed validation, in which case nothing stays pinned
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::MoveRight(Page *page, const KeyType &key, LatchMode mode, uint64_t *version, Target target,
+                                std::optional<KeyType> *low_key) {
+  KeyType high_key;
+  while (true) {
+    page_id_t next_page_id = RightLink(reinterpret_cast<BPlusTreePage *>(page->GetData()), key, target, &high_key);
+    if (mode == LatchMode::OPTIMISTIC && !page->ValidateVersion(*version)) {
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      return nullptr;
+    }
+    if (next_page_id == INVALID_PAGE_ID) {
+      return page;
+    }
+    if (low_key != nullptr) {
+      *low_key = high_key;
+    }
+    Page *next_page = FetchPage(next_page_id);
+    if (mode == LatchMode::READ) {
+      next_page->RLatch();
+      page->RUnlatch();
+    } else if (mode == LatchMode::WRITE) {
+      next_page->WLatch();
+      page->WUnlatch();
+    } else {
+      *version = ReadVersion(next_page);
+    }
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    page = next_page;
+  }
+}
+
+/*
+ * Crab down to the leaf page with write latches. Every latched page is pushed
+ * into the transaction's page set, and whenever a page is safe for the
+ * operation all latches above it are released.
+ * @return : the leaf page, or nullptr if the tree is empty. Either way the
+ * caller must call ReleaseLatches()
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPageWrite(const KeyType &key, Operation op, Transaction *transaction) {
+  root_latch_.WLock();
+  transaction->AddIntoPageSet(nullptr);
+  if (root_page_id_ == INVALID_PAGE_ID) {
+    return nullptr;
+  }
+  Page *page = FetchPage(root_page_id_);
+  page->WLatch();
+  auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+  if (IsSafe(node, op)) {
+    ReleaseLatches(transaction, false);
+  }
+  transaction->AddIntoPageSet(page);
+
+  while (!node->IsLeafPage()) {
+    auto *internal = reinterpret_cast<InternalPage *>(node);
+    page = FetchPage(internal->Lookup(key, comparator_));
+    page->WLatch();
+    node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (IsSafe(node, op)) {
+      ReleaseLatches(transaction, false);
+    }
+    transaction->AddIntoPageSet(page);
+  }
+  return page;
+}
+
+/*
+ * Fast path for appends: write-latch the cached rightmost leaf if key goes
+ * past its last key. The cache is only changed with the rightmost leaf
+ * latched, and before that leaf can be deleted by a merge, so the page is
+ * still in the tree if the cache still points to it once it is latched.
+ * @return : the rightmost leaf, pinned and write-latched, or nullptr if the
+ * key is not an append
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindRightmostLeafPage(const KeyType &key) {
+  page_id_t page_id = rightmost_leaf_page_id_;
+  if (page_id == INVALID_PAGE_ID) {
+    return nullptr;
+  }
+  Page *page = FetchPage(page_id);
+  page->WLatch();
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  if (rightmost_leaf_page_id_ == page_id && leaf->GetNextPageId() == INVALID_PAGE_ID && leaf->GetSize() > 0 &&
+      comparator_(key, leaf->KeyAt(leaf->GetSize() - 1)) > 0) {
+    return page;
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, false);
+  return nullptr;
+}
+
+/*
+ * A page is safe if the operation cannot make it split or merge, so nothing
+ * above it can change
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::IsSafe(BPlusTreePage *node, Operation op) const {
+  if (op == Operation::INSERT) {
+    return node->IsLeafPage() ? node->GetSize() + 1 < node->GetMaxSize() : node->GetSize() < node->GetMaxSize();
+  }
+  return node->GetSize() > node->GetMinSize();
+}
+
+/*
+ * Release all write latches held in the transaction's page set, including
+ * the root latch
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReleaseLatches(Transaction *transaction, bool dirty) {
+  auto page_set = transaction->GetPageSet();
+  while (!page_set->empty()) {
+    Page *page = page_set->front();
+    page_set->pop_front();
+    if (page == nullptr) {
+      root_latch_.WUnlock();
+    } else {
+      if (dirty) {
+        LogPage(page);
+      }
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), dirty);
+    }
+  }
+}
+
+/*
+ * Delete the pages emptied by merges. This happens after all latches are
+ * released: no other thread can reach these pages anymore.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::DeletePages(Transaction *transaction) {
+  auto deleted_page_set = transaction->GetDeletedPageSet();
+  for (page_id_t page_id : *deleted_page_set) {
+    buffer_pool_manager_->DeletePage(page_id);
+  }
+  deleted_page_set->clear();
 }
 
 /*
@@ -225,15 +1223,58 @@ Page *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, bool leftMost) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
-  HeaderPage *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
-  if (insert_record != 0) {
-    // create a new record<index_name + root_page_id> in header_page
-    header_page->InsertRecord(index_name_, root_page_id_);
-  } else {
+  Page *page = buffer_pool_manager_->FetchPage(header_page_id_);
+  HeaderPage *header_page = static_cast<HeaderPage *>(page);
+  page->WLatch();
+  // create a new record<index_name + root_page_id> in header_page, or update
+  // it if the tree was emptied and is started again
+  if (insert_record == 0 || !header_page->InsertRecord(index_name_, root_page_id_)) {
     // update root_page_id in header_page
     header_page->UpdateRecord(index_name_, root_page_id_);
   }
-  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+  LogPage(page);
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(header_page_id_, true);
+}
+
+/*
+ * Log an after-image of a page, which redo copies back over the page. The
+ * caller has it write-latched, or nobody else can reach it yet.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LogPage(Page *page) {
+  if (!IsLogging()) {
+    return;
+  }
+  LogRecord log_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::INDEX_PAGE_IMAGE, page->GetPageId(),
+                       page->GetData());
+  page->SetLSN(log_manager_->AppendLogRecord(&log_record));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LogPage(BPlusTreePage *node) {
+  if (!IsLogging()) {
+    return;
+  }
+  Page *page = FetchPage(node->GetPageId());
+  LogPage(page);
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+}
+
+/*
+ * Moving entries of an internal page makes the moved children adopt their new
+ * parent, see BPlusTreeInternalPage::Adopt(), which changes them as well.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::LogChildren(InternalPage *node, int begin, int end) {
+  if (!IsLogging()) {
+    return;
+  }
+  for (int i = begin; i < end; i++) {
+    Page *page = FetchPage(node->ValueAt(i));
+    LogPage(page);
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  }
 }
 
 /*
@@ -401,4 +1442,10 @@ template class BPlusTree<GenericKey<16>, RID, GenericComparator<16>>;
 template class BPlusTree<GenericKey<32>, RID, GenericComparator<32>>;
 template class BPlusTree<GenericKey<64>, RID, GenericComparator<64>>;
 
+template class BPlusTree<NormalizedKey<4>, RID, NormalizedComparator<4>>;
+template class BPlusTree<NormalizedKey<8>, RID, NormalizedComparator<8>>;
+template class BPlusTree<NormalizedKey<16>, RID, NormalizedComparator<16>>;
+template class BPlusTree<NormalizedKey<32>, RID, NormalizedComparator<32>>;
+template class BPlusTree<NormalizedKey<64>, RID, NormalizedComparator<64>>;
+
 }  // namespace bustub
@@ -9,23 +9,80 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <optional>
+#include <utility>
+
+#include "common/util/external_sorter.h"
 #include "storage/index/b_plus_tree_index.h"
 
 namespace bustub {
+
+/*
+ * Iterates over a B+ tree from a bound until the other one is passed.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+class BPlusTreeIndexScanIterator : public IndexScanIterator {
+ public:
+  BPlusTreeIndexScanIterator(INDEXITERATOR_TYPE iterator, std::optional<KeyType> stop_key, bool reverse,
+                             const KeyComparator *comparator, Schema *key_schema)
+      : iterator_(std::move(iterator)),
+        stop_key_(std::move(stop_key)),
+        reverse_(reverse),
+        comparator_(comparator),
+        key_schema_(key_schema) {}
+
+  bool Next(Tuple *key, RID *rid) override {
+    if (iterator_.IsEnd()) {
+      return false;
+    }
+    const MappingType &entry = *iterator_;
+    if (stop_key_.has_value()) {
+      int cmp = (*comparator_)(entry.first, *stop_key_);
+      if (reverse_ ? cmp < 0 : cmp > 0) {
+        // let go of the leaf page right away
+        iterator_ = INDEXITERATOR_TYPE();
+        return false;
+      }
+    }
+    if (key_schema_ != nullptr) {
+      std::vector<Value> values;
+      values.reserve(key_schema_->GetColumnCount());
+      for (uint32_t i = 0; i < key_schema_->GetColumnCount(); i++) {
+        values.push_back(entry.first.ToValue(key_schema_, i));
+      }
+      *key = Tuple(values, key_schema_);
+    }
+    *rid = entry.second;
+    ++iterator_;
+    return true;
+  }
+
+ private:
+  INDEXITERATOR_TYPE iterator_;
+  // the bound the scan ends at
+  std::optional<KeyType> stop_key_;
+  bool reverse_;
+  const KeyComparator *comparator_;
+  // the key schema if keys are returned
+  Schema *key_schema_;
+};
+
 /*
  * Constructor
  */
 INDEX_TEMPLATE_ARGUMENTS
-BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager)
+BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
+                                     page_id_t header_page_id, LogManager *log_manager)
     : Index(std::move(metadata)),
       comparator_(GetMetadata()->GetKeySchema()),
-      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_) {}
+      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, LEAF_PAGE_SIZE, INTERNAL_PAGE_SIZE,
+                 BPlusTreeMode::CRABBING, header_page_id, log_manager) {}
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct insert index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetMetadata()->GetKeySchema());
 
   container_.Insert(index_key, rid, transaction);
 }
@@ -34,7 +91,7 @@ INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct delete index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetMetadata()->GetKeySchema());
 
   container_.Remove(index_key, transaction);
 }
@@ -43,11 +100,29 @@ INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
   // construct scan index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, GetMetadata()->GetKeySchema());
 
   container_.GetValue(index_key, result, transaction);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::BulkInsertEntries(const std::function<bool(Tuple *key, RID *rid)> &next_entry,
+                                             Transaction *transaction) {
+  auto less = [this](const MappingType &a, const MappingType &b) { return comparator_(a.first, b.first) < 0; };
+  // the tree holds unique keys, so only the first RID of a key is kept
+  ExternalSorter<MappingType, decltype(less)> sorter(less, true);
+  Tuple key;
+  RID rid;
+  while (next_entry(&key, &rid)) {
+    KeyType index_key;
+    index_key.SetFromKey(key, GetMetadata()->GetKeySchema());
+    sorter.Add({index_key, rid});
+  }
+  sorter.Sort();
+  container_.BulkLoad(
+      sorter.Size(), [&sorter](MappingType *entry) { return sorter.Next(entry); }, fill_factor_);
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator() { return container_.Begin(); }
 
@@ -57,10 +132,49 @@ INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator(const KeyType &key) {
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetEndIterator() { return container_.End(); }
 
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetReverseBeginIterator() { return container_.RBegin(); }
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetReverseBeginIterator(const KeyType &key) { return container_.RBegin(key); }
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_INDEX_TYPE::ReturnsKeys() const {
+  Schema *key_schema = GetKeySchema();
+  return key_schema->IsInlined() && key_schema->GetLength() <= sizeof(KeyType);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+std::unique_ptr<IndexScanIterator> BPLUSTREE_INDEX_TYPE::ScanRange(const Tuple *low_key, const Tuple *high_key,
+                                                                   bool reverse, Transaction * /* transaction */) {
+  std::optional<KeyType> low;
+  std::optional<KeyType> high;
+  if (low_key != nullptr) {
+    low.emplace().SetFromKey(*low_key, GetKeySchema());
+  }
+  if (high_key != nullptr) {
+    high.emplace().SetFromKey(*high_key, GetKeySchema());
+  }
+  INDEXITERATOR_TYPE iterator;
+  if (reverse) {
+    iterator = high.has_value() ? container_.RBegin(*high) : container_.RBegin();
+  } else {
+    iterator = low.has_value() ? container_.Begin(*low) : container_.Begin();
+  }
+  return std::make_unique<BPlusTreeIndexScanIterator<KeyType, ValueType, KeyComparator>>(
+      std::move(iterator), reverse ? low : high, reverse, &comparator_, ReturnsKeys() ? GetKeySchema() : nullptr);
+}
+
 template class BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>>;
 template class BPlusTreeIndex<GenericKey<32>, RID, GenericComparator<32>>;
 template class BPlusTreeIndex<GenericKey<64>, RID, GenericComparator<64>>;
 
+template class BPlusTreeIndex<NormalizedKey<4>, RID, NormalizedComparator<4>>;
+template class BPlusTreeIndex<NormalizedKey<8>, RID, NormalizedComparator<8>>;
+template class BPlusTreeIndex<NormalizedKey<16>, RID, NormalizedComparator<16>>;
+template class BPlusTreeIndex<NormalizedKey<32>, RID, NormalizedComparator<32>>;
+template class BPlusTreeIndex<NormalizedKey<64>, RID, NormalizedComparator<64>>;
+
 }  // namespace bustub
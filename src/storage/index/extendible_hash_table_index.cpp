@@ -1,3 +1,4 @@
+#include <utility>
 #include <vector>
 
 #include "storage/index/extendible_hash_table_index.h"
@@ -9,10 +10,13 @@ namespace bustub {
 template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_INDEX_TYPE::ExtendibleHashTableIndex(std::unique_ptr<IndexMetadata> &&metadata,
                                                 BufferPoolManager *buffer_pool_manager,
-                                                const HashFunction<KeyType> &hash_fn)
+                                                const HashFunction<KeyType> &hash_fn, LogManager *log_manager)
     : Index(std::move(metadata)),
       comparator_(GetMetadata()->GetKeySchema()),
-      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, hash_fn) {}
+      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, hash_fn, log_manager) {
+  // deletes do not wait for buckets to merge
+  container_.StartBackgroundMerge();
+}
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
@@ -40,6 +44,30 @@ void HASH_TABLE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result,
 
   container_.GetValue(transaction, index_key, result);
 }
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_INDEX_TYPE::ScanKeys(const std::vector<Tuple> &keys, std::vector<std::vector<RID>> *results,
+                                     Transaction *transaction) {
+  std::vector<KeyType> index_keys(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    index_keys[i].SetFromKey(keys[i]);
+  }
+  container_.GetValues(transaction, index_keys, results);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_INDEX_TYPE::BulkInsertEntries(const std::function<bool(Tuple *key, RID *rid)> &next_entry,
+                                              Transaction *transaction) {
+  std::vector<std::pair<KeyType, ValueType>> entries;
+  Tuple key;
+  RID rid;
+  while (next_entry(&key, &rid)) {
+    KeyType index_key;
+    index_key.SetFromKey(key);
+    entries.emplace_back(index_key, rid);
+  }
+  container_.BulkInsert(transaction, entries);
+}
 template class ExtendibleHashTableIndex<GenericKey<4>, RID, GenericComparator<4>>;
 template class ExtendibleHashTableIndex<GenericKey<8>, RID, GenericComparator<8>>;
 template class ExtendibleHashTableIndex<GenericKey<16>, RID, GenericComparator<16>>;
@@ -1,30 +1,176 @@
 /**
  * index_iterator.cpp
  */
+#include <algorithm>
 #include <cassert>
+#include <utility>
 
+#include "common/exception.h"
 #include "storage/index/index_iterator.h"
 
 namespace bustub {
 
 /*
- * NOTE: you can change the destructor/constructor method here
- * set your own input parameters
+ * The iterator copies the entries of a leaf page while it is read-latched and
+ * lets go of the latch right away, so no latch is held between steps and the
+ * caller may do anything while it iterates.
+ * A forward iterator keeps the current leaf pinned. It moves to the next leaf
+ * by latching the current one again and pinning the next before letting go of
+ * the current one, so the next leaf cannot be deleted in between, and only
+ * latches it afterwards, so it never holds two latches at once. The current
+ * leaf may have split meanwhile, so entries that were already returned are
+ * skipped. Once a leaf is copied the one after it is prefetched.
+ * Leaf pages have no left links, so a reverse iterator finds the previous
+ * leaf from the root, as the leaf holding the greatest keys below the low
+ * fence of the current one. Fences only decrease, so it never returns an
+ * entry twice.
  */
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::IndexIterator() = default;
+INDEXITERATOR_TYPE::IndexIterator(BufferPoolManager *buffer_pool_manager, const KeyComparator *comparator, Page *page,
+                                  int index)
+    : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), page_(page) {
+  if (page_ != nullptr) {
+    Load(page_, index);
+    page_->RUnlatch();
+  }
+  SkipExhaustedPages();
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::~IndexIterator() = default;
+INDEXITERATOR_TYPE::IndexIterator(BufferPoolManager *buffer_pool_manager, Page *page, int index,
+                                  std::optional<KeyType> low_key, FindPrevLeaf find_prev_leaf)
+    : buffer_pool_manager_(buffer_pool_manager),
+      low_key_(std::move(low_key)),
+      find_prev_leaf_(std::move(find_prev_leaf)) {
+  if (page == nullptr) {
+    low_key_.reset();
+  } else {
+    Load(page, index);
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  }
+  SkipExhaustedPages();
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-bool INDEXITERATOR_TYPE::IsEnd() { throw std::runtime_error("unimplemented"); }
+INDEXITERATOR_TYPE::~IndexIterator() { Release(); }
 
 INDEX_TEMPLATE_ARGUMENTS
-const MappingType &INDEXITERATOR_TYPE::operator*() { throw std::runtime_error("unimplemented"); }
+INDEXITERATOR_TYPE::IndexIterator(IndexIterator &&other) noexcept { *this = std::move(other); }
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() { throw std::runtime_error("unimplemented"); }
+INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator=(IndexIterator &&other) noexcept {
+  if (this != &other) {
+    Release();
+    buffer_pool_manager_ = other.buffer_pool_manager_;
+    comparator_ = other.comparator_;
+    page_ = std::exchange(other.page_, nullptr);
+    page_id_ = std::exchange(other.page_id_, INVALID_PAGE_ID);
+    entries_ = std::move(other.entries_);
+    index_ = std::exchange(other.index_, 0);
+    last_key_ = std::move(other.last_key_);
+    low_key_ = std::move(other.low_key_);
+    find_prev_leaf_ = std::move(other.find_prev_leaf_);
+    other.entries_.clear();
+    other.low_key_.reset();
+  }
+  return *this;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool INDEXITERATOR_TYPE::IsEnd() { return page_id_ == INVALID_PAGE_ID; }
+
+INDEX_TEMPLATE_ARGUMENTS
+const MappingType &INDEXITERATOR_TYPE::operator*() { return entries_[index_]; }
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() {
+  index_++;
+  SkipExhaustedPages();
+  return *this;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Load(Page *page, int index) {
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  page_id_ = page->GetPageId();
+  entries_.clear();
+  index_ = 0;
+  if (find_prev_leaf_) {
+    for (int i = std::min(index, leaf->GetSize() - 1); i >= 0; i--) {
+      entries_.push_back(leaf->GetItem(i));
+    }
+    return;
+  }
+  for (int i = std::max(index, 0); i < leaf->GetSize(); i++) {
+    if (!last_key_.has_value() || (*comparator_)(leaf->KeyAt(i), *last_key_) > 0) {
+      entries_.push_back(leaf->GetItem(i));
+    }
+  }
+  if (leaf->GetNextPageId() != INVALID_PAGE_ID) {
+    buffer_pool_manager_->PrefetchPage(leaf->GetNextPageId());
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SkipExhaustedPages() {
+  while (index_ >= static_cast<int>(entries_.size())) {
+    if (find_prev_leaf_) {
+      if (!low_key_.has_value()) {
+        Release();
+        return;
+      }
+      KeyType fence = *low_key_;
+      int index = -1;
+      Page *page = find_prev_leaf_(fence, &low_key_, &index);
+      if (page == nullptr) {
+        Release();
+        return;
+      }
+      Load(page, index);
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      continue;
+    }
+
+    if (page_ == nullptr) {
+      Release();
+      return;
+    }
+    if (!entries_.empty()) {
+      last_key_ = entries_.back().first;
+    }
+    page_->RLatch();
+    page_id_t next_page_id = reinterpret_cast<LeafPage *>(page_->GetData())->GetNextPageId();
+    Page *next_page = nullptr;
+    if (next_page_id != INVALID_PAGE_ID) {
+      next_page = buffer_pool_manager_->FetchPage(next_page_id);
+    }
+    page_->RUnlatch();
+    if (next_page_id != INVALID_PAGE_ID && next_page == nullptr) {
+      Release();
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch next leaf page");
+    }
+    Release();
+    page_ = next_page;
+    if (page_ != nullptr) {
+      page_->RLatch();
+      Load(page_, 0);
+      page_->RUnlatch();
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Release() {
+  if (page_ != nullptr) {
+    buffer_pool_manager_->UnpinPage(page_->GetPageId(), false);
+    page_ = nullptr;
+  }
+  page_id_ = INVALID_PAGE_ID;
+  entries_.clear();
+  index_ = 0;
+}
 
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
 
@@ -36,4 +182,10 @@ template class IndexIterator<GenericKey<32>, RID, GenericComparator<32>>;
 
 template class IndexIterator<GenericKey<64>, RID, GenericComparator<64>>;
 
+template class IndexIterator<NormalizedKey<4>, RID, NormalizedComparator<4>>;
+template class IndexIterator<NormalizedKey<8>, RID, NormalizedComparator<8>>;
+template class IndexIterator<NormalizedKey<16>, RID, NormalizedComparator<16>>;
+template class IndexIterator<NormalizedKey<32>, RID, NormalizedComparator<32>>;
+template class IndexIterator<NormalizedKey<64>, RID, NormalizedComparator<64>>;
+
 }  // namespace bustub
@@ -0,0 +1,481 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// varlen_b_plus_tree.cpp
+//
+// Identification: src/storage/index/varlen_b_plus_tree.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "common/exception.h"
+#include "common/macros.h"
+#include "storage/index/varlen_b_plus_tree.h"
+#include "storage/page/header_page.h"
+
+namespace bustub {
+
+VarlenBPlusTree::VarlenBPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, page_id_t header_page_id)
+    : index_name_(std::move(name)),
+      root_page_id_(INVALID_PAGE_ID),
+      buffer_pool_manager_(buffer_pool_manager),
+      header_page_id_(header_page_id) {}
+
+/*
+ * Helper function to decide whether current b+tree is empty
+ */
+bool VarlenBPlusTree::IsEmpty() const { return root_page_id_ == INVALID_PAGE_ID; }
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+/*
+ * Return the only value that associated with input key
+ * This method is used for point query
+ * @return : true means key exists
+ */
+bool VarlenBPlusTree::GetValue(const std::string &key, std::vector<RID> *result) {
+  Page *page = FindLeafPage(Target::KEY, &key, false);
+  if (page == nullptr) {
+    return false;
+  }
+  auto *leaf = reinterpret_cast<BPlusTreeSlottedPage *>(page->GetData());
+  int index = leaf->LowerBound(key, buffer_pool_manager_);
+  bool found = index < leaf->GetSize() && leaf->Compare(key, index, buffer_pool_manager_) == 0;
+  if (found) {
+    result->push_back(leaf->RidAt(index));
+  }
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  return found;
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+/*
+ * Insert constant key & value pair into b+ tree
+ * @return: since we only support unique key, if user try to insert duplicate
+ * keys return false, otherwise return true.
+ */
+bool VarlenBPlusTree::Insert(const std::string &key, const RID &value) {
+  // optimistic pass: only the leaf is write-latched, good enough unless the leaf splits
+  Page *page = FindLeafPage(Target::KEY, &key, true);
+  if (page == nullptr) {
+    return InsertPessimistic(key, value);
+  }
+  auto *leaf = reinterpret_cast<BPlusTreeSlottedPage *>(page->GetData());
+  int index = leaf->LowerBound(key, buffer_pool_manager_);
+  bool exists = index < leaf->GetSize() && leaf->Compare(key, index, buffer_pool_manager_) == 0;
+  bool safe = !exists && leaf->HasRoomFor(key.size());
+  if (safe) {
+    leaf->InsertLeaf(index, key, value, buffer_pool_manager_);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), safe);
+  if (exists || safe) {
+    return safe;
+  }
+  return InsertPessimistic(key, value);
+}
+
+/*
+ * Insert with the path from the last safe page down to the leaf
+ * write-latched, splitting the leaf and as many of its ancestors as needed
+ */
+bool VarlenBPlusTree::InsertPessimistic(const std::string &key, const RID &value) {
+  std::vector<Page *> path;
+  Page *page = FindLeafPageWrite(key, &path);
+  if (page == nullptr) {
+    // start a new tree
+    Page *root_page = NewPage(0);
+    reinterpret_cast<BPlusTreeSlottedPage *>(root_page->GetData())->InsertLeaf(0, key, value, buffer_pool_manager_);
+    root_page_id_ = root_page->GetPageId();
+    buffer_pool_manager_->UnpinPage(root_page->GetPageId(), true);
+    UpdateRootPageId(1);
+    ReleasePath(&path, false);
+    return true;
+  }
+
+  auto *leaf = reinterpret_cast<BPlusTreeSlottedPage *>(page->GetData());
+  int index = leaf->LowerBound(key, buffer_pool_manager_);
+  if (index < leaf->GetSize() && leaf->Compare(key, index, buffer_pool_manager_) == 0) {
+    ReleasePath(&path, false);
+    return false;
+  }
+  if (leaf->HasRoomFor(key.size())) {
+    leaf->InsertLeaf(index, key, value, buffer_pool_manager_);
+    ReleasePath(&path, true);
+    return true;
+  }
+
+  // split, an append to the last leaf leaves the old leaf full
+  Page *new_page = NewPage(0);
+  auto *new_leaf = reinterpret_cast<BPlusTreeSlottedPage *>(new_page->GetData());
+  bool append = leaf->GetNextPageId() == INVALID_PAGE_ID && index == leaf->GetSize();
+  int split_index = append ? leaf->GetSize() : leaf->SplitIndex();
+  leaf->MoveTailTo(split_index, new_leaf);
+  new_leaf->SetNextPageId(leaf->GetNextPageId());
+  leaf->SetNextPageId(new_page->GetPageId());
+  if (index < split_index) {
+    leaf->InsertLeaf(index, key, value, buffer_pool_manager_);
+  } else {
+    new_leaf->InsertLeaf(index - split_index, key, value, buffer_pool_manager_);
+  }
+  std::string separator =
+      Separator(leaf->KeyAt(leaf->GetSize() - 1, buffer_pool_manager_), new_leaf->KeyAt(0, buffer_pool_manager_));
+  page_id_t new_page_id = new_page->GetPageId();
+  buffer_pool_manager_->UnpinPage(new_page_id, true);
+  InsertIntoParent(&path, std::move(separator), new_page_id);
+  ReleasePath(&path, true);
+  return true;
+}
+
+/*
+ * Insert the separator of a split page and its new right sibling into the
+ * parent, which is the page before it on the path, splitting the parent in
+ * turn if it has no room. The last page of the path is the page that split.
+ */
+void VarlenBPlusTree::InsertIntoParent(std::vector<Page *> *path, std::string separator, page_id_t new_page_id) {
+  for (size_t depth = path->size() - 1;; depth--) {
+    BUSTUB_ASSERT(depth > 0, "a page that splits is not safe, so its parent or the root latch is on the path");
+    Page *page = (*path)[depth];
+    auto *node = reinterpret_cast<BPlusTreeSlottedPage *>(page->GetData());
+    if ((*path)[depth - 1] == nullptr) {
+      // the root split, grow a new root above it
+      Page *root_page = NewPage(node->GetLevel() + 1);
+      auto *root = reinterpret_cast<BPlusTreeSlottedPage *>(root_page->GetData());
+      root->InsertChild(0, "", page->GetPageId(), buffer_pool_manager_);
+      root->InsertChild(1, separator, new_page_id, buffer_pool_manager_);
+      root_page_id_ = root_page->GetPageId();
+      buffer_pool_manager_->UnpinPage(root_page->GetPageId(), true);
+      UpdateRootPageId();
+      return;
+    }
+
+    auto *parent = reinterpret_cast<BPlusTreeSlottedPage *>((*path)[depth - 1]->GetData());
+    int index = parent->ChildIndex(separator, false, buffer_pool_manager_) + 1;
+    if (parent->HasRoomFor(separator.size())) {
+      parent->InsertChild(index, separator, new_page_id, buffer_pool_manager_);
+      return;
+    }
+
+    // split the parent: the first key of the new page moves up
+    Page *sibling_page = NewPage(parent->GetLevel());
+    auto *sibling = reinterpret_cast<BPlusTreeSlottedPage *>(sibling_page->GetData());
+    int split_index = parent->SplitIndex();
+    std::string parent_separator = parent->KeyAt(split_index, buffer_pool_manager_);
+    parent->MoveTailTo(split_index, sibling);
+    sibling->ClearKey(0, buffer_pool_manager_);
+    if (index <= split_index) {
+      parent->InsertChild(index, separator, new_page_id, buffer_pool_manager_);
+    } else {
+      sibling->InsertChild(index - split_index, separator, new_page_id, buffer_pool_manager_);
+    }
+    separator = std::move(parent_separator);
+    new_page_id = sibling_page->GetPageId();
+    buffer_pool_manager_->UnpinPage(new_page_id, true);
+  }
+}
+
+/*
+ * @return: the shortest prefix of rhs that is greater than lhs, which sorts
+ * after lhs and not after rhs. lhs must be less than rhs.
+ */
+std::string VarlenBPlusTree::Separator(const std::string &lhs, const std::string &rhs) {
+  size_t common = std::mismatch(lhs.begin(), lhs.end(), rhs.begin(), rhs.end()).first - lhs.begin();
+  return rhs.substr(0, common + 1);
+}
+
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+/*
+ * Delete the entry of key from its leaf, if there is one. Pages don't merge.
+ */
+void VarlenBPlusTree::Remove(const std::string &key) {
+  Page *page = FindLeafPage(Target::KEY, &key, true);
+  if (page == nullptr) {
+    return;
+  }
+  auto *leaf = reinterpret_cast<BPlusTreeSlottedPage *>(page->GetData());
+  int index = leaf->LowerBound(key, buffer_pool_manager_);
+  bool found = index < leaf->GetSize() && leaf->Compare(key, index, buffer_pool_manager_) == 0;
+  if (found) {
+    leaf->Remove(index, buffer_pool_manager_);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), found);
+}
+
+/*****************************************************************************
+ * INDEX ITERATOR
+ *****************************************************************************/
+VarlenIndexIterator VarlenBPlusTree::Begin() { return VarlenIndexIterator(this, nullptr, false); }
+
+VarlenIndexIterator VarlenBPlusTree::Begin(const std::string &key) { return VarlenIndexIterator(this, &key, false); }
+
+VarlenIndexIterator VarlenBPlusTree::RBegin() { return VarlenIndexIterator(this, nullptr, true); }
+
+VarlenIndexIterator VarlenBPlusTree::RBegin(const std::string &key) { return VarlenIndexIterator(this, &key, true); }
+
+VarlenIndexIterator::VarlenIndexIterator(VarlenBPlusTree *tree, const std::string *key, bool reverse)
+    : tree_(tree), reverse_(reverse), inclusive_(true) {
+  if (key != nullptr) {
+    bound_ = *key;
+  }
+  Load();
+}
+
+VarlenIndexIterator &VarlenIndexIterator::operator++() {
+  if (++position_ == entries_.size()) {
+    Load();
+  }
+  return *this;
+}
+
+void VarlenIndexIterator::Load() {
+  entries_.clear();
+  position_ = 0;
+  if (reverse_) {
+    LoadReverse();
+  } else {
+    LoadForward();
+  }
+  if (!entries_.empty()) {
+    bound_ = entries_.back().first;
+    inclusive_ = false;
+  }
+}
+
+void VarlenIndexIterator::LoadForward() {
+  BufferPoolManager *bpm = tree_->buffer_pool_manager_;
+  Page *page;
+  if (page_id_ == INVALID_PAGE_ID) {
+    page = tree_->FindLeafPage(bound_.has_value() ? VarlenBPlusTree::Target::KEY : VarlenBPlusTree::Target::LEFT_MOST,
+                               bound_.has_value() ? &*bound_ : nullptr, false);
+  } else {
+    // back to the last leaf for its current next page, which may be new since a split
+    page = tree_->FetchPage(page_id_);
+    page->RLatch();
+    auto *leaf = reinterpret_cast<BPlusTreeSlottedPage *>(page->GetData());
+    Page *next_page = nullptr;
+    if (leaf->GetNextPageId() != INVALID_PAGE_ID) {
+      next_page = tree_->FetchPage(leaf->GetNextPageId());
+      next_page->RLatch();
+    }
+    page->RUnlatch();
+    bpm->UnpinPage(page->GetPageId(), false);
+    page = next_page;
+  }
+
+  while (page != nullptr) {
+    auto *leaf = reinterpret_cast<BPlusTreeSlottedPage *>(page->GetData());
+    int index = 0;
+    if (bound_.has_value()) {
+      index = leaf->LowerBound(*bound_, bpm);
+      if (!inclusive_ && index < leaf->GetSize() && leaf->Compare(*bound_, index, bpm) == 0) {
+        index++;
+      }
+    }
+    for (; index < leaf->GetSize(); index++) {
+      entries_.emplace_back(leaf->KeyAt(index, bpm), leaf->RidAt(index));
+    }
+    page_id_ = page->GetPageId();
+    Page *next_page = nullptr;
+    if (entries_.empty() && leaf->GetNextPageId() != INVALID_PAGE_ID) {
+      next_page = tree_->FetchPage(leaf->GetNextPageId());
+      next_page->RLatch();
+    }
+    page->RUnlatch();
+    bpm->UnpinPage(page->GetPageId(), false);
+    page = next_page;
+  }
+}
+
+/*
+ * Search for the leaf of the keys before the bound. If it has none, which a
+ * delete may leave it with, go on with the keys before its low fence.
+ */
+void VarlenIndexIterator::LoadReverse() {
+  BufferPoolManager *bpm = tree_->buffer_pool_manager_;
+  while (true) {
+    auto target = !bound_.has_value() ? VarlenBPlusTree::Target::RIGHT_MOST
+                                      : inclusive_ ? VarlenBPlusTree::Target::KEY : VarlenBPlusTree::Target::BEFORE_KEY;
+    std::optional<std::string> low_key;
+    Page *page = tree_->FindLeafPage(target, bound_.has_value() ? &*bound_ : nullptr, false, &low_key);
+    if (page == nullptr) {
+      return;
+    }
+    auto *leaf = reinterpret_cast<BPlusTreeSlottedPage *>(page->GetData());
+    int end = leaf->GetSize();
+    if (bound_.has_value()) {
+      end = leaf->LowerBound(*bound_, bpm);
+      if (inclusive_ && end < leaf->GetSize() && leaf->Compare(*bound_, end, bpm) == 0) {
+        end++;
+      }
+    }
+    for (int index = end - 1; index >= 0; index--) {
+      entries_.emplace_back(leaf->KeyAt(index, bpm), leaf->RidAt(index));
+    }
+    page->RUnlatch();
+    bpm->UnpinPage(page->GetPageId(), false);
+    if (!entries_.empty() || !low_key.has_value()) {
+      return;
+    }
+    bound_ = std::move(low_key);
+    inclusive_ = false;
+  }
+}
+
+/*****************************************************************************
+ * UTILITIES AND DEBUG
+ *****************************************************************************/
+Page *VarlenBPlusTree::FetchPage(page_id_t page_id) {
+  Page *page = buffer_pool_manager_->FetchPage(page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch b+ tree page");
+  }
+  return page;
+}
+
+/*
+ * @return: a new empty page at a level of the tree, pinned
+ */
+Page *VarlenBPlusTree::NewPage(uint16_t level) {
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(&page_id);
+  if (page == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate new b+ tree page");
+  }
+  reinterpret_cast<BPlusTreeSlottedPage *>(page->GetData())->Init(page_id, level);
+  return page;
+}
+
+/*
+ * Crab down to the target leaf with read latches, write-latching the leaf if
+ * write is set
+ * @param low_key: set to the low fence of the leaf, the separator in front of
+ * it in the closest ancestor that has one; left alone for the left most leaf
+ * @return: the leaf, pinned and latched, or nullptr if the tree is empty
+ */
+Page *VarlenBPlusTree::FindLeafPage(Target target, const std::string *key, bool write,
+                                    std::optional<std::string> *low_key) {
+  root_latch_.RLock();
+  if (root_page_id_ == INVALID_PAGE_ID) {
+    root_latch_.RUnlock();
+    return nullptr;
+  }
+  Page *page = FetchPage(root_page_id_);
+  page->RLatch();
+  auto *node = reinterpret_cast<BPlusTreeSlottedPage *>(page->GetData());
+  if (write && node->IsLeafPage()) {
+    // the root stays a leaf while root_latch_ is held
+    page->RUnlatch();
+    page->WLatch();
+  }
+  root_latch_.RUnlock();
+
+  while (!node->IsLeafPage()) {
+    int index;
+    switch (target) {
+      case Target::LEFT_MOST:
+        index = 0;
+        break;
+      case Target::RIGHT_MOST:
+        index = node->GetSize() - 1;
+        break;
+      default:
+        index = node->ChildIndex(*key, target == Target::BEFORE_KEY, buffer_pool_manager_);
+    }
+    if (low_key != nullptr && index > 0) {
+      *low_key = node->KeyAt(index, buffer_pool_manager_);
+    }
+    Page *child_page = FetchPage(node->ChildAt(index));
+    if (write && node->GetLevel() == 1) {
+      child_page->WLatch();
+    } else {
+      child_page->RLatch();
+    }
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    page = child_page;
+    node = reinterpret_cast<BPlusTreeSlottedPage *>(page->GetData());
+  }
+  return page;
+}
+
+/*
+ * Crab down to the leaf of key with write latches, which are kept in path
+ * from the last safe page down. A nullptr in path stands for root_latch_,
+ * which is kept while the root may split.
+ * @return: the leaf, or nullptr if the tree is empty
+ */
+Page *VarlenBPlusTree::FindLeafPageWrite(const std::string &key, std::vector<Page *> *path) {
+  root_latch_.WLock();
+  path->push_back(nullptr);
+  if (root_page_id_ == INVALID_PAGE_ID) {
+    return nullptr;
+  }
+  Page *page = FetchPage(root_page_id_);
+  while (true) {
+    page->WLatch();
+    auto *node = reinterpret_cast<BPlusTreeSlottedPage *>(page->GetData());
+    if (IsSafe(node, key)) {
+      ReleasePath(path, false);
+    }
+    path->push_back(page);
+    if (node->IsLeafPage()) {
+      return page;
+    }
+    page = FetchPage(node->ChildAt(node->ChildIndex(key, false, buffer_pool_manager_)));
+  }
+}
+
+/*
+ * A page is safe if it has room for the key, or for any separator if it is
+ * an internal page, so it won't split
+ */
+bool VarlenBPlusTree::IsSafe(const BPlusTreeSlottedPage *node, const std::string &key) const {
+  return node->HasRoomFor(node->IsLeafPage() ? key.size() : BPlusTreeSlottedPage::MAX_INLINE_KEY_SIZE + 1);
+}
+
+/*
+ * Release the write latches held on path, including the root latch
+ */
+void VarlenBPlusTree::ReleasePath(std::vector<Page *> *path, bool dirty) {
+  for (Page *page : *path) {
+    if (page == nullptr) {
+      root_latch_.WUnlock();
+    } else {
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), dirty);
+    }
+  }
+  path->clear();
+}
+
+/*
+ * Update/Insert root page id in the header page
+ * @parameter: insert_record      defualt value is false. When set to true,
+ * insert a record <index_name, root_page_id> into header page instead of
+ * updating it.
+ */
+void VarlenBPlusTree::UpdateRootPageId(int insert_record) {
+  Page *page = buffer_pool_manager_->FetchPage(header_page_id_);
+  HeaderPage *header_page = static_cast<HeaderPage *>(page);
+  page->WLatch();
+  if (insert_record == 0 || !header_page->InsertRecord(index_name_, root_page_id_)) {
+    header_page->UpdateRecord(index_name_, root_page_id_);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(header_page_id_, true);
+}
+
+}  // namespace bustub
@@ -0,0 +1,102 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// varlen_b_plus_tree_index.cpp
+//
+// Identification: src/storage/index/varlen_b_plus_tree_index.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <optional>
+#include <utility>
+
+#include "storage/index/normalized_key.h"
+#include "storage/index/varlen_b_plus_tree_index.h"
+
+namespace bustub {
+
+/*
+ * Iterates over a VarlenBPlusTree from a bound until the other one is passed.
+ */
+class VarlenBPlusTreeIndexScanIterator : public IndexScanIterator {
+ public:
+  VarlenBPlusTreeIndexScanIterator(VarlenIndexIterator iterator, std::optional<std::string> stop_key, bool reverse,
+                                   Schema *key_schema)
+      : iterator_(std::move(iterator)), stop_key_(std::move(stop_key)), reverse_(reverse), key_schema_(key_schema) {}
+
+  bool Next(Tuple *key, RID *rid) override {
+    if (iterator_.IsEnd()) {
+      return false;
+    }
+    const auto &[index_key, value] = *iterator_;
+    if (stop_key_.has_value()) {
+      int cmp = index_key.compare(*stop_key_);
+      if (reverse_ ? cmp < 0 : cmp > 0) {
+        iterator_ = VarlenIndexIterator();
+        return false;
+      }
+    }
+    std::vector<Value> values;
+    values.reserve(key_schema_->GetColumnCount());
+    size_t offset = 0;
+    for (uint32_t i = 0; i < key_schema_->GetColumnCount(); i++) {
+      values.push_back(NormalizedEncoding::Read(key_schema_->GetColumn(i).GetType(), index_key.data(),
+                                                index_key.size(), &offset));
+    }
+    *key = Tuple(values, key_schema_);
+    *rid = value;
+    ++iterator_;
+    return true;
+  }
+
+ private:
+  VarlenIndexIterator iterator_;
+  // the bound the scan ends at
+  std::optional<std::string> stop_key_;
+  bool reverse_;
+  Schema *key_schema_;
+};
+
+/*
+ * Constructor
+ */
+VarlenBPlusTreeIndex::VarlenBPlusTreeIndex(std::unique_ptr<IndexMetadata> &&metadata,
+                                           BufferPoolManager *buffer_pool_manager, page_id_t header_page_id)
+    : Index(std::move(metadata)), container_(GetMetadata()->GetName(), buffer_pool_manager, header_page_id) {}
+
+void VarlenBPlusTreeIndex::InsertEntry(const Tuple &key, RID rid, Transaction * /* transaction */) {
+  container_.Insert(NormalizedEncoding::Encode(key, GetKeySchema()), rid);
+}
+
+void VarlenBPlusTreeIndex::DeleteEntry(const Tuple &key, RID /* rid */, Transaction * /* transaction */) {
+  container_.Remove(NormalizedEncoding::Encode(key, GetKeySchema()));
+}
+
+void VarlenBPlusTreeIndex::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction * /* transaction */) {
+  container_.GetValue(NormalizedEncoding::Encode(key, GetKeySchema()), result);
+}
+
+std::unique_ptr<IndexScanIterator> VarlenBPlusTreeIndex::ScanRange(const Tuple *low_key, const Tuple *high_key,
+                                                                   bool reverse, Transaction * /* transaction */) {
+  std::optional<std::string> low;
+  std::optional<std::string> high;
+  if (low_key != nullptr) {
+    low = NormalizedEncoding::Encode(*low_key, GetKeySchema());
+  }
+  if (high_key != nullptr) {
+    high = NormalizedEncoding::Encode(*high_key, GetKeySchema());
+  }
+  VarlenIndexIterator iterator;
+  if (reverse) {
+    iterator = high.has_value() ? container_.RBegin(*high) : container_.RBegin();
+  } else {
+    iterator = low.has_value() ? container_.Begin(*low) : container_.Begin();
+  }
+  return std::make_unique<VarlenBPlusTreeIndexScanIterator>(std::move(iterator), reverse ? low : high, reverse,
+                                                            GetKeySchema());
+}
+
+}  // namespace bustub
@@ -17,45 +17,61 @@ namespace bustub {
  * Helper methods to get/set page type
  * Page type enum class is defined in b_plus_tree_page.h
  */
-bool BPlusTreePage::IsLeafPage() const { return false; }
-bool BPlusTreePage::IsRootPage() const { return false; }
-void BPlusTreePage::SetPageType(IndexPageType page_type) {}
+bool BPlusTreePage::IsLeafPage() const { return page_type_ == IndexPageType::LEAF_PAGE; }
+bool BPlusTreePage::IsRootPage() const { return parent_page_id_ == INVALID_PAGE_ID; }
+void BPlusTreePage::SetPageType(IndexPageType page_type) { page_type_ = page_type; }
 
 /*
  * Helper methods to get/set size (number of key/value pairs stored in that
  * page)
  */
-int BPlusTreePage::GetSize() const { return 0; }
-void BPlusTreePage::SetSize(int size) {}
-void BPlusTreePage::IncreaseSize(int amount) {}
+int BPlusTreePage::GetSize() const { return size_; }
+void BPlusTreePage::SetSize(int size) { size_ = size; }
+void BPlusTreePage::IncreaseSize(int amount) { size_ += amount; }
 
 /*
  * Helper methods to get/set max size (capacity) of the page
  */
-int BPlusTreePage::GetMaxSize() const { return 0; }
-void BPlusTreePage::SetMaxSize(int max_size) {}
+int BPlusTreePage::GetMaxSize() const { return max_size_; }
+void BPlusTreePage::SetMaxSize(int max_size) { max_size_ = max_size; }
 
 /*
  * Helper method to get min page size
- * Generally, min page size == max page size / 2
+ * Generally, min page size == max page size / 2. A leaf splits as soon as it
+ * reaches max size while an internal page splits only once it exceeds it, so an
+ * internal page keeps one more entry. The root only has to hold one key (leaf)
+ * or two children (internal).
  */
-int BPlusTreePage::GetMinSize() const { return 0; }
+int BPlusTreePage::GetMinSize() const {
+  if (IsRootPage()) {
+    return IsLeafPage() ? 1 : 2;
+  }
+  return IsLeafPage() ? max_size_ / 2 : (max_size_ + 1) / 2;
+}
 
 /*
  * Helper methods to get/set parent page id
  */
-page_id_t BPlusTreePage::GetParentPageId() const { return 0; }
-void BPlusTreePage::SetParentPageId(page_id_t parent_page_id) {}
+/*
+ * Helper methods to get/set parent page id. A B-link tree re-parents the
+ * children of a split page without latching them, so the id is accessed
+ * atomically; a stale one is corrected by moving right.
+ */
+page_id_t BPlusTreePage::GetParentPageId() const { return __atomic_load_n(&parent_page_id_, __ATOMIC_RELAXED); }
+void BPlusTreePage::SetParentPageId(page_id_t parent_page_id) {
+  __atomic_store_n(&parent_page_id_, parent_page_id, __ATOMIC_RELAXED);
+}
 
 /*
  * Helper methods to get/set self page id
  */
-page_id_t BPlusTreePage::GetPageId() const { return 0; }
-void BPlusTreePage::SetPageId(page_id_t page_id) {}
+page_id_t BPlusTreePage::GetPageId() const { return page_id_; }
+void BPlusTreePage::SetPageId(page_id_t page_id) { page_id_ = page_id; }
 
 /*
- * Helper methods to set lsn
+ * Helper methods to get/set lsn
  */
+lsn_t BPlusTreePage::GetLSN() const { return lsn_; }
 void BPlusTreePage::SetLSN(lsn_t lsn) { lsn_ = lsn; }
 
 }  // namespace bustub
@@ -0,0 +1,304 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_slotted_page.cpp
+//
+// Identification: src/storage/page/b_plus_tree_slotted_page.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#include "common/exception.h"
+#include "common/macros.h"
+#include "storage/page/b_plus_tree_slotted_page.h"
+
+namespace bustub {
+
+static_assert(sizeof(BPlusTreeSlottedPage) == BPlusTreeSlottedPage::HEADER_SIZE, "header layout");
+
+/*****************************************************************************
+ * HELPER METHODS AND UTILITIES
+ *****************************************************************************/
+
+/**
+ * Init method after creating a new page: a leaf at level 0, an internal page
+ * above it
+ */
+void BPlusTreeSlottedPage::Init(page_id_t page_id, uint16_t level) {
+  SetPageType(level == 0 ? IndexPageType::LEAF_PAGE : IndexPageType::INTERNAL_PAGE);
+  SetLSN();
+  SetSize(0);
+  SetPageId(page_id);
+  SetParentPageId(INVALID_PAGE_ID);
+  SetMaxSize(0);
+  next_page_id_ = INVALID_PAGE_ID;
+  free_space_pointer_ = PAGE_SIZE;
+  level_ = level;
+}
+
+std::string BPlusTreeSlottedPage::KeyAt(int index, BufferPoolManager *bpm) const {
+  std::string key(RecordAt(index) + ValueSize(), InlineKeySize(index));
+  if (HasOverflow(index)) {
+    ReadOverflow(OverflowPageId(index), &key, bpm);
+  }
+  return key;
+}
+
+RID BPlusTreeSlottedPage::RidAt(int index) const {
+  RID rid;
+  memcpy(&rid, RecordAt(index), sizeof(RID));
+  return rid;
+}
+
+page_id_t BPlusTreeSlottedPage::ChildAt(int index) const {
+  page_id_t child;
+  memcpy(&child, RecordAt(index), sizeof(page_id_t));
+  return child;
+}
+
+page_id_t BPlusTreeSlottedPage::OverflowPageId(int index) const {
+  page_id_t page_id;
+  memcpy(&page_id, RecordAt(index) + ValueSize() + InlineKeySize(index), sizeof(page_id_t));
+  return page_id;
+}
+
+size_t BPlusTreeSlottedPage::RecordSize(int index) const {
+  return ValueSize() + InlineKeySize(index) + (HasOverflow(index) ? sizeof(page_id_t) : 0);
+}
+
+size_t BPlusTreeSlottedPage::NewRecordSize(size_t key_size) const {
+  size_t overflow_size = key_size > MAX_INLINE_KEY_SIZE ? sizeof(page_id_t) : 0;
+  return ValueSize() + std::min(key_size, MAX_INLINE_KEY_SIZE) + overflow_size;
+}
+
+/*****************************************************************************
+ * LOOKUP
+ *****************************************************************************/
+/*
+ * Compare the inline bytes first; the overflow pages are only read if they
+ * are equal, which takes keys that share a prefix of MAX_INLINE_KEY_SIZE bytes
+ */
+int BPlusTreeSlottedPage::Compare(const std::string &key, int index, BufferPoolManager *bpm) const {
+  size_t inline_size = InlineKeySize(index);
+  int cmp = memcmp(key.data(), RecordAt(index) + ValueSize(), std::min(key.size(), inline_size));
+  if (cmp != 0) {
+    return cmp;
+  }
+  if (key.size() <= inline_size) {
+    return key.size() < inline_size || HasOverflow(index) ? -1 : 0;
+  }
+  if (!HasOverflow(index)) {
+    return 1;
+  }
+  std::string rest;
+  ReadOverflow(OverflowPageId(index), &rest, bpm);
+  return std::string_view(key).substr(inline_size).compare(rest);
+}
+
+int BPlusTreeSlottedPage::LowerBound(const std::string &key, BufferPoolManager *bpm) const {
+  int low = 0;
+  int high = GetSize();
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (Compare(key, mid, bpm) > 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+/*
+ * Find the last slot whose key is not greater than key, or less than key if
+ * before is set. Slot 0 has no key and is taken if there is none.
+ */
+int BPlusTreeSlottedPage::ChildIndex(const std::string &key, bool before, BufferPoolManager *bpm) const {
+  int low = 1;
+  int high = GetSize();
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    int cmp = Compare(key, mid, bpm);
+    if (cmp > 0 || (cmp == 0 && !before)) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low - 1;
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+bool BPlusTreeSlottedPage::HasRoomFor(size_t key_size) const {
+  size_t used = HEADER_SIZE + (GetSize() + 1) * SLOT_SIZE + NewRecordSize(key_size);
+  for (int i = 0; i < GetSize(); i++) {
+    used += RecordSize(i);
+  }
+  return used <= PAGE_SIZE;
+}
+
+void BPlusTreeSlottedPage::InsertLeaf(int index, const std::string &key, const RID &rid, BufferPoolManager *bpm) {
+  Insert(index, key, reinterpret_cast<const char *>(&rid), bpm);
+}
+
+void BPlusTreeSlottedPage::InsertChild(int index, const std::string &key, page_id_t child, BufferPoolManager *bpm) {
+  Insert(index, key, reinterpret_cast<const char *>(&child), bpm);
+}
+
+void BPlusTreeSlottedPage::Insert(int index, const std::string &key, const char *value, BufferPoolManager *bpm) {
+  char record[PAGE_SIZE];
+  size_t value_size = ValueSize();
+  size_t inline_size = std::min(key.size(), MAX_INLINE_KEY_SIZE);
+  memcpy(record, value, value_size);
+  memcpy(record + value_size, key.data(), inline_size);
+  size_t size = value_size + inline_size;
+  auto key_size = static_cast<uint16_t>(inline_size);
+  if (key.size() > MAX_INLINE_KEY_SIZE) {
+    page_id_t overflow_page_id = WriteOverflow(key.data() + inline_size, key.size() - inline_size, bpm);
+    memcpy(record + size, &overflow_page_id, sizeof(page_id_t));
+    size += sizeof(page_id_t);
+    key_size |= OVERFLOW_FLAG;
+  }
+  InsertRecord(index, record, size, key_size);
+}
+
+void BPlusTreeSlottedPage::InsertRecord(int index, const char *record, size_t size, uint16_t key_size) {
+  size_t slots_end = HEADER_SIZE + (GetSize() + 1) * SLOT_SIZE;
+  if (free_space_pointer_ < slots_end + size) {
+    Compact();
+  }
+  BUSTUB_ASSERT(free_space_pointer_ >= slots_end + size, "no room in slotted page");
+  free_space_pointer_ -= size;
+  memcpy(reinterpret_cast<char *>(this) + free_space_pointer_, record, size);
+  Slot *slots = Slots();
+  memmove(slots + index + 1, slots + index, (GetSize() - index) * SLOT_SIZE);
+  slots[index] = {free_space_pointer_, key_size};
+  IncreaseSize(1);
+}
+
+/*
+ * Move the records to the end of the page, in slot order, leaving all free
+ * space between the slots and the records
+ */
+void BPlusTreeSlottedPage::Compact() {
+  char buffer[PAGE_SIZE];
+  uint16_t offset = PAGE_SIZE;
+  Slot *slots = Slots();
+  for (int i = 0; i < GetSize(); i++) {
+    size_t size = RecordSize(i);
+    offset -= size;
+    memcpy(buffer + offset, RecordAt(i), size);
+    slots[i].offset_ = offset;
+  }
+  memcpy(reinterpret_cast<char *>(this) + offset, buffer + offset, PAGE_SIZE - offset);
+  free_space_pointer_ = offset;
+}
+
+/*
+ * Split around the middle of the record bytes, keeping at least one slot on
+ * each side
+ */
+int BPlusTreeSlottedPage::SplitIndex() const {
+  size_t total = 0;
+  for (int i = 0; i < GetSize(); i++) {
+    total += RecordSize(i);
+  }
+  size_t left = 0;
+  int index = 0;
+  while (index < GetSize() - 1 && 2 * (left + RecordSize(index)) <= total) {
+    left += RecordSize(index++);
+  }
+  return std::max(index, 1);
+}
+
+void BPlusTreeSlottedPage::MoveTailTo(int index, BPlusTreeSlottedPage *recipient) {
+  for (int i = index; i < GetSize(); i++) {
+    recipient->InsertRecord(recipient->GetSize(), RecordAt(i), RecordSize(i), Slots()[i].key_size_);
+  }
+  SetSize(index);
+}
+
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+void BPlusTreeSlottedPage::Remove(int index, BufferPoolManager *bpm) {
+  if (HasOverflow(index)) {
+    DeleteOverflow(OverflowPageId(index), bpm);
+  }
+  Slot *slots = Slots();
+  memmove(slots + index, slots + index + 1, (GetSize() - index - 1) * SLOT_SIZE);
+  IncreaseSize(-1);
+}
+
+void BPlusTreeSlottedPage::ClearKey(int index, BufferPoolManager *bpm) {
+  if (HasOverflow(index)) {
+    DeleteOverflow(OverflowPageId(index), bpm);
+  }
+  Slots()[index].key_size_ = 0;
+}
+
+/*****************************************************************************
+ * OVERFLOW PAGES
+ *****************************************************************************/
+/*
+ * Write data to a new chain of overflow pages
+ * @return: the first page of the chain
+ */
+page_id_t BPlusTreeSlottedPage::WriteOverflow(const char *data, size_t size, BufferPoolManager *bpm) {
+  page_id_t first_page_id;
+  Page *page = bpm->NewPage(&first_page_id);
+  while (true) {
+    if (page == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot allocate overflow page");
+    }
+    auto *header = reinterpret_cast<OverflowHeader *>(page->GetData());
+    header->size_ = std::min(size, OVERFLOW_DATA_SIZE);
+    header->next_page_id_ = INVALID_PAGE_ID;
+    memcpy(page->GetData() + sizeof(OverflowHeader), data, header->size_);
+    data += header->size_;
+    size -= header->size_;
+    Page *next_page = size > 0 ? bpm->NewPage(&header->next_page_id_) : nullptr;
+    bpm->UnpinPage(page->GetPageId(), true);
+    if (size == 0) {
+      return first_page_id;
+    }
+    page = next_page;
+  }
+}
+
+void BPlusTreeSlottedPage::ReadOverflow(page_id_t page_id, std::string *key, BufferPoolManager *bpm) {
+  while (page_id != INVALID_PAGE_ID) {
+    Page *page = bpm->FetchPage(page_id);
+    if (page == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch overflow page");
+    }
+    const auto *header = reinterpret_cast<const OverflowHeader *>(page->GetData());
+    key->append(page->GetData() + sizeof(OverflowHeader), header->size_);
+    page_id_t next_page_id = header->next_page_id_;
+    bpm->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+}
+
+void BPlusTreeSlottedPage::DeleteOverflow(page_id_t page_id, BufferPoolManager *bpm) {
+  while (page_id != INVALID_PAGE_ID) {
+    Page *page = bpm->FetchPage(page_id);
+    if (page == nullptr) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot fetch overflow page");
+    }
+    page_id_t next_page_id = reinterpret_cast<const OverflowHeader *>(page->GetData())->next_page_id_;
+    bpm->UnpinPage(page_id, false);
+    bpm->DeletePage(page_id);
+    page_id = next_page_id;
+  }
+}
+
+}  // namespace bustub
@@ -10,6 +10,13 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <string>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "storage/page/hash_table_bucket_page.h"
 #include "common/logger.h"
 #include "common/util/hash_util.h"
@@ -48,15 +55,36 @@ void HASH_TABLE_BUCKET_TYPE::SetUnreadable(uint32_t bucket_idx) {
 
 // ======================================================================
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+uint32_t HASH_TABLE_BUCKET_TYPE::MatchGroup(uint32_t group, uint8_t fingerprint) const {
+  const uint8_t *fingerprints = fingerprints_ + group * GROUP_SIZE;
+  uint32_t match = 0;
+#ifdef __SSE2__
+  __m128i group_fingerprints = _mm_loadu_si128(reinterpret_cast<const __m128i *>(fingerprints));
+  match = _mm_movemask_epi8(_mm_cmpeq_epi8(group_fingerprints, _mm_set1_epi8(static_cast<char>(fingerprint))));
+#else
+  for (uint32_t i = 0; i < GROUP_SIZE; i++) {
+    match |= static_cast<uint32_t>(fingerprints[i] == fingerprint) << i;
+  }
+#endif
+  return match & GroupBits(readable_, group);
+}
+
 template <typename KeyType, typename ValueType, typename KeyComparator>
 bool HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) {
   bool flag = false;
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; ++i) {
-    if (IsReadable(i) && cmp(array_[i].first, key) == 0) {
-      result->push_back(array_[i].second);
-      flag = true;
+  uint8_t fingerprint = Fingerprint(key);
+  for (uint32_t group = 0; group < NUM_GROUPS; group++) {
+    // only the slots with the same fingerprint can hold the key
+    for (uint32_t match = MatchGroup(group, fingerprint); match != 0; match &= match - 1) {
+      uint32_t i = group * GROUP_SIZE + __builtin_ctz(match);
+      if (cmp(keys_[i], key) == 0) {
+        result->push_back(values_[i]);
+        flag = true;
+      }
     }
-    if (!IsOccupied(i)) {
+    // slots are taken in order, nothing was ever stored past a slot that is not occupied
+    if (GroupBits(occupied_, group) != 0xffff) {
       break;
     }
   }
@@ -64,42 +92,70 @@ bool HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vecto
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_BUCKET_TYPE::Insert(KeyType key, ValueType value, KeyComparator cmp) {
+void HASH_TABLE_BUCKET_TYPE::GetCandidates(const KeyType &key, std::vector<MappingType> *candidates) const {
+  uint8_t fingerprint = Fingerprint(key);
+  for (uint32_t group = 0; group < NUM_GROUPS; group++) {
+    for (uint32_t match = MatchGroup(group, fingerprint); match != 0; match &= match - 1) {
+      uint32_t i = group * GROUP_SIZE + __builtin_ctz(match);
+      candidates->emplace_back(keys_[i], values_[i]);
+    }
+    if (GroupBits(occupied_, group) != 0xffff) {
+      break;
+    }
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool HASH_TABLE_BUCKET_TYPE::Insert(KeyType key, ValueType value, KeyComparator cmp, uint32_t *bucket_idx) {
   uint32_t to_insert = BUCKET_ARRAY_SIZE;
-  for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    if (IsReadable(i)) {
-      // judge if equal
-      if (cmp(array_[i].first, key) == 0 && ValueAt(i) == value) {
+  uint8_t fingerprint = Fingerprint(key);
+  for (uint32_t group = 0; group < NUM_GROUPS; group++) {
+    // judge if equal
+    for (uint32_t match = MatchGroup(group, fingerprint); match != 0; match &= match - 1) {
+      uint32_t i = group * GROUP_SIZE + __builtin_ctz(match);
+      if (cmp(keys_[i], key) == 0 && values_[i] == value) {
         return false;
       }
-    } else {
-      if (to_insert == BUCKET_ARRAY_SIZE) {
-        to_insert = i;
-      }
-      if (!IsOccupied(i)) {
-        break;
-      }
+    }
+    uint32_t free = ~GroupBits(readable_, group) & 0xffff;
+    if (to_insert == BUCKET_ARRAY_SIZE && free != 0) {
+      to_insert = std::min<uint32_t>(group * GROUP_SIZE + __builtin_ctz(free), BUCKET_ARRAY_SIZE);
+    }
+    if (GroupBits(occupied_, group) != 0xffff) {
+      break;
     }
   }
   // judge if fulled which means no space to insert
   if (to_insert == BUCKET_ARRAY_SIZE) {
     return false;
   }
-  array_[to_insert] = {key, value};
+  fingerprints_[to_insert] = fingerprint;
+  keys_[to_insert] = key;
+  values_[to_insert] = value;
   SetOccupied(to_insert);
   SetReadable(to_insert);
+  if (bucket_idx != nullptr) {
+    *bucket_idx = to_insert;
+  }
   return true;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool HASH_TABLE_BUCKET_TYPE::Remove(KeyType key, ValueType value, KeyComparator cmp) {
+bool HASH_TABLE_BUCKET_TYPE::Remove(KeyType key, ValueType value, KeyComparator cmp, uint32_t *bucket_idx) {
   // find the pair and remove it.
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    if (IsReadable(i) && cmp(KeyAt(i), key) == 0 && value == ValueAt(i)) {
-      SetUnreadable(i);
-      return true;  // No duplicate
+  uint8_t fingerprint = Fingerprint(key);
+  for (uint32_t group = 0; group < NUM_GROUPS; group++) {
+    for (uint32_t match = MatchGroup(group, fingerprint); match != 0; match &= match - 1) {
+      uint32_t i = group * GROUP_SIZE + __builtin_ctz(match);
+      if (cmp(keys_[i], key) == 0 && values_[i] == value) {
+        SetUnreadable(i);
+        if (bucket_idx != nullptr) {
+          *bucket_idx = i;
+        }
+        return true;  // No duplicate
+      }
     }
-    if (!IsOccupied(i)) {
+    if (GroupBits(occupied_, group) != 0xffff) {
       break;
     }
   }
@@ -109,7 +165,7 @@ bool HASH_TABLE_BUCKET_TYPE::Remove(KeyType key, ValueType value, KeyComparator
 template <typename KeyType, typename ValueType, typename KeyComparator>
 KeyType HASH_TABLE_BUCKET_TYPE::KeyAt(uint32_t bucket_idx) const {
   if (IsReadable(bucket_idx)) {
-    return array_[bucket_idx].first;
+    return keys_[bucket_idx];
   }
   return {};
 }
@@ -117,11 +173,19 @@ KeyType HASH_TABLE_BUCKET_TYPE::KeyAt(uint32_t bucket_idx) const {
 template <typename KeyType, typename ValueType, typename KeyComparator>
 ValueType HASH_TABLE_BUCKET_TYPE::ValueAt(uint32_t bucket_idx) const {
   if (IsReadable(bucket_idx)) {
-    return array_[bucket_idx].second;
+    return values_[bucket_idx];
   }
   return {};
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+std::string HASH_TABLE_BUCKET_TYPE::EntryAt(uint32_t bucket_idx) const {
+  std::string entry(reinterpret_cast<const char *>(&fingerprints_[bucket_idx]), 1);
+  entry.append(reinterpret_cast<const char *>(&keys_[bucket_idx]), sizeof(KeyType));
+  entry.append(reinterpret_cast<const char *>(&values_[bucket_idx]), sizeof(ValueType));
+  return entry;
+}
+
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_BUCKET_TYPE::RemoveAt(uint32_t bucket_idx) {
   SetUnreadable(bucket_idx);
@@ -201,6 +265,21 @@ void HASH_TABLE_BUCKET_TYPE::Reset() {
   memset(readable_, 0, sizeof(readable_));
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+HashBucketSlot HASH_TABLE_BUCKET_TYPE::GetSlot(uint32_t bucket_idx) const {
+  auto base = reinterpret_cast<const char *>(this);
+  return {bucket_idx,
+          static_cast<uint16_t>(occupied_ - base),
+          static_cast<uint16_t>(readable_ - base),
+          static_cast<uint16_t>(reinterpret_cast<const char *>(fingerprints_) - base),
+          static_cast<uint16_t>(reinterpret_cast<const char *>(keys_) - base),
+          static_cast<uint16_t>(reinterpret_cast<const char *>(values_) - base),
+          static_cast<uint16_t>(sizeof(KeyType)),
+          static_cast<uint16_t>(sizeof(ValueType)),
+          static_cast<uint16_t>(1 + sizeof(KeyType) + sizeof(ValueType)),
+          static_cast<uint16_t>(BUCKET_ARRAY_SIZE)};
+}
+
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_BUCKET_TYPE::PrintBucket() {
   uint32_t size = 0;
@@ -232,6 +311,13 @@ template class HashTableBucketPage<GenericKey<16>, RID, GenericComparator<16>>;
 template class HashTableBucketPage<GenericKey<32>, RID, GenericComparator<32>>;
 template class HashTableBucketPage<GenericKey<64>, RID, GenericComparator<64>>;
 
+static_assert(sizeof(HashTableBucketPage<int, int, IntComparator>) <= PAGE_SIZE);
+static_assert(sizeof(HashTableBucketPage<GenericKey<4>, RID, GenericComparator<4>>) <= PAGE_SIZE);
+static_assert(sizeof(HashTableBucketPage<GenericKey<8>, RID, GenericComparator<8>>) <= PAGE_SIZE);
+static_assert(sizeof(HashTableBucketPage<GenericKey<16>, RID, GenericComparator<16>>) <= PAGE_SIZE);
+static_assert(sizeof(HashTableBucketPage<GenericKey<32>, RID, GenericComparator<32>>) <= PAGE_SIZE);
+static_assert(sizeof(HashTableBucketPage<GenericKey<64>, RID, GenericComparator<64>>) <= PAGE_SIZE);
+
 // template class HashTableBucketPage<hash_t, TmpTuple, HashComparator>;
 
 }  // namespace bustub
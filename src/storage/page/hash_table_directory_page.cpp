@@ -26,6 +26,10 @@ void HashTableDirectoryPage::SetLSN(lsn_t lsn) { lsn_ = lsn; }
 
 uint32_t HashTableDirectoryPage::GetGlobalDepth() { return global_depth_; }
 
+uint32_t HashTableDirectoryPage::GetHashShift() { return hash_shift_; }
+
+void HashTableDirectoryPage::SetHashShift(uint32_t hash_shift) { hash_shift_ = hash_shift; }
+
 page_id_t HashTableDirectoryPage::GetBucketPageId(uint32_t bucket_idx) { return bucket_page_ids_[bucket_idx]; }
 
 void HashTableDirectoryPage::SetBucketPageId(uint32_t bucket_idx, page_id_t bucket_page_id) {
@@ -44,10 +48,13 @@ uint32_t HashTableDirectoryPage::GetGlobalDepthMask() { return static_cast<uint3
 
 uint32_t HashTableDirectoryPage::Size() { return static_cast<uint32_t>(0x1 << global_depth_); }
 
+bool HashTableDirectoryPage::IsFull() { return global_depth_ == DIRECTORY_MAX_DEPTH; }
+
 // ----------------------------------  Modify Global Depth  ---------------------------------
 
 void HashTableDirectoryPage::IncrGlobalDepth() {
   // to incr global depth, should copy the bucket_page_ids to the free space.
+  assert(!IsFull());
   size_t bucket_count = Size();
   for (size_t i = 0; i < bucket_count; i++) {
     bucket_page_ids_[i + bucket_count] = bucket_page_ids_[i];
@@ -61,6 +68,23 @@ void HashTableDirectoryPage::DecrGlobalDepth() {
   global_depth_--;
 }
 
+void HashTableDirectoryPage::SplitTo(HashTableDirectoryPage *image) {
+  assert(global_depth_ > 0);
+  uint32_t half = Size() / 2;
+  // entry i goes to i / 2, which never overwrites an entry still to be read
+  for (uint32_t i = 0; i < half; i++) {
+    assert(local_depths_[2 * i] > 0 && local_depths_[2 * i + 1] > 0);
+    image->bucket_page_ids_[i] = bucket_page_ids_[2 * i + 1];
+    image->local_depths_[i] = local_depths_[2 * i + 1] - 1;
+    bucket_page_ids_[i] = bucket_page_ids_[2 * i];
+    local_depths_[i] = local_depths_[2 * i] - 1;
+  }
+  global_depth_--;
+  hash_shift_++;
+  image->global_depth_ = global_depth_;
+  image->hash_shift_ = hash_shift_;
+}
+
 bool HashTableDirectoryPage::CanShrink() {
   // if all page_id_count > 1, we can shrink page which means decr global depth.
   // we can indicate all page_ref_count > 1 by all local_depth < global_depth.
@@ -147,7 +171,7 @@ void HashTableDirectoryPage::VerifyIntegrity() {
 }
 
 void HashTableDirectoryPage::PrintDirectory() {
-  LOG_DEBUG("======== DIRECTORY (global_depth_: %u) ========", global_depth_);
+  LOG_DEBUG("======== DIRECTORY (global_depth_: %u, hash_shift_: %u) ========", global_depth_, hash_shift_);
   LOG_DEBUG("| bucket_idx | page_id | local_depth |");
   for (uint32_t idx = 0; idx < static_cast<uint32_t>(0x1 << global_depth_); idx++) {
     LOG_DEBUG("|      %u     |     %u     |     %u     |", idx, bucket_page_ids_[idx], local_depths_[idx]);
@@ -24,7 +24,7 @@ bool HeaderPage::InsertRecord(const std::string &name, const page_id_t root_id)
   assert(root_id > INVALID_PAGE_ID);
 
   int record_num = GetRecordCount();
-  int offset = 4 + record_num * 36;
+  int offset = RECORDS_OFFSET + record_num * 36;
   // check for duplicate name
   if (FindRecord(name) != -1) {
     return false;
@@ -46,7 +46,7 @@ bool HeaderPage::DeleteRecord(const std::string &name) {
   if (index == -1) {
     return false;
   }
-  int offset = index * 36 + 4;
+  int offset = RECORDS_OFFSET + index * 36;
   memmove(GetData() + offset, GetData() + offset + 36, (record_num - index - 1) * 36);
 
   SetRecordCount(record_num - 1);
@@ -61,7 +61,7 @@ bool HeaderPage::UpdateRecord(const std::string &name, const page_id_t root_id)
   if (index == -1) {
     return false;
   }
-  int offset = index * 36 + 4;
+  int offset = RECORDS_OFFSET + index * 36;
   // update record content, only root_id
   memcpy((GetData() + offset + 32), &root_id, 4);
 
@@ -76,8 +76,8 @@ bool HeaderPage::GetRootId(const std::string &name, page_id_t *root_id) {
   if (index == -1) {
     return false;
   }
-  int offset = (index + 1) * 36;
-  *root_id = *reinterpret_cast<page_id_t *>(GetData() + offset);
+  int offset = RECORDS_OFFSET + index * 36;
+  *root_id = *reinterpret_cast<page_id_t *>(GetData() + offset + 32);
 
   return true;
 }
@@ -94,7 +94,7 @@ int HeaderPage::FindRecord(const std::string &name) {
   int record_num = GetRecordCount();
 
   for (int i = 0; i < record_num; i++) {
-    char *raw_name = reinterpret_cast<char *>(GetData() + (4 + i * 36));
+    char *raw_name = reinterpret_cast<char *>(GetData() + (RECORDS_OFFSET + i * 36));
     if (strcmp(raw_name, name.c_str()) == 0) {
       return i;
     }
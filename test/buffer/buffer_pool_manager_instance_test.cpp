@@ -11,9 +11,15 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/buffer_pool_manager_instance.h"
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
 #include <cstdio>
+#include <mutex>  // NOLINT
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
 
@@ -141,4 +147,194 @@ TEST(BufferPoolManagerInstanceTest, SampleTest) {
   delete disk_manager;
 }
 
+// Deleted pages give their ids back to NewPage, whether they are in the buffer pool or not.
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, DeletePageReuseTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 3;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  page_id_t page_id_temp;
+  for (int i = 0; i < 6; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_EQ(i, page_id_temp);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+  }
+
+  // Scenario: a pinned page can't be deleted and keeps its id.
+  ASSERT_NE(nullptr, bpm->FetchPage(4));
+  EXPECT_FALSE(bpm->DeletePage(4));
+
+  // Scenario: page 1 was evicted, page 5 is still in the buffer pool. Deleting a page twice frees it once.
+  EXPECT_TRUE(bpm->DeletePage(5));
+  EXPECT_TRUE(bpm->DeletePage(1));
+  EXPECT_TRUE(bpm->DeletePage(1));
+
+  // Scenario: the lowest free ids are handed out first, then new ones.
+  auto *page = bpm->NewPage(&page_id_temp);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(1, page_id_temp);
+  EXPECT_EQ(0, page->GetData()[0]);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_EQ(5, page_id_temp);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_EQ(6, page_id_temp);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+  EXPECT_EQ(true, bpm->UnpinPage(4, false));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// Prefetched pages must read back correctly and never hold on to a frame
+TEST(BufferPoolManagerInstanceTest, PrefetchTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Scenario: write more pages than fit into the buffer pool, so the first ones are evicted.
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size * 2; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+  }
+
+  // Scenario: hints for evicted, resident and invalid pages are all fine.
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(buffer_pool_size) * 2; ++page_id) {
+    bpm->PrefetchPage(page_id);
+  }
+  bpm->PrefetchPage(INVALID_PAGE_ID);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  // Scenario: prefetched pages are not pinned, so every frame can still be pinned.
+  std::vector<Page *> pages;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    pages.push_back(bpm->FetchPage(static_cast<page_id_t>(i)));
+    ASSERT_NE(nullptr, pages.back());
+    EXPECT_EQ(0, strcmp(pages.back()->GetData(), ("page " + std::to_string(i)).c_str()));
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    EXPECT_EQ(true, bpm->UnpinPage(static_cast<page_id_t>(i), false));
+  }
+
+  // Scenario: the data reads back after prefetching while frames are busy.
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(buffer_pool_size) * 2; ++page_id) {
+    bpm->PrefetchPage(page_id);
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, strcmp(page->GetData(), ("page " + std::to_string(page_id)).c_str()));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+/** Holds the read of one page until Release() is called. */
+class BlockingDiskManager : public DiskManager {
+ public:
+  BlockingDiskManager(const std::string &db_file, page_id_t blocked_page_id)
+      : DiskManager(db_file), blocked_page_id_(blocked_page_id) {}
+
+  void ReadPage(page_id_t page_id, char *page_data) override {
+    if (page_id == blocked_page_id_) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      reading_ = true;
+      cv_.notify_all();
+      cv_.wait(lock, [this] { return released_; });
+    }
+    DiskManager::ReadPage(page_id, page_data);
+  }
+
+  /** Wait until the blocked page is being read. */
+  void WaitForRead() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return reading_; });
+  }
+
+  void Release() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    released_ = true;
+    cv_.notify_all();
+  }
+
+ private:
+  const page_id_t blocked_page_id_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool reading_{false};
+  bool released_{false};
+};
+
+// A page whose prefetch is in flight must not block the buffer pool, and a fetch of it waits for its content
+TEST(BufferPoolManagerInstanceTest, PrefetchInFlightTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+  const page_id_t prefetched_page_id = 3;
+
+  auto *disk_manager = new BlockingDiskManager(db_name, prefetched_page_id);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size * 2; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+  }
+
+  // Scenario: the prefetch thread is stuck reading an evicted page.
+  bpm->PrefetchPage(prefetched_page_id);
+  disk_manager->WaitForRead();
+
+  // Scenario: a fetch of that page waits for the read to finish.
+  std::atomic<bool> fetched{false};
+  Page *prefetched_page = nullptr;
+  std::thread fetcher([&] {
+    prefetched_page = bpm->FetchPage(prefetched_page_id);
+    fetched = true;
+  });
+
+  // Scenario: other pages can still be fetched, created and flushed meanwhile.
+  auto *page = bpm->FetchPage(buffer_pool_size * 2 - 1);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(0, strcmp(page->GetData(), ("page " + std::to_string(buffer_pool_size * 2 - 1)).c_str()));
+  EXPECT_EQ(true, bpm->UnpinPage(buffer_pool_size * 2 - 1, false));
+  page = bpm->NewPage(&page_id_temp);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+  EXPECT_EQ(true, bpm->FlushPage(page_id_temp));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(fetched);
+
+  // Scenario: once read, the fetch gets the page's content.
+  disk_manager->Release();
+  fetcher.join();
+  ASSERT_NE(nullptr, prefetched_page);
+  EXPECT_EQ(0, strcmp(prefetched_page->GetData(), ("page " + std::to_string(prefetched_page_id)).c_str()));
+  EXPECT_EQ(1, prefetched_page->GetPinCount());
+  EXPECT_EQ(true, bpm->UnpinPage(prefetched_page_id, false));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
 }  // namespace bustub
@@ -0,0 +1,150 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// hash_function_test.cpp
+//
+// Identification: test/container/hash_function_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "common/logger.h"
+#include "container/hash/hash_function.h"
+#include "gtest/gtest.h"
+#include "storage/index/generic_key.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+/** Set a key to the low bytes of an integer, GenericKey<4> can not take a whole one. */
+template <typename KeyType>
+void SetKey(KeyType *key, int64_t i) {
+  memset(reinterpret_cast<void *>(key), 0, sizeof(KeyType));
+  memcpy(reinterpret_cast<void *>(key), &i, std::min(sizeof(KeyType), sizeof(i)));
+}
+
+/**
+ * Spread sequential keys over 256 buckets by the low byte of their hash, which extendible hashing indexes by, and by
+ * the top byte, which the bucket pages take fingerprints from.
+ * @return the chi-squared statistic of the fuller of the two, about 255 for a uniform hash
+ */
+template <typename KeyType, typename HashPolicy>
+double ChiSquared(int num_keys) {
+  HashFunction<KeyType, HashPolicy> hash_fn;
+  std::vector<double> low(256), high(256);
+  for (int i = 0; i < num_keys; i++) {
+    KeyType key;
+    SetKey(&key, i);
+    uint64_t hash = hash_fn.GetHash(key);
+    low[hash & 0xff]++;
+    high[hash >> 56]++;
+  }
+  double expected = num_keys / 256.0;
+  double low_chi_squared = 0;
+  double high_chi_squared = 0;
+  for (int i = 0; i < 256; i++) {
+    low_chi_squared += (low[i] - expected) * (low[i] - expected) / expected;
+    high_chi_squared += (high[i] - expected) * (high[i] - expected) / expected;
+  }
+  return std::max(low_chi_squared, high_chi_squared);
+}
+
+/** @return the average fraction of hash bits that flip when one key bit flips, 0.5 for a good hash */
+template <typename KeyType, typename HashPolicy>
+double Avalanche(int num_keys) {
+  HashFunction<KeyType, HashPolicy> hash_fn;
+  double flipped = 0;
+  int trials = 0;
+  for (int i = 0; i < num_keys; i++) {
+    KeyType key;
+    SetKey(&key, i * 7919);
+    uint64_t hash = hash_fn.GetHash(key);
+    for (size_t bit = 0; bit < 8 * sizeof(KeyType); bit += 3) {
+      KeyType flipped_key = key;
+      reinterpret_cast<char *>(&flipped_key)[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+      flipped += __builtin_popcountll(hash ^ hash_fn.GetHash(flipped_key)) / 64.0;
+      trials++;
+    }
+  }
+  return flipped / trials;
+}
+
+// The policy is chosen from the key size, and sequential keys spread evenly over both ends of the hash
+TEST(HashFunctionTest, HashQualityTest) {
+  static_assert(std::is_same_v<DefaultHashPolicy<int>, IntegerHashPolicy>);
+  static_assert(std::is_same_v<DefaultHashPolicy<GenericKey<8>>, IntegerHashPolicy>);
+  static_assert(std::is_same_v<DefaultHashPolicy<GenericKey<16>>, BytesHashPolicy>);
+
+  // 255 degrees of freedom, 400 is far beyond the 99.99th percentile of a uniform hash
+  EXPECT_LT((ChiSquared<GenericKey<4>, IntegerHashPolicy>(100000)), 400);
+  EXPECT_LT((ChiSquared<GenericKey<8>, IntegerHashPolicy>(100000)), 400);
+  EXPECT_LT((ChiSquared<GenericKey<16>, BytesHashPolicy>(100000)), 400);
+  EXPECT_LT((ChiSquared<GenericKey<64>, BytesHashPolicy>(100000)), 400);
+
+  EXPECT_NEAR((Avalanche<GenericKey<8>, IntegerHashPolicy>(1000)), 0.5, 0.02);
+  EXPECT_NEAR((Avalanche<GenericKey<16>, BytesHashPolicy>(1000)), 0.5, 0.02);
+  EXPECT_NEAR((Avalanche<GenericKey<64>, BytesHashPolicy>(1000)), 0.5, 0.02);
+
+  // the hash of a value depends on the value only, and the order of combined hashes matters
+  Value text = ValueFactory::GetVarcharValue(std::string(40, 'x'));
+  Value same_text = ValueFactory::GetVarcharValue(std::string(40, 'x'));
+  Value shorter_text = ValueFactory::GetVarcharValue(std::string(39, 'x'));
+  EXPECT_EQ(HashUtil::HashValue(&text), HashUtil::HashValue(&same_text));
+  EXPECT_NE(HashUtil::HashValue(&text), HashUtil::HashValue(&shorter_text));
+  Value one = ValueFactory::GetIntegerValue(1);
+  Value two = ValueFactory::GetIntegerValue(2);
+  hash_t one_hash = HashUtil::HashValue(&one);
+  hash_t two_hash = HashUtil::HashValue(&two);
+  EXPECT_NE(HashUtil::CombineHashes(one_hash, two_hash), HashUtil::CombineHashes(two_hash, one_hash));
+}
+
+template <typename KeyType, typename HashPolicy>
+double TimeHash(int num_keys) {
+  HashFunction<KeyType, HashPolicy> hash_fn;
+  std::vector<KeyType> keys(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    SetKey(&keys[i], i);
+  }
+  uint64_t sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < 10; round++) {
+    for (const auto &key : keys) {
+      sum += hash_fn.GetHash(key);
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_NE(0, sum);
+  return elapsed.count() / (10.0 * num_keys);
+}
+
+// Nanoseconds per hash and the distribution of each key size, with the chosen policy and with murmur3
+TEST(HashFunctionTest, DISABLED_HashBenchmark) {
+  const int num_keys = 1000000;
+  LOG_INFO("GenericKey<4>: %.2f ns (chi2 %.0f), murmur3 %.2f ns (chi2 %.0f)",
+           TimeHash<GenericKey<4>, IntegerHashPolicy>(num_keys), ChiSquared<GenericKey<4>, IntegerHashPolicy>(num_keys),
+           TimeHash<GenericKey<4>, Murmur3HashPolicy>(num_keys),
+           ChiSquared<GenericKey<4>, Murmur3HashPolicy>(num_keys));
+  LOG_INFO("GenericKey<8>: %.2f ns (chi2 %.0f), murmur3 %.2f ns (chi2 %.0f)",
+           TimeHash<GenericKey<8>, IntegerHashPolicy>(num_keys), ChiSquared<GenericKey<8>, IntegerHashPolicy>(num_keys),
+           TimeHash<GenericKey<8>, Murmur3HashPolicy>(num_keys),
+           ChiSquared<GenericKey<8>, Murmur3HashPolicy>(num_keys));
+  LOG_INFO("GenericKey<32>: %.2f ns (chi2 %.0f), murmur3 %.2f ns (chi2 %.0f)",
+           TimeHash<GenericKey<32>, BytesHashPolicy>(num_keys), ChiSquared<GenericKey<32>, BytesHashPolicy>(num_keys),
+           TimeHash<GenericKey<32>, Murmur3HashPolicy>(num_keys),
+           ChiSquared<GenericKey<32>, Murmur3HashPolicy>(num_keys));
+  LOG_INFO("GenericKey<64>: %.2f ns (chi2 %.0f), murmur3 %.2f ns (chi2 %.0f)",
+           TimeHash<GenericKey<64>, BytesHashPolicy>(num_keys), ChiSquared<GenericKey<64>, BytesHashPolicy>(num_keys),
+           TimeHash<GenericKey<64>, Murmur3HashPolicy>(num_keys),
+           ChiSquared<GenericKey<64>, Murmur3HashPolicy>(num_keys));
+}
+
+}  // namespace bustub
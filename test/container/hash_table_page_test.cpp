@@ -10,7 +10,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <chrono>  // NOLINT
 #include <thread>  // NOLINT
+#include <utility>
 #include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
@@ -114,4 +116,113 @@ TEST(HashTablePageTest, BucketPageSampleTest) {
   delete bpm;
 }
 
+// Keys share buckets groups and fingerprints with other keys, and slots are freed and reused across groups
+// NOLINTNEXTLINE
+TEST(HashTablePageTest, BucketPageFingerprintTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(5, disk_manager);
+
+  page_id_t bucket_page_id = INVALID_PAGE_ID;
+  auto bucket_page = reinterpret_cast<HashTableBucketPage<int, int, IntComparator> *>(
+      bpm->NewPage(&bucket_page_id, nullptr)->GetData());
+  uint32_t size = bucket_page->Size();
+
+  // a few keys with many values each, interleaved over every group
+  for (uint32_t i = 0; i < size; i++) {
+    uint32_t slot_idx;
+    ASSERT_TRUE(bucket_page->Insert(i % 7, i, IntComparator(), &slot_idx));
+    EXPECT_EQ(i, slot_idx);
+  }
+  EXPECT_TRUE(bucket_page->IsFull());
+  EXPECT_FALSE(bucket_page->Insert(100, 100, IntComparator()));
+
+  std::vector<int> result;
+  for (int key = 0; key < 7; key++) {
+    result.clear();
+    ASSERT_TRUE(bucket_page->GetValue(key, IntComparator(), &result));
+    ASSERT_EQ((size - key + 6) / 7, result.size());
+    for (int value : result) {
+      EXPECT_EQ(key, value % 7);
+    }
+  }
+  result.clear();
+  EXPECT_FALSE(bucket_page->GetValue(7, IntComparator(), &result));
+
+  // a duplicate pair in the last group is found
+  EXPECT_FALSE(bucket_page->Insert((size - 1) % 7, size - 1, IntComparator()));
+
+  // free every third slot, the freed slots are reused in order
+  for (uint32_t i = 0; i < size; i += 3) {
+    ASSERT_TRUE(bucket_page->Remove(i % 7, i, IntComparator()));
+  }
+  EXPECT_FALSE(bucket_page->Remove(0, 0, IntComparator()));
+  result.clear();
+  ASSERT_TRUE(bucket_page->GetValue(1, IntComparator(), &result));
+  for (int value : result) {
+    EXPECT_NE(0, value % 3);
+  }
+  for (uint32_t i = 0; i < size; i += 3) {
+    uint32_t slot_idx;
+    ASSERT_TRUE(bucket_page->Insert(-1, i, IntComparator(), &slot_idx));
+    EXPECT_EQ(i, slot_idx);
+  }
+  result.clear();
+  ASSERT_TRUE(bucket_page->GetValue(-1, IntComparator(), &result));
+  EXPECT_EQ((size + 2) / 3, result.size());
+  EXPECT_TRUE(bucket_page->IsFull());
+
+  bpm->UnpinPage(bucket_page_id, true, nullptr);
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// Lookups in a full bucket, against a scan of (key, value) pairs that compares every key
+// NOLINTNEXTLINE
+TEST(HashTablePageTest, DISABLED_BucketPageLookupBenchmark) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(5, disk_manager);
+
+  page_id_t bucket_page_id = INVALID_PAGE_ID;
+  auto bucket_page = reinterpret_cast<HashTableBucketPage<int, int, IntComparator> *>(
+      bpm->NewPage(&bucket_page_id, nullptr)->GetData());
+  int size = static_cast<int>(bucket_page->Size());
+  std::vector<std::pair<int, int>> pairs;
+  for (int i = 0; i < size; i++) {
+    bucket_page->Insert(i, i, IntComparator());
+    pairs.emplace_back(i, i);
+  }
+
+  constexpr int rounds = 2000;
+  std::vector<int> result;
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    result.clear();
+    bucket_page->GetValue(round % size, IntComparator(), &result);
+  }
+  std::chrono::duration<double, std::nano> bucket_elapsed = std::chrono::steady_clock::now() - start;
+
+  IntComparator cmp;
+  start = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    result.clear();
+    for (const auto &pair : pairs) {
+      if (cmp(pair.first, round % size) == 0) {
+        result.push_back(pair.second);
+      }
+    }
+  }
+  std::chrono::duration<double, std::nano> scan_elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_EQ(1, result.size());
+  LOG_INFO("bucket of %d: %.1f ns per lookup, %.1f ns scanning pairs", size, bucket_elapsed.count() / rounds,
+           scan_elapsed.count() / rounds);
+
+  bpm->UnpinPage(bucket_page_id, true, nullptr);
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
 }  // namespace bustub
@@ -10,8 +10,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <iostream>
 #include <thread>  // NOLINT
+#include <utility>
 #include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
@@ -202,4 +206,415 @@ TEST(HashTableTest, MySplitShrinkTest2) {
   delete bpm;
 }
 
+TEST(HashTableTest, BulkInsertTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  // 16 buckets hold 5000 entries at the reserved fill, so the directory starts out at depth 4
+  std::vector<std::pair<int, int>> entries;
+  for (int i = 0; i < 5000; i++) {
+    entries.emplace_back(i, i);
+  }
+  ht.BulkInsert(nullptr, entries);
+  EXPECT_GE(ht.GetGlobalDepth(), 4);
+  ht.VerifyIntegrity();
+
+  std::vector<int> res;
+  for (int i = 0; i < 5000; i++) {
+    res.clear();
+    ht.GetValue(nullptr, i, &res);
+    ASSERT_EQ(res.size(), 1);
+    EXPECT_EQ(res[0], i);
+  }
+
+  // a table that holds entries is not resized
+  uint32_t global_depth = ht.GetGlobalDepth();
+  ht.Reserve(100000);
+  EXPECT_EQ(ht.GetGlobalDepth(), global_depth);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// more buckets than a directory page holds, inserted from several threads
+TEST(HashTableTest, MultiPageDirectoryTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(2000, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  const int num_keys = 300000;
+  const int num_threads = 4;
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < num_threads; thread++) {
+    threads.emplace_back([&ht, thread] {
+      for (int i = thread; i < num_keys; i += num_threads) {
+        ht.Insert(nullptr, i, i);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_GT(ht.GetGlobalDepth(), DIRECTORY_MAX_DEPTH);
+  ht.VerifyIntegrity();
+
+  std::vector<int> res;
+  for (int i = 0; i < num_keys; i++) {
+    res.clear();
+    ht.GetValue(nullptr, i, &res);
+    ASSERT_EQ(res.size(), 1) << "key " << i;
+    EXPECT_EQ(res[0], i);
+  }
+  for (int i = 0; i < num_keys; i += 2) {
+    EXPECT_TRUE(ht.Remove(nullptr, i, i));
+  }
+  ht.VerifyIntegrity();
+  for (int i = 0; i < num_keys; i++) {
+    res.clear();
+    EXPECT_EQ(ht.GetValue(nullptr, i, &res), i % 2 == 1);
+  }
+
+  // a reserved table spreads over directory pages from the start
+  ExtendibleHashTable<int, int, IntComparator> reserved("blah", bpm, IntComparator(), HashFunction<int>());
+  reserved.Reserve(1000000);
+  EXPECT_EQ(reserved.GetGlobalDepth(), 12);
+  reserved.VerifyIntegrity();
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_TRUE(reserved.Insert(nullptr, i, i));
+  }
+  for (int i = 0; i < 1000; i++) {
+    res.clear();
+    EXPECT_TRUE(reserved.GetValue(nullptr, i, &res));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// splits and merges of different buckets go on side by side
+TEST(HashTableTest, ConcurrentSplitMergeTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(200, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  const int num_keys = 40000;
+  const int num_threads = 4;
+  for (int round = 0; round < 2; round++) {
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < num_threads; thread++) {
+      threads.emplace_back([&ht, thread] {
+        std::vector<int> res;
+        for (int i = thread; i < num_keys; i += num_threads) {
+          EXPECT_TRUE(ht.Insert(nullptr, i, i));
+          res.clear();
+          EXPECT_TRUE(ht.GetValue(nullptr, i, &res));
+          // empty out the buckets of the keys inserted a while ago, merging them back
+          if (i >= 8000) {
+            EXPECT_TRUE(ht.Remove(nullptr, i - 8000, i - 8000));
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    ht.VerifyIntegrity();
+    std::vector<int> res;
+    for (int i = 0; i < num_keys; i++) {
+      res.clear();
+      ASSERT_EQ(ht.GetValue(nullptr, i, &res), i >= num_keys - 8000) << "key " << i;
+    }
+    for (int i = num_keys - 8000; i < num_keys; i++) {
+      EXPECT_TRUE(ht.Remove(nullptr, i, i));
+    }
+    ht.VerifyIntegrity();
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// lookups latch nothing, they still find every key while writers split, merge and chain the buckets under them
+TEST(HashTableTest, OptimisticLookupTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(100, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  const int num_keys = 10000;
+  const int hot_key = num_keys + 1;
+  for (int i = 0; i < num_keys; i++) {
+    ht.Insert(nullptr, i, i);
+  }
+  std::atomic<bool> done{false};
+  // the keys from num_keys on come and go, the values of hot_key fill overflow pages and empty them again
+  std::thread writer([&ht, &done, hot_key] {
+    for (int round = 0; round < 3; round++) {
+      for (int i = num_keys; i < 3 * num_keys; i++) {
+        ht.Insert(nullptr, i, i);
+        if (i % 10 == 0) {
+          ht.Insert(nullptr, hot_key, -i);
+        }
+      }
+      for (int i = num_keys; i < 3 * num_keys; i++) {
+        ht.Remove(nullptr, i, i);
+        if (i % 10 == 0) {
+          ht.Remove(nullptr, hot_key, -i);
+        }
+      }
+    }
+    done = true;
+  });
+  std::vector<std::thread> readers;
+  for (int thread = 0; thread < 3; thread++) {
+    readers.emplace_back([&ht, &done, thread] {
+      std::vector<int> res;
+      while (!done) {
+        for (int i = thread; i < num_keys; i += 7) {
+          res.clear();
+          ASSERT_TRUE(ht.GetValue(nullptr, i, &res)) << "key " << i;
+          ASSERT_EQ(std::vector<int>{i}, res);
+        }
+      }
+    });
+  }
+  writer.join();
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  std::vector<int> res;
+  EXPECT_FALSE(ht.GetValue(nullptr, hot_key, &res));
+  ht.VerifyIntegrity();
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// removes leave the merging to the maintenance thread, which keeps to its rate and catches up in the end
+TEST(HashTableTest, BackgroundMergeTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(100, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  const int num_keys = 20000;
+  // one merge every few seconds, nothing gets merged before the thread stops
+  ht.StartBackgroundMerge(1, std::chrono::seconds(5));
+  for (int i = 0; i < num_keys; i++) {
+    ht.Insert(nullptr, i, i);
+  }
+  uint32_t global_depth = ht.GetGlobalDepth();
+  EXPECT_GT(global_depth, 4);
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(ht.Remove(nullptr, i, i));
+  }
+  EXPECT_EQ(global_depth, ht.GetGlobalDepth());
+  ht.StopBackgroundMerge();
+  EXPECT_EQ(0, ht.GetGlobalDepth());
+  ht.VerifyIntegrity();
+
+  // merges go on while other threads insert, remove and look up keys
+  ht.StartBackgroundMerge(16, std::chrono::milliseconds(1));
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < 4; thread++) {
+    threads.emplace_back([&ht, thread] {
+      std::vector<int> res;
+      for (int round = 0; round < 2; round++) {
+        for (int i = thread; i < num_keys; i += 4) {
+          EXPECT_TRUE(ht.Insert(nullptr, i, i));
+        }
+        for (int i = thread; i < num_keys; i += 4) {
+          res.clear();
+          EXPECT_TRUE(ht.GetValue(nullptr, i, &res));
+          EXPECT_TRUE(ht.Remove(nullptr, i, i));
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ht.WaitForMerges();
+  EXPECT_EQ(0, ht.GetGlobalDepth());
+  ht.VerifyIntegrity();
+  ht.StopBackgroundMerge();
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// a batch finds the same values as one lookup per key, while other threads split and merge the buckets
+TEST(HashTableTest, BatchLookupTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(100, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  const int num_keys = 20000;
+  for (int i = 0; i < num_keys; i++) {
+    ht.Insert(nullptr, i, i);
+    if (i % 10 == 0) {
+      ht.Insert(nullptr, i, -i - 1);
+    }
+  }
+
+  // present keys, missing keys and repeated keys in no particular order
+  std::vector<int> keys;
+  for (int i = 0; i < 3000; i++) {
+    keys.push_back((i * 7919) % (2 * num_keys));
+  }
+  keys.push_back(keys[0]);
+  std::vector<std::vector<int>> results;
+  ht.GetValues(nullptr, keys, &results);
+  ASSERT_EQ(keys.size(), results.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    std::vector<int> expected;
+    ht.GetValue(nullptr, keys[i], &expected);
+    std::sort(results[i].begin(), results[i].end());
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(expected, results[i]) << "key " << keys[i];
+    ASSERT_EQ(keys[i] < num_keys ? (keys[i] % 10 == 0 ? 2 : 1) : 0, results[i].size());
+  }
+  ht.GetValues(nullptr, {}, &results);
+  EXPECT_TRUE(results.empty());
+
+  // the keys below num_keys stay put while the others come and go
+  std::thread writer([&ht] {
+    for (int round = 0; round < 3; round++) {
+      for (int i = num_keys; i < 2 * num_keys; i++) {
+        ht.Insert(nullptr, i, i);
+      }
+      for (int i = num_keys; i < 2 * num_keys; i++) {
+        ht.Remove(nullptr, i, i);
+      }
+    }
+  });
+  std::vector<int> stable_keys;
+  for (int i = 0; i < num_keys; i += 3) {
+    stable_keys.push_back(i);
+  }
+  for (int round = 0; round < 20; round++) {
+    ht.GetValues(nullptr, stable_keys, &results);
+    for (size_t i = 0; i < stable_keys.size(); i++) {
+      ASSERT_EQ(stable_keys[i] % 10 == 0 ? 2 : 1, results[i].size()) << "key " << stable_keys[i];
+    }
+  }
+  writer.join();
+  ht.VerifyIntegrity();
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// far more values for one key than a bucket holds go to overflow pages instead of splitting the directory to the end
+TEST(HashTableTest, SkewedDuplicatesTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+
+  const int hot_key = 7;
+  const int num_duplicates = 5000;
+  const int num_keys = 2000;
+  for (int i = 0; i < num_duplicates; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, hot_key, i));
+    // the other keys arrive in between, some of them go to the bucket of the hot key
+    if (i < num_keys && i != hot_key) {
+      ASSERT_TRUE(ht.Insert(nullptr, i, i));
+    }
+  }
+  EXPECT_FALSE(ht.Insert(nullptr, hot_key, 0));
+  EXPECT_FALSE(ht.Insert(nullptr, hot_key, num_duplicates - 1));
+  EXPECT_LE(ht.GetGlobalDepth(), 6);
+  ht.VerifyIntegrity();
+
+  std::vector<int> res;
+  ASSERT_TRUE(ht.GetValue(nullptr, hot_key, &res));
+  std::sort(res.begin(), res.end());
+  ASSERT_EQ(num_duplicates, res.size());
+  for (int i = 0; i < num_duplicates; i++) {
+    ASSERT_EQ(i, res[i]);
+  }
+  std::vector<std::vector<int>> results;
+  ht.GetValues(nullptr, {hot_key, 1, hot_key}, &results);
+  EXPECT_EQ(num_duplicates, results[0].size());
+  EXPECT_EQ(std::vector<int>{1}, results[1]);
+  EXPECT_EQ(num_duplicates, results[2].size());
+  for (int i = 0; i < num_keys; i++) {
+    res.clear();
+    ASSERT_TRUE(ht.GetValue(nullptr, i, &res));
+  }
+
+  // emptying the overflow pages frees them, after which the buckets merge again
+  for (int i = 0; i < num_duplicates; i++) {
+    ASSERT_TRUE(ht.Remove(nullptr, hot_key, i));
+    ASSERT_FALSE(ht.Remove(nullptr, hot_key, i));
+  }
+  res.clear();
+  EXPECT_FALSE(ht.GetValue(nullptr, hot_key, &res));
+  for (int i = 0; i < num_keys; i++) {
+    if (i != hot_key) {
+      ASSERT_TRUE(ht.Remove(nullptr, i, i));
+    }
+  }
+  EXPECT_EQ(0, ht.GetGlobalDepth());
+  ht.VerifyIntegrity();
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// Probing a table in batches against one key at a time, with the pool holding all of its pages and with a pool much
+// smaller than the table
+TEST(HashTableTest, DISABLED_BatchLookupBenchmark) {
+  const int num_keys = 200000;
+  for (size_t pool_size : {2000, 50}) {
+    auto *disk_manager = new DiskManager("test.db");
+    auto *bpm = new BufferPoolManagerInstance(pool_size, disk_manager);
+    ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
+    for (int i = 0; i < num_keys; i++) {
+      ht.Insert(nullptr, i, i);
+    }
+    std::vector<int> keys(num_keys);
+    for (int i = 0; i < num_keys; i++) {
+      keys[i] = static_cast<int>((i * 7919LL) % num_keys);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int> res;
+    for (int key : keys) {
+      res.clear();
+      ht.GetValue(nullptr, key, &res);
+    }
+    std::chrono::duration<double, std::milli> single_elapsed = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    std::vector<std::vector<int>> results;
+    const size_t batch_size = 1000;
+    for (size_t i = 0; i < keys.size(); i += batch_size) {
+      std::vector<int> batch(keys.begin() + i, keys.begin() + std::min(keys.size(), i + batch_size));
+      ht.GetValues(nullptr, batch, &results);
+    }
+    std::chrono::duration<double, std::milli> batch_elapsed = std::chrono::steady_clock::now() - start;
+    LOG_INFO("%d lookups with %zu frames: %.1f ms one by one, %.1f ms in batches of %zu", num_keys, pool_size,
+             single_elapsed.count(), batch_elapsed.count(), batch_size);
+
+    disk_manager->ShutDown();
+    remove("test.db");
+    delete disk_manager;
+    delete bpm;
+  }
+}
+
 }  // namespace bustub
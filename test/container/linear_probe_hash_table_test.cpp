@@ -0,0 +1,195 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// linear_probe_hash_table_test.cpp
+//
+// Identification: test/container/linear_probe_hash_table_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <random>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "common/logger.h"
+#include "container/hash/extendible_hash_table.h"
+#include "container/hash/linear_probe_hash_table.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(LinearProbeHashTableTest, SampleTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  LinearProbeHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), 1000, HashFunction<int>());
+
+  // insert a few values, and a second value for each key
+  for (int i = 0; i < 5; i++) {
+    EXPECT_TRUE(ht.Insert(nullptr, i, i));
+    // duplicate values for the same key are not allowed
+    EXPECT_FALSE(ht.Insert(nullptr, i, i));
+  }
+  for (int i = 1; i < 5; i++) {
+    EXPECT_TRUE(ht.Insert(nullptr, i, 2 * i));
+  }
+  for (int i = 0; i < 5; i++) {
+    std::vector<int> res;
+    EXPECT_TRUE(ht.GetValue(nullptr, i, &res));
+    std::sort(res.begin(), res.end());
+    EXPECT_EQ(i == 0 ? std::vector<int>({0}) : std::vector<int>({i, 2 * i}), res);
+  }
+  std::vector<int> res;
+  EXPECT_FALSE(ht.GetValue(nullptr, 20, &res));
+
+  // delete some values, the other value of the key stays reachable past the tombstone
+  for (int i = 0; i < 5; i++) {
+    EXPECT_TRUE(ht.Remove(nullptr, i, i));
+    EXPECT_FALSE(ht.Remove(nullptr, i, i));
+    res.clear();
+    ht.GetValue(nullptr, i, &res);
+    EXPECT_EQ(i == 0 ? std::vector<int>() : std::vector<int>({2 * i}), res);
+  }
+  // the slots of whole blocks
+  EXPECT_GE(ht.GetSize(), 1000);
+  EXPECT_EQ(0, ht.GetSize() % (4 * PAGE_SIZE / (4 * sizeof(std::pair<int, int>) + 1)));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// Every entry stays reachable while a resize moves them over, and the pairs not yet moved are still duplicates
+// NOLINTNEXTLINE
+TEST(LinearProbeHashTableTest, IncrementalResizeTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(20, disk_manager);
+  LinearProbeHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), 10, HashFunction<int>());
+  size_t initial_size = ht.GetSize();
+
+  const int num_keys = 20000;
+  int resizing_inserts = 0;
+  for (int i = 0; i < num_keys; i++) {
+    ASSERT_TRUE(ht.Insert(nullptr, i, i));
+    if (ht.IsResizing()) {
+      resizing_inserts++;
+      // the first keys are moved last, they are found and rejected in whichever table they are in
+      ASSERT_FALSE(ht.Insert(nullptr, i / 2, i / 2));
+      std::vector<int> res;
+      ASSERT_TRUE(ht.GetValue(nullptr, i / 3, &res));
+      ASSERT_EQ(1, res.size());
+    }
+  }
+  EXPECT_GT(resizing_inserts, 0);
+  EXPECT_GE(ht.GetSize(), 4 * num_keys / 3);
+  EXPECT_GT(ht.GetSize(), initial_size);
+
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<int> res;
+    ASSERT_TRUE(ht.GetValue(nullptr, i, &res)) << i;
+    ASSERT_EQ(std::vector<int>{i}, res);
+  }
+
+  // remove the odd keys, also while a resize started by hand is moving them
+  ht.Resize(ht.GetSize());
+  EXPECT_TRUE(ht.IsResizing());
+  for (int i = 1; i < num_keys; i += 2) {
+    ASSERT_TRUE(ht.Remove(nullptr, i, i));
+  }
+  EXPECT_FALSE(ht.IsResizing());
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<int> res;
+    ASSERT_EQ(i % 2 == 0, ht.GetValue(nullptr, i, &res)) << i;
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// Lookups run alongside inserts that resize the table
+// NOLINTNEXTLINE
+TEST(LinearProbeHashTableTest, ConcurrentInsertTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(30, disk_manager);
+  LinearProbeHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), 100, HashFunction<int>());
+
+  const int num_threads = 4;
+  const int num_keys = 20000;
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < num_threads; thread++) {
+    threads.emplace_back([&ht, thread] {
+      for (int i = thread; i < num_keys; i += num_threads) {
+        ht.Insert(nullptr, i, i);
+        std::vector<int> res;
+        // every thread has inserted its first few keys already
+        ht.GetValue(nullptr, i / 2 / num_threads * num_threads + thread, &res);
+        ASSERT_EQ(1, res.size());
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (int i = 0; i < num_keys; i++) {
+    std::vector<int> res;
+    ASSERT_TRUE(ht.GetValue(nullptr, i, &res)) << i;
+    ASSERT_EQ(i, res[0]);
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+// Lookup heavy workload, nine lookups for every insert, against the extendible hash table
+// NOLINTNEXTLINE
+TEST(LinearProbeHashTableTest, DISABLED_LookupBenchmark) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(500, disk_manager);
+  LinearProbeHashTable<int, int, IntComparator> linear_probe("blah", bpm, IntComparator(), 1000, HashFunction<int>());
+  ExtendibleHashTable<int, int, IntComparator> extendible("blah", bpm, IntComparator(), HashFunction<int>());
+
+  const int num_keys = 100000;
+  std::vector<int> keys(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    keys[i] = i;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+  std::mt19937 rng(1);
+  auto run = [&](auto *ht) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_keys; i++) {
+      ht->Insert(nullptr, keys[i], keys[i]);
+      for (int j = 0; j < 9; j++) {
+        std::vector<int> res;
+        ht->GetValue(nullptr, keys[rng() % (i + 1)], &res);
+        EXPECT_EQ(1, res.size());
+      }
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+  };
+  double linear_probe_ms = run(&linear_probe);
+  double extendible_ms = run(&extendible);
+  LOG_INFO("%d inserts and %d lookups: linear probing %.1f ms, extendible hashing %.1f ms", num_keys, 9 * num_keys,
+           linear_probe_ms, extendible_ms);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
+}  // namespace bustub
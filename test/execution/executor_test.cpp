@@ -22,6 +22,7 @@
 #include "execution/execution_engine.h"
 #include "execution/executor_context.h"
 #include "execution/executors/aggregation_executor.h"
+#include "execution/executors/index_scan_executor.h"
 #include "execution/executors/insert_executor.h"
 #include "execution/executors/nested_loop_join_executor.h"
 #include "execution/expressions/aggregate_value_expression.h"
@@ -31,6 +32,7 @@
 #include "execution/plans/delete_plan.h"
 #include "execution/plans/distinct_plan.h"
 #include "execution/plans/hash_join_plan.h"
+#include "execution/plans/index_scan_plan.h"
 #include "execution/plans/limit_plan.h"
 #include "execution/plans/seq_scan_plan.h"
 #include "execution/plans/update_plan.h"
@@ -672,4 +674,75 @@ TEST_F(ExecutorTest, SimpleDistinctTest) {
   ASSERT_TRUE(std::equal(results.cbegin(), results.cend(), expected.cbegin()));
 }
 
+// SELECT colA, colB FROM test_1 WHERE colA BETWEEN 100 AND 199 [ORDER BY colA DESC], through a B+ tree index
+TEST_F(ExecutorTest, SimpleIndexScanTest) {
+  auto *catalog = GetExecutorContext()->GetCatalog();
+  TableInfo *table_info = catalog->GetTable("test_1");
+  const Schema &schema = table_info->schema_;
+  auto key_schema = ParseCreateStatement("a integer");
+  auto *tree_info = catalog->CreateIndex<KeyType, ValueType, ComparatorType>(
+      GetTxn(), "tree_index", "test_1", schema, *key_schema, {0}, 8, HashFunctionType{}, IndexType::B_PLUS_TREE);
+  auto *hash_info = catalog->CreateIndex<KeyType, ValueType, ComparatorType>(
+      GetTxn(), "hash_index", "test_1", schema, *key_schema, {0}, 8, HashFunctionType{}, IndexType::EXTENDIBLE_HASH);
+  ASSERT_NE(tree_info, Catalog::NULL_INDEX_INFO);
+  ASSERT_NE(hash_info, Catalog::NULL_INDEX_INFO);
+  EXPECT_EQ(tree_info->index_type_, IndexType::B_PLUS_TREE);
+
+  // Ranges and ordered access need the tree, point lookups are served by the hash index
+  EXPECT_EQ(catalog->GetIndexForAccess("test_1", {0}, IndexAccess::RANGE), tree_info);
+  EXPECT_EQ(catalog->GetIndexForAccess("test_1", {0}, IndexAccess::POINT), hash_info);
+  EXPECT_EQ(catalog->GetIndexForAccess("test_1", {1}, IndexAccess::POINT), Catalog::NULL_INDEX_INFO);
+
+  auto *col_a = MakeColumnValueExpression(schema, 0, "colA");
+  auto *col_b = MakeColumnValueExpression(schema, 0, "colB");
+  auto *out_schema = MakeOutputSchema({{"colA", col_a}, {"colB", col_b}});
+  Tuple low_key{{ValueFactory::GetIntegerValue(100)}, key_schema.get()};
+  Tuple high_key{{ValueFactory::GetIntegerValue(199)}, key_schema.get()};
+  for (bool reverse : {false, true}) {
+    IndexScanPlanNode plan{out_schema, nullptr, tree_info->index_oid_, &low_key, &high_key, reverse};
+    std::vector<Tuple> result_set{};
+    GetExecutionEngine()->Execute(&plan, &result_set, GetTxn(), GetExecutorContext());
+    ASSERT_EQ(result_set.size(), 100);
+    for (int32_t i = 0; i < 100; i++) {
+      const auto &tuple = result_set[i];
+      int32_t expected = reverse ? 199 - i : 100 + i;
+      ASSERT_EQ(tuple.GetValue(out_schema, out_schema->GetColIdx("colA")).GetAs<int32_t>(), expected);
+      ASSERT_TRUE(tuple.GetValue(out_schema, out_schema->GetColIdx("colB")).GetAs<int32_t>() < 10);
+    }
+  }
+
+  // SELECT colA FROM test_1 WHERE colA >= 900 AND colA < 950 only reads the index
+  auto *key_out_schema = MakeOutputSchema({{"colA", col_a}});
+  auto *const950 = MakeConstantValueExpression(ValueFactory::GetIntegerValue(950));
+  auto *predicate = MakeComparisonExpression(col_a, const950, ComparisonType::LessThan);
+  Tuple from_key{{ValueFactory::GetIntegerValue(900)}, key_schema.get()};
+  IndexScanPlanNode key_plan{key_out_schema, predicate, tree_info->index_oid_, &from_key, nullptr};
+  IndexScanExecutor key_scan{GetExecutorContext(), &key_plan};
+  key_scan.Init();
+  EXPECT_TRUE(key_scan.IsIndexOnly());
+  Tuple tuple;
+  RID rid;
+  for (int32_t expected = 900; expected < 950; expected++) {
+    ASSERT_TRUE(key_scan.Next(&tuple, &rid));
+    ASSERT_EQ(tuple.GetValue(key_out_schema, 0).GetAs<int32_t>(), expected);
+  }
+  EXPECT_FALSE(key_scan.Next(&tuple, &rid));
+
+  // SELECT colA, colB FROM test_1 WHERE colA = 500, through the hash index
+  Tuple point_key{{ValueFactory::GetIntegerValue(500)}, key_schema.get()};
+  Tuple same_key{{ValueFactory::GetIntegerValue(500)}, key_schema.get()};
+  IndexScanPlanNode point_plan{out_schema, nullptr, hash_info->index_oid_, &point_key, &same_key};
+  IndexScanExecutor point_scan{GetExecutorContext(), &point_plan};
+  point_scan.Init();
+  EXPECT_FALSE(point_scan.IsIndexOnly());
+  ASSERT_TRUE(point_scan.Next(&tuple, &rid));
+  EXPECT_EQ(tuple.GetValue(out_schema, 0).GetAs<int32_t>(), 500);
+  EXPECT_FALSE(point_scan.Next(&tuple, &rid));
+
+  // the hash index can't serve a range
+  IndexScanPlanNode range_plan{out_schema, nullptr, hash_info->index_oid_, &low_key, &high_key};
+  IndexScanExecutor range_scan{GetExecutorContext(), &range_plan};
+  EXPECT_THROW(range_scan.Init(), NotImplementedException);
+}
+
 }  // namespace bustub
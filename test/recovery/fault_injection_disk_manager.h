@@ -0,0 +1,112 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// fault_injection_disk_manager.h
+//
+// Identification: test/recovery/fault_injection_disk_manager.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <limits>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_set>
+
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * A DiskManager that simulates a crash: once a given number of page and log writes went through, every later write
+ * is silently dropped, like the writes a process would have issued after it died. It also counts the I/O it sees,
+ * which is used to measure the work done by recovery.
+ */
+class FaultInjectionDiskManager : public DiskManager {
+ public:
+  explicit FaultInjectionDiskManager(const std::string &db_file,
+                                     int crash_after_writes = std::numeric_limits<int>::max())
+      : DiskManager(db_file), crash_after_writes_(crash_after_writes) {}
+
+  void WritePage(page_id_t page_id, const char *page_data) override {
+    if (DropWrite()) {
+      return;
+    }
+    DiskManager::WritePage(page_id, page_data);
+    page_writes_++;
+    TouchPage(page_id);
+  }
+
+  void ReadPage(page_id_t page_id, char *page_data) override {
+    DiskManager::ReadPage(page_id, page_data);
+    page_reads_++;
+    TouchPage(page_id);
+  }
+
+  void WriteLog(char *log_data, int size, int stream = 0) override {
+    if (size > 0 && DropWrite()) {
+      return;
+    }
+    DiskManager::WriteLog(log_data, size, stream);
+  }
+
+  bool ReadLog(char *log_data, int size, int64_t offset, int stream = 0) override {
+    bool read = DiskManager::ReadLog(log_data, size, offset, stream);
+    if (read) {
+      log_bytes_read_ += size;
+    }
+    return read;
+  }
+
+  /** Crash now: drop every write from here on. */
+  void Crash() {
+    int crash_after_writes = crash_after_writes_;
+    while (writes_ < crash_after_writes &&
+           !crash_after_writes_.compare_exchange_weak(crash_after_writes, writes_.load())) {
+    }
+  }
+
+  /** @return true once writes are being dropped */
+  bool IsCrashed() const { return writes_ >= crash_after_writes_; }
+
+  /** Reset the I/O counters, e.g. before starting recovery. */
+  void ResetCounters() {
+    page_reads_ = 0;
+    page_writes_ = 0;
+    log_bytes_read_ = 0;
+    std::scoped_lock latch(latch_);
+    touched_pages_.clear();
+  }
+
+  int GetPageReads() const { return page_reads_; }
+  int GetPageWrites() const { return page_writes_; }
+  int64_t GetLogBytesRead() const { return log_bytes_read_; }
+  int GetPagesTouched() {
+    std::scoped_lock latch(latch_);
+    return static_cast<int>(touched_pages_.size());
+  }
+
+ private:
+  /** Count a write. @return true if the write falls after the crash point */
+  bool DropWrite() { return writes_++ >= crash_after_writes_; }
+
+  void TouchPage(page_id_t page_id) {
+    std::scoped_lock latch(latch_);
+    touched_pages_.insert(page_id);
+  }
+
+  std::atomic<int> crash_after_writes_;
+  std::atomic<int> writes_{0};
+  std::atomic<int> page_reads_{0};
+  std::atomic<int> page_writes_{0};
+  std::atomic<int64_t> log_bytes_read_{0};
+  std::unordered_set<page_id_t> touched_pages_;
+  std::mutex latch_;
+};
+
+}  // namespace bustub
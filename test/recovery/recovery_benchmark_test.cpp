@@ -0,0 +1,313 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// recovery_benchmark_test.cpp
+//
+// Identification: test/recovery/recovery_benchmark_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>      // NOLINT
+#include <filesystem>  // NOLINT
+#include <iostream>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "../test/recovery/fault_injection_disk_manager.h"
+#include "buffer/buffer_pool_manager_instance.h"
+#include "common/config.h"
+#include "concurrency/lock_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "gtest/gtest.h"
+#include "recovery/log_manager.h"
+#include "recovery/log_recovery.h"
+#include "storage/table/table_heap.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/** The OLTP workload that runs until the crash. */
+struct RecoveryWorkload {
+  int num_threads_{4};
+  int txns_per_thread_{40};
+  int ops_per_txn_{8};
+  // operation mix in percent, the rest are deletes
+  int insert_pct_{50};
+  int update_pct_{30};
+  // share of the transactions that roll back instead of committing
+  int abort_pct_{10};
+  int num_log_streams_{1};
+  // the crash comes after a random number of page and log writes in [1, max_crash_writes_]
+  int max_crash_writes_{300};
+};
+
+/** What one crash and restart cost. */
+struct RecoveryStats {
+  int crash_after_writes_{0};
+  int committed_txns_{0};
+  double redo_ms_{0};
+  double undo_ms_{0};
+  int pages_touched_{0};
+  int page_reads_{0};
+  int page_writes_{0};
+  int64_t log_bytes_read_{0};
+};
+
+/** Contents of a table by RID, std::nullopt for a deleted or never committed tuple. */
+using TableImage = std::map<int64_t, std::optional<std::string>>;
+
+/** One worker thread of the workload, with its own table so that the workers never wait on each other's locks. */
+struct RecoveryWorker {
+  TableHeap *table_{nullptr};
+  page_id_t first_page_id_{INVALID_PAGE_ID};
+  // as of the last commit that returned before the crash
+  TableImage committed_;
+  // changes of the transaction whose commit was under way when the crash hit, they may or may not have survived
+  TableImage in_flight_;
+  int committed_txns_{0};
+  // transactions cut off by the crash, they still own their locks
+  std::vector<Transaction *> abandoned_;
+};
+
+class RecoveryBenchmarkTest : public ::testing::Test {
+ protected:
+  void SetUp() override { RemoveFiles(); }
+
+  void TearDown() override { RemoveFiles(); }
+
+  static void RemoveFiles() {
+    remove("test.db");
+    for (const auto &entry : std::filesystem::directory_iterator(".")) {
+      if (entry.path().filename().string().rfind("test.log", 0) == 0) {
+        std::filesystem::remove(entry.path());
+      }
+    }
+  }
+
+  static Tuple MakeTuple(const Schema &schema, std::mt19937 *rng) {
+    std::string name((*rng)() % 32 + 1, static_cast<char>('a' + (*rng)() % 26));
+    std::vector<Value> values{Value(TypeId::VARCHAR, name), Value(TypeId::INTEGER, static_cast<int32_t>((*rng)()))};
+    return Tuple(values, &schema);
+  }
+
+  static std::string Bytes(const Tuple &tuple) { return std::string(tuple.GetData(), tuple.GetLength()); }
+
+  /** Run the transactions of one worker until they are done or the disk crashed. */
+  static void RunWorker(const RecoveryWorkload &workload, const Schema &schema, uint32_t seed,
+                        FaultInjectionDiskManager *disk_manager, TransactionManager *txn_manager,
+                        RecoveryWorker *worker) {
+    std::mt19937 rng(seed);
+    for (int i = 0; i < workload.txns_per_thread_ && !disk_manager->IsCrashed(); i++) {
+      Transaction *txn = txn_manager->Begin();
+      TableImage changes;
+      for (int j = 0; j < workload.ops_per_txn_ && txn->GetState() != TransactionState::ABORTED; j++) {
+        if (disk_manager->IsCrashed()) {
+          break;
+        }
+        std::vector<int64_t> live;
+        for (const auto &[rid, tuple] : worker->committed_) {
+          auto iter = changes.find(rid);
+          if (iter == changes.end() ? tuple.has_value() : iter->second.has_value()) {
+            live.push_back(rid);
+          }
+        }
+        for (const auto &[rid, tuple] : changes) {
+          if (tuple.has_value() && worker->committed_.count(rid) == 0) {
+            live.push_back(rid);
+          }
+        }
+        int op = static_cast<int>(rng() % 100);
+        if (live.empty() || op < workload.insert_pct_) {
+          Tuple tuple = MakeTuple(schema, &rng);
+          RID rid;
+          if (worker->table_->InsertTuple(tuple, &rid, txn)) {
+            changes[rid.Get()] = Bytes(tuple);
+          }
+        } else if (op < workload.insert_pct_ + workload.update_pct_) {
+          RID rid(live[rng() % live.size()]);
+          Tuple tuple = MakeTuple(schema, &rng);
+          if (worker->table_->UpdateTuple(tuple, rid, txn)) {
+            changes[rid.Get()] = Bytes(tuple);
+          }
+        } else {
+          RID rid(live[rng() % live.size()]);
+          if (worker->table_->MarkDelete(rid, txn)) {
+            changes[rid.Get()] = std::nullopt;
+          }
+        }
+      }
+      if (disk_manager->IsCrashed()) {
+        worker->abandoned_.push_back(txn);
+        break;
+      }
+      if (txn->GetState() == TransactionState::ABORTED || static_cast<int>(rng() % 100) < workload.abort_pct_) {
+        txn_manager->Abort(txn);
+        delete txn;
+        continue;
+      }
+      txn_manager->Commit(txn);
+      delete txn;
+      if (disk_manager->IsCrashed()) {
+        worker->in_flight_ = std::move(changes);
+        break;
+      }
+      for (auto &[rid, tuple] : changes) {
+        worker->committed_[rid] = std::move(tuple);
+      }
+      worker->committed_txns_++;
+    }
+  }
+
+  /** @return true if the table holds exactly the given image */
+  static bool Matches(TableHeap *table, const TableImage &image, Transaction *txn) {
+    for (const auto &[rid, expected] : image) {
+      Tuple tuple;
+      bool found = table->GetTuple(RID(rid), &tuple, txn);
+      if (found != expected.has_value() || (found && Bytes(tuple) != *expected)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Run the workload against a disk that crashes at a random point, recover and check that exactly the committed
+   * transactions survived.
+   */
+  static RecoveryStats RunCrashRecovery(const RecoveryWorkload &workload, uint32_t seed) {
+    RemoveFiles();
+    std::mt19937 rng(seed);
+    RecoveryStats stats;
+    stats.crash_after_writes_ = static_cast<int>(rng() % workload.max_crash_writes_) + 1;
+    Schema schema{std::vector<Column>{Column{"a", TypeId::VARCHAR, 32}, Column{"b", TypeId::INTEGER}}};
+    std::vector<RecoveryWorker> workers(workload.num_threads_);
+
+    {
+      FaultInjectionDiskManager disk_manager("test.db", stats.crash_after_writes_);
+      LogManager log_manager(&disk_manager, workload.num_log_streams_);
+      BufferPoolManagerInstance buffer_pool_manager(BUFFER_POOL_SIZE, &disk_manager, &log_manager);
+      LockManager lock_manager;
+      TransactionManager txn_manager(&lock_manager, &log_manager);
+      log_manager.RunFlushThread();
+
+      for (auto &worker : workers) {
+        Transaction *txn = txn_manager.Begin();
+        worker.table_ = new TableHeap(&buffer_pool_manager, &lock_manager, &log_manager, txn);
+        worker.first_page_id_ = worker.table_->GetFirstPageId();
+        txn_manager.Commit(txn);
+        delete txn;
+      }
+      std::vector<std::thread> threads;
+      for (int i = 0; i < workload.num_threads_; i++) {
+        threads.emplace_back(RunWorker, std::cref(workload), std::cref(schema), static_cast<uint32_t>(rng()),
+                             &disk_manager, &txn_manager, &workers[i]);
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+
+      // the workload may finish before the crash point, then crash at the end; nothing buffered survives
+      disk_manager.Crash();
+      log_manager.StopFlushThread();
+      for (auto &worker : workers) {
+        stats.committed_txns_ += worker.committed_txns_;
+        delete worker.table_;
+      }
+      disk_manager.ShutDown();
+    }
+    for (auto &worker : workers) {
+      for (auto *txn : worker.abandoned_) {
+        delete txn;
+      }
+    }
+
+    // restart
+    FaultInjectionDiskManager disk_manager("test.db");
+    BufferPoolManagerInstance buffer_pool_manager(BUFFER_POOL_SIZE, &disk_manager);
+    LockManager lock_manager;
+    TransactionManager txn_manager(&lock_manager);
+    LogRecovery log_recovery(&disk_manager, &buffer_pool_manager);
+    disk_manager.ResetCounters();
+    auto start = std::chrono::steady_clock::now();
+    log_recovery.Redo();
+    auto redo_end = std::chrono::steady_clock::now();
+    log_recovery.Undo();
+    auto undo_end = std::chrono::steady_clock::now();
+    stats.redo_ms_ = std::chrono::duration<double, std::milli>(redo_end - start).count();
+    stats.undo_ms_ = std::chrono::duration<double, std::milli>(undo_end - redo_end).count();
+    stats.pages_touched_ = disk_manager.GetPagesTouched();
+    stats.page_reads_ = disk_manager.GetPageReads();
+    stats.page_writes_ = disk_manager.GetPageWrites();
+    stats.log_bytes_read_ = disk_manager.GetLogBytesRead();
+
+    Transaction *txn = txn_manager.Begin();
+    for (auto &worker : workers) {
+      TableHeap table(&buffer_pool_manager, &lock_manager, nullptr, worker.first_page_id_);
+      // a transaction whose commit straddled the crash is all there or not at all
+      TableImage before = worker.committed_;
+      TableImage after = worker.committed_;
+      for (const auto &[rid, tuple] : worker.in_flight_) {
+        before.emplace(rid, std::nullopt);
+        after[rid] = tuple;
+      }
+      EXPECT_TRUE(Matches(&table, before, txn) || (!worker.in_flight_.empty() && Matches(&table, after, txn)))
+          << "seed " << seed << ", crash after " << stats.crash_after_writes_ << " writes";
+    }
+    txn_manager.Commit(txn);
+    delete txn;
+    disk_manager.ShutDown();
+
+    std::cout << "crash after " << stats.crash_after_writes_ << " writes, " << stats.committed_txns_
+              << " txns committed | redo " << stats.redo_ms_ << " ms, undo " << stats.undo_ms_ << " ms | "
+              << stats.log_bytes_read_ << " log bytes read | " << stats.pages_touched_ << " pages touched ("
+              << stats.page_reads_ << " reads, " << stats.page_writes_ << " writes)" << std::endl;
+    return stats;
+  }
+};
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryBenchmarkTest, CrashRecoveryTest) {
+  RecoveryWorkload workload;
+  for (uint32_t seed = 0; seed < 8; seed++) {
+    RunCrashRecovery(workload, seed);
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryBenchmarkTest, MultiStreamCrashRecoveryTest) {
+  RecoveryWorkload workload;
+  workload.num_log_streams_ = workload.num_threads_;
+  for (uint32_t seed = 0; seed < 8; seed++) {
+    RunCrashRecovery(workload, seed);
+  }
+}
+
+// The yardstick for recovery performance: a bigger workload, with the averages reported at the end.
+// NOLINTNEXTLINE
+TEST_F(RecoveryBenchmarkTest, DISABLED_RecoveryBenchmark) {
+  RecoveryWorkload workload;
+  workload.num_threads_ = 8;
+  workload.txns_per_thread_ = 500;
+  workload.max_crash_writes_ = 20000;
+  const int num_runs = 5;
+  RecoveryStats total;
+  for (uint32_t seed = 0; seed < num_runs; seed++) {
+    RecoveryStats stats = RunCrashRecovery(workload, seed);
+    total.redo_ms_ += stats.redo_ms_;
+    total.undo_ms_ += stats.undo_ms_;
+    total.pages_touched_ += stats.pages_touched_;
+    total.log_bytes_read_ += stats.log_bytes_read_;
+  }
+  std::cout << "average: redo " << total.redo_ms_ / num_runs << " ms, undo " << total.undo_ms_ / num_runs << " ms | "
+            << total.log_bytes_read_ / num_runs << " log bytes read | " << total.pages_touched_ / num_runs
+            << " pages touched" << std::endl;
+}
+
+}  // namespace bustub
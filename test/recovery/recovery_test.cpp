@@ -10,19 +10,27 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <filesystem>  // NOLINT
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
+#include "../test/recovery/fault_injection_disk_manager.h"
+#include "buffer/buffer_pool_manager_instance.h"
 #include "common/bustub_instance.h"
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
 #include "concurrency/transaction_manager.h"
+#include "container/hash/extendible_hash_table.h"
 #include "gtest/gtest.h"
 #include "logging/common.h"
 #include "recovery/log_recovery.h"
+#include "storage/index/b_plus_tree.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
+#include "test_util.h"  // NOLINT
 
 namespace bustub {
 
@@ -31,15 +39,24 @@ class RecoveryTest : public ::testing::Test {
   // This function is called before every test.
   void SetUp() override {
     remove("test.db");
-    remove("test.log");
+    RemoveLogSegments();
   }
 
   // This function is called after every test.
   void TearDown() override {
     LOG_INFO("Tearing down the system..");
     remove("test.db");
-    remove("test.log");
+    RemoveLogSegments();
   };
+
+  // Remove every "test.log.*" segment and spare file.
+  static void RemoveLogSegments() {
+    for (const auto &entry : std::filesystem::directory_iterator(".")) {
+      if (entry.path().filename().string().rfind("test.log", 0) == 0) {
+        std::filesystem::remove(entry.path());
+      }
+    }
+  }
 };
 
 // NOLINTNEXTLINE
@@ -210,6 +227,588 @@ TEST_F(RecoveryTest, DISABLED_UndoTest) {
   delete bustub_instance;
 }
 
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, AsyncCommitTest) {
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+  page_id_t first_page_id;
+  RID sync_rid;
+  RID override_rid;
+  RID async_rid;
+
+  {
+    FaultInjectionDiskManager disk_manager("test.db");
+    LogManager log_manager(&disk_manager);
+    BufferPoolManagerInstance buffer_pool_manager(BUFFER_POOL_SIZE, &disk_manager, &log_manager);
+    LockManager lock_manager;
+    TransactionManager txn_manager(&lock_manager, &log_manager);
+    // keep the background flushes out of the way, only synchronous commits flush the log
+    auto saved_timeout = log_timeout;
+    log_timeout = std::chrono::seconds(15);
+    log_manager.SetCommitDelay(std::chrono::seconds(15));
+    log_manager.RunFlushThread();
+
+    // synchronous commit (the default) is durable on return
+    EXPECT_TRUE(txn_manager.IsSynchronousCommit());
+    Transaction *txn = txn_manager.Begin();
+    auto *test_table = new TableHeap(&buffer_pool_manager, &lock_manager, &log_manager, txn);
+    first_page_id = test_table->GetFirstPageId();
+    EXPECT_TRUE(test_table->InsertTuple(tuple, &sync_rid, txn));
+    txn_manager.Commit(txn);
+    EXPECT_GE(log_manager.GetPersistentLSN(), txn->GetPrevLSN());
+    delete txn;
+
+    // with the manager-wide setting off, transactions commit asynchronously unless they override it
+    txn_manager.SetSynchronousCommit(false);
+    Transaction *async_txn = txn_manager.Begin();
+    EXPECT_TRUE(test_table->InsertTuple(tuple, &async_rid, async_txn));
+    txn = txn_manager.Begin();
+    txn->SetSynchronousCommit(SynchronousCommit::ON);
+    EXPECT_TRUE(test_table->InsertTuple(tuple, &override_rid, txn));
+    txn_manager.Commit(txn);
+    EXPECT_GE(log_manager.GetPersistentLSN(), txn->GetPrevLSN());
+    delete txn;
+
+    // the insert of the asynchronous transaction went to disk with the synchronous commit, but the disk fails before
+    // its COMMIT record gets there
+    disk_manager.Crash();
+    txn_manager.Commit(async_txn);
+    EXPECT_LT(log_manager.GetPersistentLSN(), async_txn->GetPrevLSN());
+    delete async_txn;
+
+    LOG_INFO("System crash, the asynchronous commit is lost");
+    log_manager.StopFlushThread();
+    log_timeout = saved_timeout;
+    delete test_table;
+    disk_manager.ShutDown();
+  }
+
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  // the synchronous commits survive, the asynchronous one is rolled back
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_, nullptr,
+                                   first_page_id);
+  Tuple result;
+  EXPECT_TRUE(test_table->GetTuple(sync_rid, &result, txn));
+  EXPECT_TRUE(test_table->GetTuple(override_rid, &result, txn));
+  EXPECT_FALSE(test_table->GetTuple(async_rid, &result, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, AsyncCommitDelayTest) {
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  auto *log_manager = bustub_instance->log_manager_;
+  // the flush thread would only wake up on its own after log_timeout, the commit delay has to wake it up earlier
+  auto saved_timeout = log_timeout;
+  log_timeout = std::chrono::seconds(15);
+  log_manager->SetCommitDelay(std::chrono::milliseconds(50));
+  log_manager->RunFlushThread();
+  bustub_instance->transaction_manager_->SetSynchronousCommit(false);
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   log_manager, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  RID rid;
+  EXPECT_TRUE(test_table->InsertTuple(ConstructTuple(&schema), &rid, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  lsn_t commit_lsn = txn->GetPrevLSN();
+  delete txn;
+
+  // well within log_timeout, however slow the machine is
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (log_manager->GetPersistentLSN() < commit_lsn && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_GE(log_manager->GetPersistentLSN(), commit_lsn);
+  delete test_table;
+
+  LOG_INFO("System crash, the asynchronous commit is on disk already");
+  delete bustub_instance;
+  log_timeout = saved_timeout;
+  bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_, nullptr,
+                             first_page_id);
+  Tuple result;
+  EXPECT_TRUE(test_table->GetTuple(rid, &result, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, HashIndexRedoTest) {
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  auto *ht = new ExtendibleHashTable<int, int, IntComparator>("ht", bustub_instance->buffer_pool_manager_,
+                                                              IntComparator(), HashFunction<int>(),
+                                                              bustub_instance->log_manager_);
+  page_id_t header_page_id = ht->GetHeaderPageId();
+
+  // enough keys for a few bucket splits, then remove some of them
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  for (int i = 0; i < 1500; i++) {
+    EXPECT_TRUE(ht->Insert(txn, i, i));
+  }
+  for (int i = 0; i < 1500; i += 3) {
+    EXPECT_TRUE(ht->Remove(txn, i, i));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // a loser: its log records reach disk but it never commits
+  txn = bustub_instance->transaction_manager_->Begin();
+  EXPECT_TRUE(ht->Insert(txn, 5000, 5000));
+  EXPECT_TRUE(ht->Remove(txn, 1, 1));
+  bustub_instance->log_manager_->Flush();
+  delete txn;
+  delete ht;
+
+  LOG_INFO("System crash, pages still in the buffer pool are lost");
+  delete bustub_instance;
+  bustub_instance = new BustubInstance("test.db");
+
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  // the index is usable as is, no rebuild from the table heap
+  ht = new ExtendibleHashTable<int, int, IntComparator>("ht", bustub_instance->buffer_pool_manager_, IntComparator(),
+                                                        HashFunction<int>(), header_page_id);
+  ht->VerifyIntegrity();
+  for (int i = 0; i < 1500; i++) {
+    std::vector<int> result;
+    EXPECT_EQ(i % 3 != 0, ht->GetValue(nullptr, i, &result)) << "key " << i;
+  }
+  std::vector<int> result;
+  EXPECT_FALSE(ht->GetValue(nullptr, 5000, &result));
+
+  delete ht;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, HashIndexUndoTest) {
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  auto *txn_manager = bustub_instance->transaction_manager_;
+  bustub_instance->log_manager_->RunFlushThread();
+
+  auto *ht = new ExtendibleHashTable<int, int, IntComparator>("ht", bustub_instance->buffer_pool_manager_,
+                                                              IntComparator(), HashFunction<int>(),
+                                                              bustub_instance->log_manager_);
+  page_id_t header_page_id = ht->GetHeaderPageId();
+  Transaction *txn = txn_manager->Begin();
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(ht->Insert(txn, i, i));
+  }
+  txn_manager->Commit(txn);
+  delete txn;
+
+  // a loser inserts and removes a few entries
+  Transaction *loser = txn_manager->Begin();
+  for (int i = 0; i < 20; i++) {
+    EXPECT_TRUE(ht->Insert(loser, 10000 + i, i));
+    EXPECT_TRUE(ht->Remove(loser, i, i));
+  }
+  // then a committed transaction splits the buckets holding the loser's entries many times over, and takes the slots
+  // the loser freed
+  txn = txn_manager->Begin();
+  for (int i = 100; i < 2000; i++) {
+    EXPECT_TRUE(ht->Insert(txn, i, i));
+  }
+  txn_manager->Commit(txn);
+  delete txn;
+  delete loser;
+  delete ht;
+
+  LOG_INFO("System crash, pages still in the buffer pool are lost");
+  delete bustub_instance;
+  bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  ht = new ExtendibleHashTable<int, int, IntComparator>("ht", bustub_instance->buffer_pool_manager_, IntComparator(),
+                                                        HashFunction<int>(), header_page_id);
+  ht->VerifyIntegrity();
+  for (int i = 0; i < 2000; i++) {
+    std::vector<int> result;
+    EXPECT_TRUE(ht->GetValue(nullptr, i, &result)) << "key " << i;
+  }
+  for (int i = 0; i < 20; i++) {
+    std::vector<int> result;
+    EXPECT_FALSE(ht->GetValue(nullptr, 10000 + i, &result)) << "key " << 10000 + i;
+  }
+
+  delete ht;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, HashIndexUndoFullBucketTest) {
+  using KeyType = int;
+  using ValueType = int;
+  const int bucket_size = BUCKET_ARRAY_SIZE;
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  auto *txn_manager = bustub_instance->transaction_manager_;
+  bustub_instance->log_manager_->RunFlushThread();
+
+  // the values of one key fill the bucket page and an overflow page
+  auto *chain_ht = new ExtendibleHashTable<int, int, IntComparator>("chain", bustub_instance->buffer_pool_manager_,
+                                                                    IntComparator(), HashFunction<int>(),
+                                                                    bustub_instance->log_manager_);
+  page_id_t chain_header_page_id = chain_ht->GetHeaderPageId();
+  // distinct keys fill the only bucket, which has not been split yet
+  auto *full_ht = new ExtendibleHashTable<int, int, IntComparator>("full", bustub_instance->buffer_pool_manager_,
+                                                                   IntComparator(), HashFunction<int>(),
+                                                                   bustub_instance->log_manager_);
+  page_id_t full_header_page_id = full_ht->GetHeaderPageId();
+  Transaction *txn = txn_manager->Begin();
+  for (int i = 0; i < 2 * bucket_size; i++) {
+    EXPECT_TRUE(chain_ht->Insert(txn, 7, i));
+  }
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(full_ht->Insert(txn, i, i));
+  }
+  txn_manager->Commit(txn);
+  delete txn;
+
+  // a loser removes an entry of each, then a committed transaction takes its slot and fills the rest
+  Transaction *loser = txn_manager->Begin();
+  EXPECT_TRUE(chain_ht->Remove(loser, 7, bucket_size));
+  EXPECT_TRUE(full_ht->Remove(loser, 0, 0));
+  txn = txn_manager->Begin();
+  EXPECT_TRUE(chain_ht->Insert(txn, 7, 2 * bucket_size));
+  for (int i = 10; i <= bucket_size; i++) {
+    EXPECT_TRUE(full_ht->Insert(txn, i, i));
+  }
+  EXPECT_EQ(0, full_ht->GetGlobalDepth());
+  txn_manager->Commit(txn);
+  delete txn;
+  delete loser;
+  delete chain_ht;
+  delete full_ht;
+
+  LOG_INFO("System crash, pages still in the buffer pool are lost");
+  delete bustub_instance;
+  bustub_instance = new BustubInstance("test.db");
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  // the chain grows by an overflow page, the full bucket would have to be split
+  EXPECT_EQ(0, log_recovery->GetHashIndexesToRebuild().count(chain_header_page_id));
+  EXPECT_EQ(1, log_recovery->GetHashIndexesToRebuild().count(full_header_page_id));
+  delete log_recovery;
+
+  chain_ht = new ExtendibleHashTable<int, int, IntComparator>("chain", bustub_instance->buffer_pool_manager_,
+                                                              IntComparator(), HashFunction<int>(),
+                                                              chain_header_page_id);
+  chain_ht->VerifyIntegrity();
+  std::vector<int> result;
+  EXPECT_TRUE(chain_ht->GetValue(nullptr, 7, &result));
+  std::sort(result.begin(), result.end());
+  ASSERT_EQ(2 * bucket_size + 1, result.size());
+  for (int i = 0; i <= 2 * bucket_size; i++) {
+    EXPECT_EQ(i, result[i]);
+  }
+
+  delete chain_ht;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, BPlusTreeRedoTest) {
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  page_id_t header_page_id;
+  bustub_instance->buffer_pool_manager_->NewPage(&header_page_id);
+  bustub_instance->buffer_pool_manager_->UnpinPage(header_page_id, true);
+  // small pages, so that the keys split and merge pages on every level
+  auto *tree = new BPlusTree<GenericKey<8>, RID, GenericComparator<8>>(
+      "tree", bustub_instance->buffer_pool_manager_, comparator, 16, 16, BPlusTreeMode::CRABBING, header_page_id,
+      bustub_instance->log_manager_);
+
+  GenericKey<8> index_key;
+  for (int i = 0; i < 1000; i++) {
+    int key = i * 7919 % 1000;
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree->Insert(index_key, RID(key, key)));
+  }
+  for (int key = 0; key < 1000; key += 3) {
+    index_key.SetFromInteger(key);
+    tree->Remove(index_key);
+  }
+  bustub_instance->log_manager_->Flush();
+  delete tree;
+
+  LOG_INFO("System crash, pages still in the buffer pool are lost");
+  delete bustub_instance;
+  bustub_instance = new BustubInstance("test.db");
+
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  tree = new BPlusTree<GenericKey<8>, RID, GenericComparator<8>>("tree", bustub_instance->buffer_pool_manager_,
+                                                                 comparator, 16, 16, BPlusTreeMode::CRABBING,
+                                                                 header_page_id);
+  ASSERT_TRUE(tree->OpenFromHeaderPage());
+  for (int key = 0; key < 1000; key++) {
+    std::vector<RID> result;
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(key % 3 != 0, tree->GetValue(index_key, &result)) << "key " << key;
+  }
+  int expected_key = 1;
+  for (auto it = tree->Begin(); !it.IsEnd(); ++it) {
+    EXPECT_EQ(expected_key, (*it).second.GetSlotNum());
+    expected_key += expected_key % 3 == 1 ? 1 : 2;
+  }
+  EXPECT_EQ(1000, expected_key);
+
+  delete tree;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, RepeatedCrashTest) {
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  BustubInstance *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  Transaction *txn = bustub_instance->transaction_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  RID rid;
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(test_table->InsertTuple(ConstructTuple(&schema), &rid, txn));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  lsn_t last_lsn = txn->GetPrevLSN();
+  delete txn;
+  delete test_table;
+
+  LOG_INFO("First crash");
+  delete bustub_instance;
+  bustub_instance = new BustubInstance("test.db");
+  // the LSNs continue after the ones in the log
+  EXPECT_GT(bustub_instance->log_manager_->GetNextLSN(), last_lsn);
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+  // the table page goes to disk with the LSN of the first run
+  bustub_instance->buffer_pool_manager_->FlushAllPages();
+
+  bustub_instance->log_manager_->RunFlushThread();
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  RID rid1;
+  EXPECT_TRUE(test_table->InsertTuple(ConstructTuple(&schema), &rid1, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  EXPECT_GT(txn->GetPrevLSN(), last_lsn);
+  delete txn;
+  // a loser of the second run
+  txn = bustub_instance->transaction_manager_->Begin();
+  RID rid2;
+  EXPECT_TRUE(test_table->InsertTuple(ConstructTuple(&schema), &rid2, txn));
+  bustub_instance->log_manager_->Flush();
+  delete txn;
+  delete test_table;
+
+  LOG_INFO("Second crash");
+  delete bustub_instance;
+  bustub_instance = new BustubInstance("test.db");
+  log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  // the records of the second run are newer than the page on disk, and its loser is told apart from the first run
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple tuple;
+  EXPECT_TRUE(test_table->GetTuple(rid, &tuple, txn));
+  EXPECT_TRUE(test_table->GetTuple(rid1, &tuple, txn));
+  EXPECT_FALSE(test_table->GetTuple(rid2, &tuple, txn));
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, MultiStreamTest) {
+  const int num_threads = 4;
+  const int num_tuples = 50;
+  BustubInstance *bustub_instance = new BustubInstance("test.db", num_threads);
+  auto *txn_manager = bustub_instance->transaction_manager_;
+  ASSERT_EQ(num_threads, bustub_instance->log_manager_->GetNumStreams());
+  bustub_instance->log_manager_->RunFlushThread();
+  // every stream is on disk right away
+  EXPECT_EQ(num_threads, bustub_instance->disk_manager_->GetNumLogStreams());
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  Transaction *txn = txn_manager->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  txn_manager->Commit(txn);
+  delete txn;
+
+  // each thread appends to its own stream, the records of the table pages interleave across the streams
+  std::vector<std::vector<std::pair<RID, Tuple>>> committed(num_threads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&, i] {
+      Transaction *txn = txn_manager->Begin();
+      for (int j = 0; j < num_tuples; j++) {
+        RID rid;
+        Tuple tuple = ConstructTuple(&schema);
+        EXPECT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+        committed[i].emplace_back(rid, tuple);
+      }
+      txn_manager->Commit(txn);
+      delete txn;
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // a loser: its log records reach disk but it never commits
+  std::vector<RID> loser_rids;
+  txn = txn_manager->Begin();
+  for (int j = 0; j < num_tuples; j++) {
+    RID rid;
+    EXPECT_TRUE(test_table->InsertTuple(ConstructTuple(&schema), &rid, txn));
+    loser_rids.push_back(rid);
+  }
+  bustub_instance->log_manager_->Flush();
+  delete txn;
+  delete test_table;
+
+  LOG_INFO("System crash, pages still in the buffer pool are lost");
+  delete bustub_instance;
+  bustub_instance = new BustubInstance("test.db");
+  EXPECT_EQ(num_threads, bustub_instance->disk_manager_->GetNumLogStreams());
+
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  // the redo must replay the inserts of all the streams in LSN order to land them in their original slots
+  Tuple tuple;
+  for (const auto &tuples : committed) {
+    for (const auto &[rid, expected] : tuples) {
+      ASSERT_TRUE(test_table->GetTuple(rid, &tuple, txn));
+      ASSERT_EQ(expected.GetLength(), tuple.GetLength());
+      EXPECT_EQ(0, memcmp(expected.GetData(), tuple.GetData(), tuple.GetLength()));
+    }
+  }
+  for (const auto &rid : loser_rids) {
+    EXPECT_FALSE(test_table->GetTuple(rid, &tuple, txn));
+  }
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, MultiStreamCommitTest) {
+  BustubInstance *bustub_instance = new BustubInstance("test.db", 2);
+  auto *txn_manager = bustub_instance->transaction_manager_;
+  auto *disk_manager = bustub_instance->disk_manager_;
+  bustub_instance->log_manager_->RunFlushThread();
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  Transaction *txn = txn_manager->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  txn_manager->Commit(txn);
+  delete txn;
+
+  // only this thread appends: the commit writes its stream, the watermark there tells the other one is complete
+  txn = txn_manager->Begin();
+  RID rid;
+  Tuple tuple = ConstructTuple(&schema);
+  EXPECT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+  int64_t tail_offsets[] = {disk_manager->GetLogTailOffset(0), disk_manager->GetLogTailOffset(1)};
+  txn_manager->Commit(txn);
+  delete txn;
+  EXPECT_NE(tail_offsets[0] == disk_manager->GetLogTailOffset(0), tail_offsets[1] == disk_manager->GetLogTailOffset(1));
+  delete test_table;
+
+  LOG_INFO("System crash, pages still in the buffer pool are lost");
+  delete bustub_instance;
+  bustub_instance = new BustubInstance("test.db");
+
+  auto *log_recovery = new LogRecovery(bustub_instance->disk_manager_, bustub_instance->buffer_pool_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+
+  txn = bustub_instance->transaction_manager_->Begin();
+  test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                             bustub_instance->log_manager_, first_page_id);
+  Tuple result;
+  ASSERT_TRUE(test_table->GetTuple(rid, &result, txn));
+  EXPECT_EQ(tuple.GetValue(&schema, 0).CompareEquals(result.GetValue(&schema, 0)), CmpBool::CmpTrue);
+  bustub_instance->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete bustub_instance;
+}
+
 // NOLINTNEXTLINE
 TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
@@ -0,0 +1,351 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// adaptive_radix_tree_test.cpp
+//
+// Identification: test/storage/adaptive_radix_tree_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "catalog/catalog.h"
+#include "common/logger.h"
+#include "concurrency/transaction.h"
+#include "gtest/gtest.h"
+#include "storage/index/adaptive_radix_tree_index.h"
+#include "storage/index/varlen_b_plus_tree.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+/** Escape the zero bytes of a string and terminate it, as NormalizedEncoding does, so no key is a prefix of another. */
+std::string TerminateKey(const std::string &raw) {
+  std::string key;
+  for (char c : raw) {
+    key.push_back(c);
+    if (c == '\0') {
+      key.push_back('\xff');
+    }
+  }
+  key.append("\0\1", 2);
+  return key;
+}
+
+/**
+ * Keys of random lengths over all byte values, many sharing a long prefix or a short one, so that nodes of every size
+ * and long compressed paths come up.
+ */
+std::vector<std::string> MakeARTKeys(size_t num_keys, std::mt19937 *rng) {
+  std::string long_prefix(100, 'p');
+  std::vector<std::string> keys;
+  while (keys.size() < num_keys) {
+    std::string key;
+    switch ((*rng)() % 4) {
+      case 0:
+        key = long_prefix;
+        break;
+      case 1:
+        key = "ab";
+        break;
+      default:
+        break;
+    }
+    size_t length = (*rng)() % 12;
+    for (size_t i = 0; i < length; i++) {
+      uint32_t r = (*rng)();
+      key.push_back(static_cast<char>(r % 4 == 0 ? '\0' : r % 3 == 0 ? (r >> 8) % 256 : 'a' + (r >> 8) % 26));
+    }
+    keys.push_back(TerminateKey(key));
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  std::shuffle(keys.begin(), keys.end(), *rng);
+  return keys;
+}
+
+// Scanning from every few keys, kept or not, must return the kept keys in order, either way
+void CheckARTScans(AdaptiveRadixTree *tree, const std::vector<std::string> &sorted_keys,
+                   const std::vector<std::string> &probes) {
+  std::vector<std::string> scanned;
+  for (auto iterator = tree->Begin(); !iterator.IsEnd(); ++iterator) {
+    scanned.push_back((*iterator).first);
+  }
+  ASSERT_EQ(scanned, sorted_keys);
+  scanned.clear();
+  for (auto iterator = tree->RBegin(); !iterator.IsEnd(); ++iterator) {
+    scanned.push_back((*iterator).first);
+  }
+  ASSERT_TRUE(std::equal(scanned.begin(), scanned.end(), sorted_keys.rbegin(), sorted_keys.rend()));
+
+  for (size_t i = 0; i < probes.size(); i += 7) {
+    // start at a key, between two keys and inside a compressed path
+    for (const auto &probe : {probes[i], probes[i].substr(0, probes[i].size() - 1), probes[i].substr(0, i % 50)}) {
+      auto lower = std::lower_bound(sorted_keys.begin(), sorted_keys.end(), probe);
+      auto forward = tree->Begin(probe);
+      for (auto expected = lower; expected != sorted_keys.end() && expected - lower < 20; ++expected) {
+        ASSERT_FALSE(forward.IsEnd());
+        ASSERT_EQ((*forward).first, *expected);
+        ++forward;
+      }
+      auto upper = std::upper_bound(sorted_keys.begin(), sorted_keys.end(), probe);
+      auto reverse = tree->RBegin(probe);
+      for (auto expected = upper; expected != sorted_keys.begin() && upper - expected < 20;) {
+        --expected;
+        ASSERT_FALSE(reverse.IsEnd());
+        ASSERT_EQ((*reverse).first, *expected);
+        ++reverse;
+      }
+    }
+  }
+}
+
+TEST(AdaptiveRadixTreeTests, InsertScanRemoveTest) {
+  AdaptiveRadixTree tree;
+  std::mt19937 rng(11);
+  auto keys = MakeARTKeys(20000, &rng);
+  for (size_t i = 0; i < keys.size(); i++) {
+    ASSERT_TRUE(tree.Insert(keys[i], RID(0, i)));
+  }
+  EXPECT_FALSE(tree.Insert(keys[0], RID(0, 0)));
+
+  std::vector<RID> rids;
+  for (size_t i = 0; i < keys.size(); i++) {
+    rids.clear();
+    ASSERT_TRUE(tree.GetValue(keys[i], &rids));
+    ASSERT_EQ(rids[0].GetSlotNum(), i);
+  }
+  EXPECT_FALSE(tree.GetValue(TerminateKey("missing"), &rids));
+  EXPECT_FALSE(tree.GetValue(TerminateKey(std::string(100, 'p') + "missing"), &rids));
+
+  auto sorted_keys = keys;
+  std::sort(sorted_keys.begin(), sorted_keys.end());
+  CheckARTScans(&tree, sorted_keys, sorted_keys);
+
+  // remove most keys so that nodes shrink and paths collapse, and some whole ranges
+  std::vector<std::string> kept;
+  for (size_t i = 0; i < sorted_keys.size(); i++) {
+    if (i % 5 != 0 || (i / 1000) % 2 == 1) {
+      ASSERT_TRUE(tree.Remove(sorted_keys[i]));
+    } else {
+      kept.push_back(sorted_keys[i]);
+    }
+  }
+  EXPECT_FALSE(tree.Remove(sorted_keys[1]));
+  CheckARTScans(&tree, kept, sorted_keys);
+  for (size_t i = 0; i < sorted_keys.size(); i++) {
+    rids.clear();
+    ASSERT_EQ(tree.GetValue(sorted_keys[i], &rids), std::binary_search(kept.begin(), kept.end(), sorted_keys[i]));
+  }
+
+  for (const auto &key : kept) {
+    ASSERT_TRUE(tree.Remove(key));
+  }
+  EXPECT_TRUE(tree.Begin().IsEnd());
+  EXPECT_TRUE(tree.RBegin().IsEnd());
+  for (const auto &key : keys) {
+    ASSERT_TRUE(tree.Insert(key, RID(0, 0)));
+  }
+  CheckARTScans(&tree, sorted_keys, sorted_keys);
+}
+
+// Lookups and scans run alongside inserts and removes that grow, shrink and replace nodes
+TEST(AdaptiveRadixTreeTests, ConcurrentTest) {
+  AdaptiveRadixTree tree;
+  std::mt19937 rng(5);
+  auto keys = MakeARTKeys(40000, &rng);
+  // the first half is there throughout, the threads insert and remove the second half
+  size_t stable = keys.size() / 2;
+  for (size_t i = 0; i < stable; i++) {
+    tree.Insert(keys[i], RID(0, i));
+  }
+  std::vector<std::string> stable_keys(keys.begin(), keys.begin() + stable);
+  std::sort(stable_keys.begin(), stable_keys.end());
+
+  const size_t num_threads = 4;
+  std::atomic<bool> done{false};
+  std::vector<std::thread> threads;
+  for (size_t thread = 0; thread < num_threads; thread++) {
+    threads.emplace_back([&, thread] {
+      for (int round = 0; round < 3; round++) {
+        for (size_t i = stable + thread; i < keys.size(); i += num_threads) {
+          ASSERT_TRUE(tree.Insert(keys[i], RID(0, i)));
+          std::vector<RID> rids;
+          ASSERT_TRUE(tree.GetValue(keys[i / 2 % stable], &rids));
+          ASSERT_EQ(rids[0].GetSlotNum(), i / 2 % stable);
+        }
+        for (size_t i = stable + thread; i < keys.size(); i += num_threads) {
+          ASSERT_TRUE(tree.Remove(keys[i]));
+        }
+      }
+    });
+  }
+  // the stable keys come in order and none is missed
+  threads.emplace_back([&] {
+    std::mt19937 scan_rng(7);
+    while (!done) {
+      size_t start = scan_rng() % stable_keys.size();
+      auto expected = stable_keys.begin() + start;
+      std::string last;
+      for (auto iterator = tree.Begin(*expected); !iterator.IsEnd() && expected != stable_keys.end(); ++iterator) {
+        ASSERT_LT(last, (*iterator).first);
+        last = (*iterator).first;
+        if (last == *expected) {
+          ++expected;
+        } else {
+          ASSERT_LT(last, *expected);
+        }
+      }
+      ASSERT_EQ(expected, stable_keys.end());
+    }
+  });
+  for (size_t thread = 0; thread < num_threads; thread++) {
+    threads[thread].join();
+  }
+  done = true;
+  threads.back().join();
+
+  std::vector<RID> rids;
+  for (size_t i = 0; i < keys.size(); i++) {
+    rids.clear();
+    ASSERT_EQ(tree.GetValue(keys[i], &rids), i < stable);
+  }
+  CheckARTScans(&tree, stable_keys, stable_keys);
+}
+
+// The catalog builds the index from the rows already in the table, and it returns the keys whole
+TEST(AdaptiveRadixTreeTests, CatalogIndexTest) {
+  auto disk_manager = std::make_unique<DiskManager>("test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(50, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+  Transaction txn(0);
+
+  std::vector<Column> columns;
+  columns.emplace_back("email", TypeId::VARCHAR, 128);
+  columns.emplace_back("id", TypeId::INTEGER);
+  Schema schema(columns);
+  auto *table_info = catalog->CreateTable(&txn, "users", schema);
+  auto email = [](int i) { return "user" + std::to_string(i) + "@example.com"; };
+  for (int i = 0; i < 2000; i++) {
+    RID rid;
+    Tuple tuple({ValueFactory::GetVarcharValue(email(i)), ValueFactory::GetIntegerValue(i)}, &schema);
+    ASSERT_TRUE(table_info->table_->InsertTuple(tuple, &rid, &txn));
+  }
+
+  std::vector<Column> key_columns;
+  key_columns.emplace_back("email", TypeId::VARCHAR, 128);
+  Schema key_schema(key_columns);
+  auto *index_info = catalog->CreateIndex<GenericKey<8>, RID, GenericComparator<8>>(
+      &txn, "email_idx", "users", schema, key_schema, {0}, 8, HashFunction<GenericKey<8>>{},
+      IndexType::ADAPTIVE_RADIX_TREE);
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, index_info);
+  EXPECT_EQ(index_info->index_type_, IndexType::ADAPTIVE_RADIX_TREE);
+  Index *index = index_info->index_.get();
+  EXPECT_TRUE(index->SupportsRangeScan());
+  EXPECT_TRUE(index->ReturnsKeys());
+
+  Schema *index_key_schema = index->GetKeySchema();
+  for (int i = 0; i < 2000; i += 13) {
+    std::vector<RID> rids;
+    index->ScanKey(Tuple({ValueFactory::GetVarcharValue(email(i))}, index_key_schema), &rids, &txn);
+    ASSERT_EQ(rids.size(), 1);
+    Tuple row;
+    ASSERT_TRUE(table_info->table_->GetTuple(rids[0], &row, &txn));
+    EXPECT_EQ(row.GetValue(&schema, 1).GetAs<int32_t>(), i);
+  }
+
+  std::string low = "user2@example.com";
+  std::string high = "user3@example.com";
+  std::vector<std::string> expected;
+  for (int i = 0; i < 2000; i++) {
+    if (email(i) >= low && email(i) <= high) {
+      expected.push_back(email(i));
+    }
+  }
+  std::sort(expected.begin(), expected.end());
+  Tuple low_key({ValueFactory::GetVarcharValue(low)}, index_key_schema);
+  Tuple high_key({ValueFactory::GetVarcharValue(high)}, index_key_schema);
+  for (bool reverse : {false, true}) {
+    auto iterator = index->ScanRange(&low_key, &high_key, reverse, &txn);
+    std::vector<std::string> emails;
+    Tuple key;
+    RID rid;
+    while (iterator->Next(&key, &rid)) {
+      emails.push_back(key.GetValue(index_key_schema, 0).ToString());
+    }
+    if (reverse) {
+      std::reverse(emails.begin(), emails.end());
+    }
+    EXPECT_EQ(emails, expected);
+  }
+
+  catalog.reset();
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+}
+
+// Nanoseconds per point lookup and per ten key range scan, against the varlen B+ tree with all of its pages cached
+TEST(AdaptiveRadixTreeTests, DISABLED_LookupBenchmark) {
+  auto disk_manager = std::make_unique<DiskManager>("test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(20000, disk_manager.get());
+  page_id_t header_page_id;
+  bpm->NewPage(&header_page_id);
+  VarlenBPlusTree b_plus_tree("foo_pk", bpm.get());
+  AdaptiveRadixTree art;
+
+  const size_t num_keys = 1000000;
+  std::vector<std::string> keys(num_keys);
+  for (size_t i = 0; i < num_keys; i++) {
+    keys[i] = TerminateKey("user" + std::to_string(i * 7919 % num_keys) + "@example.com");
+    b_plus_tree.Insert(keys[i], RID(0, i));
+    art.Insert(keys[i], RID(0, i));
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+
+  auto time_ns = [&](auto &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &key : keys) {
+      fn(key);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / num_keys;
+  };
+  auto point_ns = [&](auto *tree) {
+    return time_ns([tree](const std::string &key) {
+      std::vector<RID> rids;
+      tree->GetValue(key, &rids);
+      ASSERT_EQ(rids.size(), 1);
+    });
+  };
+  auto range_ns = [&](auto *tree) {
+    return time_ns([tree](const std::string &key) {
+      size_t count = 0;
+      for (auto iterator = tree->Begin(key); !iterator.IsEnd() && count < 10; ++iterator) {
+        count++;
+      }
+    });
+  };
+  LOG_INFO("%zu keys, point lookup: ART %.0f ns, B+ tree %.0f ns", num_keys, point_ns(&art), point_ns(&b_plus_tree));
+  LOG_INFO("10 key range scan: ART %.0f ns, B+ tree %.0f ns", range_ns(&art), range_ns(&b_plus_tree));
+
+  bpm->UnpinPage(header_page_id, true);
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub
@@ -10,10 +10,15 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>  // NOLINT
 #include <cstdio>
 #include <functional>
+#include <iostream>
+#include <random>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include "gtest/gtest.h"
@@ -333,4 +338,336 @@ TEST(BPlusTreeConcurrentTest, DISABLED_MixTest) {
   remove("test.log");
 }
 
+/*
+ * Small pages so that concurrent inserts and deletes keep splitting and merging pages at every level, while
+ * readers look up keys that must stay visible the whole time.
+ */
+TEST(BPlusTreeConcurrentTest, SplitMergeStressTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(256, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 4);
+  GenericKey<8> index_key;
+
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  const int num_threads = 8;
+  const int64_t scale = 4000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= scale; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+  LaunchParallelTest(num_threads, InsertHelperSplit, &tree, keys, num_threads);
+
+  std::vector<RID> rids;
+  for (int64_t key = 1; key <= scale; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(tree.GetValue(index_key, &rids)) << key;
+    EXPECT_EQ(rids[0].GetSlotNum(), key);
+  }
+
+  // remove the odd keys while the even ones are looked up
+  std::vector<int64_t> odd_keys;
+  for (auto key : keys) {
+    if (key % 2 == 1) {
+      odd_keys.push_back(key);
+    }
+  }
+  std::atomic<int> missing{0};
+  std::thread reader([&tree, &missing, scale] {
+    GenericKey<8> key;
+    std::vector<RID> result;
+    for (int round = 0; round < 4; round++) {
+      for (int64_t i = 2; i <= scale; i += 2) {
+        result.clear();
+        key.SetFromInteger(i);
+        if (!tree.GetValue(key, &result)) {
+          missing++;
+        }
+      }
+    }
+  });
+  LaunchParallelTest(num_threads, DeleteHelperSplit, &tree, odd_keys, num_threads);
+  reader.join();
+  EXPECT_EQ(missing, 0);
+
+  int64_t current_key = 2;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key += 2;
+  }
+  EXPECT_EQ(current_key, scale + 2);
+
+  LaunchParallelTest(num_threads, DeleteHelperSplit, &tree, keys, num_threads);
+  EXPECT_TRUE(tree.IsEmpty());
+  EXPECT_TRUE(tree.Begin() == tree.End());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * Lookups read pages without latching them and validate page versions instead. Keys that are in the tree the whole
+ * time must be found while writers keep splitting the pages they are read from.
+ */
+TEST(BPlusTreeConcurrentTest, OptimisticLookupTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(256, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 4);
+
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  const int64_t scale = 2000;
+  std::vector<int64_t> even_keys;
+  std::vector<int64_t> odd_keys;
+  for (int64_t key = 1; key <= scale; key++) {
+    (key % 2 == 0 ? even_keys : odd_keys).push_back(key);
+  }
+  InsertHelper(&tree, even_keys);
+
+  std::atomic<bool> done{false};
+  std::atomic<int> wrong{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&tree, &done, &wrong, &even_keys] {
+      GenericKey<8> index_key;
+      std::vector<RID> result;
+      do {
+        for (auto key : even_keys) {
+          result.clear();
+          index_key.SetFromInteger(key);
+          if (!tree.GetValue(index_key, &result) || result.size() != 1 || result[0].GetSlotNum() != key) {
+            wrong++;
+          }
+        }
+      } while (!done);
+    });
+  }
+  LaunchParallelTest(4, InsertHelperSplit, &tree, odd_keys, 4);
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(wrong, 0);
+
+  int64_t current_key = 1;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key++;
+  }
+  EXPECT_EQ(current_key, scale + 1);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * B-link mode: splits finish one level at a time while other writers and readers follow the right links of pages
+ * that split under them. Keys inserted before must stay visible, and every key must end up in order.
+ */
+TEST(BPlusTreeConcurrentTest, BLinkInsertTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(256, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 4, BPlusTreeMode::B_LINK);
+
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  const int num_threads = 8;
+  const int64_t scale = 4000;
+  std::vector<int64_t> preloaded_keys;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= scale; key++) {
+    (key % 10 == 0 ? preloaded_keys : keys).push_back(key);
+  }
+  InsertHelper(&tree, preloaded_keys);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+
+  std::atomic<bool> done{false};
+  std::atomic<int> wrong{0};
+  std::thread reader([&tree, &done, &wrong, &preloaded_keys] {
+    GenericKey<8> index_key;
+    std::vector<RID> result;
+    do {
+      for (auto key : preloaded_keys) {
+        result.clear();
+        index_key.SetFromInteger(key);
+        if (!tree.GetValue(index_key, &result) || result[0].GetSlotNum() != key) {
+          wrong++;
+        }
+      }
+    } while (!done);
+  });
+  LaunchParallelTest(num_threads, InsertHelperSplit, &tree, keys, num_threads);
+  done = true;
+  reader.join();
+  EXPECT_EQ(wrong, 0);
+
+  int64_t current_key = 1;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key++;
+  }
+  EXPECT_EQ(current_key, scale + 1);
+
+  // deletes don't merge pages, the tree keeps working once it is empty
+  LaunchParallelTest(num_threads, DeleteHelperSplit, &tree, keys, num_threads);
+  current_key = 10;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+    current_key += 10;
+  }
+  EXPECT_EQ(current_key, scale + 10);
+  DeleteHelper(&tree, preloaded_keys);
+  EXPECT_TRUE(tree.Begin() == tree.End());
+  InsertHelper(&tree, preloaded_keys);
+  std::vector<RID> rids;
+  for (auto key : preloaded_keys) {
+    rids.clear();
+    GenericKey<8> index_key;
+    index_key.SetFromInteger(key);
+    ASSERT_TRUE(tree.GetValue(index_key, &rids)) << key;
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * Append-heavy inserts with lock coupling and with B-link splits: all threads insert ascending keys, so they keep
+ * splitting the same rightmost pages. Crabbing writers serialize on the root latch for every split.
+ */
+TEST(BPlusTreeConcurrentTest, DISABLED_BLinkAppendBenchmark) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  const int64_t keys_per_thread = 50000;
+
+  for (auto mode : {BPlusTreeMode::CRABBING, BPlusTreeMode::B_LINK}) {
+    for (int num_threads = 1; num_threads <= 8; num_threads *= 2) {
+      DiskManager *disk_manager = new DiskManager("test.db");
+      BufferPoolManager *bpm = new BufferPoolManagerInstance(4096, disk_manager);
+      BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 128, 128, mode);
+      page_id_t page_id;
+      bpm->NewPage(&page_id);
+
+      auto worker = [&tree, num_threads, keys_per_thread](uint64_t thread_itr) {
+        GenericKey<8> index_key;
+        Transaction transaction(static_cast<txn_id_t>(thread_itr));
+        for (int64_t i = 0; i < keys_per_thread; i++) {
+          int64_t key = i * num_threads + static_cast<int64_t>(thread_itr);
+          index_key.SetFromInteger(key);
+          tree.Insert(index_key, RID(static_cast<int32_t>(key >> 32), static_cast<uint32_t>(key)), &transaction);
+        }
+      };
+
+      auto start = std::chrono::steady_clock::now();
+      LaunchParallelTest(num_threads, worker);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      double ops = static_cast<double>(num_threads) * keys_per_thread;
+      std::cout << (mode == BPlusTreeMode::B_LINK ? "b-link" : "crabbing") << " threads " << num_threads << ": "
+                << ops / elapsed.count() / 1000 << " kops/s" << std::endl;
+
+      bpm->UnpinPage(HEADER_PAGE_ID, true);
+      delete disk_manager;
+      delete bpm;
+      remove("test.db");
+      remove("test.log");
+    }
+  }
+}
+
+/*
+ * Throughput of a mixed point lookup / insert / delete workload on a preloaded tree, for a growing number of
+ * threads. Inserts and deletes touch keys outside the preloaded set so the tree size stays roughly constant.
+ */
+TEST(BPlusTreeConcurrentTest, DISABLED_ThroughputBenchmark) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  const int64_t preload = 100000;
+  const int ops_per_thread = 50000;
+  const std::vector<int> read_percents = {100, 90, 50};
+
+  for (int read_pct : read_percents) {
+    for (int num_threads = 1; num_threads <= 8; num_threads *= 2) {
+      DiskManager *disk_manager = new DiskManager("test.db");
+      BufferPoolManager *bpm = new BufferPoolManagerInstance(2048, disk_manager);
+      BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator);
+      page_id_t page_id;
+      bpm->NewPage(&page_id);
+
+      // preload the even keys, workers insert and delete odd ones
+      std::vector<int64_t> keys;
+      for (int64_t key = 0; key < preload; key++) {
+        keys.push_back(key * 2);
+      }
+      std::shuffle(keys.begin(), keys.end(), std::mt19937(15445));
+      InsertHelper(&tree, keys);
+
+      auto worker = [&tree, read_pct, preload, ops_per_thread](uint64_t thread_itr) {
+        std::mt19937_64 rng(thread_itr);
+        std::uniform_int_distribution<int64_t> key_dist(0, preload - 1);
+        std::uniform_int_distribution<int> op_dist(0, 99);
+        GenericKey<8> index_key;
+        std::vector<RID> result;
+        Transaction transaction(static_cast<txn_id_t>(thread_itr));
+        for (int i = 0; i < ops_per_thread; i++) {
+          int64_t key = key_dist(rng) * 2;
+          int op = op_dist(rng);
+          if (op < read_pct) {
+            result.clear();
+            index_key.SetFromInteger(key);
+            tree.GetValue(index_key, &result, &transaction);
+          } else {
+            index_key.SetFromInteger(key + 1);
+            if (op % 2 == 0) {
+              tree.Insert(index_key, RID(static_cast<int32_t>(key >> 32), static_cast<uint32_t>(key + 1)),
+                          &transaction);
+            } else {
+              tree.Remove(index_key, &transaction);
+            }
+          }
+        }
+      };
+
+      auto start = std::chrono::steady_clock::now();
+      LaunchParallelTest(num_threads, worker);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      double ops = static_cast<double>(num_threads) * ops_per_thread;
+      std::cout << "read " << read_pct << "% threads " << num_threads << ": " << ops / elapsed.count() / 1000
+                << " kops/s" << std::endl;
+
+      bpm->UnpinPage(HEADER_PAGE_ID, true);
+      delete disk_manager;
+      delete bpm;
+      remove("test.db");
+      remove("test.log");
+    }
+  }
+}
+
 }  // namespace bustub
@@ -12,8 +12,13 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <functional>
+#include <random>
+#include <utility>
+#include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
+#include "common/util/external_sorter.h"
 #include "gtest/gtest.h"
 #include "storage/index/b_plus_tree.h"
 #include "test_util.h"  // NOLINT
@@ -145,4 +150,255 @@ TEST(BPlusTreeTests, DISABLED_InsertTest2) {
   remove("test.db");
   remove("test.log");
 }
+
+TEST(BPlusTreeTests, BulkLoadTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  using Entry = std::pair<GenericKey<8>, RID>;
+  auto less = [&comparator](const Entry &a, const Entry &b) { return comparator(a.first, b.first) < 0; };
+
+  for (auto [leaf_max_size, internal_max_size] : {std::pair{3, 3}, std::pair{5, 4}}) {
+    for (int64_t num_keys : {1, 2, 3, 7, 100, 1000}) {
+      for (double fill_factor : {1.0, 0.5}) {
+        DiskManager *disk_manager = new DiskManager("test.db");
+        BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+        BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, leaf_max_size,
+                                                               internal_max_size);
+        Transaction *transaction = new Transaction(0);
+        page_id_t page_id;
+        auto header_page = bpm->NewPage(&page_id);
+        (void)header_page;
+
+        // even keys, each added twice and in reverse order, sorted in small runs that spill to disk; the RID added
+        // first is kept, like Insert keeps the first one
+        ExternalSorter<Entry, decltype(less)> sorter(less, true, 7);
+        Entry entry;
+        for (int round = 0; round < 2; round++) {
+          for (int64_t key = num_keys; key > 0; key--) {
+            entry.first.SetFromInteger(key * 2);
+            entry.second.Set(round, key * 2);
+            sorter.Add(entry);
+          }
+        }
+        sorter.Sort();
+        ASSERT_EQ(sorter.Size(), num_keys);
+        tree.BulkLoad(
+            sorter.Size(), [&sorter](Entry *entry) { return sorter.Next(entry); }, fill_factor);
+
+        GenericKey<8> index_key;
+        std::vector<RID> rids;
+        for (int64_t key = 1; key <= num_keys * 2; key++) {
+          rids.clear();
+          index_key.SetFromInteger(key);
+          tree.GetValue(index_key, &rids);
+          ASSERT_EQ(rids.size(), key % 2 == 0 ? 1 : 0)
+              << num_keys << " keys, fill " << fill_factor << ", leaf size " << leaf_max_size;
+          if (!rids.empty()) {
+            ASSERT_EQ(rids[0].GetPageId(), 0) << num_keys << " keys, key " << key;
+          }
+        }
+        int64_t current_key = 2;
+        for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+          ASSERT_EQ((*iterator).second.GetSlotNum(), current_key);
+          current_key += 2;
+        }
+        EXPECT_EQ(current_key, num_keys * 2 + 2);
+
+        // the loaded tree keeps working with regular inserts and removes
+        RID rid;
+        for (int64_t key = 1; key <= num_keys * 2; key += 2) {
+          index_key.SetFromInteger(key);
+          rid.Set(0, key);
+          tree.Insert(index_key, rid, transaction);
+        }
+        current_key = 1;
+        for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+          ASSERT_EQ((*iterator).second.GetSlotNum(), current_key);
+          current_key++;
+        }
+        EXPECT_EQ(current_key, num_keys * 2 + 1);
+        for (int64_t key = 1; key <= num_keys * 2; key++) {
+          index_key.SetFromInteger(key);
+          tree.Remove(index_key, transaction);
+        }
+        EXPECT_TRUE(tree.IsEmpty());
+
+        bpm->UnpinPage(HEADER_PAGE_ID, true);
+        delete transaction;
+        delete disk_manager;
+        delete bpm;
+        remove("test.db");
+        remove("test.log");
+      }
+    }
+  }
+}
+
+// Ascending keys go through the cached rightmost leaf, and splits of the rightmost pages leave them full
+TEST(BPlusTreeTests, AppendTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  for (auto mode : {BPlusTreeMode::CRABBING, BPlusTreeMode::B_LINK}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 11, 10, mode);
+    Transaction *transaction = new Transaction(0);
+    page_id_t page_id;
+    auto header_page = bpm->NewPage(&page_id);
+    (void)header_page;
+
+    const int64_t num_keys = 3000;
+    GenericKey<8> index_key;
+    RID rid;
+    for (int64_t key = 1; key <= num_keys; key++) {
+      index_key.SetFromInteger(key);
+      rid.Set(0, key);
+      ASSERT_TRUE(tree.Insert(index_key, rid, transaction));
+    }
+    index_key.SetFromInteger(num_keys);
+    EXPECT_FALSE(tree.Insert(index_key, rid, transaction));
+
+    // every leaf but the last holds 10 entries, a leaf splits once it has 11
+    int num_leaves = 0;
+    int64_t num_entries = 0;
+    Page *page = tree.FindLeafPage(index_key, true);
+    while (page != nullptr) {
+      auto *leaf = reinterpret_cast<BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>> *>(page->GetData());
+      num_leaves++;
+      num_entries += leaf->GetSize();
+      page_id_t next_page_id = leaf->GetNextPageId();
+      bpm->UnpinPage(page->GetPageId(), false);
+      page = next_page_id == INVALID_PAGE_ID ? nullptr : bpm->FetchPage(next_page_id);
+    }
+    EXPECT_EQ(num_entries, num_keys);
+    EXPECT_EQ(num_leaves, (num_keys + 9) / 10);
+
+    // drop the tail, merging the rightmost leaves away, then append past it again
+    for (int64_t key = num_keys; key > num_keys / 2; key--) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key, transaction);
+    }
+    for (int64_t key = num_keys / 2 + 1; key <= num_keys; key++) {
+      index_key.SetFromInteger(key * 2);
+      rid.Set(0, key * 2);
+      ASSERT_TRUE(tree.Insert(index_key, rid, transaction));
+    }
+    std::vector<RID> rids;
+    for (int64_t key = 1; key <= num_keys * 2; key++) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      bool expected = key <= num_keys / 2 || (key > num_keys && key % 2 == 0);
+      ASSERT_EQ(tree.GetValue(index_key, &rids), expected) << key;
+    }
+    int64_t count = 0;
+    for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+      count++;
+    }
+    EXPECT_EQ(count, num_keys);
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete transaction;
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
+TEST(BPlusTreeTests, ScanTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  for (auto mode : {BPlusTreeMode::CRABBING, BPlusTreeMode::B_LINK}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 4, 5, mode);
+    Transaction *transaction = new Transaction(0);
+    page_id_t page_id;
+    auto header_page = bpm->NewPage(&page_id);
+    (void)header_page;
+
+    GenericKey<8> index_key;
+    EXPECT_TRUE(tree.Begin() == tree.End());
+    EXPECT_TRUE(tree.RBegin() == tree.End());
+
+    // the odd keys below 2 * num_keys
+    const int64_t num_keys = 200;
+    std::vector<int64_t> keys;
+    for (int64_t key = 1; key < 2 * num_keys; key += 2) {
+      keys.push_back(key);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+    RID rid;
+    for (auto key : keys) {
+      index_key.SetFromInteger(key);
+      rid.Set(0, key);
+      ASSERT_TRUE(tree.Insert(index_key, rid, transaction));
+    }
+
+    // scan from every key and every gap, both ways
+    auto check = [&](const std::function<bool(int64_t)> &present, int64_t *count) {
+      for (int64_t start = 0; start <= 2 * num_keys; start++) {
+        index_key.SetFromInteger(start);
+        int64_t expected = start;
+        for (auto iterator = tree.Begin(index_key); iterator != tree.End(); ++iterator, ++expected) {
+          while (!present(expected)) {
+            expected++;
+          }
+          ASSERT_EQ((*iterator).first.ToString(), expected) << "from " << start;
+          ASSERT_EQ((*iterator).second.GetSlotNum(), expected);
+        }
+        while (expected < 2 * num_keys && !present(expected)) {
+          expected++;
+        }
+        EXPECT_EQ(expected, 2 * num_keys) << "from " << start;
+
+        expected = start;
+        for (auto iterator = tree.RBegin(index_key); iterator != tree.End(); ++iterator, --expected) {
+          while (!present(expected)) {
+            expected--;
+          }
+          ASSERT_EQ((*iterator).first.ToString(), expected) << "down from " << start;
+        }
+        while (expected > 0 && !present(expected)) {
+          expected--;
+        }
+        EXPECT_EQ(expected, 0) << "down from " << start;
+      }
+      int64_t previous = 2 * num_keys;
+      for (auto iterator = tree.RBegin(); iterator != tree.End(); ++iterator, ++*count) {
+        ASSERT_LT((*iterator).first.ToString(), previous);
+        previous = (*iterator).first.ToString();
+      }
+    };
+    int64_t count = 0;
+    check([](int64_t key) { return key % 2 == 1; }, &count);
+    EXPECT_EQ(count, num_keys);
+
+    // empty out whole leaves, which merges them away in crabbing mode
+    for (int64_t key = 1; key < 2 * num_keys; key += 2) {
+      if (key % 40 < 20 || key > 3 * num_keys / 2) {
+        index_key.SetFromInteger(key);
+        tree.Remove(index_key, transaction);
+      }
+    }
+    auto present = [](int64_t key) { return key % 2 == 1 && key % 40 >= 20 && key <= 3 * num_keys / 2; };
+    int64_t remaining = 0;
+    for (int64_t key = 0; key < 2 * num_keys; key++) {
+      remaining += present(key) ? 1 : 0;
+    }
+    count = 0;
+    check(present, &count);
+    EXPECT_EQ(count, remaining);
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete transaction;
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
 }  // namespace bustub
@@ -0,0 +1,216 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_normalized_key_test.cpp
+//
+// Identification: test/storage/b_plus_tree_normalized_key_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree.h"
+#include "storage/index/b_plus_tree_index.h"
+#include "storage/index/normalized_key.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+// Normalized keys must order like their values, column by column
+TEST(BPlusTreeTests, NormalizedKeyOrderTest) {
+  std::vector<Column> columns;
+  columns.emplace_back("a", TypeId::INTEGER);
+  columns.emplace_back("b", TypeId::VARCHAR, 16);
+  columns.emplace_back("c", TypeId::DECIMAL);
+  Schema key_schema(columns);
+  NormalizedComparator<32> comparator(&key_schema);
+
+  std::vector<int32_t> ints{-100000, -1, 0, 1, 7, 100000};
+  std::vector<std::string> strings{"", std::string(1, '\0'), "a", std::string("a\0b", 3), "ab", "b"};
+  std::vector<double> decimals{-2.5, -0.5, 0.0, 0.25, 3.0};
+  std::vector<std::vector<Value>> rows;
+  for (auto a : ints) {
+    for (const auto &b : strings) {
+      for (auto c : decimals) {
+        rows.push_back({ValueFactory::GetIntegerValue(a), ValueFactory::GetVarcharValue(b),
+                        ValueFactory::GetDecimalValue(c)});
+      }
+    }
+  }
+
+  // rows were generated in ascending order
+  NormalizedKey<32> lhs;
+  NormalizedKey<32> rhs;
+  for (size_t i = 0; i < rows.size(); i++) {
+    lhs.SetFromKey(Tuple(rows[i], &key_schema), &key_schema);
+    for (size_t j = 0; j < rows.size(); j++) {
+      rhs.SetFromKey(Tuple(rows[j], &key_schema), &key_schema);
+      int cmp = comparator(lhs, rhs);
+      ASSERT_EQ(cmp < 0, i < j) << i << " " << j;
+      ASSERT_EQ(cmp == 0, i == j) << i << " " << j;
+      if (i < j) {
+        auto separator = NormalizedComparator<32>::Separator(lhs, rhs);
+        ASSERT_LT(comparator(lhs, separator), 0);
+        ASSERT_LE(comparator(separator, rhs), 0);
+      }
+    }
+  }
+}
+
+// Decoding a normalized key must give back the values it was built from
+TEST(BPlusTreeTests, NormalizedKeyDecodeTest) {
+  std::vector<Column> columns;
+  columns.emplace_back("a", TypeId::SMALLINT);
+  columns.emplace_back("b", TypeId::VARCHAR, 16);
+  columns.emplace_back("c", TypeId::BIGINT);
+  columns.emplace_back("d", TypeId::DECIMAL);
+  columns.emplace_back("e", TypeId::BOOLEAN);
+  Schema key_schema(columns);
+
+  std::vector<std::vector<Value>> rows{
+      {ValueFactory::GetSmallIntValue(-7), ValueFactory::GetVarcharValue(std::string("x\0y", 3)),
+       ValueFactory::GetBigIntValue(-1234567890123), ValueFactory::GetDecimalValue(-2.5),
+       ValueFactory::GetBooleanValue(true)},
+      {ValueFactory::GetSmallIntValue(300), ValueFactory::GetVarcharValue(""), ValueFactory::GetBigIntValue(42),
+       ValueFactory::GetDecimalValue(0.125), ValueFactory::GetBooleanValue(false)},
+  };
+  NormalizedKey<64> key;
+  for (const auto &row : rows) {
+    key.SetFromKey(Tuple(row, &key_schema), &key_schema);
+    for (uint32_t i = 0; i < row.size(); i++) {
+      EXPECT_EQ(key.ToValue(&key_schema, i).CompareEquals(row[i]), CmpBool::CmpTrue) << i;
+    }
+  }
+}
+
+TEST(BPlusTreeTests, NormalizedKeyTreeTest) {
+  NormalizedComparator<8> comparator;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  BPlusTree<NormalizedKey<8>, RID, NormalizedComparator<8>> tree("foo_pk", bpm, comparator, 4, 4);
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  std::vector<int64_t> keys;
+  for (int64_t key = -500; key < 500; key++) {
+    keys.push_back(key * 1000003);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+  NormalizedKey<8> index_key;
+  RID rid;
+  for (auto key : keys) {
+    index_key.SetFromInteger(key);
+    rid.Set(0, static_cast<int32_t>(key / 1000003 + 500));
+    EXPECT_TRUE(tree.Insert(index_key, rid, transaction));
+  }
+
+  std::sort(keys.begin(), keys.end());
+  auto expected = keys.begin();
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator, ++expected) {
+    ASSERT_NE(expected, keys.end());
+    EXPECT_EQ((*iterator).first.ToString(), *expected);
+  }
+  EXPECT_EQ(expected, keys.end());
+
+  std::vector<RID> rids;
+  for (size_t i = 0; i < keys.size(); i += 2) {
+    index_key.SetFromInteger(keys[i]);
+    tree.Remove(index_key, transaction);
+  }
+  for (size_t i = 0; i < keys.size(); i++) {
+    rids.clear();
+    index_key.SetFromInteger(keys[i]);
+    tree.GetValue(index_key, &rids);
+    ASSERT_EQ(rids.size(), i % 2);
+    if (i % 2 == 1) {
+      EXPECT_EQ(rids[0].GetSlotNum(), keys[i] / 1000003 + 500);
+    }
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// Range scans through the index return the keys in the range, in either order
+TEST(BPlusTreeTests, IndexRangeScanTest) {
+  std::vector<Column> columns;
+  columns.emplace_back("a", TypeId::INTEGER);
+  columns.emplace_back("b", TypeId::VARCHAR, 16);
+  Schema table_schema(columns);
+  auto metadata = std::make_unique<IndexMetadata>("foo_pk", "foo", &table_schema, std::vector<uint32_t>{0});
+  Schema *key_schema = metadata->GetKeySchema();
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  BPlusTreeIndex<NormalizedKey<8>, RID, NormalizedComparator<8>> index(std::move(metadata), bpm);
+  EXPECT_TRUE(index.SupportsRangeScan());
+  EXPECT_TRUE(index.ReturnsKeys());
+
+  auto make_key = [key_schema](int32_t a) { return Tuple({ValueFactory::GetIntegerValue(a)}, key_schema); };
+  for (int32_t a = -1000; a < 1000; a += 3) {
+    index.InsertEntry(make_key(a), RID(0, static_cast<uint32_t>(a + 1000)), nullptr);
+  }
+
+  auto scan = [&](const Tuple *low, const Tuple *high, bool reverse) {
+    std::vector<int32_t> result;
+    auto iterator = index.ScanRange(low, high, reverse, nullptr);
+    Tuple key;
+    RID rid;
+    while (iterator->Next(&key, &rid)) {
+      int32_t a = key.GetValue(key_schema, 0).GetAs<int32_t>();
+      EXPECT_EQ(rid.GetSlotNum(), static_cast<uint32_t>(a + 1000));
+      result.push_back(a);
+    }
+    return result;
+  };
+  auto expected = [](int32_t low, int32_t high, bool reverse) {
+    std::vector<int32_t> result;
+    for (int32_t a = -1000; a < 1000; a += 3) {
+      if (a >= low && a <= high) {
+        result.push_back(a);
+      }
+    }
+    if (reverse) {
+      std::reverse(result.begin(), result.end());
+    }
+    return result;
+  };
+
+  for (bool reverse : {false, true}) {
+    EXPECT_EQ(scan(nullptr, nullptr, reverse), expected(INT32_MIN, INT32_MAX, reverse));
+    for (auto [low, high] : {std::pair{-500, 500}, std::pair{-499, -2}, std::pair{2, 2}, std::pair{1, 1}}) {
+      Tuple low_key = make_key(low);
+      Tuple high_key = make_key(high);
+      EXPECT_EQ(scan(&low_key, &high_key, reverse), expected(low, high, reverse)) << low << " " << high;
+      EXPECT_EQ(scan(&low_key, nullptr, reverse), expected(low, INT32_MAX, reverse)) << low;
+      EXPECT_EQ(scan(nullptr, &high_key, reverse), expected(INT32_MIN, high, reverse)) << high;
+    }
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub
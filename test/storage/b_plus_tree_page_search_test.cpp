@@ -0,0 +1,124 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_page_search_test.cpp
+//
+// Identification: test/storage/b_plus_tree_page_search_test.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "common/rid.h"
+#include "gtest/gtest.h"
+#include "storage/index/generic_key.h"
+#include "storage/page/b_plus_tree_search.h"
+#include "test_util.h"  // NOLINT
+
+namespace bustub {
+
+/** Sorted entries whose keys start with one of a few heads, so that equal heads are common. */
+template <size_t KeySize>
+std::vector<std::pair<NormalizedKey<KeySize>, RID>> MakeEntries(size_t num_entries, std::mt19937 *rng) {
+  NormalizedComparator<KeySize> comparator;
+  std::vector<std::pair<NormalizedKey<KeySize>, RID>> entries(num_entries);
+  for (auto &entry : entries) {
+    for (size_t i = 0; i < KeySize; i++) {
+      entry.first.data_[i] = static_cast<char>(i < KeySize / 2 ? (*rng)() % 3 : (*rng)());
+    }
+  }
+  std::sort(entries.begin(), entries.end(),
+            [&comparator](const auto &a, const auto &b) { return comparator(a.first, b.first) < 0; });
+  return entries;
+}
+
+template <size_t KeySize>
+void CheckSearch() {
+  std::mt19937 rng(KeySize);
+  NormalizedComparator<KeySize> comparator;
+  for (size_t num_entries : {0, 1, 3, 4, 5, 17, 64, 255, 300}) {
+    auto entries = MakeEntries<KeySize>(num_entries, &rng);
+    auto probes = MakeEntries<KeySize>(200, &rng);
+    for (const auto &entry : entries) {
+      probes.push_back(entry);
+    }
+    const auto *first = entries.data();
+    const auto *last = first + entries.size();
+    for (const auto &probe : probes) {
+      for (bool upper : {false, true}) {
+        ASSERT_EQ(KeySearch<NormalizedComparator<KeySize>>::Search(first, last, probe.first, comparator, upper),
+                  ScalarKeySearch::Search(first, last, probe.first, comparator, upper))
+            << "key size " << KeySize << ", " << num_entries << " entries, upper " << upper;
+      }
+    }
+  }
+}
+
+// The specialized search must find the same entries as the scalar binary search
+TEST(BPlusTreePageSearchTest, NormalizedKeySearchTest) {
+  CheckSearch<4>();
+  CheckSearch<8>();
+  CheckSearch<16>();
+  CheckSearch<64>();
+}
+
+template <typename Entry, typename KeyType, typename Search>
+double TimeSearch(const std::vector<Entry> &entries, const std::vector<KeyType> &keys, Search search) {
+  size_t found = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < 20; round++) {
+    for (const auto &key : keys) {
+      found += search(entries.data(), entries.data() + entries.size(), key) - entries.data();
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_GT(found, 0);
+  return elapsed.count() / (20.0 * keys.size());
+}
+
+// Lookups in a full leaf of bigint keys: the generic key, and normalized keys with the scalar and specialized search
+TEST(BPlusTreePageSearchTest, DISABLED_SearchBenchmark) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> generic_comparator(key_schema.get());
+  NormalizedComparator<8> comparator;
+  constexpr int leaf_size = (PAGE_SIZE - 28) / sizeof(std::pair<NormalizedKey<8>, RID>);
+
+  std::vector<std::pair<GenericKey<8>, RID>> generic_entries(leaf_size);
+  std::vector<std::pair<NormalizedKey<8>, RID>> entries(leaf_size);
+  for (int i = 0; i < leaf_size; i++) {
+    generic_entries[i].first.SetFromInteger(i * 2);
+    entries[i].first.SetFromInteger(i * 2);
+  }
+  std::mt19937 rng(0);
+  std::vector<GenericKey<8>> generic_keys(1 << 16);
+  std::vector<NormalizedKey<8>> keys(1 << 16);
+  for (size_t i = 0; i < keys.size(); i++) {
+    int64_t key = rng() % (2 * leaf_size);
+    generic_keys[i].SetFromInteger(key);
+    keys[i].SetFromInteger(key);
+  }
+
+  double generic_ns = TimeSearch(generic_entries, generic_keys, [&](auto first, auto last, const auto &key) {
+    return ScalarKeySearch::Search(first, last, key, generic_comparator, false);
+  });
+  double scalar_ns = TimeSearch(entries, keys, [&](auto first, auto last, const auto &key) {
+    return ScalarKeySearch::Search(first, last, key, comparator, false);
+  });
+  double specialized_ns = TimeSearch(entries, keys, [&](auto first, auto last, const auto &key) {
+    return KeySearch<NormalizedComparator<8>>::Search(first, last, key, comparator, false);
+  });
+  std::cout << leaf_size << " entries per leaf" << std::endl;
+  std::cout << "generic key, binary search:        " << generic_ns << " ns/lookup" << std::endl;
+  std::cout << "normalized key, binary search:     " << scalar_ns << " ns/lookup" << std::endl;
+  std::cout << "normalized key, specialized search: " << specialized_ns << " ns/lookup" << std::endl;
+}
+
+}  // namespace bustub
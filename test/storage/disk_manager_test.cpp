@@ -10,7 +10,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <cstdint>
 #include <cstring>
+#include <filesystem>  // NOLINT
+#include <fstream>
+#include <string>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
@@ -23,14 +27,23 @@ class DiskManagerTest : public ::testing::Test {
   // This function is called before every test.
   void SetUp() override {
     remove("test.db");
-    remove("test.log");
+    RemoveLogSegments();
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
-    remove("test.log");
+    RemoveLogSegments();
   };
+
+  // Remove every "test.log.*" segment and spare file.
+  static void RemoveLogSegments() {
+    for (const auto &entry : std::filesystem::directory_iterator(".")) {
+      if (entry.path().filename().string().rfind("test.log", 0) == 0) {
+        std::filesystem::remove(entry.path());
+      }
+    }
+  }
 };
 
 // NOLINTNEXTLINE
@@ -72,6 +85,84 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LogSegmentTest) {
+  const int segment_size = 64;
+  char buf[160] = {0};
+  char data[160] = {0};
+  char other[160] = {0};
+  for (int i = 0; i < 160; i++) {
+    data[i] = static_cast<char>(i + 1);
+  }
+  auto dm = DiskManager("test.db", segment_size);
+
+  // a write spanning three segments reads back as one contiguous stream
+  dm.WriteLog(data, sizeof(data));
+  EXPECT_EQ(dm.GetLogTailOffset(), 160);
+  EXPECT_TRUE(std::filesystem::exists("test.log.2"));
+  EXPECT_EQ(std::filesystem::file_size("test.log.2"), segment_size);
+  EXPECT_TRUE(dm.ReadLog(buf, sizeof(buf), 0));
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  EXPECT_TRUE(dm.ReadLog(buf, 40, 50));
+  EXPECT_EQ(std::memcmp(buf, data + 50, 40), 0);
+
+  // the padded rest of a switched segment reads as zeros
+  dm.SwitchLogSegment();
+  EXPECT_EQ(dm.GetLogTailOffset(), 3 * segment_size);
+  EXPECT_TRUE(dm.ReadLog(buf, 32, 160));
+  EXPECT_EQ(buf[0], 0);
+  EXPECT_EQ(buf[31], 0);
+
+  // recycled segments disappear from the readable range and are reused by later writes
+  dm.RecycleLogSegments(3 * segment_size);
+  EXPECT_EQ(dm.GetLogStartOffset(), 3 * segment_size);
+  EXPECT_FALSE(dm.ReadLog(buf, 16, 0));
+  EXPECT_FALSE(std::filesystem::exists("test.log.0"));
+  EXPECT_TRUE(std::filesystem::exists("test.log.spare.0"));
+  dm.WriteLog(other, segment_size);
+  EXPECT_TRUE(std::filesystem::exists("test.log.3"));
+  EXPECT_TRUE(dm.ReadLog(buf, segment_size, 3 * segment_size));
+  EXPECT_EQ(std::memcmp(buf, other, segment_size), 0);
+  dm.ShutDown();
+
+  // a restarted log keeps the retained segments and continues in a fresh one
+  auto dm2 = DiskManager("test.db", segment_size);
+  EXPECT_EQ(dm2.GetLogStartOffset(), 3 * segment_size);
+  EXPECT_EQ(dm2.GetLogTailOffset(), 4 * segment_size);
+  EXPECT_TRUE(dm2.ReadLog(buf, segment_size, 3 * segment_size));
+  EXPECT_EQ(std::memcmp(buf, other, segment_size), 0);
+  dm2.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LargeLogOffsetTest) {
+  const int segment_size = 64;
+  char buf[160] = {0};
+  char data[160] = {0};
+  for (int i = 0; i < 160; i++) {
+    data[i] = static_cast<char>(i + 1);
+  }
+  // a segment left behind by a run that logged 4 GiB
+  const int64_t segment_no = (int64_t{1} << 32) / segment_size;
+  std::fstream("test.log." + std::to_string(segment_no), std::ios::binary | std::ios::out).close();
+  auto dm = DiskManager("test.db", segment_size);
+  EXPECT_EQ(dm.GetLogStartOffset(), segment_no * segment_size);
+  EXPECT_EQ(dm.GetLogTailOffset(), (segment_no + 1) * segment_size);
+
+  int64_t offset = dm.GetLogTailOffset();
+  dm.WriteLog(data, sizeof(data));
+  EXPECT_EQ(dm.GetLogTailOffset(), offset + 160);
+  EXPECT_TRUE(dm.ReadLog(buf, sizeof(buf), offset));
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+
+  dm.RecycleLogSegments(offset + 2 * segment_size);
+  EXPECT_EQ(dm.GetLogStartOffset(), offset + 2 * segment_size);
+  EXPECT_FALSE(dm.ReadLog(buf, 16, offset));
+  EXPECT_TRUE(dm.ReadLog(buf, 32, offset + 2 * segment_size));
+  EXPECT_EQ(std::memcmp(buf, data + 2 * segment_size, 32), 0);
+  dm.ShutDown();
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
@@ -0,0 +1,275 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// varlen_b_plus_tree_test.cpp
+//
+// Identification: test/storage/varlen_b_plus_tree_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/index/b_plus_tree_index.h"
+#include "storage/index/varlen_b_plus_tree_index.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+/** Keys of random lengths, some past the inline size and some sharing an inline size long prefix. */
+std::vector<std::string> MakeVarlenKeys(size_t num_keys, std::mt19937 *rng) {
+  std::string long_prefix(BPlusTreeSlottedPage::MAX_INLINE_KEY_SIZE + 10, 'p');
+  std::vector<std::string> keys;
+  while (keys.size() < num_keys) {
+    std::string key;
+    switch ((*rng)() % 10) {
+      case 0:
+        key = long_prefix;
+        break;
+      case 1:
+        key = std::string((*rng)() % (3 * PAGE_SIZE), 'q');
+        break;
+      default:
+        break;
+    }
+    size_t length = (*rng)() % 40;
+    for (size_t i = 0; i < length; i++) {
+      key.push_back(static_cast<char>((*rng)() % 4 == 0 ? '\0' : 'a' + (*rng)() % 26));
+    }
+    keys.push_back(std::move(key));
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  std::shuffle(keys.begin(), keys.end(), *rng);
+  return keys;
+}
+
+// Scanning from every kept key must return the keys in order, either way
+void CheckVarlenScans(VarlenBPlusTree *tree, const std::vector<std::string> &sorted_keys) {
+  std::vector<std::string> scanned;
+  for (auto iterator = tree->Begin(); !iterator.IsEnd(); ++iterator) {
+    scanned.push_back((*iterator).first);
+  }
+  ASSERT_EQ(scanned, sorted_keys);
+  scanned.clear();
+  for (auto iterator = tree->RBegin(); !iterator.IsEnd(); ++iterator) {
+    scanned.push_back((*iterator).first);
+  }
+  ASSERT_TRUE(std::equal(scanned.begin(), scanned.end(), sorted_keys.rbegin(), sorted_keys.rend()));
+
+  for (size_t i = 0; i < sorted_keys.size(); i += 7) {
+    auto forward = tree->Begin(sorted_keys[i]);
+    auto reverse = tree->RBegin(sorted_keys[i]);
+    for (size_t j = 0; j < 3; j++) {
+      if (i + j < sorted_keys.size()) {
+        ASSERT_FALSE(forward.IsEnd());
+        ASSERT_EQ((*forward).first, sorted_keys[i + j]);
+        ++forward;
+      }
+      if (i >= j) {
+        ASSERT_FALSE(reverse.IsEnd());
+        ASSERT_EQ((*reverse).first, sorted_keys[i - j]);
+        ++reverse;
+      }
+    }
+    // start between two keys
+    auto after = tree->Begin(sorted_keys[i] + '\0');
+    ASSERT_EQ(after.IsEnd(), i + 1 == sorted_keys.size());
+    if (!after.IsEnd()) {
+      ASSERT_EQ((*after).first, sorted_keys[i + 1]);
+    }
+  }
+}
+
+TEST(VarlenBPlusTreeTests, InsertScanRemoveTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(30, disk_manager);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  VarlenBPlusTree tree("foo_pk", bpm);
+
+  std::mt19937 rng(11);
+  auto keys = MakeVarlenKeys(3000, &rng);
+  for (size_t i = 0; i < keys.size(); i++) {
+    ASSERT_TRUE(tree.Insert(keys[i], RID(0, i)));
+  }
+  EXPECT_FALSE(tree.Insert(keys[0], RID(0, 0)));
+
+  std::vector<RID> rids;
+  for (size_t i = 0; i < keys.size(); i++) {
+    rids.clear();
+    ASSERT_TRUE(tree.GetValue(keys[i], &rids));
+    ASSERT_EQ(rids[0].GetSlotNum(), i);
+  }
+  EXPECT_FALSE(tree.GetValue(keys[0] + "missing", &rids));
+
+  auto sorted_keys = keys;
+  std::sort(sorted_keys.begin(), sorted_keys.end());
+  CheckVarlenScans(&tree, sorted_keys);
+
+  // empty out whole leaves, scans have to step over them
+  std::vector<std::string> kept;
+  for (size_t i = 0; i < sorted_keys.size(); i++) {
+    if (i % 3 != 0 || (i / 200) % 2 == 1) {
+      tree.Remove(sorted_keys[i]);
+    } else {
+      kept.push_back(sorted_keys[i]);
+    }
+  }
+  CheckVarlenScans(&tree, kept);
+  for (size_t i = 0; i < sorted_keys.size(); i++) {
+    rids.clear();
+    ASSERT_EQ(tree.GetValue(sorted_keys[i], &rids), std::binary_search(kept.begin(), kept.end(), sorted_keys[i]));
+  }
+
+  // the freed space is reused
+  for (const auto &key : sorted_keys) {
+    tree.Insert(key, RID(0, 0));
+  }
+  CheckVarlenScans(&tree, sorted_keys);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(VarlenBPlusTreeTests, ConcurrentInsertTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  VarlenBPlusTree tree("foo_pk", bpm);
+
+  std::mt19937 rng(5);
+  auto keys = MakeVarlenKeys(4000, &rng);
+  std::vector<std::thread> threads;
+  for (size_t thread = 0; thread < 4; thread++) {
+    threads.emplace_back([&, thread] {
+      std::vector<RID> rids;
+      for (size_t i = thread; i < keys.size(); i += 4) {
+        tree.Insert(keys[i], RID(0, i));
+        tree.GetValue(keys[i / 2], &rids);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::vector<RID> rids;
+  for (size_t i = 0; i < keys.size(); i++) {
+    rids.clear();
+    ASSERT_TRUE(tree.GetValue(keys[i], &rids));
+    ASSERT_EQ(rids[0].GetSlotNum(), i);
+  }
+  std::sort(keys.begin(), keys.end());
+  CheckVarlenScans(&tree, keys);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+// A varchar index stores its keys in far fewer pages than a fixed size key index, and returns them whole
+TEST(VarlenBPlusTreeTests, VarcharIndexTest) {
+  std::vector<Column> columns;
+  columns.emplace_back("email", TypeId::VARCHAR, 128);
+  columns.emplace_back("id", TypeId::INTEGER);
+  Schema table_schema(columns);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  auto make_key = [](Schema *key_schema, int i) {
+    return Tuple({ValueFactory::GetVarcharValue("user" + std::to_string(i) + "@example.com")}, key_schema);
+  };
+  // the number of pages an index takes, page ids are not reused
+  auto count_pages = [&](Index *index, const std::vector<int> &ids) {
+    page_id_t first_page_id;
+    bpm->NewPage(&first_page_id);
+    bpm->UnpinPage(first_page_id, false);
+    for (int i : ids) {
+      index->InsertEntry(make_key(index->GetKeySchema(), i), RID(0, i), nullptr);
+    }
+    page_id_t last_page_id;
+    bpm->NewPage(&last_page_id);
+    bpm->UnpinPage(last_page_id, false);
+    return last_page_id - first_page_id - 1;
+  };
+  std::vector<int> ids(5000);
+  for (size_t i = 0; i < ids.size(); i++) {
+    ids[i] = static_cast<int>(i);
+  }
+  std::shuffle(ids.begin(), ids.end(), std::mt19937(3));
+
+  VarlenBPlusTreeIndex index(std::make_unique<IndexMetadata>("email_idx", "users", &table_schema,
+                                                             std::vector<uint32_t>{0}),
+                             bpm);
+  BPlusTreeIndex<GenericKey<64>, RID, GenericComparator<64>> generic_index(
+      std::make_unique<IndexMetadata>("email_generic_idx", "users", &table_schema, std::vector<uint32_t>{0}), bpm);
+  int pages = count_pages(&index, ids);
+  int generic_pages = count_pages(&generic_index, ids);
+  EXPECT_LT(2 * pages, generic_pages) << pages << " pages, " << generic_pages << " with GenericKey<64>";
+
+  Schema *key_schema = index.GetKeySchema();
+  std::vector<RID> rids;
+  index.ScanKey(make_key(key_schema, 4321), &rids, nullptr);
+  ASSERT_EQ(rids.size(), 1);
+  EXPECT_EQ(rids[0].GetSlotNum(), 4321);
+
+  EXPECT_TRUE(index.ReturnsKeys());
+  std::string low = "user2@example.com";
+  std::string high = "user3@example.com";
+  std::vector<std::string> expected;
+  for (int i : ids) {
+    std::string email = "user" + std::to_string(i) + "@example.com";
+    if (email >= low && email <= high) {
+      expected.push_back(email);
+    }
+  }
+  std::sort(expected.begin(), expected.end());
+  Tuple low_key({ValueFactory::GetVarcharValue(low)}, key_schema);
+  Tuple high_key({ValueFactory::GetVarcharValue(high)}, key_schema);
+  for (bool reverse : {false, true}) {
+    auto iterator = index.ScanRange(&low_key, &high_key, reverse, nullptr);
+    std::vector<std::string> emails;
+    Tuple key;
+    RID rid;
+    while (iterator->Next(&key, &rid)) {
+      std::string email = key.GetValue(key_schema, 0).ToString();
+      EXPECT_EQ(email, "user" + std::to_string(rid.GetSlotNum()) + "@example.com");
+      emails.push_back(email);
+    }
+    if (reverse) {
+      std::reverse(emails.begin(), emails.end());
+    }
+    EXPECT_EQ(emails, expected);
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub